@@ -23,16 +23,21 @@
 #include "libstoragemgmt_types.h"
 
 #include "libstoragemgmt_accessgroups.h"
+#include "libstoragemgmt_batch.h"
 #include "libstoragemgmt_battery.h"
 #include "libstoragemgmt_blockrange.h"
 #include "libstoragemgmt_capabilities.h"
 #include "libstoragemgmt_disk.h"
 #include "libstoragemgmt_error.h"
+#include "libstoragemgmt_event.h"
 #include "libstoragemgmt_fs.h"
 #include "libstoragemgmt_local_disk.h"
+#include "libstoragemgmt_multi.h"
 #include "libstoragemgmt_nfsexport.h"
 #include "libstoragemgmt_pool.h"
+#include "libstoragemgmt_record_set.h"
 #include "libstoragemgmt_snapshot.h"
+#include "libstoragemgmt_stream.h"
 #include "libstoragemgmt_systems.h"
 #include "libstoragemgmt_targetport.h"
 #include "libstoragemgmt_volumes.h"
@@ -559,6 +564,55 @@ int LSM_DLL_EXPORT lsm_pool_list(lsm_connect *conn, char *search_key,
                                  char *search_value, lsm_pool **pool_array[],
                                  uint32_t *count, lsm_flag flags);
 
+/**
+ * lsm_pool_list_fields - Query the list of storage pools, with only some of
+ * their properties.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_pool_list(), but the plugin only sends, and when it can
+ *      only retrieves, the properties named in fields. Their names are those
+ *      of the Python API lsm.Pool properties: "name", "element_type",
+ *      "unsupported_actions", "total_space", "free_space", "status",
+ *      "status_info", "system_id" and "plugin_data". The pool ID is always
+ *      included.
+ *      The getter of a property not asked for returns an empty string,
+ *      LSM_POOL_STATUS_UNKNOWN for lsm_pool_status_get() and 0 for the
+ *      others.
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ * @search_key:
+ *      Search key(NULL for all). Valid search keys are: "id", "system_id".
+ * @search_value:
+ *      Search value.
+ * @fields:
+ *      Properties to retrieve, NULL for all of them like lsm_pool_list().
+ * @pool_array:
+ *      Output pointer of lsm_pool array. It should be manually freed by
+ *      lsm_pool_record_array_free().
+ * @count:
+ *      Output pointer of uint32_t. Number of storage pools.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number'.
+ *          * LSM_ERR_OK
+ *              On success or searched value not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL or invalid flags or invalid search
+ *              key or unknown property in fields.
+ */
+int LSM_DLL_EXPORT lsm_pool_list_fields(lsm_connect *conn,
+                                        const char *search_key,
+                                        const char *search_value,
+                                        lsm_string_list *fields,
+                                        lsm_pool **pool_array[],
+                                        uint32_t *count, lsm_flag flags);
+
 /**
  * lsm_volume_list - Gets a list of volumes on this connection.
  *
@@ -610,6 +664,60 @@ int LSM_DLL_EXPORT lsm_volume_list(lsm_connect *conn, const char *search_key,
                                    lsm_volume **volumes[], uint32_t *count,
                                    lsm_flag flags);
 
+/**
+ * lsm_volume_list_fields - Gets a list of volumes, with only some of their
+ * properties.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_list(), but the plugin only sends, and when it can
+ *      only retrieves, the properties named in fields. Their names are those
+ *      of the Python API lsm.Volume properties: "name", "vpd83",
+ *      "block_size", "num_of_blocks", "admin_state", "system_id", "pool_id"
+ *      and "plugin_data". The volume ID is always included.
+ *      For a property not asked for, lsm_volume_vpd83_get() returns NULL,
+ *      the other string getters an empty string, the size getters 0 and
+ *      lsm_volume_admin_state_get() LSM_VOLUME_ADMIN_STATE_ENABLED.
+ *
+ * Capability:
+ *      LSM_CAP_VOLUMES
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ * @search_key:
+ *      Search key(NULL for all).
+ *      Valid search keys are: "id", "system_id" and "pool_id".
+ * @search_value:
+ *      Search value.
+ * @fields:
+ *      Properties to retrieve, NULL for all of them like lsm_volume_list().
+ * @volumes:
+ *      Output pointer of lsm_volume array. It should be manually freed by
+ *      lsm_volume_record_array_free().
+ * @count:
+ *      Output pointer of uint32_t. Number of volumes.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number'.
+ *          * LSM_ERR_OK
+ *              On success or searched value not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL or invalid flags or invalid search
+ *              key or unknown property in fields.
+ *          * LSM_ERR_NO_SUPPORT
+ *              Not supported.
+ */
+int LSM_DLL_EXPORT lsm_volume_list_fields(lsm_connect *conn,
+                                          const char *search_key,
+                                          const char *search_value,
+                                          lsm_string_list *fields,
+                                          lsm_volume **volumes[],
+                                          uint32_t *count, lsm_flag flags);
+
 /**
  * lsm_disk_list - Gets a list of disks on this connection.
  *
@@ -663,6 +771,64 @@ int LSM_DLL_EXPORT lsm_disk_list(lsm_connect *conn, const char *search_key,
                                  const char *search_value, lsm_disk **disks[],
                                  uint32_t *count, lsm_flag flags);
 
+/**
+ * lsm_disk_list_fields - Gets a list of disks, with only some of their
+ * properties.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_disk_list(), but the plugin only sends the properties named
+ *      in fields, and can skip the slow queries some of them need, like
+ *      the RAID information of a disk behind a HBA. Their names are those of
+ *      the Python API lsm.Disk properties: "name", "disk_type",
+ *      "block_size", "num_of_blocks", "status", "system_id", "plugin_data",
+ *      "location", "rpm", "link_type" and "vpd83". The disk ID is always
+ *      included.
+ *      The getter of a property not asked for returns what it returns when
+ *      the plugin does not support that property: NULL for
+ *      lsm_disk_location_get() and lsm_disk_vpd83_get(),
+ *      LSM_DISK_RPM_NO_SUPPORT and LSM_DISK_LINK_TYPE_NO_SUPPORT; else an
+ *      empty string, LSM_DISK_TYPE_UNKNOWN, LSM_DISK_STATUS_UNKNOWN or 0.
+ *
+ * Capability:
+ *      LSM_CAP_DISKS
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ * @search_key:
+ *      Search key(NULL for all).
+ *      Valid search keys are: "id", "system_id".
+ * @search_value:
+ *      Search value.
+ * @fields:
+ *      Properties to retrieve, NULL for all of them like lsm_disk_list().
+ * @disks:
+ *      Output pointer of lsm_disk array. It should be manually freed by
+ *      lsm_disk_record_array_free().
+ * @count:
+ *      Output pointer of uint32_t. Number of disks.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number'.
+ *          * LSM_ERR_OK
+ *              On success or searched value not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL or invalid flags or invalid search
+ *              key or unknown property in fields.
+ *          * LSM_ERR_NO_SUPPORT
+ *              Not supported.
+ */
+int LSM_DLL_EXPORT lsm_disk_list_fields(lsm_connect *conn,
+                                        const char *search_key,
+                                        const char *search_value,
+                                        lsm_string_list *fields,
+                                        lsm_disk **disks[], uint32_t *count,
+                                        lsm_flag flags);
+
 /**
  * lsm_volume_create - Creates a new volume
  *
@@ -1691,6 +1857,49 @@ int LSM_DLL_EXPORT lsm_volume_child_dependency_delete(lsm_connect *conn,
 int LSM_DLL_EXPORT lsm_system_list(lsm_connect *conn, lsm_system **systems[],
                                    uint32_t *system_count, lsm_flag flags);
 
+/**
+ * lsm_system_list_fields - Gets a list of systems, with only some of their
+ * properties.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_system_list(), but the plugin only sends the properties named
+ *      in fields. Their names are those of the Python API lsm.System
+ *      properties: "name", "status", "status_info", "plugin_data",
+ *      "fw_version", "mode" and "read_cache_pct". The system ID is always
+ *      included.
+ *      For a property not asked for, lsm_system_status_get() returns
+ *      LSM_SYSTEM_STATUS_UNKNOWN and the other getters what they return
+ *      when the plugin does not support that property.
+ *
+ * @conn:
+ *      Valid connection.
+ * @fields:
+ *      Properties to retrieve, NULL for all of them like lsm_system_list().
+ * @systems:
+ *      Output pointer of lsm_system array. Returned data should be freed by
+ *      lsm_system_record_array_free().
+ * @system_count:
+ *      uint32_t. Number of systems.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number'.
+ *          * LSM_ERR_OK
+ *              On success or searched value not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL or invalid flags or unknown property
+ *              in fields.
+ */
+int LSM_DLL_EXPORT lsm_system_list_fields(lsm_connect *conn,
+                                          lsm_string_list *fields,
+                                          lsm_system **systems[],
+                                          uint32_t *system_count,
+                                          lsm_flag flags);
+
 /**
  * lsm_fs_list - Gets a list of file systems on this connection.
  *
@@ -3256,6 +3465,128 @@ int LSM_DLL_EXPORT lsm_volume_read_cache_policy_update(lsm_connect *conn,
                                                        uint32_t rcp,
                                                        lsm_flag flags);
 
+/**
+ * lsm_subscribe - Ask the plug-in to report changes of storage objects
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Starts sending an lsm_event for each system, pool, volume or disk
+ *      which is created, modified, deleted or changes status on this
+ *      connection, so that monitoring does not have to list everything
+ *      again and again.  Plug-ins which can tell what changed (simulator
+ *      database, SMI-S indications, udev) report it as soon as they notice;
+ *      for the others the plug-in runtime lists the subscribed kinds of
+ *      objects every 'interval' seconds and reports the differences.
+ *      Changes made before this call are not reported.  Calling it again
+ *      replaces the subscription.  Retrieve the events with
+ *      lsm_event_next().
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ * @classes:
+ *      uint64_t. Kinds of objects to report, bitmap of
+ *      LSM_EVENT_CLASS_SYSTEM, LSM_EVENT_CLASS_POOL, LSM_EVENT_CLASS_VOLUME
+ *      and LSM_EVENT_CLASS_DISK, or LSM_EVENT_CLASS_ALL.
+ * @interval:
+ *      uint32_t. Seconds between two checks of the plug-in for changes,
+ *      0 for the default of 10 seconds.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_NO_SUPPORT
+ *              Plug-in does not support any of the requested kinds of
+ *              objects.
+ */
+int LSM_DLL_EXPORT lsm_subscribe(lsm_connect *conn, uint64_t classes,
+                                 uint32_t interval, lsm_flag flags);
+
+/**
+ * lsm_unsubscribe - Stop reporting changes of storage objects
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Ends the subscription of lsm_subscribe().  Events received before
+ *      can still be retrieved with lsm_event_next().
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also when there was no subscription.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ */
+int LSM_DLL_EXPORT lsm_unsubscribe(lsm_connect *conn, lsm_flag flags);
+
+/**
+ * lsm_event_fd_get - Retrieves a file descriptor to wait for events on
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the file descriptor becoming readable when an event
+ *      arrives, to use with poll(), select() or an event loop.  Only read
+ *      from it with lsm_event_next(), and call lsm_event_next() with zero
+ *      timeout until it gives no event before waiting on the file
+ *      descriptor again: events arriving during other calls on the
+ *      connection are queued in the library and do not make it readable.
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ *
+ * Return:
+ *      int. File descriptor, -1 if 'conn' is not a valid lsm_connect pointer.
+ */
+int LSM_DLL_EXPORT lsm_event_fd_get(lsm_connect *conn);
+
+/**
+ * lsm_event_next - Retrieves the next event
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the next change reported since lsm_subscribe(), waiting
+ *      up to 'timeout_ms' milliseconds for it.
+ *
+ * @conn:
+ *      Valid lsm_connect pointer.
+ * @event:
+ *      Output pointer of lsm_event, NULL when no event came in time.
+ *      Memory should be freed by lsm_event_record_free().
+ * @timeout_ms:
+ *      int. Milliseconds to wait, 0 to not wait, -1 to wait until an event
+ *      comes.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also when no event came in time.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_TRANSPORT_COMMUNICATION
+ *              Plug-in died.
+ */
+int LSM_DLL_EXPORT lsm_event_next(lsm_connect *conn, lsm_event **event,
+                                  int timeout_ms, lsm_flag flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LIBSTORAGEMGMT_BATCH_H
+#define LIBSTORAGEMGMT_BATCH_H
+
+#include "libstoragemgmt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * lsm_batch_alloc - Creates a batch of list calls
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Creates an empty lsm_batch.  Calls added by lsm_batch_list_add()
+ *      are sent to the plug-in in one message by lsm_batch_submit(), which
+ *      gets all of their replies in one message too.  Plug-ins answering
+ *      requests with several threads work on the calls of a batch at the
+ *      same time.
+ *
+ * Return:
+ *      lsm_batch pointer. NULL on memory exhaustion.
+ */
+lsm_batch LSM_DLL_EXPORT *lsm_batch_alloc(void);
+
+/**
+ * lsm_batch_list_add - Adds a list call to a batch
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Adds a call retrieving one list, optionally searched like
+ *      lsm_volume_list() and the like.  Its result is the one at the index
+ *      of lsm_batch_count_get() before adding it.
+ *
+ * @b:
+ *      lsm_batch pointer.
+ * @list:
+ *      uint64_t. One LSM_MULTI_LIST_XXX.
+ * @search_key:
+ *      String. Search key, NULL for all records.  The systems list takes
+ *      none, the others the ones of lsm_volume_list() and the like.
+ * @search_value:
+ *      String. Search value, NULL when 'search_key' is NULL.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_UNSUPPORTED_SEARCH_KEY
+ *              When the list does not support 'search_key'.
+ *          * LSM_ERR_NO_MEMORY
+ *              On memory exhaustion.
+ */
+int LSM_DLL_EXPORT lsm_batch_list_add(lsm_batch *b, uint64_t list,
+                                      const char *search_key,
+                                      const char *search_value);
+
+/**
+ * lsm_batch_count_get - Retrieves the number of calls of a batch
+ * Version:
+ *      1.10
+ *
+ * @b:
+ *      lsm_batch pointer.
+ *
+ * Return:
+ *      uint32_t. Number of calls, 0 if 'b' is not a valid lsm_batch
+ *      pointer.
+ */
+uint32_t LSM_DLL_EXPORT lsm_batch_count_get(lsm_batch *b);
+
+/**
+ * lsm_batch_submit - Runs the calls of a batch
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Sends all calls of the batch and waits for their results, replacing
+ *      those of an earlier lsm_batch_submit().  A call failing only fails
+ *      its own result.  Plug-ins older than batches get the calls one after
+ *      the other, with the same results.
+ *
+ * @conn:
+ *      Valid connection @see lsm_connect_password().
+ * @b:
+ *      lsm_batch pointer.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also when calls failed.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_NO_MEMORY
+ *              On memory exhaustion.
+ *          * LSM_ERR_TRANSPORT_COMMUNICATION
+ *              When talking to the plug-in failed, the batch then has no
+ *              results.
+ *          * LSM_ERR_TRANSPORT_SERIALIZATION
+ *              When the plug-in replied nonsense.
+ */
+int LSM_DLL_EXPORT lsm_batch_submit(lsm_connect *conn, lsm_batch *b,
+                                    lsm_flag flags);
+
+/**
+ * lsm_batch_result_error_get - Retrieves the error of a call
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves whether a call of the last lsm_batch_submit() succeeded,
+ *      and why not.
+ *      Note: Address returned in 'message' is valid until the next
+ *      lsm_batch_submit() or lsm_batch_free().
+ *
+ * @b:
+ *      lsm_batch pointer.
+ * @i:
+ *      uint32_t. Index of the call, in the order they were added.
+ * @message:
+ *      Output pointer of the error message, NULL on success or when the
+ *      error has none.  Can be NULL when not wanted.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              Call succeeded.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When 'b' is not a valid lsm_batch pointer, 'i' is out of
+ *              range or the batch has no results.
+ *          * Any error of the list call.
+ */
+int LSM_DLL_EXPORT lsm_batch_result_error_get(lsm_batch *b, uint32_t i,
+                                              const char **message);
+
+/**
+ * lsm_batch_result_records_get - Retrieves the records of a call
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the records a call of the last lsm_batch_submit() listed,
+ *      lsm_system, lsm_pool, lsm_volume, lsm_disk, lsm_access_group,
+ *      lsm_fs, lsm_nfs_export, lsm_target_port or lsm_battery pointers as
+ *      told by the LSM_MULTI_LIST_XXX of the call.  The records belong to
+ *      the batch until the next lsm_batch_submit() or lsm_batch_free(),
+ *      copy them if you need longer scope.
+ *
+ * @b:
+ *      lsm_batch pointer.
+ * @i:
+ *      uint32_t. Index of the call, in the order they were added.
+ * @records:
+ *      Output pointer of the array of records, NULL when there are none.
+ * @count:
+ *      Output pointer of the number of records.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also for a call which failed.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid or the batch has no results.
+ */
+int LSM_DLL_EXPORT lsm_batch_result_records_get(lsm_batch *b, uint32_t i,
+                                                void ***records,
+                                                uint32_t *count);
+
+/**
+ * lsm_batch_free - Frees a batch
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Frees a batch including the records of its results.
+ *
+ * @b:
+ *      lsm_batch pointer.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When 'b' is not a valid lsm_batch pointer.
+ */
+int LSM_DLL_EXPORT lsm_batch_free(lsm_batch *b);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LIBSTORAGEMGMT_BATCH_H */
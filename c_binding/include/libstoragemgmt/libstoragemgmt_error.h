@@ -45,6 +45,9 @@ typedef enum {
     /** Permission denied. Only for library level function. */
     LSM_ERR_PERMISSION_DENIED = 13,
 
+    /** Daemon has reached the session limits of the plug-in */
+    LSM_ERR_DAEMON_BUSY = 14,
+
     /** Name exists */
     LSM_ERR_NAME_CONFLICT = 50,
 
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2021 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LIBSTORAGEMGMT_EVENT_H
+#define LIBSTORAGEMGMT_EVENT_H
+
+#include "libstoragemgmt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * lsm_event_record_free - Frees the memory for an individual event
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Frees the memory for an individual lsm_event including the storage
+ *      object it holds.
+ *
+ * @e:
+ *      lsm_event to release memory for.
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When argument is NULL or not a valid lsm_event pointer.
+ */
+int LSM_DLL_EXPORT lsm_event_record_free(lsm_event *e);
+
+/**
+ * lsm_event_type_get - Retrieves what happened to the object.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves what happened to the object of the event.
+ *
+ * @e:
+ *      Event to retrieve type for.
+ *
+ * Return:
+ *      lsm_event_type. Possible values are:
+ *          * LSM_EVENT_TYPE_UNKNOWN
+ *              Invalid lsm_event pointer.
+ *          * LSM_EVENT_TYPE_CREATED
+ *              Object showed up.
+ *          * LSM_EVENT_TYPE_MODIFIED
+ *              Some property other than the status changed.
+ *          * LSM_EVENT_TYPE_DELETED
+ *              Object is gone, the event holds its last known state.
+ *          * LSM_EVENT_TYPE_HEALTH
+ *              Status of the object changed.
+ */
+lsm_event_type LSM_DLL_EXPORT lsm_event_type_get(lsm_event *e);
+
+/**
+ * lsm_event_class_get - Retrieves the kind of object of the event.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the kind of object of the event, which tells the
+ *      lsm_event_xxx_get() function to retrieve it with.
+ *
+ * @e:
+ *      Event to retrieve object kind for.
+ *
+ * Return:
+ *      uint64_t. One of:
+ *          * LSM_EVENT_CLASS_UNKNOWN
+ *              Invalid lsm_event pointer.
+ *          * LSM_EVENT_CLASS_SYSTEM
+ *          * LSM_EVENT_CLASS_POOL
+ *          * LSM_EVENT_CLASS_VOLUME
+ *          * LSM_EVENT_CLASS_DISK
+ */
+uint64_t LSM_DLL_EXPORT lsm_event_class_get(lsm_event *e);
+
+/**
+ * lsm_event_id_get - Retrieves the ID of the object of the event.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the ID of the object of the event.
+ *      Note: Address returned is valid until lsm_event gets freed, copy
+ *      return value if you need longer scope. Do not free returned string.
+ *
+ * @e:
+ *      Event to retrieve object ID for.
+ *
+ * Return:
+ *      string. NULL if argument 'e' is NULL or not a valid lsm_event pointer.
+ */
+const char LSM_DLL_EXPORT *lsm_event_id_get(lsm_event *e);
+
+/**
+ * lsm_event_system_get - Retrieves the system of the event.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the system of an event of LSM_EVENT_CLASS_SYSTEM.
+ *      Note: The system is valid until lsm_event gets freed, copy it with
+ *      lsm_system_record_copy() if you need longer scope. Do not free it.
+ *
+ * @e:
+ *      Event to retrieve the system for.
+ *
+ * Return:
+ *      lsm_system pointer. NULL if argument 'e' is NULL, not a valid lsm_event
+ *      pointer or the event is not about a system.
+ */
+lsm_system LSM_DLL_EXPORT *lsm_event_system_get(lsm_event *e);
+
+/**
+ * lsm_event_pool_get - Retrieves the pool of the event.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the pool of an event of LSM_EVENT_CLASS_POOL.
+ *      Note: The pool is valid until lsm_event gets freed, copy it with
+ *      lsm_pool_record_copy() if you need longer scope. Do not free it.
+ *
+ * @e:
+ *      Event to retrieve the pool for.
+ *
+ * Return:
+ *      lsm_pool pointer. NULL if argument 'e' is NULL, not a valid lsm_event
+ *      pointer or the event is not about a pool.
+ */
+lsm_pool LSM_DLL_EXPORT *lsm_event_pool_get(lsm_event *e);
+
+/**
+ * lsm_event_volume_get - Retrieves the volume of the event.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the volume of an event of LSM_EVENT_CLASS_VOLUME.
+ *      Note: The volume is valid until lsm_event gets freed, copy it with
+ *      lsm_volume_record_copy() if you need longer scope. Do not free it.
+ *
+ * @e:
+ *      Event to retrieve the volume for.
+ *
+ * Return:
+ *      lsm_volume pointer. NULL if argument 'e' is NULL, not a valid
+ *      lsm_event pointer or the event is not about a volume.
+ */
+lsm_volume LSM_DLL_EXPORT *lsm_event_volume_get(lsm_event *e);
+
+/**
+ * lsm_event_disk_get - Retrieves the disk of the event.
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the disk of an event of LSM_EVENT_CLASS_DISK.
+ *      Note: The disk is valid until lsm_event gets freed, copy it with
+ *      lsm_disk_record_copy() if you need longer scope. Do not free it.
+ *
+ * @e:
+ *      Event to retrieve the disk for.
+ *
+ * Return:
+ *      lsm_disk pointer. NULL if argument 'e' is NULL, not a valid lsm_event
+ *      pointer or the event is not about a disk.
+ */
+lsm_disk LSM_DLL_EXPORT *lsm_event_disk_get(lsm_event *e);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LIBSTORAGEMGMT_EVENT_H */
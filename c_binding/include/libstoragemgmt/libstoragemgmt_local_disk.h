@@ -558,6 +558,219 @@ int LSM_DLL_EXPORT lsm_local_disk_link_speed_get(const char *disk_path,
                                                  uint32_t *link_speed,
                                                  lsm_error **lsm_err);
 
+/**
+ * lsm_local_disk_index_new - Index local disks by VPD83.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Query the SCSI VPD 0x83 page NAA type ID of all local disks once, so
+ *      that the disks of many VPD83 IDs can be found without probing every
+ *      disk for each of them, see lsm_local_disk_volume_join().
+ *      The index listens to udev events of block devices, apply them with
+ *      lsm_local_disk_index_update().
+ *
+ * @index:
+ *      Output pointer of lsm_local_disk_index.
+ *      Memory should be freed by lsm_local_disk_index_free().
+ * @lsm_err:
+ *      Output pointer of &lsm_error. Error message could be
+ *      retrieved via lsm_error_message_get(). Memory should be
+ *      freed by lsm_error_free().
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL.
+ *          * LSM_ERR_NO_MEMORY
+ *              When no memory.
+ *          * LSM_ERR_LIB_BUG
+ *              When something unexpected happens.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_index_new(lsm_local_disk_index **index,
+                                            lsm_error **lsm_err);
+
+/**
+ * lsm_local_disk_index_free - Free the VPD83 index of local disks.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Free the memory of lsm_local_disk_index.
+ *
+ * @index:
+ *      Pointer of lsm_local_disk_index to free.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When argument is NULL.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_index_free(lsm_local_disk_index *index);
+
+/**
+ * lsm_local_disk_index_fd_get - File descriptor of udev events of the index.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      The returned file descriptor is readable when local disks got added,
+ *      removed or changed, call lsm_local_disk_index_update() then.
+ *      Do not read from or close it.
+ *
+ * @index:
+ *      Pointer of lsm_local_disk_index.
+ *
+ * Return:
+ *      File descriptor, -1 if index is NULL or udev events are not
+ *      available, lsm_local_disk_index_update() queries all disks again
+ *      in that case.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_index_fd_get(lsm_local_disk_index *index);
+
+/**
+ * lsm_local_disk_index_update - Apply changes of local disks to the index.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Query the disks of the pending udev events again, without waiting for
+ *      more.  Without udev events, all disks are queried again.
+ *
+ * @index:
+ *      Pointer of lsm_local_disk_index.
+ * @lsm_err:
+ *      Output pointer of &lsm_error. Error message could be
+ *      retrieved via lsm_error_message_get(). Memory should be
+ *      freed by lsm_error_free().
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL.
+ *          * LSM_ERR_NO_MEMORY
+ *              When no memory.
+ *          * LSM_ERR_LIB_BUG
+ *              When something unexpected happens.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_index_update(lsm_local_disk_index *index,
+                                               lsm_error **lsm_err);
+
+/**
+ * lsm_local_disk_index_vpd83_search - Search indexed disks by VPD83 string.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_local_disk_vpd83_search() without probing any disk.  The
+ *      multipath devices holding the disks are included after the disks.
+ *
+ * @index:
+ *      Pointer of lsm_local_disk_index.
+ * @vpd83:
+ *      String. The SCSI VPD 0x83 page NAA type ID.
+ * @disk_path_list:
+ *      Output pointer of &lsm_string_list. The format of
+ *      disk path will be like "/dev/sdb" for SCSI or ATA disk and
+ *      "/dev/mapper/mpatha" for multipath device.
+ *      NULL if no found or got error.
+ *      Memory should be freed by lsm_string_list_free().
+ * @lsm_err:
+ *      Output pointer of &lsm_error. Error message could be
+ *      retrieved via lsm_error_message_get(). Memory should be
+ *      freed by lsm_error_free().
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success or not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL or vpd83 is too long.
+ *          * LSM_ERR_NO_MEMORY
+ *              When no memory.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_index_vpd83_search(
+    lsm_local_disk_index *index, const char *vpd83,
+    lsm_string_list **disk_path_list, lsm_error **lsm_err);
+
+/**
+ * lsm_local_disk_volume_join - Find the local disks of volumes.
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Find the local disks of each volume by its VPD83, see
+ *      lsm_local_disk_index_vpd83_search().
+ *
+ * @index:
+ *      Pointer of lsm_local_disk_index. NULL to index the local disks for
+ *      this call only.
+ * @volumes:
+ *      Array of lsm_volume, like from lsm_volume_list(). Could be NULL
+ *      when volume_count is 0.
+ * @volume_count:
+ *      Number of volumes.
+ * @disk_path_lists:
+ *      Output array of volume_count &lsm_string_list, the disks of
+ *      volumes[i] are in (*disk_path_lists)[i], NULL if none.
+ *      Memory should be freed by lsm_local_disk_volume_join_free().
+ * @lsm_err:
+ *      Output pointer of &lsm_error. Error message could be
+ *      retrieved via lsm_error_message_get(). Memory should be
+ *      freed by lsm_error_free().
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is NULL.
+ *          * LSM_ERR_NO_MEMORY
+ *              When no memory.
+ *          * LSM_ERR_LIB_BUG
+ *              When something unexpected happens.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_volume_join(
+    lsm_local_disk_index *index, lsm_volume *volumes[], uint32_t volume_count,
+    lsm_string_list **disk_path_lists[], lsm_error **lsm_err);
+
+/**
+ * lsm_local_disk_volume_join_free - Free the output of
+ * lsm_local_disk_volume_join().
+ *
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Free the memory of the output of lsm_local_disk_volume_join().
+ *
+ * @disk_path_lists:
+ *      Array of &lsm_string_list to free.
+ * @volume_count:
+ *      Number of items in disk_path_lists.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When disk_path_lists is NULL.
+ */
+int LSM_DLL_EXPORT lsm_local_disk_volume_join_free(
+    lsm_string_list *disk_path_lists[], uint32_t volume_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LIBSTORAGEMGMT_MULTI_H
+#define LIBSTORAGEMGMT_MULTI_H
+
+#include "libstoragemgmt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * lsm_multi_alloc - Creates a listing of many storage arrays
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Creates an lsm_multi, which connects to the storage arrays given by
+ *      lsm_multi_array_add() and retrieves their lists with up to 'workers'
+ *      arrays at a time.  Each array gets 'timeout_ms' milliseconds for all
+ *      of its lists: the time is passed to the plug-in as the timeout of
+ *      the connection and bounds waiting for the replies of the lists.
+ *
+ * @workers:
+ *      uint32_t. Most arrays to talk to at the same time.
+ * @timeout_ms:
+ *      uint32_t. Milliseconds each array gets.
+ *
+ * Return:
+ *      lsm_multi pointer. NULL if any argument is zero or on memory
+ *      exhaustion.
+ */
+lsm_multi LSM_DLL_EXPORT *lsm_multi_alloc(uint32_t workers,
+                                          uint32_t timeout_ms);
+
+/**
+ * lsm_multi_array_add - Adds a storage array to list
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Adds a storage array, as given to lsm_connect_password().  Arrays
+ *      can only be added before lsm_multi_run().
+ *
+ * @m:
+ *      lsm_multi pointer.
+ * @uri:
+ *      String. URI of the array.
+ * @password:
+ *      String. Password of the array, NULL for none.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid or lsm_multi_run() was called.
+ *          * LSM_ERR_NO_MEMORY
+ *              On memory exhaustion.
+ */
+int LSM_DLL_EXPORT lsm_multi_array_add(lsm_multi *m, const char *uri,
+                                       const char *password);
+
+/**
+ * lsm_multi_run - Starts listing the storage arrays
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Starts retrieving the lists of all arrays in the background.  Each
+ *      array and list gives exactly one lsm_multi_result, retrieve them
+ *      with lsm_multi_next() in the order they complete.  Lists of an
+ *      array which could not be connected to, or ran out of time, carry
+ *      the error instead of records.
+ *
+ * @m:
+ *      lsm_multi pointer.
+ * @lists:
+ *      uint64_t. Lists to retrieve, bitmap of LSM_MULTI_LIST_XXX or
+ *      LSM_MULTI_LIST_ALL.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid or it was called before.
+ *          * LSM_ERR_NO_MEMORY
+ *              When no worker could be started.
+ */
+int LSM_DLL_EXPORT lsm_multi_run(lsm_multi *m, uint64_t lists,
+                                 lsm_flag flags);
+
+/**
+ * lsm_multi_pending_get - Retrieves the number of results to come
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the number of results lsm_multi_next() has not returned
+ *      yet, for the arrays and lists given to lsm_multi_run().
+ *
+ * @m:
+ *      lsm_multi pointer.
+ *
+ * Return:
+ *      uint32_t. Number of results, 0 if 'm' is not a valid lsm_multi
+ *      pointer or not running.
+ */
+uint32_t LSM_DLL_EXPORT lsm_multi_pending_get(lsm_multi *m);
+
+/**
+ * lsm_multi_next - Retrieves the next completed list
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the next list to complete on any array, waiting up to
+ *      'timeout_ms' milliseconds for it.
+ *
+ * @m:
+ *      lsm_multi pointer.
+ * @result:
+ *      Output pointer of lsm_multi_result, NULL when none came in time or
+ *      all were retrieved.  Memory should be freed by
+ *      lsm_multi_result_free().
+ * @timeout_ms:
+ *      int. Milliseconds to wait, 0 to not wait, -1 to wait until a list
+ *      completes.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also when no list completed in time.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ */
+int LSM_DLL_EXPORT lsm_multi_next(lsm_multi *m, lsm_multi_result **result,
+                                  int timeout_ms);
+
+/**
+ * lsm_multi_free - Frees a listing of many storage arrays
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Stops listing arrays not started yet, waits for the lists in
+ *      progress and frees the results not retrieved.
+ *
+ * @m:
+ *      lsm_multi pointer.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When 'm' is not a valid lsm_multi pointer.
+ */
+int LSM_DLL_EXPORT lsm_multi_free(lsm_multi *m);
+
+/**
+ * lsm_multi_result_uri_get - Retrieves the array of a result
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the URI of the array the list came from, as given to
+ *      lsm_multi_array_add().
+ *      Note: Address returned is valid until lsm_multi_result gets freed,
+ *      copy return value if you need longer scope. Do not free returned
+ *      string.
+ *
+ * @r:
+ *      lsm_multi_result pointer.
+ *
+ * Return:
+ *      string. NULL if 'r' is not a valid lsm_multi_result pointer.
+ */
+const char LSM_DLL_EXPORT *lsm_multi_result_uri_get(lsm_multi_result *r);
+
+/**
+ * lsm_multi_result_list_get - Retrieves the list of a result
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves which list the result holds, telling the type of its
+ *      records.
+ *
+ * @r:
+ *      lsm_multi_result pointer.
+ *
+ * Return:
+ *      uint64_t. One LSM_MULTI_LIST_XXX, 0 if 'r' is not a valid
+ *      lsm_multi_result pointer.
+ */
+uint64_t LSM_DLL_EXPORT lsm_multi_result_list_get(lsm_multi_result *r);
+
+/**
+ * lsm_multi_result_error_get - Retrieves the error of a result
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves whether the list was retrieved, and why not.
+ *      Note: Address returned in 'message' is valid until lsm_multi_result
+ *      gets freed.
+ *
+ * @r:
+ *      lsm_multi_result pointer.
+ * @message:
+ *      Output pointer of the error message, NULL on success or when the
+ *      error has none.  Can be NULL when not wanted.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              List was retrieved.
+ *          * LSM_ERR_TIMEOUT
+ *              Array ran out of time before the list was retrieved.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When 'r' is not a valid lsm_multi_result pointer.
+ *          * Any error of lsm_connect_password() or of the list call.
+ */
+int LSM_DLL_EXPORT lsm_multi_result_error_get(lsm_multi_result *r,
+                                              const char **message);
+
+/**
+ * lsm_multi_result_records_get - Retrieves the records of a result
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the records of the list, lsm_system, lsm_pool, lsm_volume,
+ *      lsm_disk, lsm_access_group, lsm_fs, lsm_nfs_export, lsm_target_port
+ *      or lsm_battery pointers as told by lsm_multi_result_list_get().
+ *      The records belong to the result, copy them if you need longer
+ *      scope.
+ *
+ * @r:
+ *      lsm_multi_result pointer.
+ * @records:
+ *      Output pointer of the array of records, NULL when there are none.
+ * @count:
+ *      Output pointer of the number of records.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also for a list which failed.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ */
+int LSM_DLL_EXPORT lsm_multi_result_records_get(lsm_multi_result *r,
+                                                void ***records,
+                                                uint32_t *count);
+
+/**
+ * lsm_multi_result_free - Frees a result
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Frees a result of lsm_multi_next() including its records.
+ *
+ * @r:
+ *      lsm_multi_result pointer.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When 'r' is not a valid lsm_multi_result pointer.
+ */
+int LSM_DLL_EXPORT lsm_multi_result_free(lsm_multi_result *r);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LIBSTORAGEMGMT_MULTI_H */
@@ -70,6 +70,11 @@ typedef struct _lsm_plugin lsm_plugin;
  */
 typedef lsm_plugin *lsm_plugin_ptr;
 
+/**
+ * Opaque data type for a job the plug-in runtime runs on a worker thread
+ */
+typedef struct _lsm_plug_job lsm_plug_job;
+
 /**
  * Plug-in register callback function signature.
  * @param   c           Valid lsm plugin pointer
@@ -1201,6 +1206,56 @@ int LSM_DLL_EXPORT lsm_plugin_init_v1(int argc, char *argv[],
                                       lsm_plugin_unregister unreg,
                                       const char *desc, const char *version);
 
+/**
+ * ABI version of struct lsm_plugin_so_v1.
+ */
+#define LSM_PLUGIN_SO_ABI_V1 1
+
+/**
+ * Name of the symbol a shared object plug-in exports, see
+ * LSM_PLUGIN_SO_DEFINE.
+ */
+#define LSM_PLUGIN_SO_SYMBOL "lsm_plugin_so_v1"
+
+/**
+ * New in version 1.10.  Entry point of a plug-in built as a shared object.
+ * The same callbacks handed to lsm_plugin_init_v1() by the plug-in
+ * executable, the shared object is loaded once by lsm_plugin_host and each
+ * client connection is served on a thread with its own lsm_plugin_ptr.
+ * Plug-ins built this way must not keep per connection state outside of the
+ * private data registered with lsm_register_plugin_v1_3() and friends.
+ */
+struct lsm_plugin_so_v1 {
+    uint32_t abi_version;        /**< LSM_PLUGIN_SO_ABI_V1 */
+    const char *desc;            /**< Plug-in description */
+    const char *version;         /**< Plug-in version */
+    lsm_plugin_register reg;     /**< Registration function */
+    lsm_plugin_unregister unreg; /**< Un-Registration function */
+};
+
+/**
+ * Defines the shared object entry point of a plug-in.
+ * @param reg       Registration function
+ * @param unreg     Un-Registration function
+ * @param desc      Plug-in description
+ * @param version   Plug-in version
+ */
+#define LSM_PLUGIN_SO_DEFINE(reg, unreg, desc, version)                        \
+    LSM_DLL_EXPORT struct lsm_plugin_so_v1 lsm_plugin_so_v1 = {                \
+        LSM_PLUGIN_SO_ABI_V1, (desc), (version), (reg), (unreg)}
+
+/**
+ * New in version 1.10.  Hosts a shared object plug-in, used by the
+ * lsm_plugin_host program which lsmd starts for plug-ins configured with
+ * 'in-process-library'.  Client connections are received as SCM_RIGHTS
+ * messages on the control socket and each one is served by a thread of a
+ * fixed size worker pool.
+ * @param argc  Command line argument count
+ * @param argv  <prog> <shared object path> <control fd> [worker count]
+ * @return exit code for host
+ */
+int LSM_DLL_EXPORT lsm_plugin_host_v1(int argc, char *argv[]);
+
 /**
  * Used to register all the data needed for the plug-in operation.
  * @param plug              Pointer provided by the framework
@@ -1264,6 +1319,197 @@ int LSM_DLL_EXPORT lsm_register_plugin_v1_3(
  */
 void LSM_DLL_EXPORT *lsm_private_data_get(lsm_plugin_ptr plug);
 
+/**
+ * Tells a system, pool, volume or disk list callback whether the client asked
+ * for an attribute, so that attributes costly to retrieve can be skipped.
+ * Attributes not asked for are left out of the reply whatever their value.
+ * @param plug  Opaque plug-in pointer.
+ * @param field Attribute name as in the Python API, e.g. "rpm" or "vpd83".
+ * @return 1 if the attribute is wanted or no list callback is running with
+ *         a field projection, else 0.
+ */
+int LSM_DLL_EXPORT lsm_plug_field_requested(lsm_plugin_ptr plug,
+                                            const char *field);
+
+/**
+ * Callback through which the plug-in runtime asks a plug-in which objects it
+ * noticed changing, while the client is subscribed to changes.  The plug-in
+ * calls lsm_plug_object_changed() for each of them.
+ * @param   c           Valid lsm plugin pointer
+ * @param   start       Non-zero when the client subscribes: forget about
+ *                      earlier changes, nothing needs reporting.
+ * @param   flags       Reserved
+ * @return Error code as enumerated by \ref lsm_error_number.  Unless
+ *         LSM_ERR_OK, the runtime compares all subscribed objects.
+ */
+typedef int (*lsm_plug_changes_get)(lsm_plugin_ptr c, int start,
+                                    lsm_flag flags);
+
+/**
+ * Lets the plug-in tell which objects changed, instead of the plug-in runtime
+ * listing all objects every subscription interval and comparing them.  Call
+ * it from the plug-in register callback.
+ * @param plug          Opaque plug-in pointer.
+ * @param changes_get   Callback reporting changes.
+ * @param fd            File descriptor becoming readable when there are
+ *                      changes, changes_get is called then.  With -1,
+ *                      changes_get is called every subscription interval.
+ * @return Error code as enumerated by \ref lsm_error_number.
+ * @retval LSM_ERR_OK on success.
+ */
+int LSM_DLL_EXPORT lsm_plug_changes_register(lsm_plugin_ptr plug,
+                                             lsm_plug_changes_get changes_get,
+                                             int fd);
+
+/**
+ * Reports an object which might have been created, modified or deleted, from
+ * a lsm_plug_changes_get callback.  The plug-in runtime looks the object up
+ * and tells the client what changed, if anything.
+ * @param plug          Opaque plug-in pointer.
+ * @param event_class   LSM_EVENT_CLASS_SYSTEM, LSM_EVENT_CLASS_POOL,
+ *                      LSM_EVENT_CLASS_VOLUME or LSM_EVENT_CLASS_DISK.
+ * @param id            ID of the object, NULL when any object of the class
+ *                      might have changed.
+ * @return Error code as enumerated by \ref lsm_error_number.
+ * @retval LSM_ERR_OK on success.
+ */
+int LSM_DLL_EXPORT lsm_plug_object_changed(lsm_plugin_ptr plug,
+                                           uint64_t event_class,
+                                           const char *id);
+
+/**
+ * Work of a job handed to the plug-in runtime with lsm_plug_job_submit().
+ *
+ * Thread safety: the work runs on a worker thread of the runtime, at the same
+ * time as the request loop and other jobs.  It must not touch the plug-in
+ * pointer, lsm_log_error_basic() included, nor state shared with the
+ * plug-in callbacks unless the plug-in guards it with its own locking.
+ * Everything it needs belongs in data.  Only lsm_plug_job_progress_set() and
+ * lsm_plug_job_error_set() may be called on the job.
+ * @param   job         Job being run
+ * @param   data        Data given to lsm_plug_job_submit()
+ * @param   type        Type of the result, LSM_DATA_TYPE_NONE when none.
+ *                      Only LSM_DATA_TYPE_VOLUME, LSM_DATA_TYPE_POOL,
+ *                      LSM_DATA_TYPE_FS and LSM_DATA_TYPE_SS are supported.
+ * @param   value       Result, which the runtime owns from now on
+ * @return Error code as enumerated by \ref lsm_error_number.  On failure,
+ *         the job ends in LSM_JOB_ERROR with the message given to
+ *         lsm_plug_job_error_set().
+ */
+typedef int (*lsm_plug_job_work)(lsm_plug_job *job, void *data,
+                                 lsm_data_type *type, void **value);
+
+/**
+ * Releases the data of a job once its work is done or it was cancelled.
+ * @param   data        Data given to lsm_plug_job_submit()
+ */
+typedef void (*lsm_plug_job_data_free)(void *data);
+
+/**
+ * Queues work to run on a worker thread of the plug-in runtime, so that a
+ * slow operation does not hold the request loop.  The runtime answers
+ * job_status and job_free for the returned job without calling the plug-in;
+ * jobs it does not know are still passed to the job_status and job_free
+ * callbacks of the plug-in.  Return LSM_ERR_JOB_STARTED and the job to the
+ * client.  Jobs not started when the plug-in unregisters are dropped, the
+ * ones running are waited for before the unregister callback is called.
+ * @param plug          Opaque plug-in pointer.
+ * @param work          Work of the job.
+ * @param data          Data for the work, NULL allowed.
+ * @param data_free     Releases data, NULL when nothing to release.  Called
+ *                      on every path, failure of this function included.
+ * @param[out] job      Job ID, to be freed with free().
+ * @return Error code as enumerated by \ref lsm_error_number.
+ * @retval LSM_ERR_JOB_STARTED on success.
+ */
+int LSM_DLL_EXPORT lsm_plug_job_submit(lsm_plugin_ptr plug,
+                                       lsm_plug_job_work work, void *data,
+                                       lsm_plug_job_data_free data_free,
+                                       char **job);
+
+/**
+ * Reports how far the work of a job got, from lsm_plug_job_work.
+ * @param job           Job being run.
+ * @param percent       Percent complete, values above 99 are taken as 99
+ *                      until the work returns.
+ * @return Error code as enumerated by \ref lsm_error_number.
+ * @retval LSM_ERR_OK on success.
+ */
+int LSM_DLL_EXPORT lsm_plug_job_progress_set(lsm_plug_job *job,
+                                             uint8_t percent);
+
+/**
+ * Sets the error message the client gets for a failed job, from
+ * lsm_plug_job_work, like lsm_log_error_basic() does for requests.
+ * @param job           Job being run.
+ * @param code          Error code to return
+ * @param msg           String message
+ * @return returns code
+ */
+int LSM_DLL_EXPORT lsm_plug_job_error_set(lsm_plug_job *job,
+                                          lsm_error_number code,
+                                          const char *msg);
+
+/**
+ * Prepares what a request worker thread needs of its own, like a connection
+ * to the array, see lsm_plug_concurrency_register().
+ * @param   c           Valid lsm plugin pointer
+ * @param[out] data     Data of the worker, for lsm_plug_worker_data_get()
+ * @return Error code as enumerated by \ref lsm_error_number.  On failure,
+ *         the runtime does with the workers prepared so far.
+ */
+typedef int (*lsm_plug_worker_init)(lsm_plugin_ptr c, void **data);
+
+/**
+ * Releases the data of a request worker thread once it quit.
+ * @param   c           Valid lsm plugin pointer
+ * @param   data        Data from lsm_plug_worker_init
+ */
+typedef void (*lsm_plug_worker_cleanup)(lsm_plugin_ptr c, void *data);
+
+/**
+ * Lets the plug-in runtime answer requests on worker threads, several at a
+ * time, while the request loop reads the next ones.  Call it from the
+ * plug-in register callback.  Replies go out in the order the requests came
+ * in.
+ *
+ * Only requests which change nothing run on the workers: listing systems,
+ * pools, volumes, disks, access groups, file systems, exports, snapshots,
+ * target ports and batteries, the queries of a volume, file system, pool or
+ * access group, capabilities, job_status, plugin_info and time_out_get.  All
+ * other requests, and the lsm_plug_changes_get callback, run on the request
+ * loop once the workers answered everything before them, with no callback
+ * running at the same time.  The same goes for the requests a client sends
+ * in one batch, see lsm_batch_submit().
+ *
+ * Thread safety: the callbacks of the requests above run at the same time as
+ * each other, several of the same one included.  They must not change state
+ * shared with other callbacks unless the plug-in guards it with its own
+ * locking; lsm_private_data_get(), lsm_log_error_basic(),
+ * lsm_plugin_error_log() and lsm_plug_field_requested() are fine to call,
+ * they keep to the request being answered.
+ * @param plug          Opaque plug-in pointer.
+ * @param workers       Worker threads, 0 answers every request on the
+ *                      request loop like plug-ins not calling this do.
+ * @param init          Called on the request loop for each worker before it
+ *                      starts, NULL when workers need nothing of their own.
+ * @param cleanup       Called for each worker once it quit, before the
+ *                      unregister callback, NULL when init is.
+ * @return Error code as enumerated by \ref lsm_error_number.
+ * @retval LSM_ERR_OK on success.
+ */
+int LSM_DLL_EXPORT lsm_plug_concurrency_register(
+    lsm_plugin_ptr plug, uint32_t workers, lsm_plug_worker_init init,
+    lsm_plug_worker_cleanup cleanup);
+
+/**
+ * Data of the request worker thread calling, as set by its
+ * lsm_plug_worker_init callback.
+ * @param plug          Opaque plug-in pointer.
+ * @return Data of the worker, NULL on the request loop and job threads.
+ */
+void LSM_DLL_EXPORT *lsm_plug_worker_data_get(lsm_plugin_ptr plug);
+
 /**
  * Logs an error with the plug-in
  * @param plug  Plug-in pointer
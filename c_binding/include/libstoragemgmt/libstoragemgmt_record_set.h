@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LIBSTORAGEMGMT_RECORD_SET_H
+#define LIBSTORAGEMGMT_RECORD_SET_H
+
+#include "libstoragemgmt_common.h"
+
+/*
+ * Record sets take over the array of a list reply and look its records up
+ * by id and by the ids they refer to.  Each lookup key gets its hash index
+ * on first use, later lookups take constant time.  Records and arrays
+ * returned by lookups belong to the set, they are valid until it is freed.
+ * Lookups of one set may run in several threads at once.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * lsm_volume_set_alloc - Indexes the volumes of a list reply
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Creates a volume set taking over 'volumes', as from
+ *      lsm_volume_list().  On failure 'volumes' still belongs to the caller.
+ *
+ * @volumes:
+ *      Array of lsm_volume pointers, can be NULL when 'count' is 0.
+ * @count:
+ *      uint32_t. Number of volumes.
+ *
+ * Return:
+ *      lsm_volume_set pointer. NULL if any volume is not valid or on memory
+ *      exhaustion.
+ */
+lsm_volume_set LSM_DLL_EXPORT *lsm_volume_set_alloc(lsm_volume *volumes[],
+                                                    uint32_t count);
+
+/**
+ * lsm_volume_set_free - Frees a volume set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Frees the set with its indexes and volumes.
+ *
+ * @set:
+ *      lsm_volume_set pointer.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When 'set' is not a valid lsm_volume_set pointer.
+ */
+int LSM_DLL_EXPORT lsm_volume_set_free(lsm_volume_set *set);
+
+/**
+ * lsm_volume_set_records_get - Retrieves all volumes of a set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the volumes in the order of the list reply.
+ *
+ * @set:
+ *      lsm_volume_set pointer.
+ * @volumes:
+ *      Output pointer of the lsm_volume array, NULL when the set is empty.
+ * @count:
+ *      Output pointer of the number of volumes.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ */
+int LSM_DLL_EXPORT lsm_volume_set_records_get(lsm_volume_set *set,
+                                              lsm_volume **volumes[],
+                                              uint32_t *count);
+
+/**
+ * lsm_volume_set_find_id - Looks a volume up by its id
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the volume of the given id.
+ *
+ * @set:
+ *      lsm_volume_set pointer.
+ * @id:
+ *      String. Volume id.
+ * @volume:
+ *      Output pointer of lsm_volume, NULL when none has this id.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also when not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_NO_MEMORY
+ *              When the index could not be built.
+ */
+int LSM_DLL_EXPORT lsm_volume_set_find_id(lsm_volume_set *set,
+                                          const char *id,
+                                          lsm_volume **volume);
+
+/**
+ * lsm_volume_set_find_pool_id - Looks the volumes of a pool up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves the volumes of the given pool, in the order of the list
+ *      reply.
+ *
+ * @set:
+ *      lsm_volume_set pointer.
+ * @pool_id:
+ *      String. Pool id.
+ * @volumes:
+ *      Output pointer of the lsm_volume array, NULL when none matches.
+ * @count:
+ *      Output pointer of the number of volumes.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success, also when not found.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_NO_MEMORY
+ *              When the index could not be built.
+ */
+int LSM_DLL_EXPORT lsm_volume_set_find_pool_id(lsm_volume_set *set,
+                                               const char *pool_id,
+                                               lsm_volume **volumes[],
+                                               uint32_t *count);
+
+/**
+ * lsm_volume_set_find_system_id - Looks the volumes of a system up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the given system.
+ */
+int LSM_DLL_EXPORT lsm_volume_set_find_system_id(lsm_volume_set *set,
+                                                 const char *system_id,
+                                                 lsm_volume **volumes[],
+                                                 uint32_t *count);
+
+/**
+ * lsm_volume_set_find_vpd83 - Looks volumes up by their VPD83
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the given SCSI VPD 0x83 NAA
+ *      ID.  Volumes without one never match.
+ */
+int LSM_DLL_EXPORT lsm_volume_set_find_vpd83(lsm_volume_set *set,
+                                             const char *vpd83,
+                                             lsm_volume **volumes[],
+                                             uint32_t *count);
+
+/**
+ * lsm_disk_set_alloc - Indexes the disks of a list reply
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_alloc() for disks, as from lsm_disk_list().
+ */
+lsm_disk_set LSM_DLL_EXPORT *lsm_disk_set_alloc(lsm_disk *disks[],
+                                                uint32_t count);
+
+/**
+ * lsm_disk_set_free - Frees a disk set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_free() for disks.
+ */
+int LSM_DLL_EXPORT lsm_disk_set_free(lsm_disk_set *set);
+
+/**
+ * lsm_disk_set_records_get - Retrieves all disks of a set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_records_get() for disks.
+ */
+int LSM_DLL_EXPORT lsm_disk_set_records_get(lsm_disk_set *set,
+                                            lsm_disk **disks[],
+                                            uint32_t *count);
+
+/**
+ * lsm_disk_set_find_id - Looks a disk up by its id
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_id() for disks.
+ */
+int LSM_DLL_EXPORT lsm_disk_set_find_id(lsm_disk_set *set, const char *id,
+                                        lsm_disk **disk);
+
+/**
+ * lsm_disk_set_find_system_id - Looks the disks of a system up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the disks of the given system.
+ */
+int LSM_DLL_EXPORT lsm_disk_set_find_system_id(lsm_disk_set *set,
+                                               const char *system_id,
+                                               lsm_disk **disks[],
+                                               uint32_t *count);
+
+/**
+ * lsm_disk_set_find_vpd83 - Looks disks up by their VPD83
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_vpd83() for disks.
+ */
+int LSM_DLL_EXPORT lsm_disk_set_find_vpd83(lsm_disk_set *set,
+                                           const char *vpd83,
+                                           lsm_disk **disks[],
+                                           uint32_t *count);
+
+/**
+ * lsm_pool_set_alloc - Indexes the pools of a list reply
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_alloc() for pools, as from lsm_pool_list().
+ */
+lsm_pool_set LSM_DLL_EXPORT *lsm_pool_set_alloc(lsm_pool *pools[],
+                                                uint32_t count);
+
+/**
+ * lsm_pool_set_free - Frees a pool set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_free() for pools.
+ */
+int LSM_DLL_EXPORT lsm_pool_set_free(lsm_pool_set *set);
+
+/**
+ * lsm_pool_set_records_get - Retrieves all pools of a set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_records_get() for pools.
+ */
+int LSM_DLL_EXPORT lsm_pool_set_records_get(lsm_pool_set *set,
+                                            lsm_pool **pools[],
+                                            uint32_t *count);
+
+/**
+ * lsm_pool_set_find_id - Looks a pool up by its id
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_id() for pools.
+ */
+int LSM_DLL_EXPORT lsm_pool_set_find_id(lsm_pool_set *set, const char *id,
+                                        lsm_pool **pool);
+
+/**
+ * lsm_pool_set_find_system_id - Looks the pools of a system up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the pools of the given system.
+ */
+int LSM_DLL_EXPORT lsm_pool_set_find_system_id(lsm_pool_set *set,
+                                               const char *system_id,
+                                               lsm_pool **pools[],
+                                               uint32_t *count);
+
+/**
+ * lsm_access_group_set_alloc - Indexes the access groups of a list reply
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_alloc() for access groups, as from
+ *      lsm_access_group_list().
+ */
+lsm_access_group_set LSM_DLL_EXPORT *
+lsm_access_group_set_alloc(lsm_access_group *groups[], uint32_t count);
+
+/**
+ * lsm_access_group_set_free - Frees an access group set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_free() for access groups.
+ */
+int LSM_DLL_EXPORT lsm_access_group_set_free(lsm_access_group_set *set);
+
+/**
+ * lsm_access_group_set_records_get - Retrieves all access groups of a set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_records_get() for access groups.
+ */
+int LSM_DLL_EXPORT lsm_access_group_set_records_get(
+    lsm_access_group_set *set, lsm_access_group **groups[], uint32_t *count);
+
+/**
+ * lsm_access_group_set_find_id - Looks an access group up by its id
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_id() for access groups.
+ */
+int LSM_DLL_EXPORT lsm_access_group_set_find_id(lsm_access_group_set *set,
+                                                const char *id,
+                                                lsm_access_group **group);
+
+/**
+ * lsm_access_group_set_find_system_id - Looks the access groups of a system
+ * up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the access groups of the given
+ *      system.
+ */
+int LSM_DLL_EXPORT lsm_access_group_set_find_system_id(
+    lsm_access_group_set *set, const char *system_id,
+    lsm_access_group **groups[], uint32_t *count);
+
+/**
+ * lsm_access_group_set_find_init_id - Looks access groups up by initiator
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the access groups holding the
+ *      given initiator.  A WWPN is compared the way access groups store
+ *      it: lower case, with ':' for any separator and without "0x".
+ */
+int LSM_DLL_EXPORT lsm_access_group_set_find_init_id(
+    lsm_access_group_set *set, const char *init_id,
+    lsm_access_group **groups[], uint32_t *count);
+
+/**
+ * lsm_fs_set_alloc - Indexes the file systems of a list reply
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_alloc() for file systems, as from lsm_fs_list().
+ */
+lsm_fs_set LSM_DLL_EXPORT *lsm_fs_set_alloc(lsm_fs *fs[], uint32_t count);
+
+/**
+ * lsm_fs_set_free - Frees a file system set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_free() for file systems.
+ */
+int LSM_DLL_EXPORT lsm_fs_set_free(lsm_fs_set *set);
+
+/**
+ * lsm_fs_set_records_get - Retrieves all file systems of a set
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_records_get() for file systems.
+ */
+int LSM_DLL_EXPORT lsm_fs_set_records_get(lsm_fs_set *set, lsm_fs **fs[],
+                                          uint32_t *count);
+
+/**
+ * lsm_fs_set_find_id - Looks a file system up by its id
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_id() for file systems.
+ */
+int LSM_DLL_EXPORT lsm_fs_set_find_id(lsm_fs_set *set, const char *id,
+                                      lsm_fs **fs);
+
+/**
+ * lsm_fs_set_find_pool_id - Looks the file systems of a pool up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for file systems.
+ */
+int LSM_DLL_EXPORT lsm_fs_set_find_pool_id(lsm_fs_set *set,
+                                           const char *pool_id,
+                                           lsm_fs **fs[], uint32_t *count);
+
+/**
+ * lsm_fs_set_find_system_id - Looks the file systems of a system up
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Like lsm_volume_set_find_pool_id() for the file systems of the given
+ *      system.
+ */
+int LSM_DLL_EXPORT lsm_fs_set_find_system_id(lsm_fs_set *set,
+                                             const char *system_id,
+                                             lsm_fs **fs[], uint32_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LIBSTORAGEMGMT_RECORD_SET_H */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LIBSTORAGEMGMT_STREAM_H
+#define LIBSTORAGEMGMT_STREAM_H
+
+#include "libstoragemgmt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Callback of lsm_list_stream() taking a record.
+ * @param record    Record of the list, as lsm_volume pointer for volumes,
+ *                  free with the record free function of its type
+ * @param user_data Pointer given to lsm_list_stream()
+ * @return LSM_ERR_OK to take the next record, else stops the list, which
+ *         returns it
+ */
+typedef int (*lsm_list_stream_cb)(void *record, void *user_data);
+
+/**
+ * lsm_list_stream - Retrieves a list a record at a time
+ * Version:
+ *      1.10
+ *
+ * Description:
+ *      Retrieves one list, optionally searched like lsm_volume_list() and
+ *      the like, handing each record to 'cb' as soon as it was received
+ *      rather than once the whole reply was.  Records of long lists are
+ *      used while the plug-in is still sending the rest.  Records come in
+ *      the order the plug-in lists them, from the thread calling
+ *      lsm_list_stream().
+ *
+ * @conn:
+ *      Valid connection @see lsm_connect_password().
+ * @list:
+ *      uint64_t. One LSM_MULTI_LIST_XXX.
+ * @search_key:
+ *      String. Search key, NULL for all records.  The systems list takes
+ *      none, the others the ones of lsm_volume_list() and the like.
+ * @search_value:
+ *      String. Search value, NULL when 'search_key' is NULL.
+ * @cb:
+ *      lsm_list_stream_cb. Takes each record.
+ * @user_data:
+ *      Pointer handed to 'cb'.
+ * @flags:
+ *      Reserved for future use, must be LSM_CLIENT_FLAG_RSVD.
+ *
+ * Return:
+ *      Error code as enumerated by 'lsm_error_number':
+ *          * LSM_ERR_OK
+ *              On success.
+ *          * LSM_ERR_INVALID_ARGUMENT
+ *              When any argument is invalid.
+ *          * LSM_ERR_UNSUPPORTED_SEARCH_KEY
+ *              When the list does not support 'search_key'.
+ *          * LSM_ERR_NO_MEMORY
+ *              On memory exhaustion.
+ *          * LSM_ERR_TRANSPORT_COMMUNICATION
+ *              When talking to the plug-in failed.
+ *          * LSM_ERR_PLUGIN_BUG
+ *              When the plug-in replied invalid records.
+ *          * Anything else 'cb' returned or the plug-in failed with.
+ *      Records taken before an error stay with 'cb'.
+ */
+int LSM_DLL_EXPORT lsm_list_stream(lsm_connect *conn, uint64_t list,
+                                   const char *search_key,
+                                   const char *search_value,
+                                   lsm_list_stream_cb cb, void *user_data,
+                                   lsm_flag flags);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LIBSTORAGEMGMT_STREAM_H */
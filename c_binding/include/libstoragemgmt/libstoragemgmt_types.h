@@ -128,6 +128,56 @@ typedef struct _lsm_target_port lsm_target_port;
  */
 typedef struct _lsm_battery lsm_battery;
 
+/**
+ * Opaque data type for a change of a storage object
+ */
+typedef struct _lsm_event lsm_event;
+
+/**
+ * Opaque data type for the VPD83 index of local disks
+ */
+typedef struct _lsm_local_disk_index lsm_local_disk_index;
+
+/**
+ * Opaque data type for listing many storage arrays at once
+ */
+typedef struct _lsm_multi lsm_multi;
+
+/**
+ * Opaque data type for one list of one storage array of an lsm_multi
+ */
+typedef struct _lsm_multi_result lsm_multi_result;
+
+/**
+ * Opaque data type for list calls sent to a plug-in in one message
+ */
+typedef struct _lsm_batch lsm_batch;
+
+/**
+ * Opaque data type for indexed volumes of a list reply
+ */
+typedef struct _lsm_volume_set lsm_volume_set;
+
+/**
+ * Opaque data type for indexed disks of a list reply
+ */
+typedef struct _lsm_disk_set lsm_disk_set;
+
+/**
+ * Opaque data type for indexed pools of a list reply
+ */
+typedef struct _lsm_pool_set lsm_pool_set;
+
+/**
+ * Opaque data type for indexed access groups of a list reply
+ */
+typedef struct _lsm_access_group_set lsm_access_group_set;
+
+/**
+ * Opaque data type for indexed file systems of a list reply
+ */
+typedef struct _lsm_fs_set lsm_fs_set;
+
 /** \enum lsm_replication_type Different types of replications that can be
  * created */
 typedef enum {
@@ -449,6 +499,43 @@ typedef enum {
 #define LSM_SYSTEM_READ_CACHE_PCT_NO_SUPPORT -2
 #define LSM_SYSTEM_READ_CACHE_PCT_UNKNOWN    -1
 
+/** \enum lsm_event_type What happened to the object of an event */
+typedef enum {
+    /** Unknown */
+    LSM_EVENT_TYPE_UNKNOWN = 0,
+    /** Object showed up */
+    LSM_EVENT_TYPE_CREATED = 1,
+    /** Some property other than the status changed */
+    LSM_EVENT_TYPE_MODIFIED = 2,
+    /** Object is gone, the event holds its last known state */
+    LSM_EVENT_TYPE_DELETED = 3,
+    /** Status of the object changed */
+    LSM_EVENT_TYPE_HEALTH = 4,
+} lsm_event_type;
+
+/** Unknown or invalid lsm_event pointer. */
+#define LSM_EVENT_CLASS_UNKNOWN 0x0000000000000000
+#define LSM_EVENT_CLASS_SYSTEM  0x0000000000000001
+#define LSM_EVENT_CLASS_POOL    0x0000000000000002
+#define LSM_EVENT_CLASS_VOLUME  0x0000000000000004
+#define LSM_EVENT_CLASS_DISK    0x0000000000000008
+#define LSM_EVENT_CLASS_ALL     0x000000000000000F
+
+/**
+ * Lists retrieved by lsm_multi_run(), in this order for each array, also the
+ * lists lsm_batch_list_add() and lsm_list_stream() take.
+ */
+#define LSM_MULTI_LIST_SYSTEMS       0x0000000000000001
+#define LSM_MULTI_LIST_POOLS         0x0000000000000002
+#define LSM_MULTI_LIST_VOLUMES       0x0000000000000004
+#define LSM_MULTI_LIST_DISKS         0x0000000000000008
+#define LSM_MULTI_LIST_ACCESS_GROUPS 0x0000000000000010
+#define LSM_MULTI_LIST_FS            0x0000000000000020
+#define LSM_MULTI_LIST_NFS_EXPORTS   0x0000000000000040
+#define LSM_MULTI_LIST_TARGET_PORTS  0x0000000000000080
+#define LSM_MULTI_LIST_BATTERIES     0x0000000000000100
+#define LSM_MULTI_LIST_ALL           0x00000000000001FF
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "libstoragemgmt/libstoragemgmt.h"
+#include "libstoragemgmt/libstoragemgmt_plug_interface.h"
+#include "lsm_datatypes.hpp"
+#include "lsm_ipc.hpp"
+#include "lsm_schema.hpp"
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * Method, search keys and records of each list.
+ */
+static const struct LSM_DLL_LOCAL batch_list {
+    uint64_t list;            /**< LSM_MULTI_LIST_XXX */
+    const char *method;       /**< Method listing the records */
+    const lsm_schema *schema; /**< Schema of the records */
+    const char *keys[4];      /**< Search keys, NULL terminated */
+} BATCH_LISTS[] = {
+    {LSM_MULTI_LIST_SYSTEMS, "systems", &SYSTEM_SCHEMA, {NULL}},
+    {LSM_MULTI_LIST_POOLS, "pools", &POOL_SCHEMA, {"id", "system_id", NULL}},
+    {LSM_MULTI_LIST_VOLUMES,
+     "volumes",
+     &VOLUME_SCHEMA,
+     {"id", "system_id", "pool_id", NULL}},
+    {LSM_MULTI_LIST_DISKS, "disks", &DISK_SCHEMA, {"id", "system_id", NULL}},
+    {LSM_MULTI_LIST_ACCESS_GROUPS,
+     "access_groups",
+     &ACCESS_GROUP_SCHEMA,
+     {"id", "system_id", NULL}},
+    {LSM_MULTI_LIST_FS, "fs", &FS_SCHEMA, {"id", "system_id", "pool_id", NULL}},
+    {LSM_MULTI_LIST_NFS_EXPORTS,
+     "exports",
+     &NFS_EXPORT_SCHEMA,
+     {"id", "fs_id", NULL}},
+    {LSM_MULTI_LIST_TARGET_PORTS,
+     "target_ports",
+     &TARGET_PORT_SCHEMA,
+     {"id", "system_id", NULL}},
+    {LSM_MULTI_LIST_BATTERIES,
+     "batteries",
+     &BATTERY_SCHEMA,
+     {"id", "system_id", NULL}}};
+
+#define BATCH_LIST_COUNT (sizeof(BATCH_LISTS) / sizeof(BATCH_LISTS[0]))
+
+/**
+ * List call of a batch with its result.
+ */
+struct LSM_DLL_LOCAL batch_call {
+    const batch_list *list; /**< What to list */
+    Value params;           /**< Parameters of the method */
+    int rc;                 /**< Error code */
+    char *message;          /**< Error message, NULL for none */
+    void **records;         /**< Records of the list */
+    uint32_t count;         /**< Number of records */
+};
+
+struct LSM_DLL_LOCAL _lsm_batch {
+    uint32_t magic;                /**< Magic, used for structure validation */
+    bool done;                     /**< Calls have results */
+    std::vector<batch_call> calls; /**< Calls in the order they were added */
+};
+
+static void results_free(lsm_batch *b) {
+    for (size_t i = 0; i < b->calls.size(); ++i) {
+        batch_call &call = b->calls[i];
+
+        if (call.records) {
+            for (uint32_t j = 0; j < call.count; ++j) {
+                call.list->schema->record_free(call.records[j]);
+            }
+            free(call.records);
+        }
+        free(call.message);
+        call.rc = LSM_ERR_OK;
+        call.message = NULL;
+        call.records = NULL;
+        call.count = 0;
+    }
+    b->done = false;
+}
+
+static void call_error(batch_call &call, int rc, const std::string &message) {
+    call.rc = rc;
+    if (message.size()) {
+        call.message = strdup(message.c_str());
+    }
+}
+
+/**
+ * Takes the result of a call from a reply.
+ * @param call      Call
+ * @param m         Message holding the reply
+ * @param result    Token of the result, -1 when the reply has an error
+ * @param reply     Token of the reply
+ */
+static void call_reply(batch_call &call, const Message &m, int result,
+                       int reply) {
+    try {
+        if (result >= 0) {
+            call.rc = schema_array_decode(*call.list->schema, m, result,
+                                          &call.records, &call.count);
+        } else {
+            Value error = m.value(reply)["error"];
+
+            call_error(call, error["code"].asInt32_t(),
+                       error["message"].asString());
+        }
+    } catch (const ValueException &ve) {
+        call_error(call, LSM_ERR_PLUGIN_BUG, "Unexpected type");
+    }
+}
+
+/**
+ * Runs the calls one after the other, for plug-ins not taking batches.
+ */
+static void calls_run(lsm_connect *c, lsm_batch *b) {
+    for (size_t i = 0; i < b->calls.size(); ++i) {
+        batch_call &call = b->calls[i];
+        Message response;
+        int result = -1;
+
+        try {
+            result = c->tp->rpc(call.list->method, call.params, response);
+        } catch (const LsmException &le) {
+            if (LSM_ERR_TRANSPORT_COMMUNICATION == le.error_code) {
+                throw;
+            }
+            call_error(call, le.error_code, le.what());
+            continue;
+        }
+        call_reply(call, response, result, 0);
+    }
+}
+
+static void batch_run(lsm_connect *c, lsm_batch *b) {
+    std::vector<std::pair<std::string, Value> > requests;
+    Message response;
+
+    for (size_t i = 0; i < b->calls.size(); ++i) {
+        requests.push_back(std::make_pair(
+            std::string(b->calls[i].list->method), b->calls[i].params));
+    }
+
+    int reply = c->tp->batchRpc(requests, response);
+    for (size_t i = 0; i < b->calls.size(); ++i) {
+        call_reply(b->calls[i], response, response.member(reply, "result"),
+                   reply);
+        reply = response.next(reply);
+    }
+}
+
+lsm_batch *lsm_batch_alloc(void) {
+    lsm_batch *b = new (std::nothrow) _lsm_batch();
+
+    if (b) {
+        b->magic = LSM_BATCH_MAGIC;
+        b->done = false;
+    }
+    return b;
+}
+
+static bool search_key_check(const batch_list *l, const char *key) {
+    for (size_t i = 0; l->keys[i]; ++i) {
+        if (!strcmp(l->keys[i], key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int lsm_batch_list_add(lsm_batch *b, uint64_t list, const char *search_key,
+                       const char *search_value) {
+    const batch_list *l = NULL;
+
+    if (!LSM_IS_BATCH(b) || (!search_key != !search_value)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < BATCH_LIST_COUNT; ++i) {
+        if (BATCH_LISTS[i].list == list) {
+            l = &BATCH_LISTS[i];
+        }
+    }
+    if (!l || (search_key && !l->keys[0])) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    if (search_key && !search_key_check(l, search_key)) {
+        return LSM_ERR_UNSUPPORTED_SEARCH_KEY;
+    }
+
+    try {
+        std::map<std::string, Value> p;
+        batch_call call;
+
+        p["flags"] = Value((uint64_t)LSM_CLIENT_FLAG_RSVD);
+        if (l->keys[0]) {
+            p["search_key"] = Value(search_key);
+            p["search_value"] = Value(search_value);
+        }
+
+        call.list = l;
+        call.params = Value(p);
+        call.rc = LSM_ERR_OK;
+        call.message = NULL;
+        call.records = NULL;
+        call.count = 0;
+
+        results_free(b);
+        b->calls.push_back(call);
+    } catch (const std::bad_alloc &) {
+        return LSM_ERR_NO_MEMORY;
+    }
+    return LSM_ERR_OK;
+}
+
+uint32_t lsm_batch_count_get(lsm_batch *b) {
+    if (LSM_IS_BATCH(b)) {
+        return b->calls.size();
+    }
+    return 0;
+}
+
+int lsm_batch_submit(lsm_connect *c, lsm_batch *b, lsm_flag flags) {
+    int rc = LSM_ERR_OK;
+    const char *message = NULL;
+    const char *exception = NULL;
+
+    if (!LSM_IS_CONNECT(c) || !LSM_IS_BATCH(b) ||
+        LSM_FLAG_UNUSED_CHECK(flags)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    lsm_error_free(c->error);
+    c->error = NULL;
+    results_free(b);
+
+    try {
+        if (c->batch) {
+            batch_run(c, b);
+        } else {
+            calls_run(c, b);
+        }
+        b->done = true;
+    } catch (const ValueException &ve) {
+        rc = LSM_ERR_TRANSPORT_SERIALIZATION;
+        message = "Serialization error";
+        exception = ve.what();
+    } catch (const LsmException &le) {
+        rc = le.error_code;
+        message = le.what();
+    } catch (const EOFException &eof) {
+        rc = LSM_ERR_TRANSPORT_COMMUNICATION;
+        message = "Plug-in died";
+        exception = "Check syslog";
+    } catch (const std::bad_alloc &) {
+        rc = LSM_ERR_NO_MEMORY;
+    } catch (...) {
+        rc = LSM_ERR_LIB_BUG;
+        message = "Unexpected exception";
+    }
+
+    if (LSM_ERR_OK != rc) {
+        results_free(b);
+        if (message) {
+            c->error = lsm_error_create((lsm_error_number)rc, message,
+                                        exception, NULL, NULL, 0);
+        }
+    }
+    return rc;
+}
+
+int lsm_batch_result_error_get(lsm_batch *b, uint32_t i,
+                               const char **message) {
+    if (!LSM_IS_BATCH(b) || !b->done || i >= b->calls.size()) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    if (message) {
+        *message = b->calls[i].message;
+    }
+    return b->calls[i].rc;
+}
+
+int lsm_batch_result_records_get(lsm_batch *b, uint32_t i, void ***records,
+                                 uint32_t *count) {
+    if (!LSM_IS_BATCH(b) || !b->done || i >= b->calls.size() || !records ||
+        !count) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    *records = b->calls[i].records;
+    *count = b->calls[i].count;
+    return LSM_ERR_OK;
+}
+
+int lsm_batch_free(lsm_batch *b) {
+    if (!LSM_IS_BATCH(b)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    results_free(b);
+    b->magic = LSM_DEL_MAGIC(LSM_BATCH_MAGIC);
+    delete b;
+    return LSM_ERR_OK;
+}
@@ -81,20 +81,12 @@ lsm_volume LSM_DLL_LOCAL *value_to_volume(Value &vol);
 /**
  * Converts a lsm_volume *to a Value
  * @param vol lsm_volume to convert
+ * @param fields Attributes to include besides "class" and "id", NULL
+ *               for all of them
  * @return Value
  */
-Value LSM_DLL_LOCAL volume_to_value(lsm_volume *vol);
-
-/**
- * Converts a vector of volume values to an array
- * @param volume_values     Vector of values that represents volumes
- * @param volumes           An array of volume pointers
- * @param count             Number of volumes
- * @return LSM_ERR_OK on success, else error reason
- */
-int LSM_DLL_LOCAL value_array_to_volumes(Value &volume_values,
-                                         lsm_volume **volumes[],
-                                         uint32_t *count);
+Value LSM_DLL_LOCAL volume_to_value(lsm_volume *vol,
+                                    const std::set<std::string> *fields = NULL);
 
 /**
  * Converts a Value to a lsm_disk
@@ -106,9 +98,12 @@ lsm_disk LSM_DLL_LOCAL *value_to_disk(Value &disk);
 /**
  * Converts a lsm_disk to a value
  * @param disk  lsm_disk to convert to value
+ * @param fields Attributes to include besides "class" and "id", NULL
+ *               for all of them
  * @return Value
  */
-Value LSM_DLL_LOCAL disk_to_value(lsm_disk *disk);
+Value LSM_DLL_LOCAL disk_to_value(lsm_disk *disk,
+                                  const std::set<std::string> *fields = NULL);
 
 /**
  * Converts a vector of disk values to an array.
@@ -130,9 +125,12 @@ lsm_pool LSM_DLL_LOCAL *value_to_pool(Value &pool);
 /**
  * Converts a lsm_pool * to Value
  * @param pool Pool pointer to convert
+ * @param fields Attributes to include besides "class" and "id", NULL
+ *               for all of them
  * @return Value
  */
-Value LSM_DLL_LOCAL pool_to_value(lsm_pool *pool);
+Value LSM_DLL_LOCAL pool_to_value(lsm_pool *pool,
+                                  const std::set<std::string> *fields = NULL);
 
 /**
  * Converts a value to a system
@@ -144,9 +142,12 @@ lsm_system LSM_DLL_LOCAL *value_to_system(Value &system);
 /**
  * Converts a lsm_system * to a Value
  * @param system pointer to convert to Value
+ * @param fields Attributes to include besides "class" and "id", NULL
+ *               for all of them
  * @return Value
  */
-Value LSM_DLL_LOCAL system_to_value(lsm_system *system);
+Value LSM_DLL_LOCAL system_to_value(lsm_system *system,
+                                    const std::set<std::string> *fields = NULL);
 
 /**
  * Converts a Value to a lsm_access_group
@@ -162,26 +163,6 @@ lsm_access_group LSM_DLL_LOCAL *value_to_access_group(Value &group);
  */
 Value LSM_DLL_LOCAL access_group_to_value(lsm_access_group *group);
 
-/**
- * Converts an access group list to an array of access group pointers
- * @param[in] group         Value representing a std::vector of access groups
- * @param[out] ag_list      Access group array
- * @param[out] count        Number of items in the returned array.
- * @return LSM_ERR_OK on success, else error reason
- */
-int LSM_DLL_LOCAL value_array_to_access_groups(Value &group,
-                                               lsm_access_group **ag_list[],
-                                               uint32_t *count);
-
-/**
- * Converts an array of lsm_access_group to Value(s)
- * @param group             Pointer to an array of lsm_access_group
- * @param count             Number of items in array.
- * @return std::vector of Values representing access groups
- */
-Value LSM_DLL_LOCAL access_group_list_to_value(lsm_access_group **group,
-                                               uint32_t count);
-
 /**
  * Converts a Value to a lsm_block_range
  * @param br        Value representing a block range
@@ -311,13 +292,10 @@ lsm_battery LSM_DLL_LOCAL *value_to_battery(Value &battery);
 Value LSM_DLL_LOCAL battery_to_value(lsm_battery *battery);
 
 /**
- * Converts a vector of battery values to an array.
- * @param[in]  battery_values       Vector of values that represents batteries.
- * @param[out] bs                   An array of battery pointers
- * @param[out] count                Number of batteries
- * @return LSM_ERR_OK on success, else error reason.
+ * Converts a Value to a lsm_event
+ * @param event     Value representing an event, "type" and the "object"
+ * @return lsm_event pointer, else NULL on error
  */
-int LSM_DLL_LOCAL value_array_to_batteries(Value &battery_values,
-                                           lsm_battery **bs[], uint32_t *count);
+lsm_event LSM_DLL_LOCAL *value_to_event(Value &event);
 
 #endif
@@ -32,6 +32,7 @@
 #include "libstoragemgmt/libstoragemgmt_common.h"
 #include "libstoragemgmt/libstoragemgmt_disk.h"
 #include "libstoragemgmt/libstoragemgmt_error.h"
+#include "libstoragemgmt/libstoragemgmt_event.h"
 #include "libstoragemgmt/libstoragemgmt_fs.h"
 #include "libstoragemgmt/libstoragemgmt_nfsexport.h"
 #include "libstoragemgmt/libstoragemgmt_plug_interface.h"
@@ -240,17 +241,42 @@ static int connection_establish(lsm_connect *c, const char *password,
         params["flags"] = Value(flags);
         Value p(params);
 
-        c->tp->rpc("plugin_register", p);
+        Value r = c->tp->rpc("plugin_register", p);
+
+        /* Plug-ins taking batches say so, older ones reply null */
+        c->batch = r.hasKey("batch") &&
+                   Value::boolean_t == r["batch"].valueType() &&
+                   r["batch"].asBool();
+
+        /* Plug-ins taking CBOR list it, the exchange so far was JSON */
+        if (r.hasKey("encodings") &&
+            Value::array_t == r["encodings"].valueType()) {
+            std::vector<Value> encodings = r["encodings"].asArray();
+
+            for (size_t i = 0; i < encodings.size(); ++i) {
+                if (Value::string_t == encodings[i].valueType() &&
+                    encodings[i].asString() == "cbor") {
+                    c->tp->encodingSet(Payload::CBOR);
+                }
+            }
+        }
     } catch (const ValueException &ve) {
         *e = lsm_error_create(LSM_ERR_TRANSPORT_SERIALIZATION,
                               "Error in serialization", ve.what(), NULL, NULL,
                               0);
         rc = LSM_ERR_TRANSPORT_SERIALIZATION;
     } catch (const LsmException &le) {
-        *e = lsm_error_create(LSM_ERR_TRANSPORT_COMMUNICATION,
-                              "Error in communication", le.what(), NULL, NULL,
-                              0);
-        rc = LSM_ERR_TRANSPORT_COMMUNICATION;
+        if (LSM_ERR_DAEMON_BUSY == le.error_code) {
+            /* lsmd refused to start the plug-in for us */
+            *e = lsm_error_create(LSM_ERR_DAEMON_BUSY, le.what(), NULL, NULL,
+                                  NULL, 0);
+            rc = LSM_ERR_DAEMON_BUSY;
+        } else {
+            *e = lsm_error_create(LSM_ERR_TRANSPORT_COMMUNICATION,
+                                  "Error in communication", le.what(), NULL,
+                                  NULL, 0);
+            rc = LSM_ERR_TRANSPORT_COMMUNICATION;
+        }
     } catch (...) {
         *e = lsm_error_create(LSM_ERR_LIB_BUG, "Undefined exception", NULL,
                               NULL, NULL, 0);
@@ -270,7 +296,7 @@ const char *uds_path(void) {
 
 int driver_load(lsm_connect *c, const char *plugin_name, const char *password,
                 uint32_t timeout, lsm_error_ptr *e, int startup,
-                lsm_flag flags) {
+                uint32_t wait_ms, lsm_flag flags) {
     int rc = LSM_ERR_OK;
     char *plugin_file = NULL;
     const char *plugin_dir = uds_path();
@@ -288,8 +314,10 @@ int driver_load(lsm_connect *c, const char *plugin_name, const char *password,
 
             if (sd >= 0) {
                 c->tp = new Ipc(sd);
+                c->tp->waitLimitSet(wait_ms);
                 if (startup) {
-                    if (connection_establish(c, password, timeout, e, flags)) {
+                    rc = connection_establish(c, password, timeout, e, flags);
+                    if (rc && LSM_ERR_DAEMON_BUSY != rc) {
                         rc = LSM_ERR_PLUGIN_IPC_FAIL;
                     }
                 }
@@ -1862,6 +1890,91 @@ MEMBER_FUNC_GET(uint64_t, lsm_battery, LSM_IS_BATTERY, status,
 MEMBER_FUNC_GET(lsm_battery_type, lsm_battery, LSM_IS_BATTERY, type,
                 LSM_BATTERY_TYPE_UNKNOWN);
 
+static void event_object_free(uint64_t event_class, void *object) {
+    switch (event_class) {
+    case (LSM_EVENT_CLASS_SYSTEM):
+        lsm_system_record_free((lsm_system *)object);
+        break;
+    case (LSM_EVENT_CLASS_POOL):
+        lsm_pool_record_free((lsm_pool *)object);
+        break;
+    case (LSM_EVENT_CLASS_VOLUME):
+        lsm_volume_record_free((lsm_volume *)object);
+        break;
+    case (LSM_EVENT_CLASS_DISK):
+        lsm_disk_record_free((lsm_disk *)object);
+        break;
+    default:
+        break;
+    }
+}
+
+lsm_event *lsm_event_record_alloc(lsm_event_type type, uint64_t event_class,
+                                  void *object) {
+    lsm_event *rc = (lsm_event *)calloc(1, sizeof(lsm_event));
+    if (rc) {
+        rc->magic = LSM_EVENT_MAGIC;
+        rc->type = type;
+        rc->event_class = event_class;
+        rc->object = object;
+    } else {
+        event_object_free(event_class, object);
+    }
+    return rc;
+}
+
+int lsm_event_record_free(lsm_event *e) {
+    if (LSM_IS_EVENT(e)) {
+        e->magic = LSM_DEL_MAGIC(LSM_EVENT_MAGIC);
+        event_object_free(e->event_class, e->object);
+        e->object = NULL;
+        free(e);
+        return LSM_ERR_OK;
+    }
+    return LSM_ERR_INVALID_ARGUMENT;
+}
+
+MEMBER_FUNC_GET(lsm_event_type, lsm_event, LSM_IS_EVENT, type,
+                LSM_EVENT_TYPE_UNKNOWN);
+
+uint64_t lsm_event_class_get(lsm_event *e) {
+    if (LSM_IS_EVENT(e)) {
+        return e->event_class;
+    }
+    return LSM_EVENT_CLASS_UNKNOWN;
+}
+
+const char *lsm_event_id_get(lsm_event *e) {
+    if (LSM_IS_EVENT(e)) {
+        switch (e->event_class) {
+        case (LSM_EVENT_CLASS_SYSTEM):
+            return lsm_system_id_get((lsm_system *)e->object);
+        case (LSM_EVENT_CLASS_POOL):
+            return lsm_pool_id_get((lsm_pool *)e->object);
+        case (LSM_EVENT_CLASS_VOLUME):
+            return lsm_volume_id_get((lsm_volume *)e->object);
+        case (LSM_EVENT_CLASS_DISK):
+            return lsm_disk_id_get((lsm_disk *)e->object);
+        default:
+            break;
+        }
+    }
+    return NULL;
+}
+
+#define EVENT_OBJECT_GET(name, type, class_mask)                               \
+    type *name(lsm_event *e) {                                                 \
+        if (LSM_IS_EVENT(e) && e->event_class == (class_mask)) {               \
+            return (type *)e->object;                                          \
+        }                                                                      \
+        return NULL;                                                           \
+    }
+
+EVENT_OBJECT_GET(lsm_event_system_get, lsm_system, LSM_EVENT_CLASS_SYSTEM);
+EVENT_OBJECT_GET(lsm_event_pool_get, lsm_pool, LSM_EVENT_CLASS_POOL);
+EVENT_OBJECT_GET(lsm_event_volume_get, lsm_volume, LSM_EVENT_CLASS_VOLUME);
+EVENT_OBJECT_GET(lsm_event_disk_get, lsm_disk, LSM_EVENT_CLASS_DISK);
+
 #ifdef __cplusplus
 }
 #endif
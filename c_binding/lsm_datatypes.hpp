@@ -27,6 +27,8 @@
 #include "libxml/uri.h"
 #include "lsm_ipc.hpp"
 #include <glib.h>
+#include <set>
+#include <string>
 
 #ifdef __cplusplus
 extern "C" {
@@ -174,6 +176,10 @@ struct _lsm_system {
 #define LSM_PLUGIN_MAGIC   0xAA7A000B
 #define LSM_IS_PLUGIN(obj) MAGIC_CHECK(obj, LSM_PLUGIN_MAGIC)
 
+struct _lsm_subscription;
+struct _lsm_job_executor;
+struct _lsm_request_pool;
+
 /**
  * Information pertaining to the plug-in specifics.
  */
@@ -192,6 +198,20 @@ struct LSM_DLL_LOCAL _lsm_plugin {
     struct lsm_fs_ops_v1 *fs_ops;     /**< Callbacks for fs ops */
     struct lsm_ops_v1_2 *ops_v1_2;    /**< Callbacks for v1.2 ops */
     struct lsm_ops_v1_3 *ops_v1_3;    /**< Callbacks for v1.3 ops */
+    const std::set<std::string> *fields; /**< Attributes asked for by the
+                                              list request being served,
+                                              NULL for all of them */
+    lsm_plug_changes_get changes_get; /**< Changes reported by plug-in */
+    int changes_fd;                   /**< Readable on changes, or -1 */
+    struct _lsm_subscription *sub;    /**< Changes the client wants */
+    struct _lsm_job_executor *jobs;   /**< Jobs run by the runtime, NULL
+                                           until the first one is queued */
+    uint32_t workers;                 /**< Request workers wanted, 0 to
+                                           answer requests on the loop */
+    lsm_plug_worker_init worker_init;       /**< Prepares a worker */
+    lsm_plug_worker_cleanup worker_cleanup; /**< Releases a worker */
+    struct _lsm_request_pool *pool;   /**< Request workers, NULL until
+                                           the first request for them */
 };
 
 /**
@@ -205,6 +225,7 @@ struct LSM_DLL_LOCAL _lsm_connect {
     char *raw_uri;    /**< Raw URI string */
     lsm_error *error; /**< Error information */
     Ipc *tp;          /**< IPC transport */
+    bool batch;       /**< Plug-in takes batches of requests */
 };
 
 #define LSM_ERROR_MAGIC   0xAA7A000C
@@ -312,6 +333,41 @@ struct LSM_DLL_LOCAL _lsm_battery {
     char *plugin_data;
 };
 
+#define LSM_EVENT_MAGIC   0xAA7A0014
+#define LSM_IS_EVENT(obj) MAGIC_CHECK(obj, LSM_EVENT_MAGIC)
+struct LSM_DLL_LOCAL _lsm_event {
+    uint32_t magic;
+    lsm_event_type type;
+    uint64_t event_class; /**< LSM_EVENT_CLASS_XXX of object */
+    void *object;         /**< lsm_system, lsm_pool, lsm_volume or lsm_disk */
+};
+
+#define LSM_PLUG_JOB_MAGIC   0xAA7A0015
+#define LSM_IS_PLUG_JOB(obj) MAGIC_CHECK(obj, LSM_PLUG_JOB_MAGIC)
+
+#define LSM_MULTI_MAGIC   0xAA7A0016
+#define LSM_IS_MULTI(obj) MAGIC_CHECK(obj, LSM_MULTI_MAGIC)
+
+#define LSM_MULTI_RESULT_MAGIC   0xAA7A0017
+#define LSM_IS_MULTI_RESULT(obj) MAGIC_CHECK(obj, LSM_MULTI_RESULT_MAGIC)
+
+#define LSM_RECORD_SET_MAGIC   0xAA7A0018
+#define LSM_IS_RECORD_SET(obj) MAGIC_CHECK(obj, LSM_RECORD_SET_MAGIC)
+
+#define LSM_BATCH_MAGIC   0xAA7A0019
+#define LSM_IS_BATCH(obj) MAGIC_CHECK(obj, LSM_BATCH_MAGIC)
+
+/**
+ * Returns a newly created event, owning object, which is freed on errors.
+ * @param type          What happened to the object
+ * @param event_class   LSM_EVENT_CLASS_XXX telling the type of object
+ * @param object        Record of the object
+ * @return NULL on memory exhaustion, else new event.
+ */
+lsm_event LSM_DLL_LOCAL *lsm_event_record_alloc(lsm_event_type type,
+                                                uint64_t event_class,
+                                                void *object);
+
 /**
  * Returns a pointer to a newly created connection structure.
  * @return NULL on memory exhaustion, else new connection.
@@ -332,12 +388,32 @@ void LSM_DLL_LOCAL connection_free(lsm_connect *c);
  * @param timeout       Initial timeout
  * @param e             Error data
  * @param startup       If non zero call rpc start_up, else skip
+ * @param wait_ms       Most milliseconds to wait for the plug-in, 0 for no
+ *                      limit
  * @param flags         Reserved flag for future use
  * @return LSM_ERR_OK on success, else error code.
  */
 int LSM_DLL_LOCAL driver_load(lsm_connect *c, const char *plugin,
                               const char *password, uint32_t timeout,
-                              lsm_error_ptr *e, int startup, lsm_flag flags);
+                              lsm_error_ptr *e, int startup, uint32_t wait_ms,
+                              lsm_flag flags);
+
+/**
+ * Connects to a plug-in, as lsm_connect_password() does.
+ * @param uri           URI of the array
+ * @param password      Password, NULL for none
+ * @param conn          New connection
+ * @param timeout       Timeout for the plug-in
+ * @param wait_ms       Most milliseconds to wait for each message of the
+ *                      plug-in, 0 for no limit
+ * @param e             Error data
+ * @param flags         Reserved flag for future use
+ * @return LSM_ERR_OK on success, else error code.
+ */
+int LSM_DLL_LOCAL connection_open(const char *uri, const char *password,
+                                  lsm_connect **conn, uint32_t timeout,
+                                  uint32_t wait_ms, lsm_error_ptr *e,
+                                  lsm_flag flags);
 
 char LSM_DLL_LOCAL *capability_string(lsm_storage_capabilities *c);
 
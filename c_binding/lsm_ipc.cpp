@@ -17,6 +17,7 @@
  */
 
 #include "lsm_ipc.hpp"
+#include "lsm_json_index.hpp"
 
 #include "libstoragemgmt/libstoragemgmt_plug_interface.h"
 
@@ -26,8 +27,11 @@
 #include <iostream>
 #include <limits.h>
 #include <list>
+#include <math.h>
+#include <poll.h>
 #include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -103,7 +107,35 @@ static std::string string_read(int fd, size_t count, int &error_code) {
         throw EOFException("");
 }
 
-std::string Transport::msg_recv(int &error_code) {
+/*
+ * Reads count bytes into a string of that size, as they arrive, showing
+ * them to sink after each read.
+ */
+static std::string chunks_read(int fd, size_t count, ChunkSink &sink,
+                               int &error_code) {
+    std::string rc(count, '\0');
+    size_t amount_read = 0;
+
+    error_code = 0;
+
+    while (amount_read < count) {
+        ssize_t rd = recv(fd, &rc[amount_read], count - amount_read, 0);
+        if (rd > 0) {
+            amount_read += rd;
+            sink.received(rc, amount_read);
+        } else {
+            error_code = errno;
+            break;
+        }
+    }
+
+    if ((amount_read == count) && (error_code == 0))
+        return rc;
+    else
+        throw EOFException("");
+}
+
+std::string Transport::msg_recv(int &error_code, ChunkSink *sink) {
     std::string msg;
     error_code = 0;
     unsigned long int payload_len = 0;
@@ -111,7 +143,11 @@ std::string Transport::msg_recv(int &error_code) {
     if (len.size() && error_code == 0) {
         payload_len = strtoul(len.c_str(), NULL, 10);
         if (payload_len < 0x80000000) { /* Should be big enough */
-            msg = string_read(s, payload_len, error_code);
+            if (sink) {
+                msg = chunks_read(s, payload_len, *sink, error_code);
+            } else {
+                msg = string_read(s, payload_len, error_code);
+            }
         }
         // fprintf(stderr, "<<< %s\n", msg.c_str());
     }
@@ -153,6 +189,8 @@ void Transport::close() {
     }
 }
 
+int Transport::fd() const { return s; }
+
 EOFException::EOFException(std::string m) : std::runtime_error(m) {}
 
 ValueException::ValueException(std::string m) : std::runtime_error(m) {}
@@ -172,11 +210,11 @@ LsmException::LsmException(int code, std::string &msg,
     : std::runtime_error(msg), error_code(code), debug(debug_addl),
       debug_data(debug_data_addl) {}
 
-Ipc::Ipc() {}
+Ipc::Ipc() : enc(Payload::JSON) {}
 
-Ipc::Ipc(int fd) : t(fd) {}
+Ipc::Ipc(int fd) : t(fd), enc(Payload::JSON) {}
 
-Ipc::Ipc(std::string socket_path) {
+Ipc::Ipc(std::string socket_path) : enc(Payload::JSON) {
     int e = 0;
     int fd = Transport::socket_get(socket_path, e);
     if (fd >= 0) {
@@ -197,7 +235,7 @@ void Ipc::requestSend(const std::string request, const Value &params,
     v["params"] = params;
 
     Value req(v);
-    rc = t.msg_send(Payload::serialize(req), ec);
+    rc = t.msg_send(Payload::serialize(req, enc), ec);
 
     if (rc != 0) {
         std::string em =
@@ -206,10 +244,8 @@ void Ipc::requestSend(const std::string request, const Value &params,
     }
 }
 
-void Ipc::errorSend(int error_code, std::string msg, std::string debug,
-                    uint32_t id) {
-    int ec = 0;
-    int rc = 0;
+Value Ipc::errorValue(int error_code, const std::string &msg,
+                      const std::string &debug, uint32_t id) {
     std::map<std::string, Value> v;
     std::map<std::string, Value> error_data;
 
@@ -219,9 +255,16 @@ void Ipc::errorSend(int error_code, std::string msg, std::string debug,
 
     v["error"] = Value(error_data);
     v["id"] = Value(id);
+    return Value(v);
+}
 
-    Value e(v);
-    rc = t.msg_send(Payload::serialize(e), ec);
+void Ipc::errorSend(int error_code, std::string msg, std::string debug,
+                    uint32_t id) {
+    int ec = 0;
+    int rc = 0;
+
+    Value e = errorValue(error_code, msg, debug, id);
+    rc = t.msg_send(Payload::serialize(e, enc), ec);
 
     if (rc != 0) {
         std::string em = std::string("Error sending error message: errno ") +
@@ -233,19 +276,28 @@ void Ipc::errorSend(int error_code, std::string msg, std::string debug,
 Value Ipc::readRequest(void) {
     int ec;
     std::string resp = t.msg_recv(ec);
+
+    /* A peer sending CBOR reads it too */
+    if (Payload::CBOR == Payload::detect(resp)) {
+        enc = Payload::CBOR;
+    }
     return Payload::deserialize(resp);
 }
 
-void Ipc::responseSend(const Value &response, uint32_t id) {
-    int rc;
-    int ec;
+Value Ipc::responseValue(const Value &response, uint32_t id) {
     std::map<std::string, Value> v;
 
     v["id"] = id;
     v["result"] = response;
+    return Value(v);
+}
+
+void Ipc::responseSend(const Value &response, uint32_t id) {
+    int rc;
+    int ec;
 
-    Value resp(v);
-    rc = t.msg_send(Payload::serialize(resp), ec);
+    Value resp = responseValue(response, id);
+    rc = t.msg_send(Payload::serialize(resp, enc), ec);
 
     if (rc != 0) {
         std::string em =
@@ -254,17 +306,492 @@ void Ipc::responseSend(const Value &response, uint32_t id) {
     }
 }
 
+void Ipc::batchReplySend(const std::vector<Value> &replies) {
+    int rc;
+    int ec;
+
+    Value resp(replies);
+    rc = t.msg_send(Payload::serialize(resp, enc), ec);
+
+    if (rc != 0) {
+        std::string em =
+            std::string("Error sending replies: errno ") + ::to_string(ec);
+        throw LsmException((int)LSM_ERR_TRANSPORT_COMMUNICATION, em);
+    }
+}
+
+/**
+ * Throws the error a response carries.
+ * @param r     Response without a result
+ */
+static void response_error_throw(Value &r) {
+    std::map<std::string, Value> rp = r.asObject();
+    std::map<std::string, Value> error = rp["error"].asObject();
+
+    std::string msg = error["message"].asString();
+    std::string data = error["data"].asString();
+    throw LsmException((int)(error["code"].asInt32_t()), msg, data);
+}
+
 Value Ipc::responseRead() {
     Value r = readRequest();
-    if (r.hasKey(std::string("result"))) {
-        return r.getValue("result");
+    while (r.hasKey(std::string("event"))) {
+        events.push_back(r["event"]);
+        r = readRequest();
+    }
+    if (!r.hasKey(std::string("result"))) {
+        response_error_throw(r);
+    }
+    return r.getValue("result");
+}
+
+/* Bytes of elements handed over at once while a response arrives */
+#define STREAM_BATCH (64 * 1024)
+
+/*
+ * Reads the head of a CBOR item at pos, moving past it.
+ * Returns 1 if read, 0 if it has not fully arrived, -1 if it is an
+ * indefinite length or reserved.
+ */
+static int cbor_head_scan(const unsigned char *p, size_t len, size_t &pos,
+                          int &major, uint64_t &n) {
+    if (pos >= len) {
+        return 0;
+    }
+
+    int info = p[pos] & 0x1f;
+    int bytes = (info < 24) ? 0 : ((info < 28) ? 1 << (info - 24) : -1);
+
+    major = p[pos] >> 5;
+    if (bytes < 0) {
+        return -1;
+    }
+    if (len - pos - 1 < (size_t)bytes) {
+        return 0;
+    }
+
+    n = bytes ? 0 : info;
+    for (int i = 1; i <= bytes; ++i) {
+        n = n << 8 | p[pos + i];
+    }
+    pos += 1 + bytes;
+    return 1;
+}
+
+/*
+ * Moves pos past the CBOR item at it, returns like cbor_head_scan().
+ */
+static int cbor_item_scan(const unsigned char *p, size_t len, size_t &pos) {
+    uint64_t items = 1;
+
+    while (items) {
+        int major = 0;
+        uint64_t n = 0;
+        int rc = cbor_head_scan(p, len, pos, major, n);
+
+        if (rc <= 0) {
+            return rc;
+        }
+        --items;
+
+        switch (major) {
+        case 2:
+        case 3:
+            if (len - pos < n) {
+                return 0;
+            }
+            pos += n;
+            break;
+        case 4:
+        case 5:
+            /* Messages are shorter than 2 GiB, so are their items */
+            if (n >= 0x80000000) {
+                return -1;
+            }
+            items += (4 == major) ? n : 2 * n;
+            break;
+        case 6:
+            ++items;
+            break;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Finds the elements of the result of a response while it arrives, handing
+ * them to an ElementSink in batches.  It follows the {"id", "result"}
+ * object of either encoding, keeping its place between chunks; only a CBOR
+ * item cut short by the end of a chunk is read again from its start.
+ * Responses read at once and the ones it does not follow, errors and events
+ * among them, are left to be parsed whole.
+ */
+class LSM_DLL_LOCAL ResultScanner : public ChunkSink {
+  public:
+    ResultScanner(ElementSink &sink);
+
+    virtual void received(const std::string &msg, size_t len);
+
+    /**
+     * Whether the whole result was handed over and the response needs no
+     * parsing
+     * @return true if so
+     */
+    bool complete() const;
+
+    uint32_t delivered; /**< Elements handed over, or dropped once stopped */
+    bool stopped;       /**< Sink takes no more elements */
+    bool failed;        /**< Sink threw a ValueException */
+    std::string error;  /**< What it said */
+
+  private:
+    enum stage {
+        START,        /* Before the object */
+        KEY,          /* Before a key, or the end of the object if first */
+        COLON,        /* After a key */
+        VALUE,        /* Before a value */
+        SKIP,         /* Within a JSON key, value or element */
+        ELEMENT,      /* Before an element, or the end of the array if first */
+        ELEMENT_NEXT, /* After an element */
+        NEXT,         /* After a value */
+        END           /* After the object */
+    };
+
+    void jsonScan(const char *p, size_t len);
+    bool jsonSkip(const char *p, size_t len);
+    void cborScan(const unsigned char *p, size_t len);
+    void elementAdd(size_t start, size_t end);
+    void deliver(const std::string &msg);
+
+    ElementSink &sink;
+    bool cbor;          /* Response is CBOR */
+    bool gaveUp;        /* Response is left to be parsed whole */
+    bool result;        /* Key or value at hand is the result */
+    bool resultEnd;     /* Result array ended */
+    bool first;         /* Nothing came yet in the object or array */
+    stage at;           /* Where pos is */
+    stage after;        /* Stage following SKIP */
+    size_t pos;         /* Next byte to look at */
+    size_t start;       /* Start of the key or element at hand */
+    int depth;          /* Nesting of JSON skipped */
+    bool inString;      /* JSON skipped is within a string */
+    bool escape;        /* Character after a backslash comes next */
+    bool primitive;     /* JSON skipped is a number or literal */
+    uint64_t pairs;     /* CBOR pairs left in the object */
+    uint64_t left;      /* CBOR elements left in the array */
+    size_t batchStart;  /* Start of the first element not handed over */
+    size_t batchEnd;    /* End of the last one */
+    uint32_t batchSize; /* Number of them */
+};
+
+ResultScanner::ResultScanner(ElementSink &s)
+    : delivered(0), stopped(false), failed(false), sink(s), cbor(false),
+      gaveUp(false), result(false), resultEnd(false), first(true),
+      at(START), after(START), pos(0), start(0), depth(0), inString(false),
+      escape(false), primitive(false), pairs(0), left(0), batchStart(0),
+      batchEnd(0), batchSize(0) {}
+
+bool ResultScanner::complete() const {
+    return !gaveUp && resultEnd && END == at && !batchSize;
+}
+
+void ResultScanner::received(const std::string &msg, size_t len) {
+    if (gaveUp || END == at) {
+        return;
+    }
+    if (START == at && !pos) {
+        /* Nothing to overlap with a response read at once */
+        gaveUp = (len == msg.size());
+        cbor = (Payload::CBOR == Payload::detect(msg));
+    }
+
+    if (cbor) {
+        cborScan((const unsigned char *)msg.data(), len);
     } else {
-        std::map<std::string, Value> rp = r.asObject();
-        std::map<std::string, Value> error = rp["error"].asObject();
+        jsonScan(msg.data(), len);
+    }
+
+    if (!gaveUp && batchSize &&
+        (resultEnd || len == msg.size() ||
+         batchEnd - batchStart >= STREAM_BATCH)) {
+        deliver(msg);
+    }
+}
 
-        std::string msg = error["message"].asString();
-        std::string data = error["data"].asString();
-        throw LsmException((int)(error["code"].asInt32_t()), msg, data);
+void ResultScanner::elementAdd(size_t s, size_t e) {
+    if (!batchSize) {
+        batchStart = s;
+    }
+    batchEnd = e;
+    ++batchSize;
+}
+
+void ResultScanner::deliver(const std::string &msg) {
+    std::string text;
+    Message m;
+
+    if (cbor) {
+        Payload::cborHead(text, 4, batchSize);
+    } else {
+        text = "[";
+    }
+    text.append(msg, batchStart, batchEnd - batchStart);
+    if (!cbor) {
+        text += ']';
+    }
+
+    try {
+        m.parse(text);
+    } catch (const ValueException &ve) {
+        gaveUp = true;
+        return;
+    }
+
+    uint32_t count = batchSize;
+
+    batchSize = 0;
+    delivered += count;
+    if (stopped) {
+        return;
+    }
+    try {
+        stopped = !sink.elements(m, 1, count);
+    } catch (const ValueException &ve) {
+        stopped = true;
+        failed = true;
+        error = ve.what();
+    }
+}
+
+/*
+ * Moves pos past the JSON at it, returns false if it has not fully arrived.
+ * Numbers and literals end before the byte ending them.  The state is kept
+ * in locals meanwhile, stores through p could change members otherwise.
+ */
+bool ResultScanner::jsonSkip(const char *p, size_t len) {
+    size_t i = pos;
+    int d = depth;
+    bool str = inString;
+    bool esc = escape;
+    bool end = false;
+
+    while (i < len && !end) {
+        char c = p[i];
+
+        if (esc) {
+            ++i;
+            esc = false;
+        } else if (str) {
+            /* Strings make most of records, memchr() skips them quickest */
+            const char *q = (const char *)memchr(p + i, '"', len - i);
+            size_t k = q ? q - p : len;
+            size_t b = k;
+
+            while (b > i && '\\' == p[b - 1]) {
+                --b;
+            }
+            if (!q) {
+                /* An odd run of backslashes escapes what comes next */
+                esc = (k - b) % 2;
+                i = len;
+            } else if ((k - b) % 2) {
+                i = k + 1;
+            } else {
+                i = k + 1;
+                str = false;
+                end = !d;
+            }
+        } else if (primitive) {
+            end = (',' == c || ']' == c || '}' == c || ' ' == c ||
+                   '\t' == c || '\n' == c || '\r' == c);
+            i += !end;
+        } else {
+            ++i;
+            if ('"' == c) {
+                str = true;
+            } else if ('{' == c || '[' == c) {
+                ++d;
+            } else if ('}' == c || ']' == c) {
+                end = !--d;
+            }
+        }
+    }
+
+    pos = i;
+    depth = d;
+    inString = str;
+    escape = esc;
+    return end;
+}
+
+void ResultScanner::jsonScan(const char *p, size_t len) {
+    while (pos < len && !gaveUp && END != at) {
+        char c = p[pos];
+
+        if (SKIP == at) {
+            if (!jsonSkip(p, len)) {
+                return;
+            }
+            if (COLON == after) {
+                result = (pos - start == 7 && !memcmp(p + start, "result", 6));
+            } else if (ELEMENT_NEXT == after) {
+                elementAdd(start, pos);
+            }
+            at = after;
+            continue;
+        }
+
+        if (' ' == c || '\t' == c || '\n' == c || '\r' == c) {
+            ++pos;
+            continue;
+        }
+
+        switch (at) {
+        case START:
+            gaveUp = ('{' != c);
+            at = KEY;
+            break;
+        case KEY:
+            if ('}' == c && first) {
+                at = END;
+            } else if ('"' == c) {
+                start = pos + 1;
+                inString = true;
+                depth = 0;
+                primitive = false;
+                at = SKIP;
+                after = COLON;
+            } else {
+                gaveUp = true;
+            }
+            break;
+        case COLON:
+            gaveUp = (':' != c);
+            at = VALUE;
+            break;
+        case VALUE:
+        case ELEMENT:
+            if (VALUE == at && result && '[' == c) {
+                first = true;
+                at = ELEMENT;
+                break;
+            }
+            if (ELEMENT == at && ']' == c && first) {
+                resultEnd = true;
+                at = NEXT;
+                break;
+            }
+            if (!c || !strchr("\"{[-0123456789tfn", c)) {
+                gaveUp = true;
+                break;
+            }
+            start = pos;
+            inString = ('"' == c);
+            depth = ('{' == c || '[' == c) ? 1 : 0;
+            primitive = !inString && !depth;
+            escape = false;
+            after = (ELEMENT == at) ? ELEMENT_NEXT : NEXT;
+            at = SKIP;
+            first = false;
+            if (primitive) {
+                /* Ends before the byte ending it, looked at by SKIP */
+                continue;
+            }
+            break;
+        case ELEMENT_NEXT:
+            if (',' == c) {
+                at = ELEMENT;
+            } else if (']' == c) {
+                resultEnd = true;
+                at = NEXT;
+            } else {
+                gaveUp = true;
+            }
+            break;
+        case NEXT:
+            if (',' == c) {
+                first = false;
+                at = KEY;
+            } else if ('}' == c) {
+                at = END;
+            } else {
+                gaveUp = true;
+            }
+            break;
+        default:
+            break;
+        }
+        ++pos;
+    }
+}
+
+void ResultScanner::cborScan(const unsigned char *p, size_t len) {
+    while (!gaveUp && END != at) {
+        size_t next = pos;
+        int major = 0;
+        uint64_t n = 0;
+        int rc = 1;
+
+        if (KEY == at && !pairs) {
+            at = END;
+            break;
+        }
+        if (ELEMENT == at && !left) {
+            resultEnd = true;
+            --pairs;
+            at = KEY;
+            continue;
+        }
+
+        /* Items are read again from their start until fully arrived */
+        if (ELEMENT == at || (VALUE == at && !result)) {
+            rc = cbor_item_scan(p, len, next);
+        } else {
+            rc = cbor_head_scan(p, len, next, major, n);
+        }
+        if (rc <= 0) {
+            gaveUp = (rc < 0);
+            return;
+        }
+
+        switch (at) {
+        case START:
+            gaveUp = (5 != major);
+            pairs = n;
+            at = KEY;
+            break;
+        case KEY:
+            if (3 != major) {
+                gaveUp = true;
+            } else if (len - next < n) {
+                return;
+            } else {
+                result = (6 == n && !memcmp(p + next, "result", 6));
+                next += n;
+                at = VALUE;
+            }
+            break;
+        case VALUE:
+            if (result && 4 == major) {
+                left = n;
+                at = ELEMENT;
+            } else if (result) {
+                /* Not an array, skipped as any other value */
+                result = false;
+                next = pos;
+            } else {
+                --pairs;
+                at = KEY;
+            }
+            break;
+        case ELEMENT:
+            elementAdd(pos, next);
+            --left;
+            break;
+        default:
+            break;
+        }
+        pos = next;
     }
 }
 
@@ -272,3 +799,176 @@ Value Ipc::rpc(const std::string &request, const Value &params, int32_t id) {
     requestSend(request, params, id);
     return responseRead();
 }
+
+int Ipc::rpc(const std::string &request, const Value &params,
+             Message &response, int32_t id) {
+    requestSend(request, params, id);
+
+    while (1) {
+        int ec;
+        response.parse(t.msg_recv(ec));
+
+        int result = response.member(0, "result");
+        if (result >= 0) {
+            return result;
+        }
+
+        Value r = response.value(0);
+        if (!r.hasKey(std::string("event"))) {
+            response_error_throw(r);
+        }
+        events.push_back(r["event"]);
+    }
+}
+
+void Ipc::rpc(const std::string &request, const Value &params,
+              ElementSink &sink, int32_t id) {
+    requestSend(request, params, id);
+
+    while (1) {
+        int ec;
+        ResultScanner scan(sink);
+        std::string msg = t.msg_recv(ec, &scan);
+
+        if (!scan.complete()) {
+            Message response;
+            response.parse(msg);
+
+            int result = response.member(0, "result");
+            if (result < 0) {
+                Value r = response.value(0);
+                if (!r.hasKey(std::string("event"))) {
+                    response_error_throw(r);
+                }
+                events.push_back(r["event"]);
+                continue;
+            }
+            if (JSMN_ARRAY != response.tok[result].type) {
+                throw ValueException("Result is not an array");
+            }
+
+            // Elements the scanner did not hand over
+            uint32_t count = response.tok[result].size;
+            if (!scan.stopped && scan.delivered < count) {
+                sink.elements(response,
+                              response.element(result, scan.delivered),
+                              count - scan.delivered);
+            }
+        }
+
+        if (scan.failed) {
+            throw ValueException(scan.error);
+        }
+        return;
+    }
+}
+
+int Ipc::batchRpc(const std::vector<std::pair<std::string, Value> > &requests,
+                  Message &response) {
+    int rc = 0;
+    int ec = 0;
+    std::vector<Value> batch;
+
+    if (requests.empty()) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        std::map<std::string, Value> v;
+
+        v["method"] = Value(requests[i].first);
+        v["id"] = Value((int32_t)i);
+        v["params"] = requests[i].second;
+        batch.push_back(Value(v));
+    }
+
+    Value req(batch);
+    rc = t.msg_send(Payload::serialize(req, enc), ec);
+    if (rc != 0) {
+        std::string em =
+            std::string("Error sending message: errno ") + ::to_string(ec);
+        throw LsmException((int)LSM_ERR_TRANSPORT_COMMUNICATION, em);
+    }
+
+    while (1) {
+        response.parse(t.msg_recv(ec));
+
+        if (JSMN_ARRAY == response.tok[0].type) {
+            if (response.tok[0].size != (int)requests.size()) {
+                throw ValueException("Replies do not match the requests");
+            }
+            return response.element(0, 0);
+        }
+
+        Value r = response.value(0);
+        if (!r.hasKey(std::string("event"))) {
+            response_error_throw(r);
+        }
+        events.push_back(r["event"]);
+    }
+}
+
+void Ipc::eventSend(const Value &event) {
+    int rc = 0;
+    int ec = 0;
+    std::map<std::string, Value> v;
+
+    v["event"] = event;
+
+    Value e(v);
+    rc = t.msg_send(Payload::serialize(e, enc), ec);
+
+    if (rc != 0) {
+        std::string em =
+            std::string("Error sending event: errno ") + ::to_string(ec);
+        throw LsmException((int)LSM_ERR_TRANSPORT_COMMUNICATION, em);
+    }
+}
+
+bool Ipc::eventRead(Value &event, int timeout_ms) {
+    while (events.empty()) {
+        struct pollfd pfd;
+        pfd.fd = t.fd();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int rc = poll(&pfd, 1, timeout_ms);
+        if (rc == 0) {
+            return false;
+        }
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::string em =
+                std::string("Error waiting for event: errno ") +
+                ::to_string(errno);
+            throw LsmException((int)LSM_ERR_TRANSPORT_COMMUNICATION, em);
+        }
+
+        // Responses only come for requests, anything else is not ours.
+        Value r = readRequest();
+        if (r.hasKey(std::string("event"))) {
+            events.push_back(r["event"]);
+        }
+    }
+
+    event = events.front();
+    events.pop_front();
+    return true;
+}
+
+int Ipc::fd() const { return t.fd(); }
+
+Payload::encoding Ipc::encoding() const { return enc; }
+
+void Ipc::encodingSet(Payload::encoding e) { enc = e; }
+
+void Ipc::waitLimitSet(uint32_t ms) {
+    struct timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+
+    setsockopt(t.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(t.fd(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
@@ -20,6 +20,7 @@
 #define LSM_IPC_H
 
 #include "libstoragemgmt/libstoragemgmt_common.h"
+#include <deque>
 #include <map>
 #include <sstream>
 #include <stdexcept>
@@ -33,10 +34,25 @@
 
 // Common serialization
 
+/**
+ * Looks at a message while it is received, see Transport::msg_recv().
+ */
+class LSM_DLL_LOCAL ChunkSink {
+  public:
+    virtual ~ChunkSink() {}
+
+    /**
+     * Called each time more of the message arrived
+     * @param msg   Message, sized to all of it
+     * @param len   Number of bytes of msg received so far
+     */
+    virtual void received(const std::string &msg, size_t len) = 0;
+};
+
 /**
  * Sends and receives payloads, unaware of the contents.
  * Notes:   Not thread safe. i.e. you cannot share the same object with two or
- * more threads.
+ * more threads, except for one thread sending while another receives.
  */
 class LSM_DLL_LOCAL Transport {
   public:
@@ -75,9 +91,11 @@ class LSM_DLL_LOCAL Transport {
      * Note: A zero read indicates that the transport was closed by other side,
      *       no error code will be set in that case.
      * @param error_code    (0 on success, else errno)
+     * @param sink          Shown the message each time more of it arrived
+     *                      rather than read in one go, NULL for none
      * @return Message on success else 0 size with error_code set (not if EOF)
      */
-    std::string msg_recv(int &error_code);
+    std::string msg_recv(int &error_code, ChunkSink *sink = NULL);
 
     /**
      * Creates a connected socket (AF_UNIX) to the specified path
@@ -93,6 +111,12 @@ class LSM_DLL_LOCAL Transport {
      */
     void close();
 
+    /**
+     * Socket descriptor, to wait for it to become readable.
+     * @return Socket descriptor, -1 if not connected
+     */
+    int fd() const;
+
   private:
     int s; // Socket descriptor
 };
@@ -169,8 +193,15 @@ class LSM_DLL_LOCAL LsmException : public std::runtime_error {
     std::string debug_data;
 };
 
+struct jsmntok;
+
 /**
  * Represents a value in the serialization.
+ *
+ * Objects keep their members in a vector sorted by key atom rather than in a
+ * map.  Keys the protocol knows of are atoms from a static table, looking one
+ * up compares integers and decoding a record allocates nothing for its keys.
+ * Other keys are kept once per object, see atom().
  */
 class LSM_DLL_LOCAL Value {
   public:
@@ -183,7 +214,9 @@ class LSM_DLL_LOCAL Value {
         string_t,
         numeric_t,
         object_t,
-        array_t
+        array_t,
+        raw_t,     /**< JSON encoded elsewhere, only ever serialized */
+        raw_cbor_t /**< CBOR encoded elsewhere, only ever serialized */
     };
 
     /**
@@ -258,6 +291,12 @@ class LSM_DLL_LOCAL Value {
      */
     std::string serialize(void);
 
+    /**
+     * Serialize Value to CBOR
+     * @param out   String to append to
+     */
+    void serializeCbor(std::string &out);
+
     /**
      * Returns the enumerated type represented by object
      * @return enumerated type
@@ -340,11 +379,32 @@ class LSM_DLL_LOCAL Value {
     const char *asC_str();
 
     /**
-     * key/value represented by object.
+     * key/value represented by object.  Builds a copy, walk the members with
+     * memberCount() and the like instead where it matters.
      * @return map of key and values else ValueException on error
      */
     std::map<std::string, Value> asObject();
 
+    /**
+     * Number of members of an object.
+     * @return count, 0 if not an object
+     */
+    uint32_t memberCount() const;
+
+    /**
+     * Key of a member of an object.
+     * @param i Index of the member, below memberCount()
+     * @return key
+     */
+    const char *memberKey(uint32_t i) const;
+
+    /**
+     * Value of a member of an object.
+     * @param i Index of the member, below memberCount()
+     * @return Value
+     */
+    Value &memberValue(uint32_t i);
+
     /**
      * vector of values represented by object.
      * @return vector of array values else ValueException on error
@@ -352,30 +412,187 @@ class LSM_DLL_LOCAL Value {
     std::vector<Value> asArray();
 
   private:
+    struct member;
+
+    friend Value lsm_parse(struct jsmntok *tok, int start_tok, int end_tok,
+                           const char *j, int *consumed);
+
+    /**
+     * Atom of a key of this object.  Known keys are their index in the static
+     * table, others follow it and give the offset of the key in s, where they
+     * are kept NUL terminated.
+     * @param key   Key, need not be NUL terminated
+     * @param len   Length of key
+     * @param add   Whether to add an unknown key to s
+     * @return atom, UINT32_MAX if unknown and not added
+     */
+    uint32_t atom(const char *key, size_t len, bool add);
+
+    /**
+     * Index of the first member whose atom is not below a.
+     * @param a     Atom of the key
+     * @return index, obj.size() if there is none
+     */
+    size_t position(uint32_t a) const;
+
+    /**
+     * Looks a member up, adding a null one when missing.
+     * @param key   Key, need not be NUL terminated
+     * @param len   Length of key
+     * @return Value of the member
+     */
+    Value &memberSet(const char *key, size_t len);
+
     value_type t;
     std::vector<Value> array;
-    std::map<std::string, Value> obj;
+    std::vector<member> obj; /**< Sorted by atom */
     std::string s;
 };
 
+/**
+ * Member of an object Value.
+ */
+struct Value::member {
+    uint32_t atom; /**< Atom of the key, see Value::atom() */
+    Value value;   /**< Value */
+
+    bool operator<(const member &m) const { return atom < m.atom; }
+};
+
 /**
  * Serialize, de-serialize methods.
  */
 class LSM_DLL_LOCAL Payload {
   public:
     /**
-     * Given a Value returns json representation.
+     * Encodings of messages.  Peers speak JSON unless the plug-in says at
+     * registration it takes CBOR (RFC 8949) too, which carries numbers in
+     * binary and strings without escaping.
+     */
+    enum encoding { JSON, CBOR };
+
+    /**
+     * Given a Value returns its representation.
      * @param v Value to serialize
+     * @param e Encoding to use
      * @return String representation
      */
-    static std::string serialize(Value &v);
+    static std::string serialize(Value &v, encoding e = JSON);
+
+    /**
+     * Given a message of either encoding return a Value
+     * @param msg   String to de-serialize
+     * @return Value
+     */
+    static Value deserialize(const std::string &msg);
+
+    /**
+     * Tells the encoding of a message.  JSON ones start with ASCII, CBOR
+     * ones with the head of a map or an array.
+     * @param msg   Message
+     * @return Encoding
+     */
+    static encoding detect(const std::string &msg);
+
+    /**
+     * Appends the head of a CBOR item
+     * @param out   String to append to
+     * @param major Major type
+     * @param n     Argument, the value or length of the item
+     */
+    static void cborHead(std::string &out, int major, uint64_t n);
+
+    /**
+     * Appends a CBOR text string, null for NULL
+     * @param out   String to append to
+     * @param str   String
+     */
+    static void cborString(std::string &out, const char *str);
+
+    /**
+     * Appends a number given as JSON text as CBOR integer, or floating point
+     * if it has a fraction or exponent
+     * @param out   String to append to
+     * @param text  Number
+     */
+    static void cborNumber(std::string &out, const char *text);
+};
+
+struct jsmntok;
+
+/**
+ * A message kept as text with its tokens, so records can be decoded
+ * straight from the token stream.
+ */
+class LSM_DLL_LOCAL Message {
+  public:
+    Message();
+    ~Message();
+
+    /**
+     * Tokenizes a message, replacing any previous one.  CBOR ones get a
+     * text made up of their strings as they are, numbers in decimal and JSON
+     * literals for the tokens, so that both read the same.
+     * @param msg   Message of either encoding
+     */
+    void parse(const std::string &msg);
+
+    /**
+     * Looks up a key of an object
+     * @param index Token of the object
+     * @param key   Key to find
+     * @return Token of the value, -1 if index is no object or lacks key
+     */
+    int member(int index, const char *key) const;
+
+    /**
+     * Looks up an element of an array
+     * @param index Token of the array
+     * @param i     Element number
+     * @return Token of the element, -1 if index is no array or too short
+     */
+    int element(int index, int i) const;
+
+    /**
+     * Skips over a value and everything it contains
+     * @param index Token of the value
+     * @return Token following the value
+     */
+    int next(int index) const;
 
     /**
-     * Given a json string return a Value
-     * @param json  String to de-serialize
+     * Builds the Value of a token
+     * @param index Token to convert
      * @return Value
      */
-    static Value deserialize(const std::string &json);
+    Value value(int index) const;
+
+    std::string text;    /**< Message text */
+    struct jsmntok *tok; /**< Tokens of text */
+    int count;           /**< Number of tokens */
+
+  private:
+    Message(const Message &);
+    Message &operator=(const Message &);
+};
+
+/**
+ * Takes the elements of an array result while the response arrives, see
+ * Ipc::rpc().
+ */
+class LSM_DLL_LOCAL ElementSink {
+  public:
+    virtual ~ElementSink() {}
+
+    /**
+     * Takes elements which fully arrived, in order
+     * @param m     Message holding them
+     * @param index Token of the first one, the others follow Message::next()
+     * @param count Number of elements
+     * @return false to take no more, the rest of the response is read and
+     *         dropped
+     */
+    virtual bool elements(const Message &m, int index, uint32_t count) = 0;
 };
 
 class LSM_DLL_LOCAL Ipc {
@@ -429,6 +646,32 @@ class LSM_DLL_LOCAL Ipc {
      */
     Value responseRead();
 
+    /**
+     * Send the replies to a batch of requests, in one message
+     * @param replies   Reply of each request in order, see responseValue()
+     *                  and errorValue()
+     */
+    void batchReplySend(const std::vector<Value> &replies);
+
+    /**
+     * Builds the reply to a request which succeeded
+     * @param response      Response value
+     * @param id            Id that matches request
+     * @return Reply
+     */
+    static Value responseValue(const Value &response, uint32_t id = 100);
+
+    /**
+     * Builds the reply to a request which failed
+     * @param error_code        Error code
+     * @param msg               Error message
+     * @param debug             Debug data
+     * @param id                Id that matches request
+     * @return Reply
+     */
+    static Value errorValue(int error_code, const std::string &msg,
+                            const std::string &debug, uint32_t id = 100);
+
     /**
      * Send an error
      * @param error_code        Error code
@@ -449,8 +692,88 @@ class LSM_DLL_LOCAL Ipc {
     Value rpc(const std::string &request, const Value &params,
               int32_t id = 100);
 
+    /**
+     * Do a remote procedure call, keeping the response as tokens
+     * @param request           Function method
+     * @param params            Function parameters
+     * @param response          Response message
+     * @param id                Id of request
+     * @return Token of the result in response
+     */
+    int rpc(const std::string &request, const Value &params, Message &response,
+            int32_t id = 100);
+
+    /**
+     * Do a remote procedure call returning an array, handing its elements
+     * over as they arrive so they are decoded while the rest is still in
+     * transit.  A ValueException sink throws stops it taking elements and is
+     * thrown once the whole response is read, keeping the transport usable.
+     * @param request           Function method
+     * @param params            Function parameters
+     * @param sink              Takes the elements of the result
+     * @param id                Id of request
+     */
+    void rpc(const std::string &request, const Value &params,
+             ElementSink &sink, int32_t id = 100);
+
+    /**
+     * Do remote procedure calls in one batch message, for plug-ins taking
+     * batches.  Replies come in one message too, in the order of requests.
+     * @param requests          Method and parameters of each request
+     * @param response          Response message
+     * @return Token of the first reply in response, the next ones follow
+     *         Message::next() of it.  -1 without requests, sending nothing
+     */
+    int batchRpc(const std::vector<std::pair<std::string, Value> > &requests,
+                 Message &response);
+
+    /**
+     * Send an unsolicited event about a change of a storage object
+     * @param event             Event value
+     */
+    void eventSend(const Value &event);
+
+    /**
+     * Read the next event, events arriving while waiting for a response
+     * were queued.
+     * @param event             Event value
+     * @param timeout_ms        Milliseconds to wait, -1 for no limit
+     * @return true if an event was read, false on timeout
+     */
+    bool eventRead(Value &event, int timeout_ms);
+
+    /**
+     * Socket descriptor, readable when a message arrives
+     * @return Socket descriptor
+     */
+    int fd() const;
+
+    /**
+     * Limits how long sending or receiving blocks, a message which does not
+     * make it in time fails as if the plug-in was gone.
+     * @param ms    Milliseconds, 0 for no limit
+     */
+    void waitLimitSet(uint32_t ms);
+
+    /**
+     * Encoding messages are sent in
+     * @return Encoding
+     */
+    Payload::encoding encoding() const;
+
+    /**
+     * Changes the encoding messages are sent in, for a client once the
+     * plug-in took it at registration.  The plug-in side switches by itself
+     * to CBOR on reading a request in it, before requests are answered
+     * concurrently.
+     * @param e     Encoding
+     */
+    void encodingSet(Payload::encoding e);
+
   private:
     Transport t;
+    Payload::encoding enc;
+    std::deque<Value> events; // Events read while waiting for a response
 };
 
 #endif
@@ -0,0 +1,567 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "lsm_json_index.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_INDEX_X86
+#include <immintrin.h>
+#endif
+
+#define JSMN_HEADER
+#define JSMN_PARENT_LINKS
+#include "jsmn.h"
+
+/**
+ * Bytes of a 64 byte block, bit i standing for byte i.
+ */
+struct json_block {
+    uint64_t quote;     /**< " */
+    uint64_t backslash; /**< \ */
+    uint64_t op;        /**< { } [ ] : , */
+    uint64_t open;      /**< { [ */
+    uint64_t space;     /**< Space, tab, CR, LF */
+    uint64_t nul;       /**< NUL, jsmn stops there */
+};
+
+typedef void (*json_classify)(const unsigned char *p, json_block *b);
+
+static void classify_scalar(const unsigned char *p, json_block *b) {
+    memset(b, 0, sizeof(*b));
+
+    for (int i = 0; i < 64; ++i) {
+        uint64_t bit = (uint64_t)1 << i;
+
+        switch (p[i]) {
+        case '"':
+            b->quote |= bit;
+            break;
+        case '\\':
+            b->backslash |= bit;
+            break;
+        case '{':
+        case '[':
+            b->open |= bit;
+            b->op |= bit;
+            break;
+        case '}':
+        case ']':
+        case ':':
+        case ',':
+            b->op |= bit;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            b->space |= bit;
+            break;
+        case '\0':
+            b->nul |= bit;
+            break;
+        }
+    }
+}
+
+#ifdef JSON_INDEX_X86
+/*
+ * '{' and '[' are 0x7b and 0x5b, '}' and ']' 0x7d and 0x5d: setting bit 5
+ * finds either of a pair with one comparison.
+ */
+
+__attribute__((target("sse2"))) static void
+classify_sse2(const unsigned char *p, json_block *b) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+
+    memset(b, 0, sizeof(*b));
+
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i folded = _mm_or_si128(v, case_bit);
+        __m128i open = _mm_cmpeq_epi8(folded, _mm_set1_epi8('{'));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(open, _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        __m128i space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        int shift = 16 * i;
+
+        b->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('"')))
+                    << shift;
+        b->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')))
+                        << shift;
+        b->op |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << shift;
+        b->open |= (uint64_t)(uint16_t)_mm_movemask_epi8(open) << shift;
+        b->space |= (uint64_t)(uint16_t)_mm_movemask_epi8(space) << shift;
+        b->nul |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                      _mm_cmpeq_epi8(v, _mm_setzero_si128()))
+                  << shift;
+    }
+}
+
+__attribute__((target("avx2"))) static void
+classify_avx2(const unsigned char *p, json_block *b) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+
+    memset(b, 0, sizeof(*b));
+
+    for (int i = 0; i < 2; ++i) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + 32 * i));
+        __m256i folded = _mm256_or_si256(v, case_bit);
+        __m256i open = _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{'));
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(open,
+                            _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        __m256i space = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        int shift = 32 * i;
+
+        b->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')))
+                    << shift;
+        b->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')))
+                        << shift;
+        b->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << shift;
+        b->open |= (uint64_t)(uint32_t)_mm256_movemask_epi8(open) << shift;
+        b->space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << shift;
+        b->nul |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                      _mm256_cmpeq_epi8(v, _mm256_setzero_si256()))
+                  << shift;
+    }
+}
+#endif
+
+/**
+ * Kernel classifying bytes.
+ */
+struct json_kernel {
+    const char *name;       /**< Name */
+    json_classify classify; /**< Kernel */
+};
+
+static const json_kernel kernels[] = {
+#ifdef JSON_INDEX_X86
+    {"avx2", classify_avx2},
+    {"sse2", classify_sse2},
+#endif
+    {"scalar", classify_scalar}};
+
+#define KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static bool kernel_supported(const json_kernel &k) {
+#ifdef JSON_INDEX_X86
+    __builtin_cpu_init();
+    if (k.classify == classify_avx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (k.classify == classify_sse2) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return true;
+}
+
+static const json_kernel *kernel_best(void) {
+    for (size_t i = 0; i < KERNELS; ++i) {
+        if (kernel_supported(kernels[i])) {
+            return &kernels[i];
+        }
+    }
+    return &kernels[KERNELS - 1];
+}
+
+static const json_kernel *kernel = kernel_best();
+
+const char *json_index_kernel(void) { return kernel->name; }
+
+bool json_index_kernel_set(const char *name) {
+    if (!name) {
+        kernel = kernel_best();
+        return true;
+    }
+
+    for (size_t i = 0; i < KERNELS; ++i) {
+        if (!strcmp(kernels[i].name, name) && kernel_supported(kernels[i])) {
+            kernel = &kernels[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Finds the bytes escaped by backslashes, the way simdjson does: runs of
+ * backslashes starting on an even bit escape the byte after them when they
+ * end on an odd bit, and the other way round.
+ * @param backslash         Backslashes of the block
+ * @param[in,out] carry     Whether the first byte of the block is escaped,
+ *                          set for the next block
+ * @return Escaped bytes
+ */
+static uint64_t escaped_bytes(uint64_t backslash, uint64_t &carry) {
+    const uint64_t even = 0x5555555555555555ULL;
+    uint64_t follows;
+    uint64_t odd_starts;
+    uint64_t even_runs;
+
+    backslash &= ~carry;
+    follows = backslash << 1 | carry;
+    odd_starts = backslash & ~even & ~follows;
+    even_runs = odd_starts + backslash;
+    carry = even_runs < odd_starts;
+    return (even ^ (even_runs << 1)) & follows;
+}
+
+/* Bit i set when an odd number of bits up to i are. */
+static uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/**
+ * First pass, marks the bytes the second one visits.
+ * @param js                JSON
+ * @param len               Length of js
+ * @param[out] bits         Marked bytes, bit i of word n standing for byte
+ *                          64n + i
+ * @param[out] escapes      Whether strings hold backslashes
+ * @return Number of tokens, -1 if the index does not handle js: NUL bytes,
+ *         backslashes outside strings and strings left open
+ */
+static long index_build(const char *js, size_t len, std::vector<uint64_t> &bits,
+                        bool &escapes) {
+    json_classify classify = kernel->classify;
+    size_t blocks = (len + 63) / 64;
+    uint64_t escaped_carry = 0;
+    uint64_t string_carry = 0;
+    uint64_t scalar_carry = 0;
+    long tokens = 0;
+    long quotes = 0;
+    uint64_t backslashes = 0;
+    unsigned char tail[64];
+
+    bits.resize(blocks);
+    for (size_t n = 0; n < blocks; ++n) {
+        const unsigned char *p = (const unsigned char *)js + n * 64;
+        json_block b;
+
+        if (len - n * 64 < 64) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, len - n * 64);
+            p = tail;
+        }
+        classify(p, &b);
+        if (b.nul) {
+            return -1;
+        }
+
+        uint64_t quote = b.quote & ~escaped_bytes(b.backslash, escaped_carry);
+        /* Opening quotes and what they enclose, not the closing ones */
+        uint64_t in_string = prefix_xor(quote) ^ string_carry;
+        uint64_t op = b.op & ~in_string;
+        uint64_t scalar = ~(op | b.space | quote | in_string);
+        uint64_t starts = scalar & ~(scalar << 1 | scalar_carry);
+
+        if (b.backslash & ~in_string) {
+            return -1;
+        }
+
+        backslashes |= b.backslash;
+        string_carry = (uint64_t)((int64_t)in_string >> 63);
+        scalar_carry = scalar >> 63;
+        bits[n] = op | quote | starts;
+        tokens += __builtin_popcountll(b.open & ~in_string) +
+                  __builtin_popcountll(starts);
+        quotes += __builtin_popcountll(quote);
+    }
+    escapes = backslashes != 0;
+    return string_carry ? -1 : tokens + quotes / 2;
+}
+
+long json_index_count(const char *js, size_t len) {
+    std::vector<uint64_t> bits;
+    bool escapes;
+    return index_build(js, len, bits, escapes);
+}
+
+/**
+ * Walks the marked bytes.
+ */
+struct index_cursor {
+    const std::vector<uint64_t> *bits; /**< Marked bytes */
+    size_t n;                          /**< Word at hand */
+    uint64_t w;                        /**< Bits of it left */
+};
+
+static bool cursor_next(index_cursor &c, size_t &pos) {
+    while (!c.w) {
+        if (++c.n >= c.bits->size()) {
+            return false;
+        }
+        c.w = (*c.bits)[c.n];
+    }
+    pos = c.n * 64 + __builtin_ctzll(c.w);
+    c.w &= c.w - 1;
+    return true;
+}
+
+/* Checks the escapes of a string as jsmn_parse_string() does. */
+static bool escapes_valid(const char *s, const char *end) {
+    while ((s = (const char *)memchr(s, '\\', end - s))) {
+        switch (s[1]) {
+        case '"':
+        case '/':
+        case '\\':
+        case 'b':
+        case 'f':
+        case 'r':
+        case 'n':
+        case 't':
+            s += 2;
+            break;
+        case 'u':
+            for (int i = 2; i < 6; ++i) {
+                if (s + i >= end || !s[i] ||
+                    !strchr("0123456789ABCDEFabcdef", s[i])) {
+                    return false;
+                }
+            }
+            s += 6;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Where a primitive ends, 0 if it holds what jsmn rejects or we skipped. */
+static size_t primitive_end(const char *js, size_t len, size_t pos) {
+    for (; pos < len; ++pos) {
+        switch (js[pos]) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case ',':
+        case ':':
+        case ']':
+        case '}':
+            return pos;
+        case '"':
+        case '{':
+        case '[':
+            return 0;
+        }
+        if (js[pos] < 32 || js[pos] >= 127) {
+            return 0;
+        }
+    }
+    return pos;
+}
+
+/* What the second pass expects next. */
+enum index_state { EXPECT_VALUE, EXPECT_KEY, EXPECT_COLON, EXPECT_NEXT, DONE };
+
+/**
+ * Second pass, fills tokens the way jsmn_parse() does, for JSON only.
+ * @param js    JSON
+ * @param len   Length of js
+ * @param bits      Marked bytes
+ * @param escapes   Whether strings hold backslashes
+ * @param tok       Tokens
+ * @param count     Number of tokens the first pass counted
+ * @return true on success, false to let jsmn_parse() deal with js
+ */
+static bool index_parse(const char *js, size_t len,
+                        const std::vector<uint64_t> &bits, bool escapes,
+                        jsmntok_t *tok, int count) {
+    index_cursor c = {&bits, 0, bits.empty() ? 0 : bits[0]};
+    index_state state = EXPECT_VALUE;
+    bool empty = false;  /* Just opened, may close */
+    int next = 0;        /* Next token */
+    int super = -1;      /* Token the next one belongs to, as jsmn has it */
+    int container = -1;  /* Innermost open object or array */
+    size_t pos;
+
+    while (cursor_next(c, pos)) {
+        char ch = js[pos];
+
+        switch (ch) {
+        case '{':
+        case '[':
+            if (EXPECT_VALUE != state || next >= count) {
+                return false;
+            }
+            tok[next].type = ('{' == ch) ? JSMN_OBJECT : JSMN_ARRAY;
+            tok[next].start = pos;
+            tok[next].end = -1;
+            tok[next].size = 0;
+            tok[next].parent = super;
+            if (super != -1) {
+                tok[super].size++;
+            }
+            super = container = next++;
+            state = ('{' == ch) ? EXPECT_KEY : EXPECT_VALUE;
+            empty = true;
+            break;
+        case '}':
+        case ']':
+            if (container == -1 ||
+                tok[container].type != (('}' == ch) ? JSMN_OBJECT
+                                                    : JSMN_ARRAY) ||
+                (EXPECT_NEXT != state && !empty)) {
+                return false;
+            }
+            tok[container].end = pos + 1;
+            super = container = tok[container].parent;
+            if (container != -1 && tok[container].type == JSMN_STRING) {
+                container = tok[container].parent;
+            }
+            state = (container == -1) ? DONE : EXPECT_NEXT;
+            empty = false;
+            break;
+        case '"': {
+            size_t end;
+
+            if ((EXPECT_VALUE != state && EXPECT_KEY != state) ||
+                next >= count || !cursor_next(c, end) ||
+                (escapes && !escapes_valid(js + pos + 1, js + end))) {
+                return false;
+            }
+            tok[next].type = JSMN_STRING;
+            tok[next].start = pos + 1;
+            tok[next].end = end;
+            tok[next].size = 0;
+            tok[next].parent = super;
+            if (super != -1) {
+                tok[super].size++;
+            }
+            next++;
+            if (EXPECT_KEY == state) {
+                state = EXPECT_COLON;
+            } else {
+                state = (container == -1) ? DONE : EXPECT_NEXT;
+            }
+            empty = false;
+            break;
+        }
+        case ':':
+            if (EXPECT_COLON != state) {
+                return false;
+            }
+            super = next - 1;
+            state = EXPECT_VALUE;
+            break;
+        case ',':
+            if (EXPECT_NEXT != state) {
+                return false;
+            }
+            if (tok[super].type != JSMN_ARRAY &&
+                tok[super].type != JSMN_OBJECT) {
+                super = tok[super].parent;
+            }
+            state = (tok[container].type == JSMN_OBJECT) ? EXPECT_KEY
+                                                         : EXPECT_VALUE;
+            break;
+        default: {
+            size_t end = primitive_end(js, len, pos);
+
+            if (EXPECT_VALUE != state || !end || next >= count) {
+                return false;
+            }
+            tok[next].type = JSMN_PRIMITIVE;
+            tok[next].start = pos;
+            tok[next].end = end;
+            tok[next].size = 0;
+            tok[next].parent = super;
+            if (super != -1) {
+                tok[super].size++;
+            }
+            next++;
+            state = (container == -1) ? DONE : EXPECT_NEXT;
+            empty = false;
+            break;
+        }
+        }
+    }
+    return DONE == state && next == count;
+}
+
+int json_index_tokenize(const char *js, size_t len, jsmntok_t **tok) {
+    std::vector<uint64_t> bits;
+    jsmn_parser p;
+    bool escapes = false;
+    long count = -1;
+
+    *tok = NULL;
+    if (len < INT32_MAX) {
+        count = index_build(js, len, bits, escapes);
+    }
+
+    if (count > 0) {
+        *tok = (jsmntok_t *)malloc(sizeof(**tok) * count);
+        if (!*tok) {
+            return 0;
+        }
+        if (index_parse(js, len, bits, escapes, *tok, count)) {
+            return count;
+        }
+        free(*tok);
+        *tok = NULL;
+    }
+
+    /* Left to jsmn, counting first as well */
+    jsmn_init(&p);
+    int rc = jsmn_parse(&p, js, len, NULL, 0);
+    if (rc < 0) {
+        return rc;
+    }
+
+    *tok = (jsmntok_t *)calloc(rc ? rc : 1, sizeof(**tok));
+    if (!*tok) {
+        return 0;
+    }
+    jsmn_init(&p);
+    rc = jsmn_parse(&p, js, len, *tok, rc ? rc : 1);
+    if (rc < 0) {
+        free(*tok);
+        *tok = NULL;
+    }
+    return rc;
+}
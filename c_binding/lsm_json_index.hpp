@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LSM_JSON_INDEX_HPP
+#define LSM_JSON_INDEX_HPP
+
+#include "libstoragemgmt/libstoragemgmt_common.h"
+#include <stddef.h>
+
+struct jsmntok;
+
+/**
+ * Tokenizes JSON into the tokens jsmn_parse() makes of it with parent links.
+ *
+ * A first pass classifies the message 64 bytes at a time with SIMD, marking
+ * the brackets, colons and commas outside strings, the quotes around strings
+ * and the first byte of other values, and counting the tokens.  The second
+ * pass fills a token array of exactly that size, visiting the marked bytes
+ * only.  JSON the index does not handle, invalid JSON among it, goes through
+ * jsmn_parse(), which then counts its tokens first too.
+ *
+ * @param js        JSON
+ * @param len       Length of js
+ * @param[out] tok  Tokens, at least one, free when done, NULL on allocation
+ *                  failure
+ * @return Number of tokens, JSMN_ERROR_XXX if js is not valid
+ */
+int LSM_DLL_LOCAL json_index_tokenize(const char *js, size_t len,
+                                      struct jsmntok **tok);
+
+/**
+ * Runs the first pass of json_index_tokenize() only.
+ * @param js    JSON
+ * @param len   Length of js
+ * @return Number of tokens, -1 if the index does not handle js
+ */
+long LSM_DLL_LOCAL json_index_count(const char *js, size_t len);
+
+/**
+ * Name of the kernel classifying bytes.
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char LSM_DLL_LOCAL *json_index_kernel(void);
+
+/**
+ * Picks the kernel classifying bytes, for benchmarks and tests.  Not thread
+ * safe, the best one the CPU runs is picked at start up.
+ * @param name  "avx2", "sse2" or "scalar", NULL for the best one
+ * @return true if the CPU runs it
+ */
+bool LSM_DLL_LOCAL json_index_kernel_set(const char *name);
+
+#endif
@@ -73,6 +73,14 @@
  *   format is '0x<hex_addr>\0'
  */
 
+#define _SYSFS_HOLDERS_PATH_FORMAT "/sys/block/%s/holders"
+#define _SYSFS_DM_UUID_PATH_FORMAT "/sys/block/%s/dm/uuid"
+#define _SYSFS_DM_NAME_PATH_FORMAT "/sys/block/%s/dm/name"
+#define _DM_MPATH_UUID_PREFIX      "mpath-"
+#define _MPATH_PATH_PREFIX         "/dev/mapper/"
+#define _MAX_DM_NAME_STR_LEN       128
+/* ^ DM_NAME_LEN of linux/dm-ioctl.h */
+
 #define _SCSI_MODE_SENSE_PSP_PAGE_CODE 0x19
 /* ^ SCSI MODE SENSE page 19h Protocol Specific Port */
 #define _SCSI_MODE_SENSE_SAS_PHY_SUB_PAGE_CODE 0x01
@@ -128,6 +136,24 @@ struct t10_proto_port_mode_sub_page_hdr {
 
 #pragma pack(pop)
 
+struct _lsm_local_disk_index_entry {
+    char *vpd83;
+    char *disk_path;
+    char *mpath;
+    /* ^ Multipath device holding the disk, NULL if none */
+};
+
+struct _lsm_local_disk_index {
+    struct udev *udev;
+    struct udev_monitor *udev_mon;
+    /* ^ NULL if udev events are not available */
+    struct _lsm_local_disk_index_entry *entries;
+    uint32_t count;
+    uint32_t alloc_count;
+    bool sorted;
+    /* ^ Entries are sorted by vpd83 */
+};
+
 static int _sysfs_serial_num_of_sd_name(char *err_msg, const char *sd_name,
                                         uint8_t *serial_num);
 static int _sysfs_vpd_pg80_data_get(char *err_msg, const char *sd_name,
@@ -154,6 +180,16 @@ static int _ses_ctrl(const char *disk_path, lsm_error **lsm_err, int action,
 /*
  * `tp_sas_addr` should be char[_SG_T10_SPL_SAS_ADDR_LEN]
  */
+static char *_mpath_of_sd_name(const char *sd_name);
+static void _index_entries_clear(lsm_local_disk_index *index);
+static int _index_disk_add(char *err_msg, lsm_local_disk_index *index,
+                           const char *disk_path);
+static void _index_disk_remove(lsm_local_disk_index *index,
+                               const char *disk_path);
+static int _index_build(char *err_msg, lsm_local_disk_index *index);
+static int _index_search(char *err_msg, lsm_local_disk_index *index,
+                         const char *vpd83, lsm_string_list **disk_path_list);
+
 static int _sas_addr_get(char *err_msg, const char *disk_path,
                          char *tp_sas_addr);
 
@@ -1290,3 +1326,500 @@ out:
 
     return rc;
 }
+
+/*
+ * Return the "/dev/mapper/<name>" path of the multipath device holding
+ * given disk, NULL if none or no memory.
+ */
+static char *_mpath_of_sd_name(const char *sd_name) {
+    char sysfs_path[_MAX_SYSFS_BLK_PATH_STR_LEN];
+    char dm_name[_MAX_DM_NAME_STR_LEN + 1];
+    ssize_t size = 0;
+    DIR *dir = NULL;
+    struct dirent *holder = NULL;
+    char *mpath = NULL;
+
+    snprintf(sysfs_path, _MAX_SYSFS_BLK_PATH_STR_LEN,
+             _SYSFS_HOLDERS_PATH_FORMAT, sd_name);
+    dir = opendir(sysfs_path);
+    if (dir == NULL)
+        return NULL;
+
+    while ((mpath == NULL) && ((holder = readdir(dir)) != NULL)) {
+        if (holder->d_name[0] == '.')
+            continue;
+
+        if (snprintf(sysfs_path, _MAX_SYSFS_BLK_PATH_STR_LEN,
+                     _SYSFS_DM_UUID_PATH_FORMAT,
+                     holder->d_name) >= _MAX_SYSFS_BLK_PATH_STR_LEN)
+            continue;
+        if ((_read_file(sysfs_path, (uint8_t *)dm_name, &size,
+                        sizeof(dm_name)) != 0) ||
+            (strncmp(dm_name, _DM_MPATH_UUID_PREFIX,
+                     strlen(_DM_MPATH_UUID_PREFIX)) != 0))
+            continue;
+
+        if (snprintf(sysfs_path, _MAX_SYSFS_BLK_PATH_STR_LEN,
+                     _SYSFS_DM_NAME_PATH_FORMAT,
+                     holder->d_name) >= _MAX_SYSFS_BLK_PATH_STR_LEN)
+            continue;
+        if (_read_file(sysfs_path, (uint8_t *)dm_name, &size,
+                       sizeof(dm_name)) != 0)
+            continue;
+        dm_name[strcspn(dm_name, "\n")] = '\0';
+        if (dm_name[0] == '\0')
+            continue;
+
+        mpath = (char *)malloc(strlen(_MPATH_PATH_PREFIX) + strlen(dm_name) +
+                               1);
+        if (mpath != NULL)
+            sprintf(mpath, _MPATH_PATH_PREFIX "%s", dm_name);
+    }
+    closedir(dir);
+    return mpath;
+}
+
+static void _index_entry_free(struct _lsm_local_disk_index_entry *entry) {
+    free(entry->vpd83);
+    free(entry->disk_path);
+    free(entry->mpath);
+}
+
+static void _index_entries_clear(lsm_local_disk_index *index) {
+    uint32_t i = 0;
+
+    for (i = 0; i < index->count; ++i)
+        _index_entry_free(&index->entries[i]);
+    index->count = 0;
+}
+
+/*
+ * Disks without VPD83 NAA ID are skipped.
+ */
+static int _index_disk_add(char *err_msg, lsm_local_disk_index *index,
+                           const char *disk_path) {
+    char *vpd83 = NULL;
+    lsm_error *tmp_lsm_err = NULL;
+    struct _lsm_local_disk_index_entry *entries = NULL;
+    struct _lsm_local_disk_index_entry *entry = NULL;
+    uint32_t alloc_count = 0;
+
+    if (lsm_local_disk_vpd83_get(disk_path, &vpd83, &tmp_lsm_err) !=
+        LSM_ERR_OK) {
+        lsm_error_free(tmp_lsm_err);
+        return LSM_ERR_OK;
+    }
+    if (vpd83 == NULL)
+        return LSM_ERR_OK;
+
+    if (index->count == index->alloc_count) {
+        alloc_count = index->alloc_count ? index->alloc_count * 2 : 16;
+        entries = (struct _lsm_local_disk_index_entry *)realloc(
+            index->entries,
+            sizeof(struct _lsm_local_disk_index_entry) * alloc_count);
+        if (entries == NULL) {
+            free(vpd83);
+            _lsm_err_msg_set(err_msg, "No memory");
+            return LSM_ERR_NO_MEMORY;
+        }
+        index->entries = entries;
+        index->alloc_count = alloc_count;
+    }
+
+    entry = &index->entries[index->count];
+    entry->vpd83 = vpd83;
+    entry->disk_path = strdup(disk_path);
+    /* lsm_local_disk_vpd83_get() only support "/dev/sd" disks */
+    entry->mpath = _mpath_of_sd_name(disk_path + strlen("/dev/"));
+    if (entry->disk_path == NULL) {
+        _index_entry_free(entry);
+        _lsm_err_msg_set(err_msg, "No memory");
+        return LSM_ERR_NO_MEMORY;
+    }
+    index->count++;
+    index->sorted = false;
+    return LSM_ERR_OK;
+}
+
+static void _index_disk_remove(lsm_local_disk_index *index,
+                               const char *disk_path) {
+    uint32_t i = index->count;
+
+    while (i-- > 0) {
+        if (strcmp(index->entries[i].disk_path, disk_path) == 0) {
+            _index_entry_free(&index->entries[i]);
+            index->entries[i] = index->entries[--index->count];
+            index->sorted = false;
+        }
+    }
+}
+
+static void _index_mpath_refresh(lsm_local_disk_index *index) {
+    uint32_t i = 0;
+
+    for (i = 0; i < index->count; ++i) {
+        free(index->entries[i].mpath);
+        index->entries[i].mpath =
+            _mpath_of_sd_name(index->entries[i].disk_path + strlen("/dev/"));
+    }
+}
+
+static int _index_build(char *err_msg, lsm_local_disk_index *index) {
+    int rc = LSM_ERR_OK;
+    uint32_t i = 0;
+    const char *disk_path = NULL;
+    lsm_string_list *disk_paths = NULL;
+    lsm_error *tmp_lsm_err = NULL;
+
+    _index_entries_clear(index);
+
+    rc = lsm_local_disk_list(&disk_paths, &tmp_lsm_err);
+    if (rc != LSM_ERR_OK) {
+        _lsm_err_msg_set(err_msg, "%s", lsm_error_message_get(tmp_lsm_err));
+        lsm_error_free(tmp_lsm_err);
+        goto out;
+    }
+
+    _lsm_string_list_foreach(disk_paths, i, disk_path) {
+        _good(_index_disk_add(err_msg, index, disk_path), rc, out);
+    }
+
+out:
+    if (disk_paths != NULL)
+        lsm_string_list_free(disk_paths);
+    return rc;
+}
+
+static int _index_entry_cmp(const void *a, const void *b) {
+    const struct _lsm_local_disk_index_entry *entry_a =
+        (const struct _lsm_local_disk_index_entry *)a;
+    const struct _lsm_local_disk_index_entry *entry_b =
+        (const struct _lsm_local_disk_index_entry *)b;
+    int rc = strcmp(entry_a->vpd83, entry_b->vpd83);
+
+    if (rc == 0)
+        rc = strcmp(entry_a->disk_path, entry_b->disk_path);
+    return rc;
+}
+
+static bool _string_list_contains(lsm_string_list *str_list, const char *str) {
+    uint32_t i = 0;
+    const char *tmp_str = NULL;
+
+    _lsm_string_list_foreach(str_list, i, tmp_str) {
+        if (strcmp(tmp_str, str) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Preconditions:
+ *  strlen(vpd83) < _LSM_MAX_VPD83_ID_LEN
+ *
+ * Binary search of the sorted entries, disks first then their multipath
+ * devices.  *disk_path_list is NULL if not found.
+ */
+static int _index_search(char *err_msg, lsm_local_disk_index *index,
+                         const char *vpd83, lsm_string_list **disk_path_list) {
+    int rc = LSM_ERR_OK;
+    uint32_t low = 0;
+    uint32_t high = index->count;
+    uint32_t mid = 0;
+    uint32_t i = 0;
+
+    *disk_path_list = NULL;
+
+    if (!index->sorted) {
+        if (index->count > 0)
+            qsort(index->entries, index->count,
+                  sizeof(struct _lsm_local_disk_index_entry),
+                  _index_entry_cmp);
+        index->sorted = true;
+    }
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (strcmp(index->entries[mid].vpd83, vpd83) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if ((low == index->count) ||
+        (strcmp(index->entries[low].vpd83, vpd83) != 0))
+        return LSM_ERR_OK;
+
+    *disk_path_list = lsm_string_list_alloc(0 /* no pre-allocation */);
+    _alloc_null_check(err_msg, *disk_path_list, rc, out);
+
+    for (i = low;
+         (i < index->count) && (strcmp(index->entries[i].vpd83, vpd83) == 0);
+         ++i) {
+        if (lsm_string_list_append(*disk_path_list,
+                                   index->entries[i].disk_path) != 0) {
+            rc = LSM_ERR_NO_MEMORY;
+            goto out;
+        }
+    }
+    for (i = low;
+         (i < index->count) && (strcmp(index->entries[i].vpd83, vpd83) == 0);
+         ++i) {
+        if ((index->entries[i].mpath == NULL) ||
+            _string_list_contains(*disk_path_list, index->entries[i].mpath))
+            continue;
+        if (lsm_string_list_append(*disk_path_list,
+                                   index->entries[i].mpath) != 0) {
+            rc = LSM_ERR_NO_MEMORY;
+            goto out;
+        }
+    }
+
+out:
+    if ((rc != LSM_ERR_OK) && (*disk_path_list != NULL)) {
+        lsm_string_list_free(*disk_path_list);
+        *disk_path_list = NULL;
+    }
+    return rc;
+}
+
+int lsm_local_disk_index_new(lsm_local_disk_index **index,
+                             lsm_error **lsm_err) {
+    int rc = LSM_ERR_OK;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    struct udev_monitor *udev_mon = NULL;
+
+    _lsm_err_msg_clear(err_msg);
+
+    rc = _check_null_ptr(err_msg, 2 /* argument count */, index, lsm_err);
+    if (rc != LSM_ERR_OK) {
+        if (index != NULL)
+            *index = NULL;
+        goto out;
+    }
+
+    *lsm_err = NULL;
+    *index = (lsm_local_disk_index *)calloc(1, sizeof(lsm_local_disk_index));
+    _alloc_null_check(err_msg, *index, rc, out);
+
+    /* Listen before querying the disks, so that no change is missed */
+    (*index)->udev = udev_new();
+    if ((*index)->udev != NULL)
+        udev_mon = udev_monitor_new_from_netlink((*index)->udev, "udev");
+    if ((udev_mon != NULL) &&
+        ((udev_monitor_filter_add_match_subsystem_devtype(udev_mon, "block",
+                                                          "disk") != 0) ||
+         (udev_monitor_enable_receiving(udev_mon) != 0))) {
+        udev_monitor_unref(udev_mon);
+        udev_mon = NULL;
+    }
+    (*index)->udev_mon = udev_mon;
+
+    rc = _index_build(err_msg, *index);
+
+out:
+    if (rc != LSM_ERR_OK) {
+        if ((index != NULL) && (*index != NULL)) {
+            lsm_local_disk_index_free(*index);
+            *index = NULL;
+        }
+        if (lsm_err != NULL)
+            *lsm_err = LSM_ERROR_CREATE_PLUGIN_MSG(rc, err_msg);
+    }
+    return rc;
+}
+
+int lsm_local_disk_index_free(lsm_local_disk_index *index) {
+    if (index == NULL)
+        return LSM_ERR_INVALID_ARGUMENT;
+
+    _index_entries_clear(index);
+    free(index->entries);
+    if (index->udev_mon != NULL)
+        udev_monitor_unref(index->udev_mon);
+    if (index->udev != NULL)
+        udev_unref(index->udev);
+    free(index);
+    return LSM_ERR_OK;
+}
+
+int lsm_local_disk_index_fd_get(lsm_local_disk_index *index) {
+    if ((index == NULL) || (index->udev_mon == NULL))
+        return -1;
+    return udev_monitor_get_fd(index->udev_mon);
+}
+
+int lsm_local_disk_index_update(lsm_local_disk_index *index,
+                                lsm_error **lsm_err) {
+    int rc = LSM_ERR_OK;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    struct udev_device *udev_dev = NULL;
+    const char *disk_path = NULL;
+    const char *action = NULL;
+    const char *sys_name = NULL;
+    bool mpath_changed = false;
+
+    _lsm_err_msg_clear(err_msg);
+
+    rc = _check_null_ptr(err_msg, 2 /* argument count */, index, lsm_err);
+    if (rc != LSM_ERR_OK)
+        goto out;
+
+    *lsm_err = NULL;
+
+    if (index->udev_mon == NULL) {
+        rc = _index_build(err_msg, index);
+        goto out;
+    }
+
+    /* The udev monitor socket is non-blocking */
+    while ((udev_dev = udev_monitor_receive_device(index->udev_mon)) != NULL) {
+        disk_path = udev_device_get_devnode(udev_dev);
+        action = udev_device_get_action(udev_dev);
+        sys_name = udev_device_get_sysname(udev_dev);
+
+        if ((disk_path != NULL) &&
+            (strncmp(disk_path, "/dev/sd", strlen("/dev/sd")) == 0)) {
+            _index_disk_remove(index, disk_path);
+            if ((action == NULL) || (strcmp(action, "remove") != 0))
+                rc = _index_disk_add(err_msg, index, disk_path);
+        } else if ((sys_name != NULL) &&
+                   (strncmp(sys_name, "dm-", strlen("dm-")) == 0)) {
+            /* Multipath device got created, changed or removed */
+            mpath_changed = true;
+        }
+        udev_device_unref(udev_dev);
+        if (rc != LSM_ERR_OK)
+            goto out;
+    }
+
+    if (mpath_changed)
+        _index_mpath_refresh(index);
+
+out:
+    if ((rc != LSM_ERR_OK) && (lsm_err != NULL))
+        *lsm_err = LSM_ERROR_CREATE_PLUGIN_MSG(rc, err_msg);
+    return rc;
+}
+
+int lsm_local_disk_index_vpd83_search(lsm_local_disk_index *index,
+                                      const char *vpd83,
+                                      lsm_string_list **disk_path_list,
+                                      lsm_error **lsm_err) {
+    int rc = LSM_ERR_OK;
+    char err_msg[_LSM_ERR_MSG_LEN];
+
+    _lsm_err_msg_clear(err_msg);
+
+    rc = _check_null_ptr(err_msg, 4 /* argument count */, index, vpd83,
+                         disk_path_list, lsm_err);
+    if (rc != LSM_ERR_OK) {
+        if (disk_path_list != NULL)
+            *disk_path_list = NULL;
+        goto out;
+    }
+
+    *lsm_err = NULL;
+    *disk_path_list = NULL;
+
+    if (strlen(vpd83) >= _LSM_MAX_VPD83_ID_LEN) {
+        _lsm_err_msg_set(err_msg,
+                         "Provided vpd83 string exceeded the maximum "
+                         "string length for SCSI VPD83 NAA ID %d, current %zd",
+                         _LSM_MAX_VPD83_ID_LEN - 1, strlen(vpd83));
+        rc = LSM_ERR_INVALID_ARGUMENT;
+        goto out;
+    }
+
+    rc = _index_search(err_msg, index, vpd83, disk_path_list);
+
+out:
+    if ((rc != LSM_ERR_OK) && (lsm_err != NULL))
+        *lsm_err = LSM_ERROR_CREATE_PLUGIN_MSG(rc, err_msg);
+    return rc;
+}
+
+int lsm_local_disk_volume_join(lsm_local_disk_index *index,
+                               lsm_volume *volumes[], uint32_t volume_count,
+                               lsm_string_list **disk_path_lists[],
+                               lsm_error **lsm_err) {
+    int rc = LSM_ERR_OK;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    lsm_local_disk_index *tmp_index = NULL;
+    lsm_error *tmp_lsm_err = NULL;
+    const char *vpd83 = NULL;
+    uint32_t i = 0;
+
+    _lsm_err_msg_clear(err_msg);
+
+    rc = _check_null_ptr(err_msg, 2 /* argument count */, disk_path_lists,
+                         lsm_err);
+    if (rc != LSM_ERR_OK) {
+        if (disk_path_lists != NULL)
+            *disk_path_lists = NULL;
+        goto out;
+    }
+    if ((volumes == NULL) && (volume_count != 0)) {
+        *disk_path_lists = NULL;
+        _lsm_err_msg_set(err_msg, "Got NULL volumes with volume_count %u",
+                         (unsigned int)volume_count);
+        rc = LSM_ERR_INVALID_ARGUMENT;
+        goto out;
+    }
+
+    *lsm_err = NULL;
+    *disk_path_lists = NULL;
+
+    if (index == NULL) {
+        rc = lsm_local_disk_index_new(&tmp_index, &tmp_lsm_err);
+        if (rc != LSM_ERR_OK) {
+            _lsm_err_msg_set(err_msg, "%s",
+                             lsm_error_message_get(tmp_lsm_err));
+            lsm_error_free(tmp_lsm_err);
+            goto out;
+        }
+        index = tmp_index;
+    }
+
+    /* One more so that no volume still gets a non-NULL array */
+    *disk_path_lists =
+        (lsm_string_list **)calloc(volume_count + 1, sizeof(lsm_string_list *));
+    _alloc_null_check(err_msg, *disk_path_lists, rc, out);
+
+    for (i = 0; i < volume_count; ++i) {
+        vpd83 = lsm_volume_vpd83_get(volumes[i]);
+        if ((vpd83 == NULL) || (vpd83[0] == '\0') ||
+            (strlen(vpd83) >= _LSM_MAX_VPD83_ID_LEN))
+            continue;
+        _good(_index_search(err_msg, index, vpd83, &(*disk_path_lists)[i]), rc,
+              out);
+    }
+
+out:
+    if (tmp_index != NULL)
+        lsm_local_disk_index_free(tmp_index);
+
+    if (rc != LSM_ERR_OK) {
+        if ((disk_path_lists != NULL) && (*disk_path_lists != NULL)) {
+            lsm_local_disk_volume_join_free(*disk_path_lists, volume_count);
+            *disk_path_lists = NULL;
+        }
+        if (lsm_err != NULL)
+            *lsm_err = LSM_ERROR_CREATE_PLUGIN_MSG(rc, err_msg);
+    }
+    return rc;
+}
+
+int lsm_local_disk_volume_join_free(lsm_string_list *disk_path_lists[],
+                                    uint32_t volume_count) {
+    uint32_t i = 0;
+
+    if (disk_path_lists == NULL)
+        return LSM_ERR_INVALID_ARGUMENT;
+
+    for (i = 0; i < volume_count; ++i) {
+        if (disk_path_lists[i] != NULL)
+            lsm_string_list_free(disk_path_lists[i]);
+    }
+    free(disk_path_lists);
+    return LSM_ERR_OK;
+}
@@ -27,6 +27,7 @@
 
 #include "lsm_convert.hpp"
 #include "lsm_datatypes.hpp"
+#include "lsm_schema.hpp"
 
 #define COUNT_OF(x)                                                            \
     ((sizeof(x) / sizeof(0 [x])) / ((size_t)(!(sizeof(x) % sizeof(0 [x])))))
@@ -58,9 +59,6 @@ static const char *const TARGET_PORT_SEARCH_KEYS[] = {"id", "system_id"};
 
 #define TARGET_PORT_SEARCH_KEYS_COUNT COUNT_OF(TARGET_PORT_SEARCH_KEYS)
 
-static int get_battery_array(lsm_connect *c, int rc, Value &response,
-                             lsm_battery **bs[], uint32_t *count);
-
 /**
  * Common code to validate and initialize the connection.
  */
@@ -181,6 +179,12 @@ static int verify_initiator_id(const char *id, lsm_access_group_init_type t,
 int lsm_connect_password(const char *uri, const char *password,
                          lsm_connect **conn, uint32_t timeout, lsm_error_ptr *e,
                          lsm_flag flags) {
+    return connection_open(uri, password, conn, timeout, 0, e, flags);
+}
+
+int connection_open(const char *uri, const char *password, lsm_connect **conn,
+                    uint32_t timeout, uint32_t wait_ms, lsm_error_ptr *e,
+                    lsm_flag flags) {
     int rc = LSM_ERR_OK;
     lsm_connect *c = NULL;
 
@@ -197,7 +201,7 @@ int lsm_connect_password(const char *uri, const char *password,
             c->raw_uri = strdup(uri);
             if (c->raw_uri) {
                 rc = driver_load(c, c->uri->scheme, password, timeout, e, 1,
-                                 flags);
+                                 wait_ms, flags);
                 if (rc == LSM_ERR_OK) {
                     *conn = (lsm_connect *)c;
                 }
@@ -263,6 +267,139 @@ static int rpc(lsm_connect *c, const char *method, const Value &parameters,
     return LSM_ERR_OK;
 }
 
+static int rpc(lsm_connect *c, const char *method, const Value &parameters,
+               ElementSink &sink) throw() {
+    try {
+        c->tp->rpc(method, parameters, sink);
+    } catch (const ValueException &ve) {
+        return log_exception(c, LSM_ERR_TRANSPORT_SERIALIZATION,
+                             "Serialization error", ve.what());
+    } catch (const LsmException &le) {
+        return log_exception(c, (lsm_error_number)le.error_code, le.what(),
+                             NULL);
+    } catch (const EOFException &eof) {
+        return log_exception(c, LSM_ERR_TRANSPORT_COMMUNICATION, "Plug-in died",
+                             "Check syslog");
+    } catch (...) {
+        return log_exception(c, LSM_ERR_LIB_BUG, "Unexpected exception",
+                             "Unknown exception");
+    }
+    return LSM_ERR_OK;
+}
+
+/**
+ * Decodes the records of a list reply straight from its tokens while it
+ * arrives, handing each to a callback or keeping them.
+ */
+class LSM_DLL_LOCAL RecordSink : public ElementSink {
+  public:
+    /**
+     * Constructor
+     * @param s         Schema of the records
+     * @param callback  Takes each record, NULL to keep them
+     * @param data      Handed to callback
+     */
+    RecordSink(const lsm_schema &s, lsm_list_stream_cb callback, void *data)
+        : rc(LSM_ERR_OK), schema(s), cb(callback), user_data(data) {}
+
+    ~RecordSink() {
+        for (size_t i = 0; i < kept.size(); ++i) {
+            schema.record_free(kept[i]);
+        }
+    }
+
+    virtual bool elements(const Message &m, int index, uint32_t count) {
+        try {
+            for (uint32_t i = 0; i < count; ++i, index = m.next(index)) {
+                void *r = schema_decode(schema, m, index);
+
+                if (!r) {
+                    rc = LSM_ERR_NO_MEMORY;
+                } else if (cb) {
+                    rc = cb(r, user_data);
+                } else {
+                    kept.push_back(r);
+                }
+                if (LSM_ERR_OK != rc) {
+                    return false;
+                }
+            }
+        } catch (const ValueException &ve) {
+            rc = LSM_ERR_PLUGIN_BUG;
+            error = ve.what();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Takes the records kept
+     * @param[out] records  Records, NULL when there are none
+     * @param[out] count    Number of records
+     * @return LSM_ERR_OK on success, else error reason
+     */
+    int take(void **records[], uint32_t *count) {
+        if (kept.size()) {
+            *records = (void **)malloc(sizeof(void *) * kept.size());
+            if (!*records) {
+                return LSM_ERR_NO_MEMORY;
+            }
+            memcpy(*records, &kept[0], sizeof(void *) * kept.size());
+            *count = kept.size();
+            kept.clear();
+        }
+        return LSM_ERR_OK;
+    }
+
+    int rc;            /**< LSM_ERR_OK, else why no more records are taken */
+    std::string error; /**< Why records were invalid */
+
+  private:
+    const lsm_schema &schema;
+    lsm_list_stream_cb cb;
+    void *user_data;
+    std::vector<void *> kept;
+};
+
+/**
+ * Calls a list method, handing the records returned to sink as they
+ * arrive.
+ */
+static int rpc_stream(lsm_connect *c, const char *method,
+                      const Value &parameters, RecordSink &sink) {
+    int rc = rpc(c, method, parameters, sink);
+
+    if (LSM_ERR_OK == rc && sink.error.size()) {
+        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type",
+                           sink.error.c_str());
+    } else if (LSM_ERR_OK == rc) {
+        rc = sink.rc;
+    }
+    return rc;
+}
+
+/**
+ * Calls a list method, decoding the records returned straight from the
+ * response tokens while it arrives.
+ */
+template <class T>
+static int rpc_records(lsm_connect *c, const char *method,
+                       const Value &parameters, const lsm_schema &s,
+                       T **records[], uint32_t *count) {
+    RecordSink sink(s, NULL, NULL);
+    void **r = NULL;
+
+    *records = NULL;
+    *count = 0;
+
+    int rc = rpc_stream(c, method, parameters, sink);
+    if (LSM_ERR_OK == rc) {
+        rc = sink.take(&r, count);
+        *records = (T **)r;
+    }
+    return rc;
+}
+
 static int job_check(lsm_connect *c, int rc, Value &response, char **job) {
     try {
         if (LSM_ERR_OK == rc) {
@@ -285,18 +422,6 @@ static int job_check(lsm_connect *c, int rc, Value &response, char **job) {
     return rc;
 }
 
-static int get_access_groups(lsm_connect *c, int rc, Value &response,
-                             lsm_access_group **groups[], uint32_t *count) {
-    try {
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            rc = value_array_to_access_groups(response, groups, count);
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-    }
-    return rc;
-}
-
 static int add_search_params(std::map<std::string, Value> &p, const char *k,
                              const char *v, const char *const supported_keys[],
                              size_t supported_keys_count) {
@@ -314,6 +439,24 @@ static int add_search_params(std::map<std::string, Value> &p, const char *k,
     return LSM_ERR_OK;
 }
 
+static int add_fields_param(std::map<std::string, Value> &p,
+                            lsm_string_list *fields, const lsm_schema &s) {
+    if (fields) {
+        uint32_t i = 0;
+
+        if (!LSM_IS_STRING_LIST(fields)) {
+            return LSM_ERR_INVALID_ARGUMENT;
+        }
+        for (i = 0; i < lsm_string_list_size(fields); ++i) {
+            if (!schema_has_field(s, lsm_string_list_elem_get(fields, i))) {
+                return LSM_ERR_INVALID_ARGUMENT;
+            }
+        }
+        p["fields"] = string_list_to_value(fields);
+    }
+    return LSM_ERR_OK;
+}
+
 int lsm_connect_close(lsm_connect *c, lsm_flag flags) {
     CONN_SETUP(c);
 
@@ -415,7 +558,7 @@ int lsm_available_plugins_list(const char *sep, lsm_string_list **plugins,
             if (DT_SOCK == dp->d_type) {
                 c = connection_get();
                 if (c) {
-                    rc = driver_load(c, dp->d_name, NULL, 30000, &e, 0, 0);
+                    rc = driver_load(c, dp->d_name, NULL, 30000, &e, 0, 0, 0);
                     if (LSM_ERR_OK == rc) {
                         // Get the plugin information
                         rc = lsm_plugin_info_get(c, &desc, &version, 0);
@@ -751,62 +894,35 @@ int lsm_capabilities(lsm_connect *c, lsm_system *system,
 
 int lsm_pool_list(lsm_connect *c, char *search_key, char *search_value,
                   lsm_pool **poolArray[], uint32_t *count, lsm_flag flags) {
-    int rc = LSM_ERR_OK;
+    return lsm_pool_list_fields(c, search_key, search_value, NULL, poolArray,
+                                count, flags);
+}
+
+int lsm_pool_list_fields(lsm_connect *c, const char *search_key,
+                         const char *search_value, lsm_string_list *fields,
+                         lsm_pool **poolArray[], uint32_t *count,
+                         lsm_flag flags) {
     CONN_SETUP(c);
 
     if (!poolArray || !count || CHECK_RP(poolArray)) {
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    *count = 0;
-    *poolArray = NULL;
-
-    try {
-        std::map<std::string, Value> p;
+    std::map<std::string, Value> p;
 
-        rc = add_search_params(p, search_key, search_value, POOL_SEARCH_KEYS,
+    int rc = add_search_params(p, search_key, search_value, POOL_SEARCH_KEYS,
                                POOL_SEARCH_KEYS_COUNT);
-        if (LSM_ERR_OK != rc) {
-            return rc;
-        }
-
-        p["flags"] = Value(flags);
-        Value parameters(p);
-        Value response;
-
-        rc = rpc(c, "pools", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> pools = response.asArray();
-
-            *count = pools.size();
-
-            if (pools.size()) {
-                *poolArray = lsm_pool_record_array_alloc(pools.size());
-
-                for (size_t i = 0; i < pools.size(); ++i) {
-                    (*poolArray)[i] = value_to_pool(pools[i]);
-                    if (!(*poolArray)[i]) {
-                        rc = LSM_ERR_NO_MEMORY;
-                        goto error;
-                    }
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
+    if (LSM_ERR_OK == rc) {
+        rc = add_fields_param(p, fields, POOL_SCHEMA);
+    }
+    if (LSM_ERR_OK != rc) {
+        return rc;
     }
 
-out:
-    return rc;
+    p["flags"] = Value(flags);
+    Value parameters(p);
 
-error:
-    if (*poolArray && *count) {
-        lsm_pool_record_array_free(*poolArray, *count);
-        *poolArray = NULL;
-        *count = 0;
-    }
-    goto out;
+    return rpc_records(c, "pools", parameters, POOL_SCHEMA, poolArray, count);
 }
 
 int lsm_pool_member_info(lsm_connect *c, lsm_pool *pool,
@@ -870,76 +986,39 @@ int lsm_target_port_list(lsm_connect *c, const char *search_key,
                          const char *search_value,
                          lsm_target_port **target_ports[], uint32_t *count,
                          lsm_flag flags) {
-    int rc = LSM_ERR_OK;
     CONN_SETUP(c);
 
     if (!target_ports || !count || CHECK_RP(target_ports)) {
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    try {
-        std::map<std::string, Value> p;
+    std::map<std::string, Value> p;
 
-        rc = add_search_params(p, search_key, search_value,
+    int rc = add_search_params(p, search_key, search_value,
                                TARGET_PORT_SEARCH_KEYS,
                                TARGET_PORT_SEARCH_KEYS_COUNT);
-        if (LSM_ERR_OK != rc) {
-            return rc;
-        }
-
-        p["flags"] = Value(flags);
-        Value parameters(p);
-        Value response;
-
-        rc = rpc(c, "target_ports", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> tp = response.asArray();
-
-            *count = tp.size();
-
-            if (tp.size()) {
-                *target_ports = lsm_target_port_record_array_alloc(tp.size());
-
-                for (size_t i = 0; i < tp.size(); ++i) {
-                    (*target_ports)[i] = value_to_target_port(tp[i]);
-                    if (!((*target_ports)[i])) {
-                        rc = LSM_ERR_NO_MEMORY;
-                        goto error;
-                    }
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
+    if (LSM_ERR_OK != rc) {
+        return rc;
     }
-out:
-    return rc;
 
-error:
-    if (*target_ports && *count) {
-        lsm_target_port_record_array_free(*target_ports, *count);
-        *target_ports = NULL;
-        *count = 0;
-    }
-    goto out;
-}
+    p["flags"] = Value(flags);
+    Value parameters(p);
 
-static int get_volume_array(lsm_connect *c, int rc, Value &response,
-                            lsm_volume **volumes[], uint32_t *count) {
-    if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-        try {
-            rc = value_array_to_volumes(response, volumes, count);
-        } catch (const ValueException &ve) {
-            rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Wrong type", ve.what());
-        }
-    }
-    return rc;
+    return rpc_records(c, "target_ports", parameters, TARGET_PORT_SCHEMA,
+                       target_ports, count);
 }
 
 int lsm_volume_list(lsm_connect *c, const char *search_key,
                     const char *search_value, lsm_volume **volumes[],
                     uint32_t *count, lsm_flag flags) {
+    return lsm_volume_list_fields(c, search_key, search_value, NULL, volumes,
+                                  count, flags);
+}
+
+int lsm_volume_list_fields(lsm_connect *c, const char *search_key,
+                           const char *search_value, lsm_string_list *fields,
+                           lsm_volume **volumes[], uint32_t *count,
+                           lsm_flag flags) {
     CONN_SETUP(c);
 
     if (!volumes || !count || CHECK_RP(volumes)) {
@@ -951,33 +1030,29 @@ int lsm_volume_list(lsm_connect *c, const char *search_key,
 
     int rc = add_search_params(p, search_key, search_value, VOLUME_SEARCH_KEYS,
                                VOLUME_SEARCH_KEYS_COUNT);
+    if (LSM_ERR_OK == rc) {
+        rc = add_fields_param(p, fields, VOLUME_SCHEMA);
+    }
     if (LSM_ERR_OK != rc) {
         return rc;
     }
 
     Value parameters(p);
-    Value response;
 
-    rc = rpc(c, "volumes", parameters, response);
-    return get_volume_array(c, rc, response, volumes, count);
-}
-
-static int get_disk_array(lsm_connect *c, int rc, Value &response,
-                          lsm_disk **disks[], uint32_t *count) {
-    if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-        rc = value_array_to_disks(response, disks, count);
-
-        if (LSM_ERR_OK != rc) {
-            rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", NULL);
-        }
-    }
-
-    return rc;
+    return rpc_records(c, "volumes", parameters, VOLUME_SCHEMA, volumes,
+                       count);
 }
 
 int lsm_disk_list(lsm_connect *c, const char *search_key,
                   const char *search_value, lsm_disk **disks[], uint32_t *count,
                   lsm_flag flags) {
+    return lsm_disk_list_fields(c, search_key, search_value, NULL, disks,
+                                count, flags);
+}
+
+int lsm_disk_list_fields(lsm_connect *c, const char *search_key,
+                         const char *search_value, lsm_string_list *fields,
+                         lsm_disk **disks[], uint32_t *count, lsm_flag flags) {
     CONN_SETUP(c);
 
     if (CHECK_RP(disks) || !count) {
@@ -989,15 +1064,16 @@ int lsm_disk_list(lsm_connect *c, const char *search_key,
 
     int rc = add_search_params(p, search_key, search_value, DISK_SEARCH_KEYS,
                                DISK_SEARCH_KEYS_COUNT);
+    if (LSM_ERR_OK == rc) {
+        rc = add_fields_param(p, fields, DISK_SCHEMA);
+    }
     if (LSM_ERR_OK != rc) {
         return rc;
     }
 
     Value parameters(p);
-    Value response;
 
-    rc = rpc(c, "disks", parameters, response);
-    return get_disk_array(c, rc, response, disks, count);
+    return rpc_records(c, "disks", parameters, DISK_SCHEMA, disks, count);
 }
 
 typedef void *(*convert)(Value &v);
@@ -1341,10 +1417,9 @@ int lsm_access_group_list(lsm_connect *c, const char *search_key,
 
     p["flags"] = Value(flags);
     Value parameters(p);
-    Value response;
 
-    rc = rpc(c, "access_groups", parameters, response);
-    return get_access_groups(c, rc, response, groups, groupCount);
+    return rpc_records(c, "access_groups", parameters, ACCESS_GROUP_SCHEMA,
+                       groups, groupCount);
 }
 
 int lsm_access_group_create(lsm_connect *c, const char *name,
@@ -1523,7 +1598,6 @@ int lsm_volumes_accessible_by_access_group(lsm_connect *c,
                                            lsm_access_group *group,
                                            lsm_volume **volumes[],
                                            uint32_t *count, lsm_flag flags) {
-    int rc = LSM_ERR_OK;
     CONN_SETUP(c);
 
     if (!LSM_IS_ACCESS_GROUP(group) || !volumes || !count ||
@@ -1531,51 +1605,14 @@ int lsm_volumes_accessible_by_access_group(lsm_connect *c,
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    try {
-        std::map<std::string, Value> p;
-        p["access_group"] = access_group_to_value(group);
-        p["flags"] = Value(flags);
-
-        Value parameters(p);
-        Value response;
-
-        rc = rpc(c, "volumes_accessible_by_access_group", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> vol = response.asArray();
-
-            *count = vol.size();
-
-            if (vol.size()) {
-                *volumes = lsm_volume_record_array_alloc(vol.size());
-
-                if (*volumes) {
-                    for (size_t i = 0; i < vol.size(); ++i) {
-                        (*volumes)[i] = value_to_volume(vol[i]);
-                        if (!((*volumes)[i])) {
-                            rc = LSM_ERR_NO_MEMORY;
-                            goto error;
-                        }
-                    }
-                } else {
-                    rc = LSM_ERR_NO_MEMORY;
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
-    }
+    std::map<std::string, Value> p;
+    p["access_group"] = access_group_to_value(group);
+    p["flags"] = Value(flags);
 
-out:
-    return rc;
+    Value parameters(p);
 
-error:
-    if (*volumes && *count) {
-        lsm_volume_record_array_free(*volumes, *count);
-        *volumes = NULL;
-        *count = 0;
-    }
-    goto out;
+    return rpc_records(c, "volumes_accessible_by_access_group", parameters,
+                       VOLUME_SCHEMA, volumes, count);
 }
 
 int lsm_access_groups_granted_to_volume(lsm_connect *c, lsm_volume *volume,
@@ -1596,10 +1633,9 @@ int lsm_access_groups_granted_to_volume(lsm_connect *c, lsm_volume *volume,
     p["flags"] = Value(flags);
 
     Value parameters(p);
-    Value response;
 
-    int rc = rpc(c, "access_groups_granted_to_volume", parameters, response);
-    return get_access_groups(c, rc, response, groups, groupCount);
+    return rpc_records(c, "access_groups_granted_to_volume", parameters,
+                       ACCESS_GROUP_SCHEMA, groups, groupCount);
 }
 
 static int _retrieve_bool(int rc, Value &response, uint8_t *yes) {
@@ -1663,116 +1699,53 @@ int lsm_volume_child_dependency_delete(lsm_connect *c, lsm_volume *volume,
 
 int lsm_system_list(lsm_connect *c, lsm_system **systems[],
                     uint32_t *systemCount, lsm_flag flags) {
-    int rc = LSM_ERR_OK;
+    return lsm_system_list_fields(c, NULL, systems, systemCount, flags);
+}
+
+int lsm_system_list_fields(lsm_connect *c, lsm_string_list *fields,
+                           lsm_system **systems[], uint32_t *systemCount,
+                           lsm_flag flags) {
     CONN_SETUP(c);
 
     if (!systems || !systemCount) {
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    try {
-        std::map<std::string, Value> p;
-        p["flags"] = Value(flags);
-        Value parameters(p);
-        Value response;
-
-        rc = rpc(c, "systems", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> sys = response.asArray();
-
-            *systemCount = sys.size();
-
-            if (sys.size()) {
-                *systems = lsm_system_record_array_alloc(sys.size());
+    std::map<std::string, Value> p;
+    p["flags"] = Value(flags);
 
-                if (*systems) {
-                    for (size_t i = 0; i < sys.size(); ++i) {
-                        (*systems)[i] = value_to_system(sys[i]);
-                        if (!(*systems)[i]) {
-                            rc = LSM_ERR_NO_MEMORY;
-                            goto error;
-                        }
-                    }
-                } else {
-                    rc = LSM_ERR_NO_MEMORY;
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
+    int rc = add_fields_param(p, fields, SYSTEM_SCHEMA);
+    if (LSM_ERR_OK != rc) {
+        return rc;
     }
-out:
-    return rc;
 
-error:
-    if (*systems) {
-        lsm_system_record_array_free(*systems, *systemCount);
-        *systems = NULL;
-        *systemCount = 0;
-    }
-    goto out;
+    Value parameters(p);
+
+    return rpc_records(c, "systems", parameters, SYSTEM_SCHEMA, systems,
+                       systemCount);
 }
 
 int lsm_fs_list(lsm_connect *c, const char *search_key,
                 const char *search_value, lsm_fs **fs[], uint32_t *fsCount,
                 lsm_flag flags) {
-    int rc = LSM_ERR_OK;
     CONN_SETUP(c);
 
     if (!fs || !fsCount) {
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    try {
-        std::map<std::string, Value> p;
+    std::map<std::string, Value> p;
 
-        rc = add_search_params(p, search_key, search_value, FS_SEARCH_KEYS,
+    int rc = add_search_params(p, search_key, search_value, FS_SEARCH_KEYS,
                                FS_SEARCH_KEYS_COUNT);
-        if (LSM_ERR_OK != rc) {
-            return rc;
-        }
-
-        p["flags"] = Value(flags);
-        Value parameters(p);
-        Value response;
-
-        rc = rpc(c, "fs", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> sys = response.asArray();
-
-            *fsCount = sys.size();
-
-            if (sys.size()) {
-                *fs = lsm_fs_record_array_alloc(sys.size());
-
-                if (*fs) {
-                    for (size_t i = 0; i < sys.size(); ++i) {
-                        (*fs)[i] = value_to_fs(sys[i]);
-                        if (!((*fs)[i])) {
-                            rc = LSM_ERR_NO_MEMORY;
-                            goto error;
-                        }
-                    }
-                } else {
-                    rc = LSM_ERR_NO_MEMORY;
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
+    if (LSM_ERR_OK != rc) {
+        return rc;
     }
-out:
-    return rc;
 
-error:
-    if (*fs && *fsCount) {
-        lsm_fs_record_array_free(*fs, *fsCount);
-        *fs = NULL;
-        *fsCount = 0;
-    }
-    goto out;
+    p["flags"] = Value(flags);
+    Value parameters(p);
+
+    return rpc_records(c, "fs", parameters, FS_SCHEMA, fs, fsCount);
 }
 
 int lsm_fs_create(lsm_connect *c, lsm_pool *pool, const char *name,
@@ -1973,7 +1946,6 @@ int lsm_fs_child_dependency_delete(lsm_connect *c, lsm_fs *fs,
 
 int lsm_fs_ss_list(lsm_connect *c, lsm_fs *fs, lsm_fs_ss **ss[],
                    uint32_t *ssCount, lsm_flag flags) {
-    int rc = LSM_ERR_OK;
     CONN_SETUP(c);
 
     if (!LSM_IS_FS(fs)) {
@@ -1985,46 +1957,8 @@ int lsm_fs_ss_list(lsm_connect *c, lsm_fs *fs, lsm_fs_ss **ss[],
     }
 
     Value parameters = _create_fs_flag_param(fs, flags);
-    Value response;
-
-    try {
-        rc = rpc(c, "fs_snapshots", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> sys = response.asArray();
-
-            *ssCount = sys.size();
-
-            if (sys.size()) {
-                *ss = lsm_fs_ss_record_array_alloc(sys.size());
-
-                if (*ss) {
-                    for (size_t i = 0; i < sys.size(); ++i) {
-                        (*ss)[i] = value_to_ss(sys[i]);
-                        if (!((*ss)[i])) {
-                            rc = LSM_ERR_NO_MEMORY;
-                            goto error;
-                        }
-                    }
-                } else {
-                    rc = LSM_ERR_NO_MEMORY;
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
-    }
-out:
-    return rc;
-
-error:
-    if (*ss && *ssCount) {
-        lsm_fs_ss_record_array_free(*ss, *ssCount);
-        *ss = NULL;
-        *ssCount = 0;
-    }
 
-    goto out;
+    return rpc_records(c, "fs_snapshots", parameters, SS_SCHEMA, ss, ssCount);
 }
 
 int lsm_fs_ss_create(lsm_connect *c, lsm_fs *fs, const char *name,
@@ -2131,66 +2065,26 @@ int lsm_fs_ss_restore(lsm_connect *c, lsm_fs *fs, lsm_fs_ss *ss,
 int lsm_nfs_list(lsm_connect *c, const char *search_key,
                  const char *search_value, lsm_nfs_export **exports[],
                  uint32_t *count, lsm_flag flags) {
-    int rc = LSM_ERR_OK;
     CONN_SETUP(c);
 
     if (CHECK_RP(exports) || !count) {
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    *count = 0;
-    *exports = NULL;
-
-    try {
-        std::map<std::string, Value> p;
+    std::map<std::string, Value> p;
 
-        rc = add_search_params(p, search_key, search_value,
+    int rc = add_search_params(p, search_key, search_value,
                                NFS_EXPORT_SEARCH_KEYS,
                                NFS_EXPORT_SEARCH_KEYS_COUNT);
-        if (LSM_ERR_OK != rc) {
-            return rc;
-        }
-
-        p["flags"] = Value(flags);
-        Value parameters(p);
-        Value response;
-
-        rc = rpc(c, "exports", parameters, response);
-        if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-            std::vector<Value> exps = response.asArray();
-
-            *count = exps.size();
-
-            if (*count) {
-                *exports = lsm_nfs_export_record_array_alloc(*count);
-
-                if (*exports) {
-                    for (size_t i = 0; i < *count; ++i) {
-                        (*exports)[i] = value_to_nfs_export(exps[i]);
-                        if (!((*exports)[i])) {
-                            rc = LSM_ERR_NO_MEMORY;
-                            goto error;
-                        }
-                    }
-                } else {
-                    rc = LSM_ERR_NO_MEMORY;
-                }
-            }
-        }
-    } catch (const ValueException &ve) {
-        rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", ve.what());
-        goto error;
+    if (LSM_ERR_OK != rc) {
+        return rc;
     }
-out:
-    return rc;
 
-error:
-    if (*exports && *count) {
-        lsm_nfs_export_record_array_free(*exports, *count);
-        *exports = NULL;
-        *count = 0;
-    }
-    goto out;
+    p["flags"] = Value(flags);
+    Value parameters(p);
+
+    return rpc_records(c, "exports", parameters, NFS_EXPORT_SCHEMA, exports,
+                       count);
 }
 
 int lsm_nfs_export_fs(lsm_connect *c, const char *fs_id,
@@ -2479,19 +2373,6 @@ int lsm_system_read_cache_pct_update(lsm_connect *c, lsm_system *system,
     return rc;
 }
 
-static int get_battery_array(lsm_connect *c, int rc, Value &response,
-                             lsm_battery **bs[], uint32_t *count) {
-    if (LSM_ERR_OK == rc && Value::array_t == response.valueType()) {
-        try {
-            rc = value_array_to_batteries(response, bs, count);
-        } catch (const ValueException &ve) {
-            rc = log_exception(c, LSM_ERR_PLUGIN_BUG, "Unexpected type", NULL);
-        }
-    }
-
-    return rc;
-}
-
 int lsm_battery_list(lsm_connect *c, const char *search_key,
                      const char *search_value, lsm_battery **bs[],
                      uint32_t *count, lsm_flag flags) {
@@ -2511,10 +2392,8 @@ int lsm_battery_list(lsm_connect *c, const char *search_key,
     }
 
     Value parameters(p);
-    Value response;
 
-    rc = rpc(c, "batteries", parameters, response);
-    return get_battery_array(c, rc, response, bs, count);
+    return rpc_records(c, "batteries", parameters, BATTERY_SCHEMA, bs, count);
 }
 
 int lsm_volume_cache_info(lsm_connect *c, lsm_volume *volume,
@@ -2627,3 +2506,156 @@ int lsm_volume_read_cache_policy_update(lsm_connect *c, lsm_volume *volume,
     // No response data.
     return rpc(c, "volume_read_cache_policy_update", parameters, response);
 }
+
+int lsm_subscribe(lsm_connect *c, uint64_t classes, uint32_t interval,
+                  lsm_flag flags) {
+    CONN_SETUP(c);
+
+    if (LSM_FLAG_UNUSED_CHECK(flags) || !classes ||
+        (classes & ~LSM_EVENT_CLASS_ALL)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    std::vector<Value> class_names;
+    if (classes & LSM_EVENT_CLASS_SYSTEM) {
+        class_names.push_back(Value(CLASS_NAME_SYSTEM));
+    }
+    if (classes & LSM_EVENT_CLASS_POOL) {
+        class_names.push_back(Value(CLASS_NAME_POOL));
+    }
+    if (classes & LSM_EVENT_CLASS_VOLUME) {
+        class_names.push_back(Value(CLASS_NAME_VOLUME));
+    }
+    if (classes & LSM_EVENT_CLASS_DISK) {
+        class_names.push_back(Value(CLASS_NAME_DISK));
+    }
+
+    std::map<std::string, Value> p;
+    p["classes"] = Value(class_names);
+    p["interval"] = Value(interval);
+    p["flags"] = Value(flags);
+    Value parameters(p);
+    Value response;
+
+    // No response data.
+    return rpc(c, "subscribe", parameters, response);
+}
+
+int lsm_unsubscribe(lsm_connect *c, lsm_flag flags) {
+    CONN_SETUP(c);
+
+    if (LSM_FLAG_UNUSED_CHECK(flags)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    Value parameters = _create_flag_param(flags);
+    Value response;
+
+    // No response data.
+    return rpc(c, "unsubscribe", parameters, response);
+}
+
+int lsm_event_fd_get(lsm_connect *c) {
+    if (!LSM_IS_CONNECT(c) || !c->tp) {
+        return -1;
+    }
+    return c->tp->fd();
+}
+
+int lsm_event_next(lsm_connect *c, lsm_event **event, int timeout_ms,
+                   lsm_flag flags) {
+    CONN_SETUP(c);
+
+    if (CHECK_RP(event) || timeout_ms < -1 || LSM_FLAG_UNUSED_CHECK(flags)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    try {
+        Value e;
+
+        if (c->tp->eventRead(e, timeout_ms)) {
+            *event = value_to_event(e);
+            if (!*event) {
+                return log_exception(c, LSM_ERR_PLUGIN_BUG, "Invalid event",
+                                     NULL);
+            }
+        }
+    } catch (const ValueException &ve) {
+        return log_exception(c, LSM_ERR_TRANSPORT_SERIALIZATION,
+                             "Serialization error", ve.what());
+    } catch (const LsmException &le) {
+        return log_exception(c, (lsm_error_number)le.error_code, le.what(),
+                             NULL);
+    } catch (const EOFException &eof) {
+        return log_exception(c, LSM_ERR_TRANSPORT_COMMUNICATION, "Plug-in died",
+                             "Check syslog");
+    } catch (...) {
+        return log_exception(c, LSM_ERR_LIB_BUG, "Unexpected exception",
+                             "Unknown exception");
+    }
+    return LSM_ERR_OK;
+}
+
+/**
+ * Method, schema and search keys of each list lsm_list_stream() takes.
+ */
+static const struct LSM_DLL_LOCAL stream_list {
+    uint64_t list;            /**< LSM_MULTI_LIST_XXX */
+    const char *method;       /**< Method listing the records */
+    const lsm_schema *schema; /**< Schema of the records */
+    const char *const *keys;  /**< Search keys, NULL for none */
+    size_t key_count;         /**< Number of search keys */
+} STREAM_LISTS[] = {
+    {LSM_MULTI_LIST_SYSTEMS, "systems", &SYSTEM_SCHEMA, NULL, 0},
+    {LSM_MULTI_LIST_POOLS, "pools", &POOL_SCHEMA, POOL_SEARCH_KEYS,
+     POOL_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_VOLUMES, "volumes", &VOLUME_SCHEMA, VOLUME_SEARCH_KEYS,
+     VOLUME_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_DISKS, "disks", &DISK_SCHEMA, DISK_SEARCH_KEYS,
+     DISK_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_ACCESS_GROUPS, "access_groups", &ACCESS_GROUP_SCHEMA,
+     ACCESS_GROUP_SEARCH_KEYS, ACCESS_GROUP_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_FS, "fs", &FS_SCHEMA, FS_SEARCH_KEYS,
+     FS_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_NFS_EXPORTS, "exports", &NFS_EXPORT_SCHEMA,
+     NFS_EXPORT_SEARCH_KEYS, NFS_EXPORT_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_TARGET_PORTS, "target_ports", &TARGET_PORT_SCHEMA,
+     TARGET_PORT_SEARCH_KEYS, TARGET_PORT_SEARCH_KEYS_COUNT},
+    {LSM_MULTI_LIST_BATTERIES, "batteries", &BATTERY_SCHEMA, DISK_SEARCH_KEYS,
+     DISK_SEARCH_KEYS_COUNT}};
+
+int lsm_list_stream(lsm_connect *c, uint64_t list, const char *search_key,
+                    const char *search_value, lsm_list_stream_cb cb,
+                    void *user_data, lsm_flag flags) {
+    const stream_list *l = NULL;
+
+    CONN_SETUP(c);
+
+    if (!cb || LSM_FLAG_UNUSED_CHECK(flags)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < COUNT_OF(STREAM_LISTS); ++i) {
+        if (STREAM_LISTS[i].list == list) {
+            l = &STREAM_LISTS[i];
+        }
+    }
+    if (!l || (search_key && !l->keys)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    std::map<std::string, Value> p;
+    p["flags"] = Value(flags);
+
+    if (l->keys) {
+        int rc = add_search_params(p, search_key, search_value, l->keys,
+                                   l->key_count);
+        if (LSM_ERR_OK != rc) {
+            return rc;
+        }
+    }
+
+    Value parameters(p);
+    RecordSink sink(*l->schema, cb, user_data);
+
+    return rpc_stream(c, l->method, parameters, sink);
+}
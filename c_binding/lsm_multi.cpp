@@ -0,0 +1,495 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "libstoragemgmt/libstoragemgmt.h"
+#include "lsm_datatypes.hpp"
+#include "lsm_ipc.hpp"
+#include "lsm_schema.hpp"
+#include <algorithm>
+#include <deque>
+#include <errno.h>
+#include <new>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <vector>
+
+/**
+ * Lists in the order they are retrieved from each array.
+ */
+static const uint64_t MULTI_LISTS[] = {
+    LSM_MULTI_LIST_SYSTEMS,       LSM_MULTI_LIST_POOLS,
+    LSM_MULTI_LIST_VOLUMES,       LSM_MULTI_LIST_DISKS,
+    LSM_MULTI_LIST_ACCESS_GROUPS, LSM_MULTI_LIST_FS,
+    LSM_MULTI_LIST_NFS_EXPORTS,   LSM_MULTI_LIST_TARGET_PORTS,
+    LSM_MULTI_LIST_BATTERIES};
+
+#define MULTI_LIST_COUNT (sizeof(MULTI_LISTS) / sizeof(MULTI_LISTS[0]))
+
+#define TIMEOUT_MSG "Timed out waiting for the plug-in"
+
+/**
+ * Storage array to list.
+ */
+struct LSM_DLL_LOCAL multi_array {
+    std::string uri;      /**< URI */
+    std::string password; /**< Password, when has_password */
+    bool has_password;    /**< Password was given */
+};
+
+struct LSM_DLL_LOCAL _lsm_multi_result {
+    uint32_t magic;   /**< Magic, used for structure validation */
+    char *uri;        /**< URI of the array */
+    uint64_t list;    /**< LSM_MULTI_LIST_XXX */
+    int rc;           /**< Error code */
+    char *message;    /**< Error message, NULL for none */
+    void **records;   /**< Records of the list */
+    uint32_t count;   /**< Number of records */
+};
+
+/**
+ * Worker threads connecting to the arrays one after the other, queueing a
+ * result for each list of each array.
+ */
+struct LSM_DLL_LOCAL _lsm_multi {
+    uint32_t magic;                         /**< Magic for validation */
+    uint32_t workers;                       /**< Most threads to start */
+    uint32_t timeout_ms;                    /**< Time for each array */
+    uint64_t lists;                         /**< LSM_MULTI_LIST_XXX to get */
+    std::vector<multi_array> arrays;        /**< Fixed once running */
+    std::vector<pthread_t> threads;         /**< Workers */
+    bool running;                           /**< lsm_multi_run() was called */
+    pthread_mutex_t lock;                   /**< Guards all below */
+    pthread_cond_t cond;                    /**< Signaled on new results */
+    bool stop;                              /**< Workers have to quit */
+    size_t next_array;                      /**< Array to list next */
+    uint32_t pending;                       /**< Results still to return */
+    std::deque<lsm_multi_result *> results; /**< Results not returned yet */
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static const lsm_schema &list_schema(uint64_t list) {
+    switch (list) {
+    case (LSM_MULTI_LIST_SYSTEMS):
+        return SYSTEM_SCHEMA;
+    case (LSM_MULTI_LIST_POOLS):
+        return POOL_SCHEMA;
+    case (LSM_MULTI_LIST_VOLUMES):
+        return VOLUME_SCHEMA;
+    case (LSM_MULTI_LIST_DISKS):
+        return DISK_SCHEMA;
+    case (LSM_MULTI_LIST_ACCESS_GROUPS):
+        return ACCESS_GROUP_SCHEMA;
+    case (LSM_MULTI_LIST_FS):
+        return FS_SCHEMA;
+    case (LSM_MULTI_LIST_NFS_EXPORTS):
+        return NFS_EXPORT_SCHEMA;
+    case (LSM_MULTI_LIST_TARGET_PORTS):
+        return TARGET_PORT_SCHEMA;
+    default:
+        return BATTERY_SCHEMA;
+    }
+}
+
+static int list_call(lsm_connect *c, uint64_t list, void ***records,
+                     uint32_t *count) {
+    lsm_flag f = LSM_CLIENT_FLAG_RSVD;
+
+    switch (list) {
+    case (LSM_MULTI_LIST_SYSTEMS):
+        return lsm_system_list(c, (lsm_system ***)records, count, f);
+    case (LSM_MULTI_LIST_POOLS):
+        return lsm_pool_list(c, NULL, NULL, (lsm_pool ***)records, count, f);
+    case (LSM_MULTI_LIST_VOLUMES):
+        return lsm_volume_list(c, NULL, NULL, (lsm_volume ***)records, count,
+                               f);
+    case (LSM_MULTI_LIST_DISKS):
+        return lsm_disk_list(c, NULL, NULL, (lsm_disk ***)records, count, f);
+    case (LSM_MULTI_LIST_ACCESS_GROUPS):
+        return lsm_access_group_list(c, NULL, NULL,
+                                     (lsm_access_group ***)records, count, f);
+    case (LSM_MULTI_LIST_FS):
+        return lsm_fs_list(c, NULL, NULL, (lsm_fs ***)records, count, f);
+    case (LSM_MULTI_LIST_NFS_EXPORTS):
+        return lsm_nfs_list(c, NULL, NULL, (lsm_nfs_export ***)records, count,
+                            f);
+    case (LSM_MULTI_LIST_TARGET_PORTS):
+        return lsm_target_port_list(c, NULL, NULL,
+                                    (lsm_target_port ***)records, count, f);
+    default:
+        return lsm_battery_list(c, NULL, NULL, (lsm_battery ***)records, count,
+                                f);
+    }
+}
+
+static void records_free(uint64_t list, void **records, uint32_t count) {
+    if (records) {
+        const lsm_schema &s = list_schema(list);
+        for (uint32_t i = 0; i < count; ++i) {
+            s.record_free(records[i]);
+        }
+        free(records);
+    }
+}
+
+/**
+ * Takes the message of an error, freeing the error.
+ */
+static std::string error_take(lsm_error_ptr e) {
+    std::string msg;
+
+    if (e) {
+        const char *m = lsm_error_message_get(e);
+        if (m) {
+            msg = m;
+        }
+        lsm_error_free(e);
+    }
+    return msg;
+}
+
+static void result_push(lsm_multi *m, const std::string &uri, uint64_t list,
+                        int rc, const std::string &message, void **records,
+                        uint32_t count) {
+    lsm_multi_result *r = (lsm_multi_result *)calloc(1, sizeof(*r));
+
+    if (r) {
+        r->magic = LSM_MULTI_RESULT_MAGIC;
+        r->uri = strdup(uri.c_str());
+        r->list = list;
+        r->rc = rc;
+        r->records = records;
+        r->count = count;
+        if (rc != LSM_ERR_OK && message.size()) {
+            r->message = strdup(message.c_str());
+        }
+    }
+
+    if (!r || !r->uri) {
+        if (r) {
+            free(r->message);
+            free(r);
+        }
+        records_free(list, records, count);
+
+        /* Nobody is going to get this one */
+        pthread_mutex_lock(&m->lock);
+        m->pending--;
+        pthread_cond_broadcast(&m->cond);
+        pthread_mutex_unlock(&m->lock);
+        return;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    m->results.push_back(r);
+    pthread_cond_broadcast(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
+
+/**
+ * Retrieves the lists of one array.  Errors of a list only fail that list,
+ * running out of time or losing the plug-in fails the ones after it too.
+ */
+static void array_list(lsm_multi *m, const multi_array &a) {
+    uint64_t deadline = now_ms() + m->timeout_ms;
+    lsm_connect *c = NULL;
+    lsm_error_ptr e = NULL;
+    std::string msg;
+
+    int rc = connection_open(a.uri.c_str(),
+                             a.has_password ? a.password.c_str() : NULL, &c,
+                             m->timeout_ms, m->timeout_ms, &e,
+                             LSM_CLIENT_FLAG_RSVD);
+    if (rc != LSM_ERR_OK) {
+        msg = error_take(e);
+        c = NULL;
+        if (now_ms() >= deadline) {
+            rc = LSM_ERR_TIMEOUT;
+            msg = TIMEOUT_MSG;
+        }
+    }
+
+    for (size_t i = 0; i < MULTI_LIST_COUNT; ++i) {
+        uint64_t list = MULTI_LISTS[i];
+        void **records = NULL;
+        uint32_t count = 0;
+        int list_rc = rc;
+        std::string list_msg = msg;
+
+        if (!(m->lists & list)) {
+            continue;
+        }
+
+        if (rc == LSM_ERR_OK) {
+            uint64_t now = now_ms();
+            if (now >= deadline) {
+                list_rc = LSM_ERR_TIMEOUT;
+            } else {
+                c->tp->waitLimitSet(deadline - now);
+                list_rc = list_call(c, list, &records, &count);
+                if (list_rc != LSM_ERR_OK) {
+                    list_msg = error_take(lsm_error_last_get(c));
+                }
+                if (list_rc == LSM_ERR_TRANSPORT_COMMUNICATION &&
+                    now_ms() >= deadline) {
+                    list_rc = LSM_ERR_TIMEOUT;
+                }
+            }
+
+            if (list_rc == LSM_ERR_TIMEOUT) {
+                list_msg = TIMEOUT_MSG;
+            }
+            if (list_rc == LSM_ERR_TIMEOUT ||
+                list_rc == LSM_ERR_TRANSPORT_COMMUNICATION ||
+                list_rc == LSM_ERR_TRANSPORT_SERIALIZATION) {
+                /* Replies still on the way would answer later lists */
+                rc = list_rc;
+                msg = list_msg;
+            }
+        }
+
+        result_push(m, a.uri, list, list_rc, list_msg, records, count);
+    }
+
+    if (c) {
+        uint64_t now = now_ms();
+        if (rc != LSM_ERR_OK || now >= deadline) {
+            shutdown(c->tp->fd(), SHUT_RDWR);
+        } else {
+            c->tp->waitLimitSet(deadline - now);
+        }
+        lsm_connect_close(c, LSM_CLIENT_FLAG_RSVD);
+    }
+}
+
+static void *multi_worker(void *arg) {
+    lsm_multi *m = (lsm_multi *)arg;
+
+    pthread_mutex_lock(&m->lock);
+    while (!m->stop && m->next_array < m->arrays.size()) {
+        const multi_array &a = m->arrays[m->next_array++];
+        pthread_mutex_unlock(&m->lock);
+
+        array_list(m, a);
+
+        pthread_mutex_lock(&m->lock);
+    }
+    pthread_mutex_unlock(&m->lock);
+    return NULL;
+}
+
+lsm_multi *lsm_multi_alloc(uint32_t workers, uint32_t timeout_ms) {
+    if (!workers || !timeout_ms) {
+        return NULL;
+    }
+
+    lsm_multi *m = new (std::nothrow) _lsm_multi();
+    if (m) {
+        pthread_condattr_t attr;
+
+        m->magic = LSM_MULTI_MAGIC;
+        m->workers = workers;
+        m->timeout_ms = timeout_ms;
+        m->lists = 0;
+        m->running = false;
+        m->stop = false;
+        m->next_array = 0;
+        m->pending = 0;
+
+        pthread_mutex_init(&m->lock, NULL);
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&m->cond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+    return m;
+}
+
+int lsm_multi_array_add(lsm_multi *m, const char *uri, const char *password) {
+    if (!LSM_IS_MULTI(m) || !uri || !strlen(uri) || m->running) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    try {
+        multi_array a;
+        a.uri = uri;
+        a.has_password = (password != NULL);
+        if (password) {
+            a.password = password;
+        }
+        m->arrays.push_back(a);
+    } catch (const std::bad_alloc &) {
+        return LSM_ERR_NO_MEMORY;
+    }
+    return LSM_ERR_OK;
+}
+
+int lsm_multi_run(lsm_multi *m, uint64_t lists, lsm_flag flags) {
+    if (!LSM_IS_MULTI(m) || m->running || !lists ||
+        (lists & ~LSM_MULTI_LIST_ALL) || LSM_FLAG_UNUSED_CHECK(flags)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    uint32_t per_array = 0;
+    for (size_t i = 0; i < MULTI_LIST_COUNT; ++i) {
+        if (lists & MULTI_LISTS[i]) {
+            ++per_array;
+        }
+    }
+
+    m->lists = lists;
+    m->pending = per_array * m->arrays.size();
+    m->running = true;
+
+    size_t count = std::min((size_t)m->workers, m->arrays.size());
+    for (size_t i = 0; i < count; ++i) {
+        pthread_t t;
+        if (0 == pthread_create(&t, NULL, multi_worker, m)) {
+            m->threads.push_back(t);
+        }
+    }
+
+    if (count && m->threads.empty()) {
+        m->pending = 0;
+        return LSM_ERR_NO_MEMORY;
+    }
+    return LSM_ERR_OK;
+}
+
+uint32_t lsm_multi_pending_get(lsm_multi *m) {
+    uint32_t rc = 0;
+
+    if (LSM_IS_MULTI(m)) {
+        pthread_mutex_lock(&m->lock);
+        rc = m->pending;
+        pthread_mutex_unlock(&m->lock);
+    }
+    return rc;
+}
+
+int lsm_multi_next(lsm_multi *m, lsm_multi_result **result, int timeout_ms) {
+    if (!LSM_IS_MULTI(m) || !result || *result || timeout_ms < -1) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    struct timespec until;
+    clock_gettime(CLOCK_MONOTONIC, &until);
+    if (timeout_ms > 0) {
+        until.tv_sec += timeout_ms / 1000;
+        until.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec += 1;
+            until.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&m->lock);
+    while (m->results.empty() && m->pending && timeout_ms) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&m->cond, &m->lock);
+        } else if (pthread_cond_timedwait(&m->cond, &m->lock, &until) ==
+                   ETIMEDOUT) {
+            break;
+        }
+    }
+
+    if (!m->results.empty()) {
+        *result = m->results.front();
+        m->results.pop_front();
+        m->pending--;
+    }
+    pthread_mutex_unlock(&m->lock);
+    return LSM_ERR_OK;
+}
+
+int lsm_multi_free(lsm_multi *m) {
+    if (!LSM_IS_MULTI(m)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    m->stop = true;
+    pthread_mutex_unlock(&m->lock);
+
+    for (size_t i = 0; i < m->threads.size(); ++i) {
+        pthread_join(m->threads[i], NULL);
+    }
+
+    while (!m->results.empty()) {
+        lsm_multi_result_free(m->results.front());
+        m->results.pop_front();
+    }
+
+    pthread_cond_destroy(&m->cond);
+    pthread_mutex_destroy(&m->lock);
+    m->magic = LSM_DEL_MAGIC(LSM_MULTI_MAGIC);
+    delete m;
+    return LSM_ERR_OK;
+}
+
+const char *lsm_multi_result_uri_get(lsm_multi_result *r) {
+    if (LSM_IS_MULTI_RESULT(r)) {
+        return r->uri;
+    }
+    return NULL;
+}
+
+uint64_t lsm_multi_result_list_get(lsm_multi_result *r) {
+    if (LSM_IS_MULTI_RESULT(r)) {
+        return r->list;
+    }
+    return 0;
+}
+
+int lsm_multi_result_error_get(lsm_multi_result *r, const char **message) {
+    if (!LSM_IS_MULTI_RESULT(r)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    if (message) {
+        *message = r->message;
+    }
+    return r->rc;
+}
+
+int lsm_multi_result_records_get(lsm_multi_result *r, void ***records,
+                                 uint32_t *count) {
+    if (!LSM_IS_MULTI_RESULT(r) || !records || !count) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    *records = r->records;
+    *count = r->count;
+    return LSM_ERR_OK;
+}
+
+int lsm_multi_result_free(lsm_multi_result *r) {
+    if (!LSM_IS_MULTI_RESULT(r)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    r->magic = LSM_DEL_MAGIC(LSM_MULTI_RESULT_MAGIC);
+    records_free(r->list, r->records, r->count);
+    free(r->uri);
+    free(r->message);
+    free(r);
+    return LSM_ERR_OK;
+}
@@ -32,18 +32,30 @@
 #include "lsm_convert.hpp"
 #include "lsm_datatypes.hpp"
 #include "lsm_ipc.hpp"
+#include "lsm_schema.hpp"
 #include "util/qparams.h"
+#include <deque>
+#include <dlfcn.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <libxml/uri.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <syslog.h>
+#include <time.h>
+#include <unistd.h>
 
 #define UNUSED(x) (void)(x)
 
 // Forward decl.
 static int lsm_plugin_run(lsm_plugin_ptr plug);
+static int process_request(lsm_plugin_ptr p, const std::string &method,
+                           Value &request, Value &response);
 static void get_batteries(int rc, lsm_battery *bs[], uint32_t count,
-                          Value &response);
+                          Value &response, Payload::encoding e);
 static int handle_batteries(lsm_plugin_ptr p, Value &params, Value &response);
 static int handle_volume_cache_info(lsm_plugin_ptr p, Value &params,
                                     Value &response);
@@ -54,6 +66,120 @@ static int handle_volume_wcp_update(lsm_plugin_ptr p, Value &params,
 static int handle_volume_rcp_update(lsm_plugin_ptr p, Value &params,
                                     Value &response);
 
+/**
+ * Changes of storage objects a client subscribed to.  Unless the plug-in
+ * reports changes through lsm_plug_changes_register(), every interval all
+ * objects of the subscribed classes are listed and compared to the previous
+ * listing.  Otherwise only the objects the plug-in reported are looked up.
+ */
+struct LSM_DLL_LOCAL _lsm_subscription {
+    /** Serialized and parsed object, by object ID */
+    typedef std::map<std::string, std::pair<std::string, Value> > snapshot;
+
+    uint64_t classes;  /**< LSM_EVENT_CLASS_XXX subscribed to */
+    uint32_t interval; /**< Seconds between checks */
+    time_t next;       /**< Monotonic time of next check */
+    bool native;       /**< Plug-in reports what changed */
+    std::map<uint64_t, snapshot> objects;             /**< Last known state */
+    std::map<uint64_t, std::set<std::string> > dirty; /**< IDs to look up */
+    std::set<uint64_t> dirty_classes; /**< Classes to compare completely */
+};
+
+/** Worker threads running the jobs of a plug-in */
+#define LSM_PLUG_JOB_WORKERS 4
+
+/**
+ * Job queued with lsm_plug_job_submit().  Everything but work, data and
+ * data_free is guarded by the lock of the executor.
+ */
+struct LSM_DLL_LOCAL _lsm_plug_job {
+    uint32_t magic;               /**< Magic, used for struct validation */
+    struct _lsm_job_executor *ex; /**< Executor running the job */
+    lsm_plug_job_work work;       /**< Work of the plug-in */
+    void *data;                   /**< Data of the work */
+    lsm_plug_job_data_free data_free; /**< Releases data */
+    lsm_job_status status;            /**< State of the job */
+    uint8_t percent;                  /**< Percent complete */
+    int rc;                           /**< Error code on LSM_JOB_ERROR */
+    std::string err_msg;              /**< Error message on LSM_JOB_ERROR */
+    lsm_data_type type;               /**< Type of value */
+    void *value;                      /**< Result on LSM_JOB_COMPLETE */
+    bool freed; /**< Client freed the job before the work returned */
+};
+
+/**
+ * Worker threads running the jobs of a plug-in, keeping the state of the
+ * jobs so that job_status and job_free get answered without the plug-in.
+ */
+struct LSM_DLL_LOCAL _lsm_job_executor {
+    pthread_mutex_t lock;                       /**< Guards all below */
+    pthread_cond_t cond;                        /**< Signaled on changes */
+    bool stop;                                  /**< Workers have to quit */
+    uint64_t next_id;                           /**< Number of next job */
+    std::deque<lsm_plug_job *> queue;           /**< Jobs not started */
+    std::map<std::string, lsm_plug_job *> jobs; /**< Jobs by ID */
+    std::vector<pthread_t> threads;             /**< Workers */
+};
+
+/**
+ * Request answered by a request worker, holding the reply until the replies
+ * of the requests before it are sent.
+ */
+struct LSM_DLL_LOCAL _lsm_plug_request {
+    uint64_t seq;       /**< Position in the order requests came in */
+    std::string method; /**< Method of the request */
+    Value request;      /**< The request */
+    int rc;             /**< Return code of the handler */
+    Value response;     /**< Result, when rc tells success */
+    lsm_error *error;   /**< Error the plug-in logged, or NULL */
+    Value *reply;       /**< Reply slot in a batch, NULL to send the reply */
+};
+
+/**
+ * Request worker, with its own copy of the state of the request being
+ * answered, which the plug-in keeps for requests answered on the loop.
+ */
+struct LSM_DLL_LOCAL _lsm_plug_worker {
+    struct _lsm_request_pool *pool;      /**< Pool of the worker */
+    pthread_t thread;                    /**< Thread of the worker */
+    void *data;                          /**< From lsm_plug_worker_init */
+    lsm_error *error;                    /**< Error logged by the request */
+    const std::set<std::string> *fields; /**< Like _lsm_plugin.fields */
+};
+
+/**
+ * Worker threads answering the requests which change nothing, see
+ * lsm_plug_concurrency_register().  Replies are sent holding the lock.
+ */
+struct LSM_DLL_LOCAL _lsm_request_pool {
+    lsm_plugin_ptr plug;                          /**< Plug-in of the pool */
+    pthread_mutex_t lock;                         /**< Guards all below */
+    pthread_cond_t cond;                          /**< Signaled on requests */
+    pthread_cond_t idle;                          /**< Signaled on replies */
+    bool stop;                                    /**< Workers have to quit */
+    bool broken;                                  /**< Sending a reply failed */
+    uint64_t next_seq;                            /**< Number of next request */
+    uint64_t next_reply;                          /**< Number of next reply */
+    std::deque<_lsm_plug_request *> queue;        /**< Not started */
+    std::map<uint64_t, _lsm_plug_request *> done; /**< Replies held */
+    std::vector<_lsm_plug_worker *> workers;      /**< Workers */
+};
+
+/** Request worker of the calling thread, NULL for any other thread */
+static __thread _lsm_plug_worker *current_worker = NULL;
+
+/**
+ * Request worker of the calling thread, when it works for the plug-in.
+ * @param p     Plug-in
+ * @return Worker, NULL on the request loop and any other thread
+ */
+static _lsm_plug_worker *worker_get(lsm_plugin_ptr p) {
+    if (current_worker && current_worker->pool->plug == p) {
+        return current_worker;
+    }
+    return NULL;
+}
+
 /**
  * Safe string wrapper
  * @param s Character array to convert to std::string
@@ -108,6 +234,45 @@ void *lsm_data_type_copy(lsm_data_type t, void *item) {
     return rc;
 }
 
+static void data_type_free(lsm_data_type t, void *item) {
+    if (item) {
+        switch (t) {
+        case (LSM_DATA_TYPE_ACCESS_GROUP):
+            lsm_access_group_record_free((lsm_access_group *)item);
+            break;
+        case (LSM_DATA_TYPE_BLOCK_RANGE):
+            lsm_block_range_record_free((lsm_block_range *)item);
+            break;
+        case (LSM_DATA_TYPE_FS):
+            lsm_fs_record_free((lsm_fs *)item);
+            break;
+        case (LSM_DATA_TYPE_NFS_EXPORT):
+            lsm_nfs_export_record_free((lsm_nfs_export *)item);
+            break;
+        case (LSM_DATA_TYPE_POOL):
+            lsm_pool_record_free((lsm_pool *)item);
+            break;
+        case (LSM_DATA_TYPE_SS):
+            lsm_fs_ss_record_free((lsm_fs_ss *)item);
+            break;
+        case (LSM_DATA_TYPE_STRING_LIST):
+            lsm_string_list_free((lsm_string_list *)item);
+            break;
+        case (LSM_DATA_TYPE_SYSTEM):
+            lsm_system_record_free((lsm_system *)item);
+            break;
+        case (LSM_DATA_TYPE_VOLUME):
+            lsm_volume_record_free((lsm_volume *)item);
+            break;
+        case (LSM_DATA_TYPE_DISK):
+            lsm_disk_record_free((lsm_disk *)item);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static Value job_handle(const Value &val, char *job) {
     std::vector<Value> r;
     r.push_back(Value(job));
@@ -174,12 +339,629 @@ void *lsm_private_data_get(lsm_plugin_ptr plug) {
     return plug->private_data;
 }
 
+static void job_record_free(lsm_plug_job *j) {
+    data_type_free(j->type, j->value);
+    j->magic = LSM_DEL_MAGIC(LSM_PLUG_JOB_MAGIC);
+    delete j;
+}
+
+static void *job_worker(void *arg) {
+    struct _lsm_job_executor *ex = (struct _lsm_job_executor *)arg;
+
+    pthread_mutex_lock(&ex->lock);
+    while (true) {
+        while (!ex->stop && ex->queue.empty()) {
+            pthread_cond_wait(&ex->cond, &ex->lock);
+        }
+        if (ex->stop) {
+            break;
+        }
+
+        lsm_plug_job *j = ex->queue.front();
+        bool cancelled = j->freed;
+        ex->queue.pop_front();
+        pthread_mutex_unlock(&ex->lock);
+
+        lsm_data_type t = LSM_DATA_TYPE_NONE;
+        void *value = NULL;
+        int rc = LSM_ERR_OK;
+
+        if (!cancelled) {
+            rc = j->work(j, j->data, &t, &value);
+        }
+        if (j->data_free) {
+            j->data_free(j->data);
+        }
+        j->data = NULL;
+
+        pthread_mutex_lock(&ex->lock);
+        if (j->freed) {
+            data_type_free(t, value);
+            job_record_free(j);
+        } else if (LSM_ERR_OK != rc) {
+            data_type_free(t, value);
+            j->status = LSM_JOB_ERROR;
+            j->rc = rc;
+            if (j->err_msg.empty()) {
+                j->err_msg = "Plugin didn't provide error message";
+            }
+        } else if (value && LSM_DATA_TYPE_VOLUME != t &&
+                   LSM_DATA_TYPE_POOL != t && LSM_DATA_TYPE_FS != t &&
+                   LSM_DATA_TYPE_SS != t) {
+            data_type_free(t, value);
+            j->status = LSM_JOB_ERROR;
+            j->rc = LSM_ERR_PLUGIN_BUG;
+            j->err_msg = "Job returned unsupported data type";
+        } else {
+            j->status = LSM_JOB_COMPLETE;
+            j->percent = 100;
+            j->type = t;
+            j->value = value;
+        }
+    }
+    pthread_mutex_unlock(&ex->lock);
+    return NULL;
+}
+
+static int job_executor_start(lsm_plugin_ptr p) {
+    struct _lsm_job_executor *ex = new _lsm_job_executor();
+
+    ex->stop = false;
+    ex->next_id = 1;
+    pthread_mutex_init(&ex->lock, NULL);
+    pthread_cond_init(&ex->cond, NULL);
+
+    for (int i = 0; i < LSM_PLUG_JOB_WORKERS; ++i) {
+        pthread_t t;
+        if (0 == pthread_create(&t, NULL, job_worker, ex)) {
+            ex->threads.push_back(t);
+        }
+    }
+
+    if (ex->threads.empty()) {
+        pthread_cond_destroy(&ex->cond);
+        pthread_mutex_destroy(&ex->lock);
+        delete ex;
+        return LSM_ERR_NO_MEMORY;
+    }
+
+    p->jobs = ex;
+    return LSM_ERR_OK;
+}
+
+/**
+ * Drops the jobs not started and waits for the running ones, which can use
+ * the private data of the plug-in until they return.
+ */
+static void job_executor_stop(lsm_plugin_ptr p) {
+    struct _lsm_job_executor *ex = p->jobs;
+
+    if (!ex) {
+        return;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    ex->stop = true;
+    pthread_cond_broadcast(&ex->cond);
+    pthread_mutex_unlock(&ex->lock);
+
+    for (size_t i = 0; i < ex->threads.size(); ++i) {
+        pthread_join(ex->threads[i], NULL);
+    }
+
+    for (std::deque<lsm_plug_job *>::iterator i = ex->queue.begin();
+         i != ex->queue.end(); ++i) {
+        if ((*i)->data_free) {
+            (*i)->data_free((*i)->data);
+        }
+        if ((*i)->freed) {
+            job_record_free(*i);
+        }
+    }
+    for (std::map<std::string, lsm_plug_job *>::iterator i = ex->jobs.begin();
+         i != ex->jobs.end(); ++i) {
+        job_record_free(i->second);
+    }
+
+    pthread_cond_destroy(&ex->cond);
+    pthread_mutex_destroy(&ex->lock);
+    delete ex;
+    p->jobs = NULL;
+}
+
+/**
+ * Answers job_status for a job of the runtime.
+ * @return LSM_ERR_NOT_FOUND_JOB when the runtime does not know the job.
+ */
+static int job_executor_status(lsm_plugin_ptr p, const std::string &job_id,
+                               lsm_job_status *status, uint8_t *percent,
+                               lsm_data_type *t, void **value) {
+    int rc = LSM_ERR_NOT_FOUND_JOB;
+    struct _lsm_job_executor *ex = p->jobs;
+    std::string err_msg;
+
+    *value = NULL;
+    if (!ex) {
+        return rc;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    std::map<std::string, lsm_plug_job *>::iterator i = ex->jobs.find(job_id);
+    if (i != ex->jobs.end()) {
+        lsm_plug_job *j = i->second;
+
+        if (LSM_JOB_ERROR == j->status) {
+            rc = j->rc;
+            err_msg = j->err_msg;
+        } else {
+            rc = LSM_ERR_OK;
+            *status = j->status;
+            *percent = j->percent;
+            *t = j->type;
+            if (j->value) {
+                *value = lsm_data_type_copy(j->type, j->value);
+                if (!*value) {
+                    rc = LSM_ERR_NO_MEMORY;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&ex->lock);
+
+    if (LSM_ERR_OK != rc && LSM_ERR_NOT_FOUND_JOB != rc) {
+        lsm_log_error_basic(p, (lsm_error_number)rc, err_msg.c_str());
+    }
+    return rc;
+}
+
+/**
+ * Answers job_free for a job of the runtime.
+ * @return LSM_ERR_NOT_FOUND_JOB when the runtime does not know the job.
+ */
+static int job_executor_free(lsm_plugin_ptr p, const std::string &job_id) {
+    int rc = LSM_ERR_NOT_FOUND_JOB;
+    struct _lsm_job_executor *ex = p->jobs;
+
+    if (!ex) {
+        return rc;
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    std::map<std::string, lsm_plug_job *>::iterator i = ex->jobs.find(job_id);
+    if (i != ex->jobs.end()) {
+        lsm_plug_job *j = i->second;
+
+        ex->jobs.erase(i);
+        if (LSM_JOB_INPROGRESS == j->status) {
+            /* Queued or running, the worker frees it */
+            j->freed = true;
+        } else {
+            job_record_free(j);
+        }
+        rc = LSM_ERR_OK;
+    }
+    pthread_mutex_unlock(&ex->lock);
+    return rc;
+}
+
+int lsm_plug_job_submit(lsm_plugin_ptr plug, lsm_plug_job_work work,
+                        void *data, lsm_plug_job_data_free data_free,
+                        char **job) {
+    int rc = LSM_ERR_INVALID_ARGUMENT;
+    char id[64];
+
+    if (job) {
+        *job = NULL;
+    }
+
+    if (LSM_IS_PLUGIN(plug) && work && job) {
+        rc = LSM_ERR_OK;
+        if (!plug->jobs) {
+            rc = job_executor_start(plug);
+        }
+    }
+
+    if (LSM_ERR_OK == rc) {
+        struct _lsm_job_executor *ex = plug->jobs;
+        lsm_plug_job *j = new lsm_plug_job();
+
+        j->magic = LSM_PLUG_JOB_MAGIC;
+        j->ex = ex;
+        j->work = work;
+        j->data = data;
+        j->data_free = data_free;
+        j->status = LSM_JOB_INPROGRESS;
+        j->percent = 0;
+        j->rc = LSM_ERR_OK;
+        j->type = LSM_DATA_TYPE_NONE;
+        j->value = NULL;
+        j->freed = false;
+
+        pthread_mutex_lock(&ex->lock);
+        snprintf(id, sizeof(id), "PLUG_JOB_%" PRIu64, ex->next_id++);
+        *job = strdup(id);
+        if (*job) {
+            ex->jobs[id] = j;
+            ex->queue.push_back(j);
+            pthread_cond_signal(&ex->cond);
+            rc = LSM_ERR_JOB_STARTED;
+        } else {
+            job_record_free(j);
+            rc = LSM_ERR_NO_MEMORY;
+        }
+        pthread_mutex_unlock(&ex->lock);
+    }
+
+    if (LSM_ERR_JOB_STARTED != rc && data_free) {
+        data_free(data);
+    }
+    return rc;
+}
+
+int lsm_plug_job_progress_set(lsm_plug_job *job, uint8_t percent) {
+    if (!LSM_IS_PLUG_JOB(job)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    pthread_mutex_lock(&job->ex->lock);
+    job->percent = percent > 99 ? 99 : percent;
+    pthread_mutex_unlock(&job->ex->lock);
+    return LSM_ERR_OK;
+}
+
+int lsm_plug_job_error_set(lsm_plug_job *job, lsm_error_number code,
+                           const char *msg) {
+    if (LSM_IS_PLUG_JOB(job)) {
+        pthread_mutex_lock(&job->ex->lock);
+        job->err_msg = ss((char *)msg);
+        pthread_mutex_unlock(&job->ex->lock);
+    }
+    return (int)code;
+}
+
+/** Requests answered by request workers, the ones changing nothing */
+static const char *const concurrent_methods[] = {
+    "access_groups",
+    "access_groups_granted_to_volume",
+    "batteries",
+    "capabilities",
+    "disks",
+    "export_auth",
+    "exports",
+    "fs",
+    "fs_child_dependency",
+    "fs_snapshots",
+    "job_status",
+    "plugin_info",
+    "pool_member_info",
+    "pools",
+    "systems",
+    "target_ports",
+    "time_out_get",
+    "volume_cache_info",
+    "volume_child_dependency",
+    "volume_raid_create_cap_get",
+    "volume_raid_info",
+    "volume_replicate_range_block_size",
+    "volumes",
+    "volumes_accessible_by_access_group"};
+
+static bool method_concurrent(const std::string &method) {
+    for (size_t i = 0;
+         i < sizeof(concurrent_methods) / sizeof(concurrent_methods[0]); ++i) {
+        if (method == concurrent_methods[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Sends the reply to a request.
+ * @param tp        Transport of the client
+ * @param rc        Return code of the handler
+ * @param response  Result, when rc tells success
+ * @param error     Error the plug-in logged, or NULL
+ */
+static void reply_send(Ipc *tp, int rc, const Value &response,
+                       lsm_error *error) {
+    if (LSM_ERR_OK == rc || LSM_ERR_JOB_STARTED == rc) {
+        tp->responseSend(response);
+    } else if (error) {
+        tp->errorSend(error->code, ss(error->message), ss(error->debug));
+    } else {
+        tp->errorSend(rc, "Plugin didn't provide error message", "");
+    }
+}
+
+/**
+ * Id of a request, which its reply echoes.
+ * @param request   The request
+ * @return Id, 100 for requests without a numeric one like clients send
+ */
+static uint32_t request_id(Value &request) {
+    Value id = request["id"];
+
+    return Value::numeric_t == id.valueType() ? id.asUint32_t() : 100;
+}
+
+/**
+ * Builds the reply to a request of a batch.
+ * @param rc        Return code of the handler
+ * @param response  Result, when rc tells success
+ * @param error     Error the plug-in logged, or NULL
+ * @param id        Id of the request
+ * @return Reply
+ */
+static Value reply_value(int rc, const Value &response, lsm_error *error,
+                         uint32_t id) {
+    if (LSM_ERR_OK == rc || LSM_ERR_JOB_STARTED == rc) {
+        return Ipc::responseValue(response, id);
+    } else if (error) {
+        return Ipc::errorValue(error->code, ss(error->message),
+                               ss(error->debug), id);
+    }
+    return Ipc::errorValue(rc, "Plugin didn't provide error message", "", id);
+}
+
+static void request_free(_lsm_plug_request *r) {
+    lsm_error_free(r->error);
+    delete r;
+}
+
+/**
+ * Sends the held replies which are next in order, holding the lock of the
+ * pool.
+ */
+static void replies_send(struct _lsm_request_pool *pool) {
+    std::map<uint64_t, _lsm_plug_request *>::iterator i;
+
+    while ((i = pool->done.find(pool->next_reply)) != pool->done.end()) {
+        _lsm_plug_request *r = i->second;
+
+        pool->done.erase(i);
+        if (r->reply) {
+            *r->reply = reply_value(r->rc, r->response, r->error,
+                                    request_id(r->request));
+        } else if (!pool->broken) {
+            try {
+                reply_send(pool->plug->tp, r->rc, r->response, r->error);
+            } catch (...) {
+                syslog(LOG_USER | LOG_NOTICE, "Sending reply failed");
+                pool->broken = true;
+            }
+        }
+        request_free(r);
+        ++pool->next_reply;
+    }
+    pthread_cond_broadcast(&pool->idle);
+}
+
+static void *request_worker(void *arg) {
+    _lsm_plug_worker *w = (_lsm_plug_worker *)arg;
+    struct _lsm_request_pool *pool = w->pool;
+
+    current_worker = w;
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (!pool->stop && pool->queue.empty()) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+
+        _lsm_plug_request *r = pool->queue.front();
+        pool->queue.pop_front();
+        pthread_mutex_unlock(&pool->lock);
+
+        try {
+            r->rc = process_request(pool->plug, r->method, r->request,
+                                    r->response);
+        } catch (...) {
+            syslog(LOG_USER | LOG_NOTICE, "Plug-in exception in %s",
+                   r->method.c_str());
+            r->rc = LSM_ERR_PLUGIN_BUG;
+        }
+        r->error = w->error;
+        w->error = NULL;
+        w->fields = NULL;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->done[r->seq] = r;
+        replies_send(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    current_worker = NULL;
+    return NULL;
+}
+
+static int request_pool_start(lsm_plugin_ptr p) {
+    struct _lsm_request_pool *pool = new _lsm_request_pool();
+
+    pool->plug = p;
+    pool->stop = false;
+    pool->broken = false;
+    pool->next_seq = 0;
+    pool->next_reply = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (uint32_t i = 0; i < p->workers; ++i) {
+        _lsm_plug_worker *w = new _lsm_plug_worker();
+
+        w->pool = pool;
+        w->data = NULL;
+        w->error = NULL;
+        w->fields = NULL;
+        if (p->worker_init && LSM_ERR_OK != p->worker_init(p, &w->data)) {
+            syslog(LOG_USER | LOG_NOTICE,
+                   "Plug-in failed to prepare request worker %u", i);
+            lsm_error_free(p->error);
+            p->error = NULL;
+            delete w;
+            break;
+        }
+        if (0 != pthread_create(&w->thread, NULL, request_worker, w)) {
+            if (p->worker_cleanup) {
+                p->worker_cleanup(p, w->data);
+            }
+            delete w;
+            break;
+        }
+        pool->workers.push_back(w);
+    }
+
+    if (pool->workers.empty()) {
+        pthread_cond_destroy(&pool->idle);
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        delete pool;
+        return LSM_ERR_NO_MEMORY;
+    }
+
+    p->pool = pool;
+    return LSM_ERR_OK;
+}
+
+/**
+ * Drops the requests not started and waits for the workers, which use the
+ * transport and the private data of the plug-in until they quit.
+ */
+static void request_pool_stop(lsm_plugin_ptr p) {
+    struct _lsm_request_pool *pool = p->pool;
+
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->workers.size(); ++i) {
+        pthread_join(pool->workers[i]->thread, NULL);
+        if (p->worker_cleanup) {
+            p->worker_cleanup(p, pool->workers[i]->data);
+        }
+        delete pool->workers[i];
+    }
+
+    for (std::deque<_lsm_plug_request *>::iterator i = pool->queue.begin();
+         i != pool->queue.end(); ++i) {
+        request_free(*i);
+    }
+    for (std::map<uint64_t, _lsm_plug_request *>::iterator i =
+             pool->done.begin();
+         i != pool->done.end(); ++i) {
+        request_free(i->second);
+    }
+
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    delete pool;
+    p->pool = NULL;
+}
+
+/**
+ * Hands a request to the request workers, if the plug-in wants them and the
+ * request changes nothing.
+ * @param p         Plug-in
+ * @param method    Method of the request
+ * @param request   The request
+ * @param reply     Where to keep the reply when the request is part of a
+ *                  batch, valid until requests_drain() returns
+ * @return true when a worker answers the request
+ */
+static bool request_queue(lsm_plugin_ptr p, const std::string &method,
+                          const Value &request, Value *reply = NULL) {
+    bool queued = false;
+
+    if (!p->workers || !method_concurrent(method)) {
+        return false;
+    }
+    if (!p->pool && LSM_ERR_OK != request_pool_start(p)) {
+        syslog(LOG_USER | LOG_NOTICE, "No request workers, answering "
+                                      "requests one at a time");
+        p->workers = 0;
+        return false;
+    }
+
+    struct _lsm_request_pool *pool = p->pool;
+    pthread_mutex_lock(&pool->lock);
+    if (!pool->broken) {
+        _lsm_plug_request *r = new _lsm_plug_request();
+
+        r->seq = pool->next_seq++;
+        r->method = method;
+        r->request = request;
+        r->rc = LSM_ERR_OK;
+        r->error = NULL;
+        r->reply = reply;
+        pool->queue.push_back(r);
+        pthread_cond_signal(&pool->cond);
+        queued = true;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return queued;
+}
+
+/**
+ * Waits until the replies of all requests handed to the workers are sent,
+ * before the request loop answers or sends anything itself.
+ * @param p     Plug-in
+ * @return false when sending one of them failed
+ */
+static bool requests_drain(lsm_plugin_ptr p) {
+    struct _lsm_request_pool *pool = p->pool;
+    bool broken = false;
+
+    if (pool) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->next_reply != pool->next_seq) {
+            pthread_cond_wait(&pool->idle, &pool->lock);
+        }
+        broken = pool->broken;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return !broken;
+}
+
+int lsm_plug_concurrency_register(lsm_plugin_ptr plug, uint32_t workers,
+                                  lsm_plug_worker_init init,
+                                  lsm_plug_worker_cleanup cleanup) {
+    if (!LSM_IS_PLUGIN(plug) || plug->pool) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    plug->workers = workers;
+    plug->worker_init = init;
+    plug->worker_cleanup = cleanup;
+    return LSM_ERR_OK;
+}
+
+void *lsm_plug_worker_data_get(lsm_plugin_ptr plug) {
+    _lsm_plug_worker *w = worker_get(plug);
+
+    return w ? w->data : NULL;
+}
+
 static void lsm_plugin_free(lsm_plugin_ptr p, lsm_flag flags) {
     if (LSM_IS_PLUGIN(p)) {
 
+        request_pool_stop(p);
+
         delete (p->tp);
         p->tp = NULL;
 
+        delete (p->sub);
+        p->sub = NULL;
+
+        job_executor_stop(p);
+
         if (p->unreg) {
             p->unreg(p, flags);
         }
@@ -214,6 +996,7 @@ static lsm_plugin_ptr lsm_plugin_alloc(lsm_plugin_register reg,
         rc->unreg = unreg;
         rc->desc = strdup(desc);
         rc->version = strdup(version);
+        rc->changes_fd = -1;
 
         if (!rc->desc || !rc->version) {
             lsm_plugin_free(rc, LSM_CLIENT_FLAG_RSVD);
@@ -228,16 +1011,9 @@ static void error_send(lsm_plugin_ptr p, int error_code) {
         return;
     }
 
-    if (p->error) {
-        if (p->tp) {
-            p->tp->errorSend(p->error->code, ss(p->error->message),
-                             ss(p->error->debug));
-            lsm_error_free(p->error);
-            p->error = NULL;
-        }
-    } else {
-        p->tp->errorSend(error_code, "Plugin didn't provide error message", "");
-    }
+    reply_send(p->tp, error_code, Value(), p->error);
+    lsm_error_free(p->error);
+    p->error = NULL;
 }
 
 static int get_search_params(Value &params, char **k, char **v) {
@@ -267,6 +1043,65 @@ static int get_search_params(Value &params, char **k, char **v) {
     return rc;
 }
 
+/**
+ * Reads the optional "fields" of list requests, the attributes the client
+ * wants in the records returned.
+ * @param[in] params        Request parameters
+ * @param[out] fields       Attributes requested
+ * @param[out] projected    false if all attributes are wanted
+ * @return LSM_ERR_OK, else LSM_ERR_TRANSPORT_INVALID_ARG
+ */
+static int get_fields_param(Value &params, std::set<std::string> &fields,
+                            bool &projected) {
+    Value f = params["fields"];
+
+    projected = false;
+    if (Value::null_t == f.valueType()) {
+        return LSM_ERR_OK;
+    }
+    if (Value::array_t != f.valueType()) {
+        return LSM_ERR_TRANSPORT_INVALID_ARG;
+    }
+
+    std::vector<Value> names = f.asArray();
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (Value::string_t != names[i].valueType()) {
+            return LSM_ERR_TRANSPORT_INVALID_ARG;
+        }
+        fields.insert(names[i].asString());
+    }
+    projected = true;
+    return LSM_ERR_OK;
+}
+
+/**
+ * Sets the attributes asked for by the list request being served.
+ * @param p         Plug-in
+ * @param fields    Attributes, NULL for all of them
+ */
+static void fields_set(lsm_plugin_ptr p, const std::set<std::string> *fields) {
+    _lsm_plug_worker *w = worker_get(p);
+
+    if (w) {
+        w->fields = fields;
+    } else {
+        p->fields = fields;
+    }
+}
+
+int lsm_plug_field_requested(lsm_plugin_ptr plug, const char *field) {
+    const std::set<std::string> *fields = NULL;
+
+    if (LSM_IS_PLUGIN(plug)) {
+        _lsm_plug_worker *w = worker_get(plug);
+        fields = w ? w->fields : plug->fields;
+    }
+    if (NULL == fields || NULL == field) {
+        return 1;
+    }
+    return fields->count(field) != 0;
+}
+
 /**
  * Checks to see if a character string is an integer and returns result
  * @param[in] sn    Character array holding the integer
@@ -289,30 +1124,199 @@ int lsm_plugin_init_v1(int argc, char *argv[], lsm_plugin_register reg,
     int rc = 1;
     lsm_plugin_ptr plug = NULL;
 
-    if (NULL == desc || NULL == version) {
-        return LSM_ERR_INVALID_ARGUMENT;
+    if (NULL == desc || NULL == version) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    int sd = 0;
+    if (argc == 2 && get_num(argv[1], sd)) {
+        plug = lsm_plugin_alloc(reg, unreg, desc, version);
+        if (plug) {
+            plug->tp = new Ipc(sd);
+            if (plug->tp) {
+                rc = lsm_plugin_run(plug);
+            } else {
+                lsm_plugin_free(plug, LSM_CLIENT_FLAG_RSVD);
+                rc = LSM_ERR_NO_MEMORY;
+            }
+        } else {
+            rc = LSM_ERR_NO_MEMORY;
+        }
+    } else {
+        // Process command line arguments or display help text.
+        rc = 2;
+    }
+
+    return rc;
+}
+
+#define LSM_PLUGIN_HOST_WORKERS_DEFAULT 8
+
+/**
+ * Shared state of lsm_plugin_host_v1() and its worker threads.
+ */
+struct plugin_host {
+    struct lsm_plugin_so_v1 *so;
+    int ctl_fd;
+    bool done;
+    /* Connection id and client socket of connections not served yet */
+    std::deque<std::pair<int, int> > pending;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+/**
+ * Worker thread, serves one client connection at a time with a newly
+ * allocated lsm_plugin_ptr so that plug-in state is never shared between
+ * connections.
+ */
+static void *plugin_host_worker(void *arg) {
+    struct plugin_host *h = (struct plugin_host *)arg;
+
+    while (true) {
+        int fd = -1;
+        int id = 0;
+
+        pthread_mutex_lock(&h->lock);
+        while (h->pending.empty() && !h->done) {
+            pthread_cond_wait(&h->cond, &h->lock);
+        }
+        if (!h->pending.empty()) {
+            id = h->pending.front().first;
+            fd = h->pending.front().second;
+            h->pending.pop_front();
+        }
+        pthread_mutex_unlock(&h->lock);
+
+        if (fd < 0) {
+            break;
+        }
+
+        int rc = LSM_ERR_NO_MEMORY;
+        lsm_plugin_ptr plug = lsm_plugin_alloc(h->so->reg, h->so->unreg,
+                                               h->so->desc, h->so->version);
+        if (plug) {
+            plug->tp = new Ipc(fd);
+            rc = lsm_plugin_run(plug);
+        } else {
+            close(fd);
+        }
+
+        /* Same report a python zygote sends when a child exits */
+        char msg[64];
+        int len = snprintf(msg, sizeof(msg), "EXIT %d %d", id,
+                           (rc & 0xff) << 8);
+        send(h->ctl_fd, msg, len, MSG_NOSIGNAL);
+    }
+    return NULL;
+}
+
+int lsm_plugin_host_v1(int argc, char *argv[]) {
+    struct plugin_host h;
+    int workers = LSM_PLUGIN_HOST_WORKERS_DEFAULT;
+    int next_id = 1;
+    void *so_handle = NULL;
+    std::vector<pthread_t> threads;
+
+    if (argc < 3 || argc > 4 || !get_num(argv[2], h.ctl_fd)) {
+        fprintf(stderr, "Usage: %s <shared object> <control fd> [workers]\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (argc == 4 && (!get_num(argv[3], workers) || workers < 1)) {
+        workers = LSM_PLUGIN_HOST_WORKERS_DEFAULT;
+    }
+
+    so_handle = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+    if (!so_handle) {
+        syslog(LOG_USER | LOG_NOTICE, "Unable to load plug-in %s: %s",
+               argv[1], dlerror());
+        return 1;
+    }
+
+    h.so = (struct lsm_plugin_so_v1 *)dlsym(so_handle, LSM_PLUGIN_SO_SYMBOL);
+    if (!h.so || h.so->abi_version != LSM_PLUGIN_SO_ABI_V1 || !h.so->reg ||
+        !h.so->unreg || !h.so->desc || !h.so->version) {
+        syslog(LOG_USER | LOG_NOTICE, "Plug-in %s has no valid %s entry",
+               argv[1], LSM_PLUGIN_SO_SYMBOL);
+        dlclose(so_handle);
+        return 1;
+    }
+
+    h.done = false;
+    pthread_mutex_init(&h.lock, NULL);
+    pthread_cond_init(&h.cond, NULL);
+
+    for (int i = 0; i < workers; ++i) {
+        pthread_t t;
+        if (0 == pthread_create(&t, NULL, plugin_host_worker, &h)) {
+            threads.push_back(t);
+        }
     }
 
-    int sd = 0;
-    if (argc == 2 && get_num(argv[1], sd)) {
-        plug = lsm_plugin_alloc(reg, unreg, desc, version);
-        if (plug) {
-            plug->tp = new Ipc(sd);
-            if (plug->tp) {
-                rc = lsm_plugin_run(plug);
-            } else {
-                lsm_plugin_free(plug, LSM_CLIENT_FLAG_RSVD);
-                rc = LSM_ERR_NO_MEMORY;
-            }
+    if (threads.empty() || -1 == send(h.ctl_fd, "READY", 5, MSG_NOSIGNAL)) {
+        h.done = true;
+    }
+
+    while (!h.done) {
+        struct msghdr msg;
+        struct iovec iov;
+        char buf[16];
+        union {
+            struct cmsghdr hdr;
+            char buf[CMSG_SPACE(sizeof(int))];
+        } cmsg_buf;
+
+        memset(&msg, 0, sizeof(msg));
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsg_buf.buf;
+        msg.msg_controllen = sizeof(cmsg_buf.buf);
+
+        ssize_t len = recvmsg(h.ctl_fd, &msg, MSG_CMSG_CLOEXEC);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+
+        pthread_mutex_lock(&h.lock);
+        if (len <= 0) {
+            /* lsmd closed the control socket, finish the connections we
+             * have and exit */
+            h.done = true;
         } else {
-            rc = LSM_ERR_NO_MEMORY;
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS) {
+                int fd = -1;
+                char reply[32];
+                int reply_len = snprintf(reply, sizeof(reply), "PID %d",
+                                         next_id);
+
+                memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+                h.pending.push_back(std::make_pair(next_id++, fd));
+                send(h.ctl_fd, reply, reply_len, MSG_NOSIGNAL);
+            }
         }
-    } else {
-        // Process command line arguments or display help text.
-        rc = 2;
+        pthread_cond_signal(&h.cond);
+        pthread_mutex_unlock(&h.lock);
     }
 
-    return rc;
+    pthread_mutex_lock(&h.lock);
+    pthread_cond_broadcast(&h.cond);
+    pthread_mutex_unlock(&h.lock);
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&h.cond);
+    pthread_mutex_destroy(&h.lock);
+    close(h.ctl_fd);
+    dlclose(so_handle);
+    return 0;
 }
 
 typedef int (*handler)(lsm_plugin_ptr p, Value &params, Value &response);
@@ -330,8 +1334,6 @@ static int handle_register(lsm_plugin_ptr p, Value &params, Value &response) {
     std::string uri_string;
     std::string password;
 
-    UNUSED(response);
-
     if (p && p->reg) {
 
         Value uri_v = params["uri"];
@@ -352,6 +1354,20 @@ static int handle_register(lsm_plugin_ptr p, Value &params, Value &response) {
             // Let the plug-in initialize itself.
             rc = p->reg(p, uri_string.c_str(), password.c_str(),
                         tmo_v.asUint32_t(), flags);
+
+            if (LSM_ERR_OK == rc) {
+                /*
+                 * Tell the client that lsm_plugin_run() takes batches, and
+                 * CBOR besides JSON.
+                 */
+                std::map<std::string, Value> features;
+                std::vector<Value> encodings;
+
+                encodings.push_back(Value("cbor"));
+                features["batch"] = Value(true);
+                features["encodings"] = Value(encodings);
+                response = Value(features);
+            }
         } else {
             rc = LSM_ERR_TRANSPORT_INVALID_ARG;
         }
@@ -395,6 +1411,38 @@ static int handle_get_time_out(lsm_plugin_ptr p, Value &params,
     return rc;
 }
 
+static int job_status_to_value(lsm_job_status status, uint8_t percent,
+                               lsm_data_type t, void *value, Value &response) {
+    int rc = LSM_ERR_OK;
+    std::vector<Value> result;
+
+    result.push_back(Value((int32_t)status));
+    result.push_back(Value(percent));
+
+    if (NULL == value) {
+        result.push_back(Value());
+    } else {
+        if (LSM_DATA_TYPE_VOLUME == t && LSM_IS_VOL((lsm_volume *)value)) {
+            result.push_back(volume_to_value((lsm_volume *)value));
+            lsm_volume_record_free((lsm_volume *)value);
+        } else if (LSM_DATA_TYPE_FS == t && LSM_IS_FS((lsm_fs *)value)) {
+            result.push_back(fs_to_value((lsm_fs *)value));
+            lsm_fs_record_free((lsm_fs *)value);
+        } else if (LSM_DATA_TYPE_SS == t && LSM_IS_SS((lsm_fs_ss *)value)) {
+            result.push_back(ss_to_value((lsm_fs_ss *)value));
+            lsm_fs_ss_record_free((lsm_fs_ss *)value);
+        } else if (LSM_DATA_TYPE_POOL == t &&
+                   LSM_IS_POOL((lsm_pool *)value)) {
+            result.push_back(pool_to_value((lsm_pool *)value));
+            lsm_pool_record_free((lsm_pool *)value);
+        } else {
+            rc = LSM_ERR_PLUGIN_BUG;
+        }
+    }
+    response = Value(result);
+    return rc;
+}
+
 static int handle_job_status(lsm_plugin_ptr p, Value &params, Value &response) {
     std::string job_id;
     lsm_job_status status;
@@ -403,6 +1451,18 @@ static int handle_job_status(lsm_plugin_ptr p, Value &params, Value &response) {
     void *value = NULL;
     int rc = LSM_ERR_NO_SUPPORT;
 
+    if (p && p->jobs && Value::string_t == params["job_id"].valueType()) {
+        rc = job_executor_status(p, params["job_id"].asString(), &status,
+                                 &percent, &t, &value);
+        if (LSM_ERR_OK == rc) {
+            return job_status_to_value(status, percent, t, value, response);
+        } else if (LSM_ERR_NOT_FOUND_JOB != rc ||
+                   !(p->mgmt_ops && p->mgmt_ops->job_status)) {
+            return rc;
+        }
+        rc = LSM_ERR_NO_SUPPORT;
+    }
+
     if (p && p->mgmt_ops && p->mgmt_ops->job_status) {
 
         if (Value::string_t != params["job_id"].valueType() &&
@@ -417,35 +1477,7 @@ static int handle_job_status(lsm_plugin_ptr p, Value &params, Value &response) {
                                         &t, &value, LSM_FLAG_GET_VALUE(params));
 
             if (LSM_ERR_OK == rc) {
-                std::vector<Value> result;
-
-                result.push_back(Value((int32_t)status));
-                result.push_back(Value(percent));
-
-                if (NULL == value) {
-                    result.push_back(Value());
-                } else {
-                    if (LSM_DATA_TYPE_VOLUME == t &&
-                        LSM_IS_VOL((lsm_volume *)value)) {
-                        result.push_back(volume_to_value((lsm_volume *)value));
-                        lsm_volume_record_free((lsm_volume *)value);
-                    } else if (LSM_DATA_TYPE_FS == t &&
-                               LSM_IS_FS((lsm_fs *)value)) {
-                        result.push_back(fs_to_value((lsm_fs *)value));
-                        lsm_fs_record_free((lsm_fs *)value);
-                    } else if (LSM_DATA_TYPE_SS == t &&
-                               LSM_IS_SS((lsm_fs_ss *)value)) {
-                        result.push_back(ss_to_value((lsm_fs_ss *)value));
-                        lsm_fs_ss_record_free((lsm_fs_ss *)value);
-                    } else if (LSM_DATA_TYPE_POOL == t &&
-                               LSM_IS_POOL((lsm_pool *)value)) {
-                        result.push_back(pool_to_value((lsm_pool *)value));
-                        lsm_pool_record_free((lsm_pool *)value);
-                    } else {
-                        rc = LSM_ERR_PLUGIN_BUG;
-                    }
-                }
-                response = Value(result);
+                rc = job_status_to_value(status, percent, t, value, response);
             }
         }
     }
@@ -471,6 +1503,16 @@ static int handle_plugin_info(lsm_plugin_ptr p, Value &params,
 static int handle_job_free(lsm_plugin_ptr p, Value &params, Value &response) {
     int rc = LSM_ERR_NO_SUPPORT;
     UNUSED(response);
+
+    if (p && p->jobs && Value::string_t == params["job_id"].valueType()) {
+        rc = job_executor_free(p, params["job_id"].asString());
+        if (LSM_ERR_NOT_FOUND_JOB != rc ||
+            !(p->mgmt_ops && p->mgmt_ops->job_free)) {
+            return rc;
+        }
+        rc = LSM_ERR_NO_SUPPORT;
+    }
+
     if (p && p->mgmt_ops && p->mgmt_ops->job_free) {
         if (Value::string_t == params["job_id"].valueType() &&
             LSM_FLAG_EXPECTED_TYPE(params)) {
@@ -491,22 +1533,22 @@ static int handle_system_list(lsm_plugin_ptr p, Value &params,
     if (p && p->mgmt_ops && p->mgmt_ops->system_list) {
         lsm_system **systems = NULL;
         uint32_t count = 0;
+        std::set<std::string> fields;
+        bool projected = false;
 
-        if (LSM_FLAG_EXPECTED_TYPE(params)) {
+        if (LSM_FLAG_EXPECTED_TYPE(params) &&
+            get_fields_param(params, fields, projected) == LSM_ERR_OK) {
 
+            fields_set(p, projected ? &fields : NULL);
             rc = p->mgmt_ops->system_list(p, &systems, &count,
                                           LSM_FLAG_GET_VALUE(params));
+            fields_set(p, NULL);
             if (LSM_ERR_OK == rc) {
-                std::vector<Value> result;
-                result.reserve(count);
-
-                for (uint32_t i = 0; i < count; ++i) {
-                    result.push_back(system_to_value(systems[i]));
-                }
-
+                response = schema_array_to_value(SYSTEM_SCHEMA, systems, count,
+                                                 p->tp->encoding(),
+                                                 projected ? &fields : NULL);
                 lsm_system_record_array_free(systems, count);
                 systems = NULL;
-                response = Value(result);
             }
         } else {
             rc = LSM_ERR_TRANSPORT_INVALID_ARG;
@@ -523,22 +1565,23 @@ static int handle_pools(lsm_plugin_ptr p, Value &params, Value &response) {
     if (p && p->mgmt_ops && p->mgmt_ops->pool_list) {
         lsm_pool **pools = NULL;
         uint32_t count = 0;
+        std::set<std::string> fields;
+        bool projected = false;
 
         if (LSM_FLAG_EXPECTED_TYPE(params) &&
+            ((rc = get_fields_param(params, fields, projected)) ==
+             LSM_ERR_OK) &&
             ((rc = get_search_params(params, &key, &val)) == LSM_ERR_OK)) {
+            fields_set(p, projected ? &fields : NULL);
             rc = p->mgmt_ops->pool_list(p, key, val, &pools, &count,
                                         LSM_FLAG_GET_VALUE(params));
+            fields_set(p, NULL);
             if (LSM_ERR_OK == rc) {
-                std::vector<Value> result;
-                result.reserve(count);
-
-                for (uint32_t i = 0; i < count; ++i) {
-                    result.push_back(pool_to_value(pools[i]));
-                }
-
+                response = schema_array_to_value(POOL_SCHEMA, pools, count,
+                                                 p->tp->encoding(),
+                                                 projected ? &fields : NULL);
                 lsm_pool_record_array_free(pools, count);
                 pools = NULL;
-                response = Value(result);
             }
             free(key);
             free(val);
@@ -566,16 +1609,10 @@ static int handle_target_ports(lsm_plugin_ptr p, Value &params,
             rc = p->san_ops->target_port_list(
                 p, key, val, &target_ports, &count, LSM_FLAG_GET_VALUE(params));
             if (LSM_ERR_OK == rc) {
-                std::vector<Value> result;
-                result.reserve(count);
-
-                for (uint32_t i = 0; i < count; ++i) {
-                    result.push_back(target_port_to_value(target_ports[i]));
-                }
-
+                response = schema_array_to_value(
+                    TARGET_PORT_SCHEMA, target_ports, count, p->tp->encoding());
                 lsm_target_port_record_array_free(target_ports, count);
                 target_ports = NULL;
-                response = Value(result);
             }
             free(key);
             free(val);
@@ -619,18 +1656,12 @@ static int capabilities(lsm_plugin_ptr p, Value &params, Value &response) {
 }
 
 static void get_volumes(int rc, lsm_volume **vols, uint32_t count,
-                        Value &response) {
+                        Value &response, Payload::encoding e,
+                        const std::set<std::string> *fields) {
     if (LSM_ERR_OK == rc) {
-        std::vector<Value> result;
-        result.reserve(count);
-
-        for (uint32_t i = 0; i < count; ++i) {
-            result.push_back(volume_to_value(vols[i]));
-        }
-
+        response = schema_array_to_value(VOLUME_SCHEMA, vols, count, e, fields);
         lsm_volume_record_array_free(vols, count);
         vols = NULL;
-        response = Value(result);
     }
 }
 
@@ -642,13 +1673,19 @@ static int handle_volumes(lsm_plugin_ptr p, Value &params, Value &response) {
     if (p && p->san_ops && p->san_ops->vol_get) {
         lsm_volume **vols = NULL;
         uint32_t count = 0;
+        std::set<std::string> fields;
+        bool projected = false;
 
         if (LSM_FLAG_EXPECTED_TYPE(params) &&
+            (rc = get_fields_param(params, fields, projected)) == LSM_ERR_OK &&
             (rc = get_search_params(params, &key, &val)) == LSM_ERR_OK) {
+            fields_set(p, projected ? &fields : NULL);
             rc = p->san_ops->vol_get(p, key, val, &vols, &count,
                                      LSM_FLAG_GET_VALUE(params));
+            fields_set(p, NULL);
 
-            get_volumes(rc, vols, count, response);
+            get_volumes(rc, vols, count, response, p->tp->encoding(),
+                        projected ? &fields : NULL);
             free(key);
             free(val);
         } else {
@@ -661,18 +1698,12 @@ static int handle_volumes(lsm_plugin_ptr p, Value &params, Value &response) {
 }
 
 static void get_disks(int rc, lsm_disk **disks, uint32_t count,
-                      Value &response) {
+                      Value &response, Payload::encoding e,
+                      const std::set<std::string> *fields) {
     if (LSM_ERR_OK == rc) {
-        std::vector<Value> result;
-        result.reserve(count);
-
-        for (uint32_t i = 0; i < count; ++i) {
-            result.push_back(disk_to_value(disks[i]));
-        }
-
+        response = schema_array_to_value(DISK_SCHEMA, disks, count, e, fields);
         lsm_disk_record_array_free(disks, count);
         disks = NULL;
-        response = Value(result);
     }
 }
 
@@ -684,12 +1715,18 @@ static int handle_disks(lsm_plugin_ptr p, Value &params, Value &response) {
     if (p && p->san_ops && p->san_ops->disk_get) {
         lsm_disk **disks = NULL;
         uint32_t count = 0;
+        std::set<std::string> fields;
+        bool projected = false;
 
         if (LSM_FLAG_EXPECTED_TYPE(params) &&
+            (rc = get_fields_param(params, fields, projected)) == LSM_ERR_OK &&
             (rc = get_search_params(params, &key, &val)) == LSM_ERR_OK) {
+            fields_set(p, projected ? &fields : NULL);
             rc = p->san_ops->disk_get(p, key, val, &disks, &count,
                                       LSM_FLAG_GET_VALUE(params));
-            get_disks(rc, disks, count, response);
+            fields_set(p, NULL);
+            get_disks(rc, disks, count, response, p->tp->encoding(),
+                      projected ? &fields : NULL);
             free(key);
             free(val);
         } else {
@@ -1089,7 +2126,8 @@ static int ag_list(lsm_plugin_ptr p, Value &params, Value &response) {
             rc = p->san_ops->ag_list(p, key, val, &groups, &count,
                                      LSM_FLAG_GET_VALUE(params));
             if (LSM_ERR_OK == rc) {
-                response = access_group_list_to_value(groups, count);
+                response = schema_array_to_value(ACCESS_GROUP_SCHEMA, groups,
+                                                 count, p->tp->encoding());
 
                 /* Free the memory */
                 lsm_access_group_record_array_free(groups, count);
@@ -1338,13 +2376,8 @@ static int vol_accessible_by_ag(lsm_plugin_ptr p, Value &params,
                     p, ag, &vols, &count, LSM_FLAG_GET_VALUE(params));
 
                 if (LSM_ERR_OK == rc) {
-                    std::vector<Value> result;
-                    result.reserve(count);
-
-                    for (uint32_t i = 0; i < count; ++i) {
-                        result.push_back(volume_to_value(vols[i]));
-                    }
-                    response = Value(result);
+                    response = schema_array_to_value(VOLUME_SCHEMA, vols, count,
+                                                     p->tp->encoding());
                 }
 
                 lsm_access_group_record_free(ag);
@@ -1380,13 +2413,8 @@ static int ag_granted_to_volume(lsm_plugin_ptr p, Value &params,
                                                    LSM_FLAG_GET_VALUE(params));
 
                 if (LSM_ERR_OK == rc) {
-                    std::vector<Value> result;
-                    result.reserve(count);
-
-                    for (uint32_t i = 0; i < count; ++i) {
-                        result.push_back(access_group_to_value(groups[i]));
-                    }
-                    response = Value(result);
+                    response = schema_array_to_value(
+                        ACCESS_GROUP_SCHEMA, groups, count, p->tp->encoding());
                 }
 
                 lsm_volume_record_free(volume);
@@ -1486,14 +2514,8 @@ static int fs(lsm_plugin_ptr p, Value &params, Value &response) {
                                     LSM_FLAG_GET_VALUE(params));
 
             if (LSM_ERR_OK == rc) {
-                std::vector<Value> result;
-                result.reserve(count);
-
-                for (uint32_t i = 0; i < count; ++i) {
-                    result.push_back(fs_to_value(fs[i]));
-                }
-
-                response = Value(result);
+                response = schema_array_to_value(FS_SCHEMA, fs, count,
+                                                 p->tp->encoding());
                 lsm_fs_record_array_free(fs, count);
                 fs = NULL;
             }
@@ -1845,13 +2867,8 @@ static int ss_list(lsm_plugin_ptr p, Value &params, Value &response) {
                                            LSM_FLAG_GET_VALUE(params));
 
                 if (LSM_ERR_OK == rc) {
-                    std::vector<Value> result;
-                    result.reserve(count);
-
-                    for (uint32_t i = 0; i < count; ++i) {
-                        result.push_back(ss_to_value(ss[i]));
-                    }
-                    response = Value(result);
+                    response = schema_array_to_value(SS_SCHEMA, ss, count,
+                                                     p->tp->encoding());
 
                     lsm_fs_record_free(fs);
                     fs = NULL;
@@ -2042,13 +3059,8 @@ static int exports(lsm_plugin_ptr p, Value &params, Value &response) {
                                       LSM_FLAG_GET_VALUE(params));
 
             if (LSM_ERR_OK == rc) {
-                std::vector<Value> result;
-                result.reserve(count);
-
-                for (uint32_t i = 0; i < count; ++i) {
-                    result.push_back(nfs_export_to_value(exports[i]));
-                }
-                response = Value(result);
+                response = schema_array_to_value(NFS_EXPORT_SCHEMA, exports,
+                                                 count, p->tp->encoding());
 
                 lsm_nfs_export_record_array_free(exports, count);
                 exports = NULL;
@@ -2369,6 +3381,369 @@ static int handle_system_read_cache_pct_update(lsm_plugin_ptr p, Value &params,
     return rc;
 }
 
+#define SUBSCRIPTION_INTERVAL_DEFAULT 10
+
+static const struct {
+    uint64_t event_class;
+    const char *class_name;
+    const char *method;  /* List request */
+    bool search_by_id;   /* List request takes search_key "id" */
+} event_classes[] = {
+    {LSM_EVENT_CLASS_SYSTEM, CLASS_NAME_SYSTEM, "systems", false},
+    {LSM_EVENT_CLASS_POOL, CLASS_NAME_POOL, "pools", true},
+    {LSM_EVENT_CLASS_VOLUME, CLASS_NAME_VOLUME, "volumes", true},
+    {LSM_EVENT_CLASS_DISK, CLASS_NAME_DISK, "disks", true},
+};
+
+static time_t monotonic_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static bool event_class_supported(lsm_plugin_ptr p, uint64_t event_class) {
+    switch (event_class) {
+    case (LSM_EVENT_CLASS_SYSTEM):
+        return p->mgmt_ops && p->mgmt_ops->system_list;
+    case (LSM_EVENT_CLASS_POOL):
+        return p->mgmt_ops && p->mgmt_ops->pool_list;
+    case (LSM_EVENT_CLASS_VOLUME):
+        return p->san_ops && p->san_ops->vol_get;
+    case (LSM_EVENT_CLASS_DISK):
+        return p->san_ops && p->san_ops->disk_get;
+    default:
+        break;
+    }
+    return false;
+}
+
+/**
+ * Lists objects of a class through the regular request handlers.
+ * @param p         Plug-in
+ * @param i         Index in event_classes
+ * @param id        Only list this object, NULL for all
+ * @param result    Objects listed
+ * @return LSM_ERR_OK on success, else error reason.
+ */
+static int subscription_list(lsm_plugin_ptr p, size_t i, const char *id,
+                             std::vector<Value> &result) {
+    std::map<std::string, Value> params;
+    std::map<std::string, Value> req;
+    Value resp;
+
+    params["flags"] = Value(LSM_CLIENT_FLAG_RSVD);
+    if (id) {
+        params["search_key"] = Value("id");
+        params["search_value"] = Value(id);
+    }
+    req["params"] = Value(params);
+    Value request(req);
+
+    int rc = process_request(p, event_classes[i].method, request, resp);
+    if (LSM_ERR_OK == rc) {
+        if (Value::raw_t == resp.valueType()) {
+            resp = Payload::deserialize(Payload::serialize(resp));
+        } else if (Value::raw_cbor_t == resp.valueType()) {
+            resp =
+                Payload::deserialize(Payload::serialize(resp, Payload::CBOR));
+        }
+        if (Value::array_t == resp.valueType()) {
+            result = resp.asArray();
+        } else {
+            rc = LSM_ERR_PLUGIN_BUG;
+        }
+    }
+    if (LSM_ERR_OK != rc) {
+        syslog(LOG_USER | LOG_NOTICE, "Listing %s for subscription failed: %d",
+               event_classes[i].method, rc);
+        lsm_error_free(p->error);
+        p->error = NULL;
+    }
+    return rc;
+}
+
+static void event_send(lsm_plugin_ptr p, lsm_event_type type,
+                       const Value &object) {
+    std::map<std::string, Value> e;
+    e["type"] = Value((int32_t)type);
+    e["object"] = object;
+    p->tp->eventSend(Value(e));
+}
+
+/**
+ * Compares objects of a class to the last known state and sends an event for
+ * each difference.
+ * @param p         Plug-in
+ * @param i         Index in event_classes
+ * @param id        Only compare this object, NULL for all
+ * @param notify    Send events, else just take the current state
+ * @return LSM_ERR_OK on success, else error reason.
+ */
+static int subscription_diff(lsm_plugin_ptr p, size_t i, const char *id,
+                             bool notify) {
+    std::vector<Value> current;
+    int rc = subscription_list(p, i, id, current);
+    if (LSM_ERR_OK != rc) {
+        return rc;
+    }
+
+    _lsm_subscription::snapshot &known =
+        p->sub->objects[event_classes[i].event_class];
+    std::set<std::string> seen;
+
+    for (size_t j = 0; j < current.size(); ++j) {
+        Value &o = current[j];
+        if (Value::string_t != o["id"].valueType()) {
+            continue;
+        }
+        std::string o_id = o["id"].asString();
+        std::string json = Payload::serialize(o);
+        _lsm_subscription::snapshot::iterator k = known.find(o_id);
+
+        seen.insert(o_id);
+        if (k == known.end()) {
+            if (notify) {
+                event_send(p, LSM_EVENT_TYPE_CREATED, o);
+            }
+        } else if (k->second.first != json) {
+            if (notify) {
+                Value &old = k->second.second;
+                bool health = o.hasKey("status") &&
+                              Payload::serialize(o["status"]) !=
+                                  Payload::serialize(old["status"]);
+                event_send(p,
+                           health ? LSM_EVENT_TYPE_HEALTH
+                                  : LSM_EVENT_TYPE_MODIFIED,
+                           o);
+            }
+        } else {
+            continue;
+        }
+        known[o_id] = std::make_pair(json, o);
+    }
+
+    _lsm_subscription::snapshot::iterator k = known.begin();
+    while (k != known.end()) {
+        if ((id && k->first != id) || seen.count(k->first)) {
+            ++k;
+            continue;
+        }
+        if (notify) {
+            event_send(p, LSM_EVENT_TYPE_DELETED, k->second.second);
+        }
+        known.erase(k++);
+    }
+    return LSM_ERR_OK;
+}
+
+/**
+ * Checks the subscribed classes for changes, the ones the plug-in reported
+ * or all of them.
+ * @param p         Plug-in
+ * @param fd_ready  Changes fd of the plug-in is readable
+ */
+static void subscription_check(lsm_plugin_ptr p, bool fd_ready) {
+    _lsm_subscription *sub = p->sub;
+
+    /* Events must not go out between replies, nor race with the workers. */
+    requests_drain(p);
+
+    if (sub->native && (fd_ready || p->changes_fd < 0)) {
+        if (p->changes_get(p, 0, LSM_CLIENT_FLAG_RSVD) != LSM_ERR_OK) {
+            syslog(LOG_USER | LOG_NOTICE, "Plug-in failed to report changes");
+            lsm_error_free(p->error);
+            p->error = NULL;
+            lsm_plug_object_changed(p, sub->classes, NULL);
+        }
+    } else if (!sub->native) {
+        lsm_plug_object_changed(p, sub->classes, NULL);
+    }
+
+    for (size_t i = 0; i < sizeof(event_classes) / sizeof(event_classes[0]);
+         ++i) {
+        uint64_t c = event_classes[i].event_class;
+
+        if (sub->dirty_classes.count(c)) {
+            subscription_diff(p, i, NULL, true);
+        } else if (!sub->dirty[c].empty()) {
+            std::set<std::string> &ids = sub->dirty[c];
+            for (std::set<std::string>::iterator id = ids.begin();
+                 id != ids.end(); ++id) {
+                if (subscription_diff(p, i, id->c_str(), true) !=
+                    LSM_ERR_OK) {
+                    subscription_diff(p, i, NULL, true);
+                    break;
+                }
+            }
+        }
+        sub->dirty_classes.erase(c);
+        sub->dirty[c].clear();
+    }
+}
+
+/**
+ * Waits for the next request of the client while checking for changes the
+ * client subscribed to.
+ * @param p     Plug-in
+ * @return true when a request is there to read
+ */
+static bool subscription_wait(lsm_plugin_ptr p) {
+    struct pollfd pfd[2];
+    nfds_t count = 1;
+    int timeout = -1;
+    bool periodic = !p->sub->native || p->changes_fd < 0;
+
+    pfd[0].fd = p->tp->fd();
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    if (p->sub->native && p->changes_fd >= 0) {
+        pfd[1].fd = p->changes_fd;
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        count = 2;
+    }
+    if (periodic) {
+        time_t now = monotonic_now();
+        timeout = p->sub->next > now ? (p->sub->next - now) * 1000 : 0;
+    }
+
+    int rc = poll(pfd, count, timeout);
+    if (rc < 0) {
+        return errno != EINTR;
+    }
+    if (rc > 0 && (pfd[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+        return true;
+    }
+    if (count == 2 && pfd[1].revents) {
+        subscription_check(p, true);
+    } else if (rc == 0) {
+        p->sub->next = monotonic_now() + p->sub->interval;
+        subscription_check(p, false);
+    }
+    return false;
+}
+
+int lsm_plug_changes_register(lsm_plugin_ptr plug,
+                              lsm_plug_changes_get changes_get, int fd) {
+    if (!LSM_IS_PLUGIN(plug) || !changes_get) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    plug->changes_get = changes_get;
+    plug->changes_fd = fd;
+    return LSM_ERR_OK;
+}
+
+int lsm_plug_object_changed(lsm_plugin_ptr plug, uint64_t event_class,
+                            const char *id) {
+    if (!LSM_IS_PLUGIN(plug) || (event_class & ~LSM_EVENT_CLASS_ALL)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    if (plug->sub) {
+        for (size_t i = 0;
+             i < sizeof(event_classes) / sizeof(event_classes[0]); ++i) {
+            uint64_t c = event_classes[i].event_class;
+
+            if (!(event_class & plug->sub->classes & c)) {
+                continue;
+            }
+            if (id && event_classes[i].search_by_id) {
+                plug->sub->dirty[c].insert(id);
+            } else {
+                plug->sub->dirty_classes.insert(c);
+            }
+        }
+    }
+    return LSM_ERR_OK;
+}
+
+static int handle_subscribe(lsm_plugin_ptr p, Value &params, Value &response) {
+    Value v_classes = params["classes"];
+    Value v_interval = params["interval"];
+    uint64_t classes = 0;
+    UNUSED(response);
+
+    if (!LSM_FLAG_EXPECTED_TYPE(params) ||
+        (Value::null_t != v_interval.valueType() &&
+         Value::numeric_t != v_interval.valueType())) {
+        return LSM_ERR_TRANSPORT_INVALID_ARG;
+    }
+
+    if (Value::null_t == v_classes.valueType()) {
+        classes = LSM_EVENT_CLASS_ALL;
+    } else if (Value::array_t == v_classes.valueType()) {
+        std::vector<Value> names = v_classes.asArray();
+        for (size_t j = 0; j < names.size(); ++j) {
+            size_t i = 0;
+            for (; i < sizeof(event_classes) / sizeof(event_classes[0]); ++i) {
+                if (Value::string_t == names[j].valueType() &&
+                    names[j].asString() == event_classes[i].class_name) {
+                    classes |= event_classes[i].event_class;
+                    break;
+                }
+            }
+            if (i == sizeof(event_classes) / sizeof(event_classes[0])) {
+                return LSM_ERR_INVALID_ARGUMENT;
+            }
+        }
+    } else {
+        return LSM_ERR_TRANSPORT_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < sizeof(event_classes) / sizeof(event_classes[0]);
+         ++i) {
+        if (!event_class_supported(p, event_classes[i].event_class)) {
+            classes &= ~event_classes[i].event_class;
+        }
+    }
+    if (!classes) {
+        return LSM_ERR_NO_SUPPORT;
+    }
+
+    delete p->sub;
+    p->sub = new _lsm_subscription();
+    p->sub->classes = classes;
+    p->sub->interval = SUBSCRIPTION_INTERVAL_DEFAULT;
+    if (Value::numeric_t == v_interval.valueType() &&
+        v_interval.asUint32_t() > 0) {
+        p->sub->interval = v_interval.asUint32_t();
+    }
+    p->sub->native = p->changes_get &&
+                     p->changes_get(p, 1, LSM_CLIENT_FLAG_RSVD) == LSM_ERR_OK;
+    if (!p->sub->native) {
+        lsm_error_free(p->error);
+        p->error = NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(event_classes) / sizeof(event_classes[0]);
+         ++i) {
+        if (classes & event_classes[i].event_class) {
+            int rc = subscription_diff(p, i, NULL, false);
+            if (LSM_ERR_OK != rc) {
+                delete p->sub;
+                p->sub = NULL;
+                return rc;
+            }
+        }
+    }
+    p->sub->next = monotonic_now() + p->sub->interval;
+    return LSM_ERR_OK;
+}
+
+static int handle_unsubscribe(lsm_plugin_ptr p, Value &params,
+                              Value &response) {
+    UNUSED(response);
+
+    if (!LSM_FLAG_EXPECTED_TYPE(params)) {
+        return LSM_ERR_TRANSPORT_INVALID_ARG;
+    }
+
+    delete p->sub;
+    p->sub = NULL;
+    return LSM_ERR_OK;
+}
+
 /**
  * map of function pointers
  */
@@ -2419,7 +3794,8 @@ static std::map<std::string, handler> dispatch =
                                        handle_volume_cache_info)(
         "volume_physical_disk_cache_update", handle_volume_pdc_update)(
         "volume_write_cache_policy_update", handle_volume_wcp_update)(
-        "volume_read_cache_policy_update", handle_volume_rcp_update);
+        "volume_read_cache_policy_update", handle_volume_rcp_update)(
+        "subscribe", handle_subscribe)("unsubscribe", handle_unsubscribe);
 
 static int process_request(lsm_plugin_ptr p, const std::string &method,
                            Value &request, Value &response) {
@@ -2427,8 +3803,9 @@ static int process_request(lsm_plugin_ptr p, const std::string &method,
 
     response = Value(); // Default response will be null
 
-    if (dispatch.find(method) != dispatch.end()) {
-        rc = (dispatch[method])(p, request["params"], response);
+    std::map<std::string, handler>::const_iterator h = dispatch.find(method);
+    if (h != dispatch.end()) {
+        rc = (h->second)(p, request["params"], response);
     } else {
         rc = LSM_ERR_NO_SUPPORT;
     }
@@ -2436,6 +3813,60 @@ static int process_request(lsm_plugin_ptr p, const std::string &method,
     return rc;
 }
 
+/**
+ * Answers a batch of requests with one message holding the replies in
+ * order.  Requests which change nothing go to the request workers, any
+ * other waits for the ones before it and is answered on the loop.
+ * @param p         Plug-in
+ * @param batch     Array of requests
+ * @return false when sending the replies failed
+ */
+static bool batch_process(lsm_plugin_ptr p, Value &batch) {
+    std::vector<Value> requests = batch.asArray();
+    std::vector<Value> replies(requests.size());
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        Value &req = requests[i];
+
+        if (!req.isValidRequest()) {
+            replies[i] = Ipc::errorValue(LSM_ERR_TRANSPORT_INVALID_ARG,
+                                         "Invalid request", "", (uint32_t)i);
+            continue;
+        }
+
+        std::string method = req["method"].asString();
+        uint32_t id = request_id(req);
+
+        /* These change the state of the connection */
+        if (method == "plugin_register" || method == "plugin_unregister" ||
+            method == "subscribe" || method == "unsubscribe") {
+            replies[i] = Ipc::errorValue(LSM_ERR_INVALID_ARGUMENT,
+                                         method + " cannot be batched", "", id);
+            continue;
+        }
+
+        if (request_queue(p, method, req, &replies[i])) {
+            continue;
+        }
+        if (!requests_drain(p)) {
+            return false;
+        }
+
+        Value resp;
+        int rc = process_request(p, method, req, resp);
+
+        replies[i] = reply_value(rc, resp, p->error, id);
+        lsm_error_free(p->error);
+        p->error = NULL;
+    }
+
+    if (!requests_drain(p)) {
+        return false;
+    }
+    p->tp->batchReplySend(replies);
+    return true;
+}
+
 static int lsm_plugin_run(lsm_plugin_ptr p) {
     int rc = 0;
     lsm_flag flags = 0;
@@ -2450,11 +3881,22 @@ static int lsm_plugin_run(lsm_plugin_ptr p) {
                     break;
                 }
 
+                if (p->sub && !subscription_wait(p)) {
+                    continue;
+                }
+
                 Value req = p->tp->readRequest();
                 Value resp;
 
                 if (req.isValidRequest()) {
                     std::string method = req["method"].asString();
+
+                    if (request_queue(p, method, req)) {
+                        continue;
+                    }
+                    if (!requests_drain(p)) {
+                        break;
+                    }
                     rc = process_request(p, method, req, resp);
 
                     if (LSM_ERR_OK == rc || LSM_ERR_JOB_STARTED == rc) {
@@ -2467,6 +3909,10 @@ static int lsm_plugin_run(lsm_plugin_ptr p) {
                         flags = LSM_FLAG_GET_VALUE(req["params"]);
                         break;
                     }
+                } else if (Value::array_t == req.valueType()) {
+                    if (!batch_process(p, req)) {
+                        break;
+                    }
                 } else {
                     syslog(LOG_USER | LOG_NOTICE, "Invalid request");
                     break;
@@ -2523,11 +3969,15 @@ int lsm_plugin_error_log(lsm_plugin_ptr plug, lsm_error_ptr error) {
         return LSM_ERR_INVALID_ARGUMENT;
     }
 
-    if (plug->error) {
-        lsm_error_free(plug->error);
+    /* Requests answered by a worker keep their own error. */
+    _lsm_plug_worker *w = worker_get(plug);
+    lsm_error **logged = w ? &w->error : &plug->error;
+
+    if (*logged) {
+        lsm_error_free(*logged);
     }
 
-    plug->error = error;
+    *logged = error;
 
     return LSM_ERR_OK;
 }
@@ -2825,19 +4275,11 @@ void lsm_plug_target_port_search_filter(const char *search_key,
 }
 
 static void get_batteries(int rc, lsm_battery *bs[], uint32_t count,
-                          Value &response) {
-    uint32_t i = 0;
-
+                          Value &response, Payload::encoding e) {
     if (LSM_ERR_OK == rc) {
-        std::vector<Value> result;
-        result.reserve(count);
-
-        for (; i < count; ++i)
-            result.push_back(battery_to_value(bs[i]));
-
+        response = schema_array_to_value(BATTERY_SCHEMA, bs, count, e);
         lsm_battery_record_array_free(bs, count);
         bs = NULL;
-        response = Value(result);
     }
 }
 
@@ -2855,7 +4297,7 @@ static int handle_batteries(lsm_plugin_ptr p, Value &params, Value &response) {
             rc = p->ops_v1_3->battery_list(p, key, val, &bs, &count,
                                            LSM_FLAG_GET_VALUE(params));
 
-            get_batteries(rc, bs, count, response);
+            get_batteries(rc, bs, count, response, p->tp->encoding());
             free(key);
             free(val);
         } else {
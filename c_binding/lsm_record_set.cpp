@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "libstoragemgmt/libstoragemgmt.h"
+#include "lsm_datatypes.hpp"
+#include "lsm_schema.hpp"
+#include <new>
+#include <pthread.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * Records sharing a key, in the order of the list reply.
+ */
+typedef std::vector<void *> record_group;
+
+/**
+ * List reply with hash indexes on string attributes of its records, every
+ * typed set of the API is one of these.
+ */
+struct LSM_DLL_LOCAL record_set {
+    uint32_t magic;                    /**< Magic for validation */
+    const lsm_schema *schema;          /**< Layout of the records */
+    void **records;                    /**< Records, owned */
+    uint32_t count;                    /**< Number of records */
+    pthread_mutex_t lock;              /**< Guards building indexes */
+    std::vector<GHashTable *> indexes; /**< Key to record_group for each
+                                            attribute, NULL until used */
+};
+
+static bool set_valid(const record_set *set, const lsm_schema &s) {
+    return LSM_IS_RECORD_SET(set) && set->schema == &s;
+}
+
+static void group_free(gpointer group) { delete (record_group *)group; }
+
+/* Keys point into the records, which outlive the index. */
+static void index_add(GHashTable *index, const char *key, void *record) {
+    if (!key || !*key) {
+        return;
+    }
+
+    record_group *group = (record_group *)g_hash_table_lookup(index, key);
+    if (!group) {
+        group = new record_group();
+        g_hash_table_insert(index, (gpointer)key, group);
+    }
+    /* A string list can hold the same key more than once. */
+    if (group->empty() || group->back() != record) {
+        group->push_back(record);
+    }
+}
+
+static GHashTable *index_build(const record_set *set, const lsm_field &f) {
+    GHashTable *index =
+        g_hash_table_new_full(g_str_hash, g_str_equal, NULL, group_free);
+
+    try {
+        for (uint32_t i = 0; i < set->count; ++i) {
+            void *record = set->records[i];
+            const char *member = (const char *)record + f.offset;
+
+            if (f.kind == LSM_FIELD_STR_LIST) {
+                lsm_string_list *keys = *(lsm_string_list *const *)member;
+
+                for (uint32_t j = 0; j < lsm_string_list_size(keys); ++j) {
+                    index_add(index, lsm_string_list_elem_get(keys, j),
+                              record);
+                }
+            } else {
+                index_add(index, *(const char *const *)member, record);
+            }
+        }
+    } catch (const std::bad_alloc &) {
+        g_hash_table_destroy(index);
+        return NULL;
+    }
+    return index;
+}
+
+static record_set *record_set_alloc(const lsm_schema &s, void **records,
+                                    uint32_t count) {
+    record_set *set = NULL;
+
+    if (count && !records) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!records[i] || *(const uint32_t *)records[i] != s.magic) {
+            return NULL;
+        }
+    }
+
+    set = new (std::nothrow) record_set();
+    if (!set) {
+        return NULL;
+    }
+    try {
+        set->indexes.assign(s.count, NULL);
+    } catch (const std::bad_alloc &) {
+        delete set;
+        return NULL;
+    }
+    pthread_mutex_init(&set->lock, NULL);
+    set->magic = LSM_RECORD_SET_MAGIC;
+    set->schema = &s;
+    set->records = records;
+    set->count = count;
+    return set;
+}
+
+static int record_set_free(record_set *set, const lsm_schema &s) {
+    if (!set_valid(set, s)) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    for (size_t i = 0; i < set->indexes.size(); ++i) {
+        if (set->indexes[i]) {
+            g_hash_table_destroy(set->indexes[i]);
+        }
+    }
+    for (uint32_t i = 0; i < set->count; ++i) {
+        s.record_free(set->records[i]);
+    }
+    free(set->records);
+    pthread_mutex_destroy(&set->lock);
+    set->magic = LSM_DEL_MAGIC(LSM_RECORD_SET_MAGIC);
+    delete set;
+    return LSM_ERR_OK;
+}
+
+static int record_set_records_get(record_set *set, const lsm_schema &s,
+                                  void ***records, uint32_t *count) {
+    if (!set_valid(set, s) || !records || !count) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+
+    *records = set->count ? set->records : NULL;
+    *count = set->count;
+    return LSM_ERR_OK;
+}
+
+static int record_set_find(record_set *set, const lsm_schema &s,
+                           const char *key, const char *value,
+                           void ***records, uint32_t *count) {
+    const lsm_field *f = schema_field(s, key);
+    GHashTable *index = NULL;
+    record_group *group = NULL;
+
+    if (!set_valid(set, s) || !f || !value || !records || !count) {
+        return LSM_ERR_INVALID_ARGUMENT;
+    }
+    *records = NULL;
+    *count = 0;
+
+    /* Built indexes are never changed, looking them up needs no lock. */
+    pthread_mutex_lock(&set->lock);
+    index = set->indexes[f - s.fields];
+    if (!index) {
+        index = index_build(set, *f);
+        set->indexes[f - s.fields] = index;
+    }
+    pthread_mutex_unlock(&set->lock);
+    if (!index) {
+        return LSM_ERR_NO_MEMORY;
+    }
+
+    group = (record_group *)g_hash_table_lookup(index, value);
+    if (group) {
+        *records = &(*group)[0];
+        *count = (uint32_t)group->size();
+    }
+    return LSM_ERR_OK;
+}
+
+static int record_set_find_id(record_set *set, const lsm_schema &s,
+                              const char *id, void **record) {
+    void **records = NULL;
+    uint32_t count = 0;
+    int rc = LSM_ERR_INVALID_ARGUMENT;
+
+    if (record) {
+        rc = record_set_find(set, s, "id", id, &records, &count);
+        *record = count ? records[0] : NULL;
+    }
+    return rc;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates the functions every typed set has.
+ * @param   name    Prefix of the functions, type of the set minus "_set"
+ * @param   type    Type of the records
+ * @param   schema  Schema of the records
+ */
+#define RECORD_SET_FUNCS(name, type, schema)                                   \
+    name##_set *name##_set_alloc(type *records[], uint32_t count) {            \
+        return (name##_set *)record_set_alloc(schema, (void **)records,        \
+                                              count);                          \
+    }                                                                          \
+                                                                               \
+    int name##_set_free(name##_set *set) {                                     \
+        return record_set_free((record_set *)set, schema);                     \
+    }                                                                          \
+                                                                               \
+    int name##_set_records_get(name##_set *set, type **records[],              \
+                               uint32_t *count) {                              \
+        return record_set_records_get((record_set *)set, schema,               \
+                                      (void ***)records, count);               \
+    }                                                                          \
+                                                                               \
+    int name##_set_find_id(name##_set *set, const char *id, type **record) {   \
+        return record_set_find_id((record_set *)set, schema, id,               \
+                                  (void **)record);                            \
+    }
+
+/**
+ * Creates the lookup of records by an attribute.
+ * @param   name    Prefix of the function, type of the set minus "_set"
+ * @param   type    Type of the records
+ * @param   schema  Schema of the records
+ * @param   key     Attribute, as named in the schema
+ */
+#define RECORD_SET_FIND_FUNC(name, type, schema, key)                          \
+    int name##_set_find_##key(name##_set *set, const char *key,                \
+                              type **records[], uint32_t *count) {             \
+        return record_set_find((record_set *)set, schema, #key, key,           \
+                               (void ***)records, count);                      \
+    }
+
+RECORD_SET_FUNCS(lsm_volume, lsm_volume, VOLUME_SCHEMA)
+RECORD_SET_FIND_FUNC(lsm_volume, lsm_volume, VOLUME_SCHEMA, pool_id)
+RECORD_SET_FIND_FUNC(lsm_volume, lsm_volume, VOLUME_SCHEMA, system_id)
+RECORD_SET_FIND_FUNC(lsm_volume, lsm_volume, VOLUME_SCHEMA, vpd83)
+
+RECORD_SET_FUNCS(lsm_disk, lsm_disk, DISK_SCHEMA)
+RECORD_SET_FIND_FUNC(lsm_disk, lsm_disk, DISK_SCHEMA, system_id)
+RECORD_SET_FIND_FUNC(lsm_disk, lsm_disk, DISK_SCHEMA, vpd83)
+
+RECORD_SET_FUNCS(lsm_pool, lsm_pool, POOL_SCHEMA)
+RECORD_SET_FIND_FUNC(lsm_pool, lsm_pool, POOL_SCHEMA, system_id)
+
+RECORD_SET_FUNCS(lsm_access_group, lsm_access_group, ACCESS_GROUP_SCHEMA)
+RECORD_SET_FIND_FUNC(lsm_access_group, lsm_access_group, ACCESS_GROUP_SCHEMA,
+                     system_id)
+
+RECORD_SET_FUNCS(lsm_fs, lsm_fs, FS_SCHEMA)
+RECORD_SET_FIND_FUNC(lsm_fs, lsm_fs, FS_SCHEMA, pool_id)
+RECORD_SET_FIND_FUNC(lsm_fs, lsm_fs, FS_SCHEMA, system_id)
+
+/* Access groups hold their WWPNs converted, see standardize_init_list(). */
+int lsm_access_group_set_find_init_id(lsm_access_group_set *set,
+                                      const char *init_id,
+                                      lsm_access_group **groups[],
+                                      uint32_t *count) {
+    char *wwpn = NULL;
+    int rc = LSM_ERR_OK;
+
+    if (init_id && LSM_ERR_OK == wwpn_validate(init_id)) {
+        wwpn = wwpn_convert(init_id);
+        if (!wwpn) {
+            return LSM_ERR_NO_MEMORY;
+        }
+    }
+    rc = record_set_find((record_set *)set, ACCESS_GROUP_SCHEMA, "init_ids",
+                         wwpn ? wwpn : init_id, (void ***)groups, count);
+    free(wwpn);
+    return rc;
+}
+
+#ifdef __cplusplus
+}
+#endif
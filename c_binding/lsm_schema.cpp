@@ -0,0 +1,846 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "lsm_schema.hpp"
+#include "libstoragemgmt/libstoragemgmt.h"
+#include "libstoragemgmt/libstoragemgmt_plug_interface.h"
+#include "lsm_convert.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSMN_HEADER
+#define JSMN_PARENT_LINKS
+#include "jsmn.h"
+
+#define FIELD(type, member, key, kind, flags, absent)                          \
+    { key, kind, flags, offsetof(type, member), absent }
+
+#define RECORD_FREE(type)                                                      \
+    static int type##_free(void *record) {                                     \
+        return type##_record_free((type *)record);                             \
+    }
+
+#define SCHEMA(name, type, class_name, magic, fields, finish)                  \
+    const lsm_schema name = {class_name,                                       \
+                             magic,                                            \
+                             sizeof(type),                                     \
+                             fields,                                           \
+                             sizeof(fields) / sizeof(fields[0]),               \
+                             type##_free,                                      \
+                             finish}
+
+RECORD_FREE(lsm_system)
+RECORD_FREE(lsm_pool)
+RECORD_FREE(lsm_volume)
+RECORD_FREE(lsm_disk)
+RECORD_FREE(lsm_access_group)
+RECORD_FREE(lsm_fs)
+RECORD_FREE(lsm_fs_ss)
+RECORD_FREE(lsm_nfs_export)
+RECORD_FREE(lsm_target_port)
+RECORD_FREE(lsm_battery)
+
+static void *volume_finish(void *record) {
+    lsm_volume *v = (lsm_volume *)record;
+
+    if (v->vpd83 && LSM_ERR_OK != lsm_volume_vpd83_verify(v->vpd83)) {
+        lsm_volume_record_free(v);
+        return NULL;
+    }
+    return v;
+}
+
+/* Allocation puts the initiators into their standard form. */
+static void *access_group_finish(void *record) {
+    lsm_access_group *ag = (lsm_access_group *)record;
+    lsm_access_group *rc = lsm_access_group_record_copy(ag);
+
+    lsm_access_group_record_free(ag);
+    return rc;
+}
+
+static const lsm_field system_fields[] = {
+    FIELD(lsm_system, id, "id", LSM_FIELD_STR, LSM_FIELD_ALWAYS, 0),
+    FIELD(lsm_system, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_system, status, "status", LSM_FIELD_U32, 0,
+          LSM_SYSTEM_STATUS_UNKNOWN),
+    FIELD(lsm_system, status_info, "status_info", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_system, plugin_data, "plugin_data", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0),
+    FIELD(lsm_system, fw_version, "fw_version", LSM_FIELD_STR,
+          LSM_FIELD_OPTIONAL, 0),
+    FIELD(lsm_system, mode, "mode", LSM_FIELD_I32, LSM_FIELD_OPTIONAL,
+          LSM_SYSTEM_MODE_NO_SUPPORT),
+    FIELD(lsm_system, read_cache_pct, "read_cache_pct", LSM_FIELD_I32,
+          LSM_FIELD_OPTIONAL, LSM_SYSTEM_READ_CACHE_PCT_NO_SUPPORT)};
+
+static const lsm_field pool_fields[] = {
+    FIELD(lsm_pool, id, "id", LSM_FIELD_STR, LSM_FIELD_ALWAYS, 0),
+    FIELD(lsm_pool, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_pool, element_type, "element_type", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_pool, unsupported_actions, "unsupported_actions", LSM_FIELD_U64,
+          0, 0),
+    FIELD(lsm_pool, total_space, "total_space", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_pool, free_space, "free_space", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_pool, status, "status", LSM_FIELD_U64, 0,
+          LSM_POOL_STATUS_UNKNOWN),
+    FIELD(lsm_pool, status_info, "status_info", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_pool, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_pool, plugin_data, "plugin_data", LSM_FIELD_STR, LSM_FIELD_NULL,
+          0)};
+
+static const lsm_field volume_fields[] = {
+    FIELD(lsm_volume, id, "id", LSM_FIELD_STR, LSM_FIELD_ALWAYS, 0),
+    FIELD(lsm_volume, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_volume, vpd83, "vpd83", LSM_FIELD_STR, LSM_FIELD_NULL, 0),
+    FIELD(lsm_volume, block_size, "block_size", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_volume, number_of_blocks, "num_of_blocks", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_volume, admin_state, "admin_state", LSM_FIELD_U32, 0,
+          LSM_VOLUME_ADMIN_STATE_ENABLED),
+    FIELD(lsm_volume, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_volume, pool_id, "pool_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_volume, plugin_data, "plugin_data", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0)};
+
+static const lsm_field disk_fields[] = {
+    FIELD(lsm_disk, id, "id", LSM_FIELD_STR, LSM_FIELD_ALWAYS, 0),
+    FIELD(lsm_disk, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_disk, type, "disk_type", LSM_FIELD_I32, 0,
+          LSM_DISK_TYPE_UNKNOWN),
+    FIELD(lsm_disk, block_size, "block_size", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_disk, number_of_blocks, "num_of_blocks", LSM_FIELD_U64, 0, 0),
+    FIELD(lsm_disk, status, "status", LSM_FIELD_U64, 0,
+          LSM_DISK_STATUS_UNKNOWN),
+    FIELD(lsm_disk, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_disk, plugin_data, "plugin_data", LSM_FIELD_STR, LSM_FIELD_NULL,
+          0),
+    FIELD(lsm_disk, location, "location", LSM_FIELD_STR, LSM_FIELD_OPTIONAL,
+          0),
+    FIELD(lsm_disk, rpm, "rpm", LSM_FIELD_I32, LSM_FIELD_OPTIONAL,
+          LSM_DISK_RPM_NO_SUPPORT),
+    FIELD(lsm_disk, link_type, "link_type", LSM_FIELD_I32, LSM_FIELD_OPTIONAL,
+          LSM_DISK_LINK_TYPE_NO_SUPPORT),
+    FIELD(lsm_disk, vpd83, "vpd83", LSM_FIELD_STR, LSM_FIELD_OPTIONAL, 0)};
+
+static const lsm_field access_group_fields[] = {
+    FIELD(lsm_access_group, id, "id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_access_group, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_access_group, initiators, "init_ids", LSM_FIELD_STR_LIST, 0, 0),
+    FIELD(lsm_access_group, init_type, "init_type", LSM_FIELD_I32,
+          LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_access_group, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_access_group, plugin_data, "plugin_data", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0)};
+
+static const lsm_field fs_fields[] = {
+    FIELD(lsm_fs, id, "id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_fs, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_fs, total_space, "total_space", LSM_FIELD_U64,
+          LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_fs, free_space, "free_space", LSM_FIELD_U64, LSM_FIELD_REQUIRED,
+          0),
+    FIELD(lsm_fs, pool_id, "pool_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_fs, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_fs, plugin_data, "plugin_data", LSM_FIELD_STR, LSM_FIELD_NULL,
+          0)};
+
+static const lsm_field ss_fields[] = {
+    FIELD(lsm_fs_ss, id, "id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_fs_ss, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_fs_ss, time_stamp, "ts", LSM_FIELD_U64, LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_fs_ss, plugin_data, "plugin_data", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0)};
+
+static const lsm_field nfs_export_fields[] = {
+    FIELD(lsm_nfs_export, id, "id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_nfs_export, fs_id, "fs_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_nfs_export, export_path, "export_path", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0),
+    FIELD(lsm_nfs_export, auth_type, "auth", LSM_FIELD_STR, LSM_FIELD_NULL, 0),
+    FIELD(lsm_nfs_export, root, "root", LSM_FIELD_STR_LIST, 0, 0),
+    FIELD(lsm_nfs_export, read_write, "rw", LSM_FIELD_STR_LIST, 0, 0),
+    FIELD(lsm_nfs_export, read_only, "ro", LSM_FIELD_STR_LIST, 0, 0),
+    FIELD(lsm_nfs_export, anon_uid, "anonuid", LSM_FIELD_ANON_ID,
+          LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_nfs_export, anon_gid, "anongid", LSM_FIELD_ANON_ID,
+          LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_nfs_export, options, "options", LSM_FIELD_STR, LSM_FIELD_NULL,
+          0),
+    FIELD(lsm_nfs_export, plugin_data, "plugin_data", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0)};
+
+static const lsm_field target_port_fields[] = {
+    FIELD(lsm_target_port, id, "id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_target_port, type, "port_type", LSM_FIELD_I32,
+          LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_target_port, service_address, "service_address", LSM_FIELD_STR,
+          0, 0),
+    FIELD(lsm_target_port, network_address, "network_address", LSM_FIELD_STR,
+          0, 0),
+    FIELD(lsm_target_port, physical_address, "physical_address",
+          LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_target_port, physical_name, "physical_name", LSM_FIELD_STR, 0,
+          0),
+    FIELD(lsm_target_port, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_target_port, plugin_data, "plugin_data", LSM_FIELD_STR,
+          LSM_FIELD_NULL, 0)};
+
+static const lsm_field battery_fields[] = {
+    FIELD(lsm_battery, id, "id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_battery, name, "name", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_battery, type, "type", LSM_FIELD_I32, LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_battery, status, "status", LSM_FIELD_U64, LSM_FIELD_REQUIRED, 0),
+    FIELD(lsm_battery, system_id, "system_id", LSM_FIELD_STR, 0, 0),
+    FIELD(lsm_battery, plugin_data, "plugin_data", LSM_FIELD_STR, 0, 0)};
+
+SCHEMA(SYSTEM_SCHEMA, lsm_system, CLASS_NAME_SYSTEM, LSM_SYSTEM_MAGIC,
+       system_fields, NULL);
+SCHEMA(POOL_SCHEMA, lsm_pool, CLASS_NAME_POOL, LSM_POOL_MAGIC, pool_fields,
+       NULL);
+SCHEMA(VOLUME_SCHEMA, lsm_volume, CLASS_NAME_VOLUME, LSM_VOL_MAGIC,
+       volume_fields, volume_finish);
+SCHEMA(DISK_SCHEMA, lsm_disk, CLASS_NAME_DISK, LSM_DISK_MAGIC, disk_fields,
+       NULL);
+SCHEMA(ACCESS_GROUP_SCHEMA, lsm_access_group, CLASS_NAME_ACCESS_GROUP,
+       LSM_ACCESS_GROUP_MAGIC, access_group_fields, access_group_finish);
+SCHEMA(FS_SCHEMA, lsm_fs, CLASS_NAME_FILE_SYSTEM, LSM_FS_MAGIC, fs_fields,
+       NULL);
+SCHEMA(SS_SCHEMA, lsm_fs_ss, CLASS_NAME_FS_SNAPSHOT, LSM_SS_MAGIC, ss_fields,
+       NULL);
+SCHEMA(NFS_EXPORT_SCHEMA, lsm_nfs_export, CLASS_NAME_FS_EXPORT,
+       LSM_NFS_EXPORT_MAGIC, nfs_export_fields, NULL);
+SCHEMA(TARGET_PORT_SCHEMA, lsm_target_port, CLASS_NAME_TARGET_PORT,
+       LSM_TARGET_PORT_MAGIC, target_port_fields, NULL);
+SCHEMA(BATTERY_SCHEMA, lsm_battery, CLASS_NAME_BATTERY, LSM_BATTERY_MAGIC,
+       battery_fields, NULL);
+
+template <class T> static T &member(void *record, const lsm_field &f) {
+    return *(T *)((char *)record + f.offset);
+}
+
+template <class T>
+static const T &member(const void *record, const lsm_field &f) {
+    return *(const T *)((const char *)record + f.offset);
+}
+
+static bool record_valid(const lsm_schema &s, const void *record) {
+    return record && *(const uint32_t *)record == s.magic;
+}
+
+static int field_index(const lsm_schema &s, const char *key, size_t len) {
+    for (size_t i = 0; i < s.count; ++i) {
+        if (strlen(s.fields[i].key) == len &&
+            memcmp(s.fields[i].key, key, len) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool schema_has_field(const lsm_schema &s, const char *key) {
+    return field_index(s, key, strlen(key)) >= 0;
+}
+
+const lsm_field *schema_field(const lsm_schema &s, const char *key) {
+    int i = field_index(s, key, strlen(key));
+
+    return i < 0 ? NULL : &s.fields[i];
+}
+
+static bool field_wanted(const lsm_field &f,
+                         const std::set<std::string> *fields) {
+    return fields == NULL || (f.flags & LSM_FIELD_ALWAYS) ||
+           fields->count(f.key) != 0;
+}
+
+/* Optional attributes are left out while they hold their absent value. */
+static bool field_present(const lsm_field &f, const void *record) {
+    if (!(f.flags & LSM_FIELD_OPTIONAL)) {
+        return true;
+    }
+
+    switch (f.kind) {
+    case LSM_FIELD_STR:
+        return member<const char *>(record, f) != NULL;
+    case LSM_FIELD_U64:
+    case LSM_FIELD_ANON_ID:
+        return member<uint64_t>(record, f) != (uint64_t)f.absent;
+    case LSM_FIELD_U32:
+        return member<uint32_t>(record, f) != (uint32_t)f.absent;
+    case LSM_FIELD_I32:
+        return member<int32_t>(record, f) != (int32_t)f.absent;
+    default:
+        return true;
+    }
+}
+
+static const char *number_text(const lsm_field &f, const void *record,
+                               char *buf, size_t len) {
+    switch (f.kind) {
+    case LSM_FIELD_ANON_ID:
+        if (member<uint64_t>(record, f) == UINT64_MAX) {
+            return "-1";
+        }
+        if (member<uint64_t>(record, f) == UINT64_MAX - 1) {
+            return "-2";
+        }
+        /* Fall through */
+    case LSM_FIELD_U64:
+        snprintf(buf, len, "%" PRIu64, member<uint64_t>(record, f));
+        break;
+    case LSM_FIELD_U32:
+        snprintf(buf, len, "%" PRIu32, member<uint32_t>(record, f));
+        break;
+    default:
+        snprintf(buf, len, "%" PRId32, member<int32_t>(record, f));
+        break;
+    }
+    return buf;
+}
+
+Value schema_to_value(const lsm_schema &s, const void *record,
+                      const std::set<std::string> *fields) {
+    if (!record_valid(s, record)) {
+        return Value();
+    }
+
+    std::map<std::string, Value> v;
+    char buf[32];
+
+    v["class"] = Value(s.class_name);
+    for (size_t i = 0; i < s.count; ++i) {
+        const lsm_field &f = s.fields[i];
+
+        if (!field_wanted(f, fields) || !field_present(f, record)) {
+            continue;
+        }
+        switch (f.kind) {
+        case LSM_FIELD_STR:
+            v[f.key] = Value(member<const char *>(record, f));
+            break;
+        case LSM_FIELD_STR_LIST:
+            v[f.key] =
+                string_list_to_value(member<lsm_string_list *>(record, f));
+            break;
+        default:
+            v[f.key] = Value(Value::numeric_t,
+                             number_text(f, record, buf, sizeof(buf)));
+            break;
+        }
+    }
+    return Value(v);
+}
+
+/*
+ * Strings go out as they are, the same as Value::serialize() does, so both
+ * converters produce the same JSON for a record.
+ */
+static void string_encode(std::string &out, const char *str) {
+    if (str) {
+        out += '"';
+        out += str;
+        out += '"';
+    } else {
+        out += "null";
+    }
+}
+
+static void json_encode(std::string &out, const lsm_schema &s,
+                        const void *record,
+                        const std::set<std::string> *fields) {
+    char buf[32];
+
+    out += "{\"class\": ";
+    string_encode(out, s.class_name);
+    for (size_t i = 0; i < s.count; ++i) {
+        const lsm_field &f = s.fields[i];
+
+        if (!field_wanted(f, fields) || !field_present(f, record)) {
+            continue;
+        }
+
+        out += ", \"";
+        out += f.key;
+        out += "\": ";
+        switch (f.kind) {
+        case LSM_FIELD_STR:
+            string_encode(out, member<const char *>(record, f));
+            break;
+        case LSM_FIELD_STR_LIST: {
+            lsm_string_list *sl = member<lsm_string_list *>(record, f);
+            uint32_t size = lsm_string_list_size(sl);
+
+            out += '[';
+            for (uint32_t e = 0; e < size; ++e) {
+                if (e) {
+                    out += ", ";
+                }
+                string_encode(out, lsm_string_list_elem_get(sl, e));
+            }
+            out += ']';
+            break;
+        }
+        default:
+            out += number_text(f, record, buf, sizeof(buf));
+            break;
+        }
+    }
+    out += '}';
+}
+
+/* Negative anonymous ids and int32_t go out as CBOR negative integers. */
+static void cbor_number(std::string &out, const lsm_field &f,
+                        const void *record) {
+    switch (f.kind) {
+    case LSM_FIELD_ANON_ID:
+        if (member<uint64_t>(record, f) >= UINT64_MAX - 1) {
+            Payload::cborHead(out, 1, UINT64_MAX - member<uint64_t>(record, f));
+            return;
+        }
+        /* Fall through */
+    case LSM_FIELD_U64:
+        Payload::cborHead(out, 0, member<uint64_t>(record, f));
+        break;
+    case LSM_FIELD_U32:
+        Payload::cborHead(out, 0, member<uint32_t>(record, f));
+        break;
+    default: {
+        int32_t n = member<int32_t>(record, f);
+
+        if (n < 0) {
+            Payload::cborHead(out, 1, (uint64_t)(-1 - (int64_t)n));
+        } else {
+            Payload::cborHead(out, 0, n);
+        }
+        break;
+    }
+    }
+}
+
+static void cbor_encode(std::string &out, const lsm_schema &s,
+                        const void *record,
+                        const std::set<std::string> *fields) {
+    uint64_t size = 1;
+
+    for (size_t i = 0; i < s.count; ++i) {
+        if (field_wanted(s.fields[i], fields) &&
+            field_present(s.fields[i], record)) {
+            ++size;
+        }
+    }
+
+    Payload::cborHead(out, 5, size);
+    Payload::cborString(out, "class");
+    Payload::cborString(out, s.class_name);
+    for (size_t i = 0; i < s.count; ++i) {
+        const lsm_field &f = s.fields[i];
+
+        if (!field_wanted(f, fields) || !field_present(f, record)) {
+            continue;
+        }
+
+        Payload::cborString(out, f.key);
+        switch (f.kind) {
+        case LSM_FIELD_STR:
+            Payload::cborString(out, member<const char *>(record, f));
+            break;
+        case LSM_FIELD_STR_LIST: {
+            lsm_string_list *sl = member<lsm_string_list *>(record, f);
+            uint32_t size = lsm_string_list_size(sl);
+
+            Payload::cborHead(out, 4, size);
+            for (uint32_t e = 0; e < size; ++e) {
+                Payload::cborString(out, lsm_string_list_elem_get(sl, e));
+            }
+            break;
+        }
+        default:
+            cbor_number(out, f, record);
+            break;
+        }
+    }
+}
+
+void schema_encode(std::string &out, const lsm_schema &s, const void *record,
+                   const std::set<std::string> *fields, Payload::encoding e) {
+    if (!record_valid(s, record)) {
+        out += (Payload::CBOR == e) ? "\xf6" : "null";
+    } else if (Payload::CBOR == e) {
+        cbor_encode(out, s, record, fields);
+    } else {
+        json_encode(out, s, record, fields);
+    }
+}
+
+void schema_array_encode(std::string &out, const lsm_schema &s,
+                         void *const *records, uint32_t count,
+                         const std::set<std::string> *fields,
+                         Payload::encoding e) {
+    if (Payload::CBOR == e) {
+        Payload::cborHead(out, 4, count);
+        for (uint32_t i = 0; i < count; ++i) {
+            schema_encode(out, s, records[i], fields, e);
+        }
+        return;
+    }
+
+    out += '[';
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i) {
+            out += ", ";
+        }
+        schema_encode(out, s, records[i], fields, e);
+    }
+    out += ']';
+}
+
+static void *record_new(const lsm_schema &s) {
+    void *record = calloc(1, s.size);
+    if (record) {
+        *(uint32_t *)record = s.magic;
+    }
+    return record;
+}
+
+static void string_list_set(const lsm_field &f, void *record,
+                            lsm_string_list *sl) {
+    lsm_string_list *&member_sl = member<lsm_string_list *>(record, f);
+
+    if (member_sl) {
+        lsm_string_list_free(member_sl);
+    }
+    member_sl = sl;
+}
+
+/**
+ * Sets an attribute from a JSON scalar, throws ValueException if it is of
+ * the wrong type.
+ * @param f         Attribute
+ * @param record    Record
+ * @param type      Type of the scalar
+ * @param text      Text of the scalar, strings without quotes
+ * @param len       Length of text
+ * @return false on allocation failure
+ */
+static bool field_set(const lsm_field &f, void *record, Value::value_type type,
+                      const char *text, size_t len) {
+    if (LSM_FIELD_STR == f.kind) {
+        char *&str = member<char *>(record, f);
+
+        free(str);
+        str = NULL;
+        if (Value::null_t == type || ((f.flags & LSM_FIELD_OPTIONAL) &&
+                                      Value::string_t == type && len == 0)) {
+            if (f.flags & (LSM_FIELD_NULL | LSM_FIELD_OPTIONAL)) {
+                return true;
+            }
+            text = "";
+            len = 0;
+        } else if (Value::string_t != type) {
+            throw ValueException(std::string(f.key) + ": not a string");
+        }
+        str = strndup(text, len);
+        return str != NULL;
+    }
+
+    if (Value::numeric_t != type || LSM_FIELD_STR_LIST == f.kind) {
+        throw ValueException(std::string(f.key) + ": not numeric");
+    }
+
+    char buf[32];
+    int converted = 0;
+
+    if (len >= sizeof(buf)) {
+        throw ValueException(std::string(f.key) + ": not an integer");
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+
+    switch (f.kind) {
+    case LSM_FIELD_U64:
+    case LSM_FIELD_ANON_ID: {
+        unsigned long long n;
+        converted = sscanf(buf, "%llu", &n);
+        member<uint64_t>(record, f) = n;
+        break;
+    }
+    case LSM_FIELD_U32: {
+        unsigned int n;
+        converted = sscanf(buf, "%u", &n);
+        member<uint32_t>(record, f) = n;
+        break;
+    }
+    default: {
+        int n;
+        converted = sscanf(buf, "%d", &n);
+        member<int32_t>(record, f) = n;
+        break;
+    }
+    }
+    if (converted != 1) {
+        throw ValueException(std::string(f.key) + ": not an integer");
+    }
+    return true;
+}
+
+/**
+ * Fills in the attributes missing from the JSON and checks the record.
+ * @param s         Schema of the record
+ * @param record    Record, freed on failure
+ * @param seen      Bit mask of the attributes in the JSON
+ * @param ok        false if setting an attribute failed already
+ * @return Record, NULL on failure
+ */
+static void *record_finish(const lsm_schema &s, void *record, uint32_t seen,
+                           bool ok) {
+    try {
+        for (size_t i = 0; ok && i < s.count; ++i) {
+            const lsm_field &f = s.fields[i];
+
+            if (seen & (1u << i)) {
+                continue;
+            }
+            if ((f.flags & LSM_FIELD_REQUIRED) ||
+                LSM_FIELD_STR_LIST == f.kind) {
+                throw ValueException(std::string(s.class_name) +
+                                     ": missing " + f.key);
+            }
+            switch (f.kind) {
+            case LSM_FIELD_STR:
+                ok = field_set(f, record, Value::null_t, NULL, 0);
+                break;
+            case LSM_FIELD_U64:
+            case LSM_FIELD_ANON_ID:
+                member<uint64_t>(record, f) = (uint64_t)f.absent;
+                break;
+            case LSM_FIELD_U32:
+                member<uint32_t>(record, f) = (uint32_t)f.absent;
+                break;
+            default:
+                member<int32_t>(record, f) = (int32_t)f.absent;
+                break;
+            }
+        }
+    } catch (const ValueException &ve) {
+        s.record_free(record);
+        throw;
+    }
+
+    if (!ok) {
+        s.record_free(record);
+        return NULL;
+    }
+    return s.finish ? s.finish(record) : record;
+}
+
+void *schema_from_value(const lsm_schema &s, Value &v) {
+    if (!is_expected_object(v, s.class_name)) {
+        throw ValueException(std::string("Not a ") + s.class_name);
+    }
+
+    void *record = record_new(s);
+    if (!record) {
+        return NULL;
+    }
+
+    uint32_t count = v.memberCount();
+    uint32_t seen = 0;
+    bool ok = true;
+
+    try {
+        for (uint32_t m = 0; ok && m < count; ++m) {
+            const char *key = v.memberKey(m);
+            int i = field_index(s, key, strlen(key));
+            if (i < 0) {
+                continue;
+            }
+
+            const lsm_field &f = s.fields[i];
+            Value &fv = v.memberValue(m);
+
+            seen |= 1u << i;
+            if (LSM_FIELD_STR_LIST == f.kind) {
+                lsm_string_list *sl = value_to_string_list(fv);
+                string_list_set(f, record, sl);
+                ok = sl != NULL;
+            } else {
+                std::string text = Value::string_t == fv.valueType()
+                                       ? fv.asString()
+                                       : fv.serialize();
+                ok = field_set(f, record, fv.valueType(), text.c_str(),
+                               text.size());
+            }
+        }
+    } catch (const ValueException &ve) {
+        s.record_free(record);
+        throw;
+    }
+    return record_finish(s, record, seen, ok);
+}
+
+static Value::value_type token_type(const Message &m, int index) {
+    const jsmntok_t &t = m.tok[index];
+
+    switch (t.type) {
+    case JSMN_STRING:
+        return Value::string_t;
+    case JSMN_PRIMITIVE:
+        switch (m.text[t.start]) {
+        case 'n':
+            return Value::null_t;
+        case 't':
+        case 'f':
+            return Value::boolean_t;
+        default:
+            return Value::numeric_t;
+        }
+    case JSMN_ARRAY:
+        return Value::array_t;
+    default:
+        return Value::object_t;
+    }
+}
+
+static lsm_string_list *token_to_string_list(const Message &m, int index) {
+    if (Value::array_t != token_type(m, index)) {
+        throw ValueException("Not an array of strings");
+    }
+
+    lsm_string_list *sl = lsm_string_list_alloc(m.tok[index].size);
+    int k = index + 1;
+
+    for (int i = 0; sl && i < m.tok[index].size; ++i) {
+        if (k >= m.count || Value::string_t != token_type(m, k)) {
+            lsm_string_list_free(sl);
+            throw ValueException("Not an array of strings");
+        }
+
+        std::string e(m.text, m.tok[k].start, m.tok[k].end - m.tok[k].start);
+        if (LSM_ERR_OK != lsm_string_list_elem_set(sl, i, e.c_str())) {
+            lsm_string_list_free(sl);
+            sl = NULL;
+        }
+        k = m.next(k);
+    }
+    return sl;
+}
+
+void *schema_decode(const lsm_schema &s, const Message &m, int index) {
+    int c = m.member(index, "class");
+    if (c < 0 || Value::string_t != token_type(m, c) ||
+        m.text.compare(m.tok[c].start, m.tok[c].end - m.tok[c].start,
+                       s.class_name) != 0) {
+        throw ValueException(std::string("Not a ") + s.class_name);
+    }
+
+    void *record = record_new(s);
+    if (!record) {
+        return NULL;
+    }
+
+    uint32_t seen = 0;
+    bool ok = true;
+    int k = index + 1;
+
+    try {
+        for (int n = 0; ok && n < m.tok[index].size; ++n) {
+            int v = k + 1;
+            if (v >= m.count) {
+                throw ValueException("Truncated object");
+            }
+
+            const jsmntok_t &key = m.tok[k];
+            int i =
+                field_index(s, m.text.c_str() + key.start, key.end - key.start);
+            if (i >= 0) {
+                const lsm_field &f = s.fields[i];
+
+                seen |= 1u << i;
+                if (LSM_FIELD_STR_LIST == f.kind) {
+                    lsm_string_list *sl = token_to_string_list(m, v);
+                    string_list_set(f, record, sl);
+                    ok = sl != NULL;
+                } else {
+                    ok = field_set(f, record, token_type(m, v),
+                                   m.text.c_str() + m.tok[v].start,
+                                   m.tok[v].end - m.tok[v].start);
+                }
+            }
+            k = m.next(v);
+        }
+    } catch (const ValueException &ve) {
+        s.record_free(record);
+        throw;
+    }
+    return record_finish(s, record, seen, ok);
+}
+
+static void records_free(const lsm_schema &s, void **records,
+                         uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (records[i]) {
+            s.record_free(records[i]);
+        }
+    }
+    free(records);
+}
+
+int schema_array_decode(const lsm_schema &s, const Message &m, int index,
+                        void **records[], uint32_t *count) {
+    *records = NULL;
+    *count = 0;
+
+    if (index < 0 || index >= m.count ||
+        Value::array_t != token_type(m, index)) {
+        throw ValueException("Not an array");
+    }
+
+    uint32_t size = m.tok[index].size;
+    if (!size) {
+        return LSM_ERR_OK;
+    }
+
+    void **r = (void **)calloc(size, sizeof(void *));
+    if (!r) {
+        return LSM_ERR_NO_MEMORY;
+    }
+
+    int k = index + 1;
+    for (uint32_t i = 0; i < size; ++i) {
+        try {
+            if (k >= m.count) {
+                throw ValueException("Truncated array");
+            }
+            r[i] = schema_decode(s, m, k);
+        } catch (const ValueException &ve) {
+            records_free(s, r, i);
+            throw;
+        }
+        if (!r[i]) {
+            records_free(s, r, i);
+            return LSM_ERR_NO_MEMORY;
+        }
+        k = m.next(k);
+    }
+
+    *records = r;
+    *count = size;
+    return LSM_ERR_OK;
+}
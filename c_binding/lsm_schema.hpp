@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LSM_SCHEMA_HPP
+#define LSM_SCHEMA_HPP
+
+#include "lsm_datatypes.hpp"
+#include "lsm_ipc.hpp"
+#include <set>
+#include <stddef.h>
+#include <string>
+
+/**
+ * How an attribute is held in its record and carried in JSON.
+ */
+enum lsm_field_kind {
+    LSM_FIELD_STR,      /**< char *, JSON string or null */
+    LSM_FIELD_U64,      /**< uint64_t */
+    LSM_FIELD_U32,      /**< uint32_t */
+    LSM_FIELD_I32,      /**< int32_t or enumeration */
+    LSM_FIELD_STR_LIST, /**< lsm_string_list *, JSON array of strings */
+    LSM_FIELD_ANON_ID   /**< uint64_t, UINT64_MAX and one less go as -1, -2 */
+};
+
+/*
+ * Attribute flags:
+ *  ALWAYS      Sent no matter which attributes the client asked for.
+ *  NULL        String reads as NULL when null or left out, else as "".
+ *  OPTIONAL    Left out while NULL or at its absent value, "" reads as NULL.
+ *  REQUIRED    Record is not valid without it.
+ */
+#define LSM_FIELD_ALWAYS   0x01
+#define LSM_FIELD_NULL     0x02
+#define LSM_FIELD_OPTIONAL 0x04
+#define LSM_FIELD_REQUIRED 0x08
+
+/**
+ * One attribute of a record.
+ */
+struct LSM_DLL_LOCAL lsm_field {
+    const char *key;     /**< JSON key */
+    lsm_field_kind kind; /**< Type of the member */
+    int flags;           /**< LSM_FIELD_XXX flags */
+    size_t offset;       /**< Offset of the member in the record */
+    int64_t absent;      /**< Numeric value when not in JSON */
+};
+
+/**
+ * Layout of a record, drives both the Value and the direct JSON converters.
+ */
+struct LSM_DLL_LOCAL lsm_schema {
+    const char *class_name;     /**< "class" in JSON */
+    uint32_t magic;             /**< Magic of the record */
+    size_t size;                /**< Size of the record */
+    const lsm_field *fields;    /**< Attributes */
+    size_t count;               /**< Number of attributes */
+    int (*record_free)(void *); /**< Frees a record */
+    /**
+     * Checks a decoded record, may replace it. NULL for none.
+     * @return Record, NULL when it was freed for being invalid.
+     */
+    void *(*finish)(void *);
+};
+
+extern const lsm_schema LSM_DLL_LOCAL SYSTEM_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL POOL_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL VOLUME_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL DISK_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL ACCESS_GROUP_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL FS_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL SS_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL NFS_EXPORT_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL TARGET_PORT_SCHEMA;
+extern const lsm_schema LSM_DLL_LOCAL BATTERY_SCHEMA;
+
+/**
+ * Checks whether a record has an attribute
+ * @param s     Schema of the record
+ * @param key   Attribute name
+ * @return true if it has
+ */
+bool LSM_DLL_LOCAL schema_has_field(const lsm_schema &s, const char *key);
+
+/**
+ * Looks an attribute of a record up
+ * @param s     Schema of the record
+ * @param key   Attribute name
+ * @return Attribute, NULL if the record has none of this name
+ */
+const lsm_field LSM_DLL_LOCAL *schema_field(const lsm_schema &s,
+                                            const char *key);
+
+/**
+ * Converts a record to a Value
+ * @param s         Schema of the record
+ * @param record    Record to convert
+ * @param fields    Attributes to include besides the ones always sent, NULL
+ *                  for all of them
+ * @return Value, null one if record is not valid
+ */
+Value LSM_DLL_LOCAL schema_to_value(const lsm_schema &s, const void *record,
+                                    const std::set<std::string> *fields);
+
+/**
+ * Converts a Value to a record
+ * @param s     Schema of the record
+ * @param v     Value to convert, throws ValueException if it is not one
+ * @return Record, NULL on allocation failure or invalid attribute
+ */
+void LSM_DLL_LOCAL *schema_from_value(const lsm_schema &s, Value &v);
+
+/**
+ * Appends the JSON or CBOR of a record
+ * @param out       String to append to
+ * @param s         Schema of the record
+ * @param record    Record to encode
+ * @param fields    Attributes to include besides the ones always sent, NULL
+ *                  for all of them
+ * @param e         Encoding
+ */
+void LSM_DLL_LOCAL schema_encode(std::string &out, const lsm_schema &s,
+                                 const void *record,
+                                 const std::set<std::string> *fields,
+                                 Payload::encoding e = Payload::JSON);
+
+/**
+ * Appends the JSON or CBOR array of records
+ * @param out       String to append to
+ * @param s         Schema of the records
+ * @param records   Records to encode
+ * @param count     Number of records
+ * @param fields    Attributes to include besides the ones always sent, NULL
+ *                  for all of them
+ * @param e         Encoding
+ */
+void LSM_DLL_LOCAL schema_array_encode(std::string &out, const lsm_schema &s,
+                                       void *const *records, uint32_t count,
+                                       const std::set<std::string> *fields,
+                                       Payload::encoding e = Payload::JSON);
+
+/**
+ * Decodes a record from the tokens of a message
+ * @param s     Schema of the record
+ * @param m     Message
+ * @param index Token of the record, throws ValueException if it is not one
+ * @return Record, NULL on allocation failure or invalid attribute
+ */
+void LSM_DLL_LOCAL *schema_decode(const lsm_schema &s, const Message &m,
+                                  int index);
+
+/**
+ * Decodes an array of records from the tokens of a message
+ * @param s         Schema of the records
+ * @param m         Message
+ * @param index     Token of the array, throws ValueException if it is not
+ *                  an array of records
+ * @param[out] records  Records, NULL when there are none
+ * @param[out] count    Number of records
+ * @return LSM_ERR_OK on success, else error reason
+ */
+int LSM_DLL_LOCAL schema_array_decode(const lsm_schema &s, const Message &m,
+                                      int index, void **records[],
+                                      uint32_t *count);
+
+/**
+ * Encodes records for a response without building a Value for each.
+ * @param s         Schema of the records
+ * @param records   Records to encode
+ * @param count     Number of records
+ * @param e         Encoding of the response
+ * @param fields    Attributes to include besides the ones always sent, NULL
+ *                  for all of them
+ * @return Value holding the encoded array
+ */
+template <class T>
+Value schema_array_to_value(const lsm_schema &s, T **records, uint32_t count,
+                            Payload::encoding e,
+                            const std::set<std::string> *fields = NULL) {
+    std::string out;
+    schema_array_encode(out, s, (void *const *)records, count, fields, e);
+    return Value((Payload::CBOR == e) ? Value::raw_cbor_t : Value::raw_t,
+                 out);
+}
+
+#endif
@@ -19,6 +19,38 @@
 #define JSMN_PARENT_LINKS
 #include "jsmn.h"
 
+/*
+ * Keys of the protocol and of its records, sorted as strcmp() does.  Objects
+ * refer to these by index, add the keys of new calls and attributes here.
+ */
+static const char *const value_atoms[] = {
+    "access_group", "admin_state", "all_files", "anon_gid", "anon_uid",
+    "anongid", "anonuid", "auth", "auth_type", "batch", "block_count",
+    "block_size", "cap", "class", "classes", "code", "data", "dest_block",
+    "dest_file_name", "dest_fs_name", "disk_type", "disks", "element_type",
+    "encodings", "error", "event", "export", "export_path", "fields", "files",
+    "flags", "free_space", "fs", "fs_id", "fw_version", "id", "in_password",
+    "in_user", "init_id", "init_ids", "init_type", "interval", "job_id",
+    "link_type", "location", "message", "method", "mode", "ms", "name",
+    "network_address", "new_size_bytes", "num_of_blocks", "object", "options",
+    "out_password", "out_user", "params", "password", "pdc", "physical_address",
+    "physical_name", "plugin_data", "pool", "pool_id", "port_type",
+    "provisioning", "raid_type", "ranges", "rcp", "read_cache_pct", "read_pct",
+    "rep_type", "restore_files", "result", "ro", "ro_list", "root", "root_list",
+    "rpm", "rw", "rw_list", "search_key", "search_value", "service_address",
+    "size_bytes", "snapshot", "snapshot_name", "src_block", "src_file_name",
+    "src_fs", "status", "status_info", "strip_size", "system", "system_id",
+    "timeout", "total_space", "ts", "type", "unsupported_actions", "uri",
+    "volume", "volume_dest", "volume_name", "volume_src", "vpd83", "wcp"};
+
+#define VALUE_ATOMS (sizeof(value_atoms) / sizeof(value_atoms[0]))
+
+/* Compares a known key with one of len bytes holding no NUL. */
+static int atom_compare(const char *known, const char *key, size_t len) {
+    int rc = strncmp(known, key, len);
+    return rc ? rc : (unsigned char)known[len];
+}
+
 Value::Value(void) : t(null_t), s("null") {}
 
 Value::Value(bool v) : t(boolean_t), s((v) ? "true" : "false") {}
@@ -47,7 +79,17 @@ Value::Value(const char *v) {
 
 Value::Value(const std::string &v) : t(string_t), s(v) {}
 
-Value::Value(const std::map<std::string, Value> &v) : t(object_t), obj(v) {}
+Value::Value(const std::map<std::string, Value> &v) : t(object_t) {
+    std::map<std::string, Value>::const_iterator iter;
+
+    obj.reserve(v.size());
+    for (iter = v.begin(); iter != v.end(); ++iter) {
+        obj.push_back(member());
+        obj.back().atom = atom(iter->first.c_str(), iter->first.size(), true);
+        obj.back().value = iter->second;
+    }
+    std::sort(obj.begin(), obj.end());
+}
 
 std::string Value::serialize(void) {
     switch (t) {
@@ -58,16 +100,13 @@ std::string Value::serialize(void) {
 
         obj_s += "{";
 
-        std::map<std::string, Value>::iterator iter;
-        std::map<std::string, Value>::iterator final_iter = obj.end();
-        --final_iter;
-
-        for (iter = obj.begin(); iter != obj.end(); iter++) {
-
-            obj_s += "\"" + iter->first + "\": ";
-            obj_s += iter->second.serialize();
+        for (uint32_t i = 0; i < obj.size(); ++i) {
+            obj_s += "\"";
+            obj_s += memberKey(i);
+            obj_s += "\": ";
+            obj_s += obj[i].value.serialize();
 
-            if (iter != final_iter) {
+            if ((i + 1) < obj.size()) {
                 obj_s += ", ";
             }
         }
@@ -89,16 +128,61 @@ std::string Value::serialize(void) {
         obj_s += "]";
         return obj_s;
     }
+    case (raw_cbor_t): {
+        Value v = Payload::deserialize(s);
+        return v.serialize();
+    }
     default:
         return s;
     }
 }
 
+void Value::serializeCbor(std::string &out) {
+    switch (t) {
+    case (null_t):
+        out += '\xf6';
+        break;
+    case (boolean_t):
+        out += (s == "true") ? '\xf5' : '\xf4';
+        break;
+    case (string_t):
+        Payload::cborHead(out, 3, s.size());
+        out += s;
+        break;
+    case (numeric_t):
+        Payload::cborNumber(out, s.c_str());
+        break;
+    case (object_t): {
+        Payload::cborHead(out, 5, obj.size());
+
+        for (uint32_t i = 0; i < obj.size(); ++i) {
+            Payload::cborString(out, memberKey(i));
+            obj[i].value.serializeCbor(out);
+        }
+        break;
+    }
+    case (array_t):
+        Payload::cborHead(out, 4, array.size());
+        for (unsigned int i = 0; i < array.size(); ++i) {
+            array[i].serializeCbor(out);
+        }
+        break;
+    case (raw_t): {
+        Value v = Payload::deserialize(s);
+        v.serializeCbor(out);
+        break;
+    }
+    case (raw_cbor_t):
+        out += s;
+        break;
+    }
+}
+
 Value::value_type Value::valueType() const { return t; }
 
 Value &Value::operator[](const std::string &key) {
     if (t == object_t) {
-        return obj[key];
+        return memberSet(key.c_str(), key.size());
     }
     throw ValueException("Value not object");
 }
@@ -112,22 +196,91 @@ Value &Value::operator[](uint32_t i) {
 
 bool Value::hasKey(const std::string &k) {
     if (t == object_t) {
-        std::map<std::string, Value>::iterator iter = obj.find(k);
-        if (iter != obj.end() && iter->first == k) {
-            return true;
-        }
+        uint32_t a = atom(k.c_str(), k.size(), false);
+        size_t i = position(a);
+
+        return UINT32_MAX != a && i < obj.size() && obj[i].atom == a;
     }
     return false;
 }
 
+uint32_t Value::atom(const char *key, size_t len, bool add) {
+    size_t low = 0;
+    size_t high = VALUE_ATOMS;
+
+    if (memchr(key, '\0', len)) {
+        throw ValueException("Object key holds a NUL");
+    }
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int rc = atom_compare(value_atoms[mid], key, len);
+
+        if (!rc) {
+            return mid;
+        } else if (rc < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for (size_t o = 0; o < s.size(); o += strlen(s.c_str() + o) + 1) {
+        if (!s.compare(o, len, key, len) && !s[o + len]) {
+            return VALUE_ATOMS + o;
+        }
+    }
+
+    if (!add) {
+        return UINT32_MAX;
+    }
+
+    uint32_t a = VALUE_ATOMS + s.size();
+    s.append(key, len);
+    s += '\0';
+    return a;
+}
+
+size_t Value::position(uint32_t a) const {
+    size_t low = 0;
+    size_t high = obj.size();
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+
+        if (obj[mid].atom < a) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+Value &Value::memberSet(const char *key, size_t len) {
+    uint32_t a = atom(key, len, true);
+    size_t i = position(a);
+
+    if (i == obj.size() || obj[i].atom != a) {
+        obj.insert(obj.begin() + i, member());
+        obj[i].atom = a;
+    }
+    return obj[i].value;
+}
+
 bool Value::isValidRequest() {
     return (t == Value::object_t && hasKey("method") && hasKey("id") &&
             hasKey("params"));
 }
 
 Value Value::getValue(const char *key) {
-    if (hasKey(key)) {
-        return obj[key];
+    if (t == object_t) {
+        uint32_t a = atom(key, strlen(key), false);
+        size_t i = position(a);
+
+        if (UINT32_MAX != a && i < obj.size() && obj[i].atom == a) {
+            return obj[i].value;
+        }
     }
     return Value();
 }
@@ -204,11 +357,27 @@ const char *Value::asC_str() {
 
 std::map<std::string, Value> Value::asObject() {
     if (t == object_t) {
-        return obj;
+        std::map<std::string, Value> m;
+
+        for (uint32_t i = 0; i < obj.size(); ++i) {
+            m[memberKey(i)] = obj[i].value;
+        }
+        return m;
     }
     throw ValueException("Value not object");
 }
 
+uint32_t Value::memberCount() const {
+    return (t == object_t) ? obj.size() : 0;
+}
+
+const char *Value::memberKey(uint32_t i) const {
+    uint32_t a = obj[i].atom;
+    return (a < VALUE_ATOMS) ? value_atoms[a] : s.c_str() + (a - VALUE_ATOMS);
+}
+
+Value &Value::memberValue(uint32_t i) { return obj[i].value; }
+
 std::vector<Value> Value::asArray() {
     if (t == array_t) {
         return array;
@@ -216,7 +385,87 @@ std::vector<Value> Value::asArray() {
     throw ValueException("Value not array");
 }
 
-std::string Payload::serialize(Value &v) { return v.serialize(); }
+std::string Payload::serialize(Value &v, encoding e) {
+    if (CBOR == e) {
+        std::string out;
+        v.serializeCbor(out);
+        return out;
+    }
+    return v.serialize();
+}
+
+Payload::encoding Payload::detect(const std::string &msg) {
+    return (msg.size() && ((unsigned char)msg[0] & 0x80)) ? CBOR : JSON;
+}
+
+void Payload::cborHead(std::string &out, int major, uint64_t n) {
+    char head[9];
+    int bytes = 0;
+
+    if (n < 24) {
+        head[0] = (char)(major << 5 | n);
+    } else if (n <= 0xff) {
+        head[0] = (char)(major << 5 | 24);
+        bytes = 1;
+    } else if (n <= 0xffff) {
+        head[0] = (char)(major << 5 | 25);
+        bytes = 2;
+    } else if (n <= 0xffffffff) {
+        head[0] = (char)(major << 5 | 26);
+        bytes = 4;
+    } else {
+        head[0] = (char)(major << 5 | 27);
+        bytes = 8;
+    }
+
+    for (int i = bytes; i > 0; --i) {
+        head[i] = (char)(n & 0xff);
+        n >>= 8;
+    }
+    out.append(head, bytes + 1);
+}
+
+void Payload::cborString(std::string &out, const char *str) {
+    if (str) {
+        size_t len = strlen(str);
+
+        cborHead(out, 3, len);
+        out.append(str, len);
+    } else {
+        out += '\xf6';
+    }
+}
+
+void Payload::cborNumber(std::string &out, const char *text) {
+    if (!strpbrk(text, ".eE")) {
+        bool negative = (text[0] == '-');
+        const char *digits = negative ? text + 1 : text;
+        char *end = NULL;
+        uint64_t n;
+
+        errno = 0;
+        n = strtoull(digits, &end, 10);
+        if (!errno && end != digits && !*end && isdigit(digits[0])) {
+            if (!negative) {
+                cborHead(out, 0, n);
+                return;
+            }
+            if (n) {
+                cborHead(out, 1, n - 1);
+                return;
+            }
+        }
+    }
+
+    double d = strtod(text, NULL);
+    uint64_t bits;
+
+    memcpy(&bits, &d, sizeof(bits));
+    out += '\xfb';
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out += (char)((bits >> shift) & 0xff);
+    }
+}
 
 int inc_token(int current, int amount, int max) {
     if (current + amount >= max) {
@@ -262,8 +511,10 @@ Value lsm_parse(jsmntok_t *tok, int start_tok, int end_tok, const char *j,
         *consumed = i - start_tok;
         return Value(values);
     } else if (tok[i].type == JSMN_OBJECT) {
-        std::map<std::string, Value> values;
+        Value values((std::map<std::string, Value>()));
         int num = tok[i].size;
+
+        values.obj.reserve(num);
         // Key, value
         for (int class_mem = 0; class_mem < num; class_mem++) {
             // Get the key
@@ -272,51 +523,297 @@ Value lsm_parse(jsmntok_t *tok, int start_tok, int end_tok, const char *j,
                 throw ValueException("Expecting JSON object key to be string " +
                                      tok[i].type);
             } else {
-                std::string key(j + tok[i].start, tok[i].end - tok[i].start);
+                Value &v = values.memberSet(j + tok[i].start,
+                                            tok[i].end - tok[i].start);
                 i += inc_token(i, 1, end_tok);
                 // Get the value
                 int used = 0;
-                values[key] = lsm_parse(tok, i, end_tok, j, &used);
+                v = lsm_parse(tok, i, end_tok, j, &used);
                 i += inc_token(i, used, end_tok);
             }
         }
         *consumed = i - start_tok;
-        return Value(values);
+        return values;
     }
     throw ValueException("Unreachable path!");
 }
 
-Value Payload::deserialize(const std::string &json_str) {
-    jsmn_parser p;
-    jsmntok_t *tok = NULL;
-    int rc = 0;
-    size_t num_tokens = std::max(size_t(json_str.length() / 10), size_t(500));
-
-    while (1) {
-        jsmn_init(&p);
-        tok = (jsmntok_t *)calloc(1, sizeof(*tok) * num_tokens);
-        if (tok) {
-            rc = jsmn_parse(&p, json_str.c_str(), json_str.length(), tok,
-                            num_tokens);
-
-            if (rc < 0) {
-                if (JSMN_ERROR_NOMEM == rc) {
-                    free(tok);
-                    num_tokens *= 2;
-                    continue;
-                } else {
-                    free(tok);
-                    throw ValueException("In-valid json");
-                }
-            }
-            break;
+/**
+ * Tokenizes json_str, see json_index_tokenize().
+ * @param json_str  JSON to tokenize
+ * @param[out] tok  Tokens, free when done, NULL on allocation failure
+ * @return Number of tokens
+ */
+static int json_tokenize(const std::string &json_str, jsmntok_t **tok) {
+    int rc = json_index_tokenize(json_str.c_str(), json_str.length(), tok);
 
+    if (rc < 0) {
+        throw ValueException("In-valid json");
+    }
+    return rc;
+}
+
+/* Deeper CBOR is taken for an attack on the stack rather than a message */
+#define CBOR_DEPTH_MAX 512
+
+/**
+ * Reads CBOR into tokens like jsmn makes of JSON.
+ */
+struct cbor_reader {
+    const unsigned char *p;       /**< Next byte */
+    const unsigned char *end;     /**< End of the message */
+    std::string *text;            /**< Text the tokens point into */
+    std::vector<jsmntok_t> *tok; /**< Tokens */
+};
+
+static uint64_t cbor_argument(cbor_reader &r, int info) {
+    int bytes = 0;
+
+    switch (info) {
+    case 24:
+        bytes = 1;
+        break;
+    case 25:
+        bytes = 2;
+        break;
+    case 26:
+        bytes = 4;
+        break;
+    case 27:
+        bytes = 8;
+        break;
+    default:
+        if (info < 24) {
+            return info;
+        }
+        throw ValueException("Indefinite or reserved CBOR length");
+    }
+
+    if (r.end - r.p < bytes) {
+        throw ValueException("Truncated CBOR");
+    }
+
+    uint64_t n = 0;
+    while (bytes--) {
+        n = n << 8 | *r.p++;
+    }
+    return n;
+}
+
+static void cbor_decimal(std::string &text, uint64_t n) {
+    char buf[20];
+    int i = sizeof(buf);
+
+    do {
+        buf[--i] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n);
+    text.append(buf + i, sizeof(buf) - i);
+}
+
+static int cbor_token(cbor_reader &r, jsmntype_t type, int parent) {
+    jsmntok_t t;
+
+    t.type = type;
+    t.start = t.end = r.text->size();
+    t.size = 0;
+    t.parent = parent;
+    r.tok->push_back(t);
+    return r.tok->size() - 1;
+}
+
+static double cbor_half(uint64_t bits) {
+    int exp = (bits >> 10) & 0x1f;
+    int mant = bits & 0x3ff;
+    double d;
+
+    if (exp == 0) {
+        d = ldexp(mant, -24);
+    } else if (exp != 31) {
+        d = ldexp(mant + 1024, exp - 25);
+    } else {
+        d = mant ? NAN : INFINITY;
+    }
+    return (bits & 0x8000) ? -d : d;
+}
+
+static void cbor_simple(cbor_reader &r, int info, int parent) {
+    int t = cbor_token(r, JSMN_PRIMITIVE, parent);
+    std::string &text = *r.text;
+
+    switch (info) {
+    case 20:
+        text += "false";
+        break;
+    case 21:
+        text += "true";
+        break;
+    case 22:
+    case 23:
+        text += "null";
+        break;
+    case 25:
+    case 26:
+    case 27: {
+        uint64_t bits = cbor_argument(r, info);
+        double d;
+
+        if (25 == info) {
+            d = cbor_half(bits);
+        } else if (26 == info) {
+            uint32_t b = (uint32_t)bits;
+            float f;
+
+            memcpy(&f, &b, sizeof(f));
+            d = f;
         } else {
-            // This is what we did when we were using yajl for an allocation
-            // error, not sure this is ideal, but typically you never get
-            // back NULL on memory allocation anyway.
-            return Value();
+            memcpy(&d, &bits, sizeof(d));
+        }
+
+        /* JSON has no NaN nor infinity, neither have the users of Value */
+        if (isfinite(d)) {
+            char buf[32];
+
+            snprintf(buf, sizeof(buf), "%.17g", d);
+            text += buf;
+        } else {
+            text += "null";
         }
+        break;
+    }
+    default:
+        throw ValueException("Unsupported CBOR simple value");
+    }
+    (*r.tok)[t].end = text.size();
+}
+
+static void cbor_item(cbor_reader &r, int parent, int depth) {
+    if (r.p >= r.end) {
+        throw ValueException("Truncated CBOR");
+    }
+    if (depth > CBOR_DEPTH_MAX) {
+        throw ValueException("CBOR nested too deep");
+    }
+
+    int major = *r.p >> 5;
+    int info = *r.p++ & 0x1f;
+
+    if (7 == major) {
+        cbor_simple(r, info, parent);
+        return;
+    }
+
+    uint64_t n = cbor_argument(r, info);
+    std::string &text = *r.text;
+    int t = -1;
+
+    switch (major) {
+    case 0:
+        t = cbor_token(r, JSMN_PRIMITIVE, parent);
+        cbor_decimal(text, n);
+        break;
+    case 1:
+        t = cbor_token(r, JSMN_PRIMITIVE, parent);
+        if (UINT64_MAX == n) {
+            text += "-18446744073709551616";
+        } else {
+            text += '-';
+            cbor_decimal(text, n + 1);
+        }
+        break;
+    case 2:
+    case 3:
+        if ((uint64_t)(r.end - r.p) < n) {
+            throw ValueException("Truncated CBOR");
+        }
+        t = cbor_token(r, JSMN_STRING, parent);
+        text.append((const char *)r.p, n);
+        r.p += n;
+        break;
+    case 4:
+    case 5:
+        /* Every item takes a byte at least */
+        if ((uint64_t)(r.end - r.p) < n) {
+            throw ValueException("Truncated CBOR");
+        }
+        t = cbor_token(r, (4 == major) ? JSMN_ARRAY : JSMN_OBJECT, parent);
+        text += (4 == major) ? '[' : '{';
+        for (uint64_t i = 0; i < n; ++i) {
+            if (4 == major) {
+                cbor_item(r, t, depth + 1);
+                continue;
+            }
+
+            int key = r.tok->size();
+            cbor_item(r, t, depth + 1);
+            if ((*r.tok)[key].type != JSMN_STRING) {
+                throw ValueException("CBOR map key is not a string");
+            }
+            (*r.tok)[key].size = 1;
+            cbor_item(r, key, depth + 1);
+        }
+        (*r.tok)[t].size = (int)n;
+        text += (4 == major) ? ']' : '}';
+        break;
+    default:
+        /* Tags only qualify the item following them */
+        if (2 == n || 3 == n) {
+            throw ValueException("CBOR bignums are not supported");
+        }
+        cbor_item(r, parent, depth + 1);
+        return;
+    }
+    (*r.tok)[t].end = text.size();
+}
+
+/**
+ * Tokenizes CBOR like json_tokenize() does JSON, see Message::parse().
+ * @param msg       CBOR to tokenize
+ * @param[out] text Text the tokens point into
+ * @param[out] tok  Tokens, free when done, NULL on allocation failure
+ * @return Number of tokens
+ */
+static int cbor_tokenize(const std::string &msg, std::string &text,
+                         jsmntok_t **tok) {
+    std::vector<jsmntok_t> tokens;
+    cbor_reader r;
+
+    r.p = (const unsigned char *)msg.data();
+    r.end = r.p + msg.size();
+    r.text = &text;
+    r.tok = &tokens;
+
+    text.clear();
+    text.reserve(msg.size() + msg.size() / 2);
+    tokens.reserve(msg.size() / 4 + 1);
+    cbor_item(r, -1, 0);
+    if (r.p != r.end) {
+        throw ValueException("Trailing data after CBOR");
+    }
+
+    *tok = (jsmntok_t *)malloc(sizeof(**tok) * tokens.size());
+    if (*tok) {
+        memcpy(*tok, &tokens[0], sizeof(**tok) * tokens.size());
+    }
+    return tokens.size();
+}
+
+Value Payload::deserialize(const std::string &json_str) {
+    if (CBOR == detect(json_str)) {
+        Message m;
+
+        m.parse(json_str);
+        return m.value(0);
+    }
+
+    jsmntok_t *tok = NULL;
+    int rc = json_tokenize(json_str, &tok);
+
+    if (!tok) {
+        // This is what we did when we were using yajl for an allocation
+        // error, not sure this is ideal, but typically you never get
+        // back NULL on memory allocation anyway.
+        return Value();
     }
 
     int used = 0;
@@ -324,3 +821,70 @@ Value Payload::deserialize(const std::string &json_str) {
     free(tok);
     return result;
 }
+
+Message::Message() : tok(NULL), count(0) {}
+
+Message::~Message() { free(tok); }
+
+void Message::parse(const std::string &msg) {
+    free(tok);
+    tok = NULL;
+    count = 0;
+
+    if (Payload::CBOR == Payload::detect(msg)) {
+        count = cbor_tokenize(msg, text, &tok);
+    } else {
+        text = msg;
+        count = json_tokenize(text, &tok);
+    }
+    if (!tok) {
+        throw ValueException("Out of memory tokenizing message");
+    }
+    if (count < 1) {
+        throw ValueException("In-valid json");
+    }
+}
+
+int Message::member(int index, const char *key) const {
+    if (index < 0 || index >= count || tok[index].type != JSMN_OBJECT) {
+        return -1;
+    }
+
+    size_t len = strlen(key);
+    int k = index + 1;
+    for (int i = 0; i < tok[index].size && k + 1 < count; ++i) {
+        if (tok[k].type == JSMN_STRING &&
+            (size_t)(tok[k].end - tok[k].start) == len &&
+            memcmp(text.c_str() + tok[k].start, key, len) == 0) {
+            return k + 1;
+        }
+        k = next(k + 1);
+    }
+    return -1;
+}
+
+int Message::element(int index, int i) const {
+    if (index < 0 || index >= count || tok[index].type != JSMN_ARRAY ||
+        i < 0 || i >= tok[index].size) {
+        return -1;
+    }
+
+    int k = index + 1;
+    while (i-- > 0) {
+        k = next(k);
+    }
+    return k;
+}
+
+int Message::next(int index) const {
+    int i = index + 1;
+    while (i < count && tok[i].start < tok[index].end) {
+        ++i;
+    }
+    return i;
+}
+
+Value Message::value(int index) const {
+    int used = 0;
+    return lsm_parse(tok, index, count, text.c_str(), &used);
+}
@@ -28,24 +28,33 @@
 #include <libgen.h>
 #include <limits.h>
 #include <pwd.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/queue.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "libstoragemgmt/libstoragemgmt_error.h"
+
 #define BASE_DIR                       "/var/run/lsm"
 #define SOCKET_DIR                     BASE_DIR "/ipc"
+#define ADMIN_SOCKET                   BASE_DIR "/lsmd-admin"
 #define PLUGIN_DIR                     "/usr/bin"
 #define LSM_USER                       "libstoragemgmt"
 #define LSM_CONF_DIR                   "/etc/lsm/"
@@ -53,6 +62,52 @@
 #define LSMD_CONF_FILE                 "lsmd.conf"
 #define LSM_CONF_ALLOW_ROOT_OPT_NAME   "allow-plugin-root-privilege"
 #define LSM_CONF_REQUIRE_ROOT_OPT_NAME "require-root-privilege"
+#define LSM_CONF_PY_ZYGOTE_OPT_NAME    "python-plugin-zygote"
+#define LSM_CONF_SO_OPT_NAME           "in-process-library"
+#define LSM_CONF_SO_WORKERS_OPT_NAME   "in-process-workers"
+#define LSM_CONF_MAX_SESSIONS_OPT_NAME "max-sessions"
+#define LSM_CONF_MAX_USER_OPT_NAME     "max-sessions-per-user"
+#define LSM_CONF_QUEUE_LEN_OPT_NAME    "session-queue-length"
+#define LSM_CONF_QUEUE_TMO_OPT_NAME    "session-queue-timeout"
+#define LSM_CONF_MUX_OPT_NAME          "session-multiplexing"
+#define LSM_CONF_MUX_IDLE_OPT_NAME     "session-idle-timeout"
+#define DEFAULT_QUEUE_LEN              32
+#define DEFAULT_QUEUE_TMO              30
+#define DEFAULT_MUX_IDLE               60
+#define REJECT_TMO_MS                  1000
+#define ADMIN_TMO_MS                   1000
+#define ADMIN_CMD_MAX                  256
+#define ADMIN_DRAIN_MAX                16
+#define SPAWN_HIST_BUCKETS             10
+#define RESCAN_DELAY_MS                200
+#define PLUGIN_DIR_EVENTS                                                      \
+    (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |   \
+     IN_ATTRIB)
+#define CONF_DIR_EVENTS                                                        \
+    (IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE)
+#define ZYGOTE_ARG                     "--lsmd-zygote"
+#define MUX_ARG                        "--lsmd-mux"
+
+#ifndef LSM_PLUGIN_HOST_PATH
+#define LSM_PLUGIN_HOST_PATH "/usr/libexec/lsm.d/lsm_plugin_host"
+#endif
+
+#define SPAWN_STACK_SIZE (64 * 1024)
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
+/* Raw syscalls for spawn_child(), 32 bit ids on the archs having both */
+#ifdef SYS_setuid32
+#define SYS_SETUID     SYS_setuid32
+#define SYS_SETGID     SYS_setgid32
+#define SYS_SETGROUPS  SYS_setgroups32
+#else
+#define SYS_SETUID     SYS_setuid
+#define SYS_SETGID     SYS_setgid
+#define SYS_SETGROUPS  SYS_setgroups
+#endif
 
 #define max(a, b)                                                              \
     ({                                                                         \
@@ -65,6 +120,7 @@ int verbose_flag = 0;
 int systemd = 0;
 
 const char *socket_dir = SOCKET_DIR;
+const char *admin_socket = ADMIN_SOCKET;
 const char *plugin_dir = PLUGIN_DIR;
 const char *conf_dir = LSM_CONF_DIR;
 
@@ -79,14 +135,125 @@ int plugin_mem_debug = 0;
 
 int allow_root_plugin = 0;
 int has_root_plugin = 0;
+int python_zygote = 0;
+
+int dump_stats = 0;
+
+/* Listening admin socket, -1 if disabled */
+int admin_fd = -1;
+
+/* inotify of plug-in and plugin config directories, -1 if unavailable */
+int inotify_fd = -1;
+int plugin_wd = -1;
+int conf_wd = -1;
+
+/* ms of CLOCK_MONOTONIC to run plugins_rescan(), 0 if not needed */
+unsigned long long rescan_deadline = 0;
+
+/* Upper bounds in us of spawn latency buckets, last bucket has no bound */
+const unsigned long long spawn_hist_us[SPAWN_HIST_BUCKETS - 1] = {
+    250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000};
+
+/* Signal mask to restore while waiting for events and in children */
+sigset_t orig_sigmask;
+
+/**
+ * Client session served by a plug-in process, a zygote child or a worker of
+ * lsm_plugin_host.
+ */
+struct session {
+    pid_t pid;      /* Plug-in process, or id reported by zygote, 0 until known */
+    uid_t uid;      /* Client user */
+    int via_zygote; /* pid is reported by the zygote instead of our child */
+    unsigned long long start; /* us of CLOCK_MONOTONIC the session started */
+    TAILQ_ENTRY(session) pointers;
+};
+
+/**
+ * Accepted client connection waiting for a session slot, or for its request
+ * to be answered with busy error.
+ */
+struct waiter {
+    int fd;
+    uid_t uid;
+    unsigned long long deadline; /* ms of CLOCK_MONOTONIC */
+    const char *busy_msg;        /* Error message of rejected client */
+    TAILQ_ENTRY(waiter) pointers;
+};
+
+/**
+ * Admin socket connection, its command is buffered until the end of line.
+ */
+struct admin_conn {
+    int fd;
+    unsigned long long deadline; /* ms of CLOCK_MONOTONIC */
+    char cmd[ADMIN_CMD_MAX];     /* Command received so far */
+    size_t len;                  /* Length of cmd */
+    TAILQ_ENTRY(admin_conn) pointers;
+};
+
+TAILQ_HEAD(session_list, session);
+TAILQ_HEAD(waiter_list, waiter);
+TAILQ_HEAD(admin_conn_list, admin_conn);
+
+/**
+ * Rejected clients, we answer once their first request arrives.
+ */
+struct waiter_list rejected = TAILQ_HEAD_INITIALIZER(rejected);
+
+/**
+ * Connections to admin socket.
+ */
+struct admin_conn_list admin_conns = TAILQ_HEAD_INITIALIZER(admin_conns);
+
+/* us of CLOCK_MONOTONIC plug-ins were (re)loaded and stats reset */
+unsigned long long stats_start = 0;
+
+/**
+ * Counters of a plug-in reported on admin socket, reset when plug-ins are
+ * reloaded.
+ */
+struct plugin_stats {
+    unsigned long accepts;  /* Client connections accepted */
+    unsigned long forks;    /* Plug-in processes fork'ed by lsmd */
+    unsigned long handoffs; /* Client connections passed to zygote */
+    unsigned long rejects;  /* Clients answered with busy error */
+    unsigned long exits;    /* Sessions ended, by exit or signal */
+    unsigned long crashes;  /* Sessions ended by signal */
+    unsigned long zygote_exits;
+    unsigned long exit_codes[256];
+    unsigned long signals[NSIG];
+    unsigned long spawn_hist[SPAWN_HIST_BUCKETS];
+};
 
 /**
  * Each item in plugin list contains this information
  */
 struct plugin {
+    char *name; /* URI scheme, socket file name */
     char *file_path;
     int require_root;
     int fd;
+    char *so_path;    /* Shared object served by lsm_plugin_host, or NULL */
+    int so_workers;   /* Worker threads of lsm_plugin_host, 0 for default */
+    int mux;          /* Python plug-in serves all sessions in one process */
+    int mux_idle;     /* Seconds an unregistered mux session is kept */
+    int zygote_fd;    /* Control socket of zygote, -1 if none */
+    int zygote_ready; /* Zygote has loaded the plug-in and is serving */
+    int max_sessions; /* Concurrent sessions limit, 0 for unlimited */
+    int max_user;     /* Concurrent sessions limit per user, 0 for unlimited */
+    int queue_len;    /* Max connections waiting for a session slot */
+    int queue_tmo;    /* Seconds a connection waits before getting busy */
+    int active;       /* Number of items in sessions */
+    int queued;       /* Number of items in waiters */
+    int draining;     /* Reject new clients, set via admin socket */
+    int seen;         /* Found by last plugins_rescan() */
+    int conf_changed; /* Plugin config changed since loaded */
+    ino_t ino;        /* Plug-in file, to tell when it gets replaced */
+    struct timespec mtime;
+    struct plugin_stats stats;
+    struct session_list sessions;
+    struct waiter_list waiters;
     LIST_ENTRY(plugin) pointers;
 };
 
@@ -104,7 +271,8 @@ LIST_HEAD(plugin_list, plugin) head;
 void logger(int severity, const char *fmt, ...) {
     char buf[2048];
 
-    if (verbose_flag || LOG_WARNING == severity || LOG_ERR == severity) {
+    if (verbose_flag || LOG_NOTICE == severity || LOG_WARNING == severity ||
+        LOG_ERR == severity) {
         va_list arg;
         va_start(arg, fmt);
         vsnprintf(buf, sizeof(buf), fmt, arg);
@@ -129,6 +297,7 @@ void logger(int severity, const char *fmt, ...) {
 
 #define log_and_exit(fmt, ...) logger(LOG_ERR, fmt, ##__VA_ARGS__)
 #define warn(fmt, ...)         logger(LOG_WARNING, fmt, ##__VA_ARGS__)
+#define notice(fmt, ...)       logger(LOG_NOTICE, fmt, ##__VA_ARGS__)
 #define info(fmt, ...)         logger(LOG_INFO, fmt, ##__VA_ARGS__)
 
 /**
@@ -140,6 +309,8 @@ void signal_handler(int s) {
         serve_state = EXIT;
     } else if (SIGHUP == s) {
         serve_state = RESTART;
+    } else if (SIGUSR1 == s) {
+        dump_stats = 1;
     }
 }
 
@@ -154,6 +325,52 @@ void install_sh(void) {
     if (signal(SIGHUP, signal_handler) == SIG_ERR) {
         log_and_exit("Can't catch signal SIGHUP\n");
     }
+
+    if (signal(SIGUSR1, signal_handler) == SIG_ERR) {
+        log_and_exit("Can't catch signal SIGUSR1\n");
+    }
+
+    /* Wakes us up to give the session slot of exited plug-in to a queued
+     * client */
+    if (signal(SIGCHLD, signal_handler) == SIG_ERR) {
+        log_and_exit("Can't catch signal SIGCHLD\n");
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGUSR1);
+    if (-1 == sigprocmask(SIG_BLOCK, &mask, &orig_sigmask)) {
+        log_and_exit("Can't block signals\n");
+    }
+}
+
+/**
+ * Looks up the ids of our default user for a plug-in process to drop its
+ * privileges to, see drop_privileges().
+ * @param uid       Output, user id
+ * @param gid       Output, group id
+ * @return 1 if we are running as root and the ids need changing, else 0
+ */
+int unprivileged_ids_get(uid_t *uid, gid_t *gid) {
+    struct passwd *pw = NULL;
+
+    pw = getpwnam(LSM_USER);
+    if (!pw) {
+        info("Warn: Missing %s user, running as existing user!\n", LSM_USER);
+        return 0;
+    }
+
+    if (geteuid()) {
+        if (pw->pw_uid != getuid()) {
+            warn("Daemon not running as correct user\n");
+        }
+        return 0;
+    }
+
+    *uid = pw->pw_uid;
+    *gid = pw->pw_gid;
+    return 1;
 }
 
 /**
@@ -190,6 +407,32 @@ void drop_privileges(void) {
     }
 }
 
+/**
+ * Marks all file descriptors but stdin, stdout and stderr close-on-exec, so
+ * that plug-ins only inherit what we pass them.  Everything lsmd opens
+ * itself is created close-on-exec.
+ */
+void fds_cloexec(void) {
+    struct rlimit rl;
+    int fd = 0;
+
+#ifdef SYS_close_range
+    if (0 == syscall(SYS_close_range, 3, ~0U, CLOSE_RANGE_CLOEXEC)) {
+        return;
+    }
+#endif
+    /* Kernel older than 5.11 */
+    if (getrlimit(RLIMIT_NOFILE, &rl) || rl.rlim_cur == RLIM_INFINITY) {
+        rl.rlim_cur = 1024;
+    }
+    for (fd = 3; fd < (int)rl.rlim_cur; fd++) {
+        int flags = fcntl(fd, F_GETFD);
+        if (-1 != flags) {
+            fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+        }
+    }
+}
+
 /**
  * Check to make sure we have access to the directories of interest
  */
@@ -220,6 +463,7 @@ void usage(void) {
         "be created\n");
     printf("     --confdir   = The directory where the config files are "
            "located\n");
+    printf("     --adminsocket = The admin socket file, empty to disable\n");
     printf("     -v          = Verbose logging\n");
     printf("     -d          = New style daemon (systemd)\n");
 }
@@ -245,14 +489,15 @@ char *path_form(const char *path, const char *name) {
 typedef int (*file_op)(void *p, char *full_file_path);
 
 /**
- * For a given directory iterate through each directory item and exec the
- * callback, recursively process nested directories too.
+ * Walks a directory for process_directory() and rescan_directory().
  * @param   dir         Directory to transverse
  * @param   p           Pointer to user data (Optional)
  * @param   call_back   Function to call against file
- * @return
+ * @param   fatal       Exit on errors if set, else log and skip the directory
+ * @return 0 on success, else errno of opendir() on dir
  */
-void process_directory(const char *dir, void *p, file_op call_back) {
+static int directory_walk(const char *dir, void *p, file_op call_back,
+                          int fatal) {
     int err = 0;
 
     if (call_back && dir && strlen(dir)) {
@@ -275,7 +520,7 @@ void process_directory(const char *dir, void *p, file_op call_back) {
                     if (strncmp(entry->d_name, ".", 1) == 0) {
                         continue;
                     }
-                    process_directory(full_name, p, call_back);
+                    directory_walk(full_name, p, call_back, fatal);
                 } else {
                     if (call_back(p, full_name)) {
                         break;
@@ -286,16 +531,50 @@ void process_directory(const char *dir, void *p, file_op call_back) {
             free(full_name);
 
             if (closedir(dp)) {
-                err = errno;
-                log_and_exit("Error on closing dir %s: %s\n", dir,
-                             strerror(err));
+                int close_err = errno;
+                if (fatal) {
+                    log_and_exit("Error on closing dir %s: %s\n", dir,
+                                 strerror(close_err));
+                }
+                warn("Error on closing dir %s: %s\n", dir,
+                     strerror(close_err));
             }
         } else {
             err = errno;
-            log_and_exit("Error on processing directory %s: %s\n", dir,
-                         strerror(err));
+            if (fatal) {
+                log_and_exit("Error on processing directory %s: %s\n", dir,
+                             strerror(err));
+            }
+            warn("Error on processing directory %s: %s, skipped\n", dir,
+                 strerror(err));
         }
     }
+    return err;
+}
+
+/**
+ * For a given directory iterate through each directory item and exec the
+ * callback, recursively process nested directories too.
+ * @param   dir         Directory to transverse
+ * @param   p           Pointer to user data (Optional)
+ * @param   call_back   Function to call against file
+ * @return
+ */
+void process_directory(const char *dir, void *p, file_op call_back) {
+    directory_walk(dir, p, call_back, 1);
+}
+
+/**
+ * Same as process_directory(), but for use while serving: directories that
+ * cannot be read, e.g. removed during a package update, are logged and
+ * skipped instead of stopping the daemon.
+ * @param   dir         Directory to transverse
+ * @param   p           Pointer to user data (Optional)
+ * @param   call_back   Function to call against file
+ * @return 0 on success, else errno of opendir() on dir
+ */
+int rescan_directory(const char *dir, void *p, file_op call_back) {
+    return directory_walk(dir, p, call_back, 0);
 }
 
 /**
@@ -338,7 +617,7 @@ int setup_socket(char *name) {
     char *socket_file = path_form(socket_dir, name);
     delete_socket(NULL, socket_file);
 
-    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (-1 != fd) {
         struct sockaddr_un addr;
         memset(&addr, 0, sizeof(addr));
@@ -360,7 +639,7 @@ int setup_socket(char *name) {
                          strerror(err));
         }
 
-        if (-1 == listen(fd, 5)) {
+        if (-1 == listen(fd, SOMAXCONN)) {
             err = errno;
             log_and_exit("Error on listening %s: %s\n", socket_file,
                          strerror(err));
@@ -376,43 +655,316 @@ int setup_socket(char *name) {
     return fd;
 }
 
+/**
+ * Returns the current time of CLOCK_MONOTONIC.
+ * @return microseconds
+ */
+unsigned long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Returns the current time of CLOCK_MONOTONIC.
+ * @return milliseconds
+ */
+unsigned long long now_ms(void) { return now_us() / 1000; }
+
+/**
+ * Records a new session of plug-in.
+ * @param item          Plug-in
+ * @param pid           Plug-in process, 0 if not known yet
+ * @param uid           Client user
+ * @param via_zygote    1 if pid will be reported by zygote, else 0
+ * @param start         us of CLOCK_MONOTONIC the session started
+ */
+void session_add(struct plugin *item, pid_t pid, uid_t uid, int via_zygote,
+                 unsigned long long start) {
+    struct session *s = calloc(1, sizeof(struct session));
+    if (!s) {
+        log_and_exit("Memory allocation failure!\n");
+        return;
+    }
+    s->pid = pid;
+    s->uid = uid;
+    s->via_zygote = via_zygote;
+    s->start = start;
+    TAILQ_INSERT_TAIL(&item->sessions, s, pointers);
+    item->active++;
+}
+
+/**
+ * Accounts the time it took to get a plug-in process for a session.
+ * @param item      Plug-in
+ * @param start     us of CLOCK_MONOTONIC the session started
+ */
+void spawn_record(struct plugin *item, unsigned long long start) {
+    unsigned long long latency = now_us() - start;
+    int i = 0;
+
+    while (i < SPAWN_HIST_BUCKETS - 1 && latency > spawn_hist_us[i]) {
+        i++;
+    }
+    item->stats.spawn_hist[i]++;
+}
+
+/**
+ * Accounts the exit of the plug-in process serving a session.
+ * @param item      Plug-in
+ * @param status    Wait status of plug-in process
+ */
+void exit_record(struct plugin *item, int status) {
+    item->stats.exits++;
+    if (WIFEXITED(status)) {
+        item->stats.exit_codes[WEXITSTATUS(status)]++;
+    } else if (WIFSIGNALED(status)) {
+        item->stats.crashes++;
+        if (WTERMSIG(status) < NSIG) {
+            item->stats.signals[WTERMSIG(status)]++;
+        }
+    }
+}
+
+/**
+ * Removes session from plug-in.
+ * @param item      Plug-in
+ * @param s         Session to remove and free
+ */
+void session_remove(struct plugin *item, struct session *s) {
+    TAILQ_REMOVE(&item->sessions, s, pointers);
+    item->active--;
+    free(s);
+}
+
+/**
+ * Looks up the session of plug-in with given process or zygote id.
+ * @param item          Plug-in
+ * @param pid           Plug-in process, 0 for oldest session without it
+ * @param via_zygote    Whether the id comes from zygote
+ * @return struct session or NULL
+ */
+struct session *session_lookup(struct plugin *item, pid_t pid, int via_zygote) {
+    struct session *s = NULL;
+    TAILQ_FOREACH(s, &item->sessions, pointers) {
+        if (s->pid == pid && s->via_zygote == via_zygote) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Checks plug-in session limits for a new session of given user.
+ * @param item      Plug-in
+ * @param uid       Client user
+ * @return 1 if a new session may start now, else 0
+ */
+int session_allowed(struct plugin *item, uid_t uid) {
+    struct session *s = NULL;
+    int user_sessions = 0;
+
+    if (item->max_sessions > 0 && item->active >= item->max_sessions) {
+        return 0;
+    }
+
+    if (item->max_user > 0) {
+        TAILQ_FOREACH(s, &item->sessions, pointers) {
+            if (s->uid == uid) {
+                user_sessions++;
+            }
+        }
+        if (user_sessions >= item->max_user) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Sends the client a JSON-RPC error telling lsmd is too busy to serve it and
+ * closes the connection.
+ * @param client_fd     Client connected file descriptor
+ * @param msg           Error message
+ */
+void client_busy(int client_fd, const char *msg) {
+    char payload[256];
+    char buf[sizeof(payload) + 16];
+    char discard[1024];
+    int len = 0;
+
+    len = snprintf(payload, sizeof(payload),
+                   "{\"id\": 100, \"error\": {\"code\": %d, "
+                   "\"message\": \"%s\", \"data\": null}}",
+                   LSM_ERR_DAEMON_BUSY, msg);
+    len = snprintf(buf, sizeof(buf), "%010d%s", len, payload);
+
+    if (-1 == send(client_fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT)) {
+        int err = errno;
+        info("Error on sending busy error to client: %s\n", strerror(err));
+    }
+
+    /* Unread request would make the client see ECONNRESET instead of the
+     * error above */
+    while (recv(client_fd, discard, sizeof(discard), MSG_DONTWAIT) > 0) {
+    }
+    close(client_fd);
+}
+
+/**
+ * Rejects the client with busy error.  Replying before the client sent its
+ * request would make it fail on sending instead, so this only queues the
+ * client for rejected_process().
+ * @param client_fd     Client connected file descriptor
+ * @param msg           Error message, static string
+ */
+void client_reject(int client_fd, const char *msg) {
+    struct waiter *w = calloc(1, sizeof(struct waiter));
+    if (!w) {
+        log_and_exit("Memory allocation failure!\n");
+        return;
+    }
+    w->fd = client_fd;
+    w->busy_msg = msg;
+    w->deadline = now_ms() + REJECT_TMO_MS;
+    TAILQ_INSERT_TAIL(&rejected, w, pointers);
+}
+
+/**
+ * Sends busy error to rejected clients which sent their request, or did not
+ * within REJECT_TMO_MS.
+ * @param readfds   Readable file descriptors
+ * @param now       Current time in ms of CLOCK_MONOTONIC
+ */
+void rejected_process(fd_set *readfds, unsigned long long now) {
+    struct waiter *w = NULL;
+    struct waiter *next = NULL;
+
+    for (w = TAILQ_FIRST(&rejected); w; w = next) {
+        next = TAILQ_NEXT(w, pointers);
+        if (FD_ISSET(w->fd, readfds) || now >= w->deadline) {
+            TAILQ_REMOVE(&rejected, w, pointers);
+            client_busy(w->fd, w->busy_msg);
+            free(w);
+        }
+    }
+}
+
+/**
+ * Closes the connections of rejected clients.
+ */
+void rejected_clear(void) {
+    struct waiter *w = NULL;
+
+    while (!TAILQ_EMPTY(&rejected)) {
+        w = TAILQ_FIRST(&rejected);
+        TAILQ_REMOVE(&rejected, w, pointers);
+        close(w->fd);
+        free(w);
+    }
+}
+
+/**
+ * Drops all sessions and closes waiting connections of plug-in.
+ * @param item      Plug-in
+ */
+void sessions_clear(struct plugin *item) {
+    struct waiter *w = NULL;
+
+    while (!TAILQ_EMPTY(&item->sessions)) {
+        session_remove(item, TAILQ_FIRST(&item->sessions));
+    }
+
+    while (!TAILQ_EMPTY(&item->waiters)) {
+        w = TAILQ_FIRST(&item->waiters);
+        TAILQ_REMOVE(&item->waiters, w, pointers);
+        close(w->fd);
+        free(w);
+    }
+    item->queued = 0;
+}
+
+/**
+ * Closes the control socket of a plug-in zygote, the zygote exits once it
+ * reads EOF on it.
+ * @param item      Plug-in owning the zygote
+ */
+void zygote_stop(struct plugin *item) {
+    struct session *s = NULL;
+    struct session *next = NULL;
+
+    /* We lose track of the sessions served by the zygote, python zygote
+     * children keep serving their clients but are no longer counted */
+    for (s = TAILQ_FIRST(&item->sessions); s; s = next) {
+        next = TAILQ_NEXT(s, pointers);
+        if (s->via_zygote) {
+            session_remove(item, s);
+        }
+    }
+
+    if (item->zygote_fd >= 0) {
+        close(item->zygote_fd);
+    }
+    item->zygote_fd = -1;
+    item->zygote_ready = 0;
+}
+
+/**
+ * Closes the listening socket of plug-in and re-claims its memory.
+ * @param item      Plug-in, already removed from the list
+ */
+void plugin_free(struct plugin *item) {
+    int err;
+
+    zygote_stop(item);
+    sessions_clear(item);
+
+    if (-1 == close(item->fd)) {
+        err = errno;
+        info("Error on closing fd %d for file %s: %s\n", item->fd,
+             item->file_path, strerror(err));
+    }
+
+    free(item->name);
+    item->name = NULL;
+    free(item->file_path);
+    item->file_path = NULL;
+    free(item->so_path);
+    item->so_path = NULL;
+    item->fd = INT_MAX;
+    free(item);
+}
+
 /**
  * Closes all the listening sockets and re-claims memory in linked list.
  * @param list
  */
 void empty_plugin_list(struct plugin_list *list) {
-    int err;
     struct plugin *item = NULL;
 
     while (!LIST_EMPTY(list)) {
         item = LIST_FIRST(list);
         LIST_REMOVE(item, pointers);
-
-        if (-1 == close(item->fd)) {
-            err = errno;
-            info("Error on closing fd %d for file %s: %s\n", item->fd,
-                 item->file_path, strerror(err));
-        }
-
-        free(item->file_path);
-        item->file_path = NULL;
-        item->fd = INT_MAX;
-        free(item);
+        plugin_free(item);
     }
 }
 
+/* Which libconfig lookup parse_conf() does */
+typedef enum { CONF_BOOL, CONF_INT, CONF_STRING } conf_type;
+
 /**
- * Parse config and seeking provided key name bool
+ * Parse config and seeking provided key name
  *  1. Keep value untouched if file not exist
  *  2. If file is not readable, abort via log_and_exit()
  *  3. Keep value untouched if provided key not found
  *  4. Abort via log_and_exit() if no enough memory.
  * @param conf_path     config file path
  * @param key_name      string, searching key
- * @param value         int, output, value of this config key
+ * @param type          type of value
+ * @param value         output, value of this config key
  */
-
-void parse_conf_bool(const char *conf_path, const char *key_name, int *value) {
+void parse_conf(const char *conf_path, const char *key_name, conf_type type,
+                void *value) {
     if (access(conf_path, F_OK) == -1) {
         /* file not exist. */
         return;
@@ -421,7 +973,25 @@ void parse_conf_bool(const char *conf_path, const char *key_name, int *value) {
     if (cfg) {
         config_init(cfg);
         if (CONFIG_TRUE == config_read_file(cfg, conf_path)) {
-            config_lookup_bool(cfg, key_name, value);
+            const char *str = NULL;
+
+            switch (type) {
+            case CONF_BOOL:
+                config_lookup_bool(cfg, key_name, (int *)value);
+                break;
+            case CONF_INT:
+                config_lookup_int(cfg, key_name, (int *)value);
+                break;
+            case CONF_STRING:
+                if (CONFIG_TRUE == config_lookup_string(cfg, key_name, &str)) {
+                    free(*(char **)value);
+                    *(char **)value = strdup(str);
+                    if (!*(char **)value) {
+                        log_and_exit("strdup failed %s\n", str);
+                    }
+                }
+                break;
+            }
         } else {
             log_and_exit("configure %s parsing failed: %s at line %d\n",
                          conf_path, config_error_text(cfg),
@@ -436,6 +1006,56 @@ void parse_conf_bool(const char *conf_path, const char *key_name, int *value) {
     free(cfg);
 }
 
+/**
+ * Same as parse_conf() for a bool key.
+ * @param value         int, output, value of this config key
+ */
+void parse_conf_bool(const char *conf_path, const char *key_name, int *value) {
+    parse_conf(conf_path, key_name, CONF_BOOL, value);
+}
+
+/**
+ * Same as parse_conf() for an integer key.
+ * @param value         int, output, value of this config key
+ */
+void parse_conf_int(const char *conf_path, const char *key_name, int *value) {
+    parse_conf(conf_path, key_name, CONF_INT, value);
+}
+
+/**
+ * Same as parse_conf() for a string key.
+ * @param value         char *, output, caller must call free when done
+ */
+void parse_conf_string(const char *conf_path, const char *key_name,
+                       char **value) {
+    parse_conf(conf_path, key_name, CONF_STRING, value);
+}
+
+/**
+ * Returns the path of the config file of given plug-in.
+ * @param plugin_name   plugin name.
+ * @return Path string, caller must call free when done
+ */
+char *plugin_conf_path_get(const char *plugin_name) {
+    size_t s = strlen(plugin_name) + strlen(plugin_conf_extension) + 1;
+    char *plugin_conf_filename = (char *)malloc(s);
+    char *plugin_conf_dir_path = NULL;
+    char *plugin_conf_path = NULL;
+
+    if (!plugin_conf_filename) {
+        log_and_exit("malloc failure while trying to allocate %zu bytes\n", s);
+        return NULL;
+    }
+
+    snprintf(plugin_conf_filename, s, "%s%s", plugin_name,
+             plugin_conf_extension);
+    plugin_conf_dir_path = path_form(conf_dir, LSM_PLUGIN_CONF_DIR_NAME);
+    plugin_conf_path = path_form(plugin_conf_dir_path, plugin_conf_filename);
+    free(plugin_conf_dir_path);
+    free(plugin_conf_filename);
+    return plugin_conf_path;
+}
+
 /**
  * Load plugin config for root privilege setting.
  * If config not found, return 0 for no root privilege required.
@@ -445,54 +1065,404 @@ void parse_conf_bool(const char *conf_path, const char *key_name, int *value) {
 
 int chk_pconf_root_pri(char *plugin_name) {
     int require_root = 0;
-    size_t plugin_name_len = strlen(plugin_name);
-    size_t conf_ext_len = strlen(plugin_conf_extension);
-    size_t conf_file_name_len = plugin_name_len + conf_ext_len + 1;
-    char *plugin_conf_filename = (char *)malloc(conf_file_name_len);
-
-    if (plugin_conf_filename) {
-        snprintf(plugin_conf_filename, conf_file_name_len, "%s%s", plugin_name,
-                 plugin_conf_extension);
-
-        char *plugin_conf_dir_path =
-            path_form(conf_dir, LSM_PLUGIN_CONF_DIR_NAME);
-
-        char *plugin_conf_path =
-            path_form(plugin_conf_dir_path, plugin_conf_filename);
-        parse_conf_bool(plugin_conf_path, LSM_CONF_REQUIRE_ROOT_OPT_NAME,
-                        &require_root);
-
-        if (require_root == 1 && allow_root_plugin == 0) {
-            warn("Plugin %s require root privilege while %s disable globally\n",
-                 plugin_name, LSMD_CONF_FILE);
-        }
-        free(plugin_conf_dir_path);
-        free(plugin_conf_filename);
-        free(plugin_conf_path);
-    } else {
-        log_and_exit("malloc failure while trying to allocate %zu "
-                     "bytes\n",
-                     conf_file_name_len);
+    char *plugin_conf_path = plugin_conf_path_get(plugin_name);
+
+    parse_conf_bool(plugin_conf_path, LSM_CONF_REQUIRE_ROOT_OPT_NAME,
+                    &require_root);
+
+    if (require_root == 1 && allow_root_plugin == 0) {
+        warn("Plugin %s require root privilege while %s disable globally\n",
+             plugin_name, LSMD_CONF_FILE);
     }
+    free(plugin_conf_path);
     return require_root;
 }
 
 /**
- * Call back for plug-in processing.
- * @param p             Private data
- * @param full_name     Full path and file name
- * @return 0 to continue, else abort directory processing
+ * Load plugin config for serving all connections in one plug-in process,
+ * a shared object served by lsm_plugin_host or a multiplexing python
+ * plug-in.
+ * @param plugin_name   plugin name.
+ * @param item          Plug-in to update so_path, so_workers, mux and
+ *                      mux_idle of
  */
-int process_plugin(void *p, char *full_name) {
-    char *base_nm = NULL;
-    size_t base_nm_len = 0;
-    size_t no_ext_len = 0;
-    char plugin_name[128];
-    size_t ext_len = strlen(plugin_extension);
-    size_t plugin_name_max_len = sizeof(plugin_name) / sizeof(char);
+void chk_pconf_in_process(char *plugin_name, struct plugin *item) {
+    char *plugin_conf_path = plugin_conf_path_get(plugin_name);
+
+    item->mux_idle = DEFAULT_MUX_IDLE;
+    parse_conf_string(plugin_conf_path, LSM_CONF_SO_OPT_NAME, &item->so_path);
+    parse_conf_int(plugin_conf_path, LSM_CONF_SO_WORKERS_OPT_NAME,
+                   &item->so_workers);
+    parse_conf_bool(plugin_conf_path, LSM_CONF_MUX_OPT_NAME, &item->mux);
+    parse_conf_int(plugin_conf_path, LSM_CONF_MUX_IDLE_OPT_NAME,
+                   &item->mux_idle);
+    if (item->mux_idle < 0) {
+        item->mux_idle = 0;
+    }
+    free(plugin_conf_path);
+}
 
-    if (full_name == NULL)
-        return 0;
+/**
+ * Load plugin config for session limits.
+ * @param plugin_name   plugin name.
+ * @param item          Plug-in to update limits of
+ */
+void chk_pconf_sessions(char *plugin_name, struct plugin *item) {
+    char *plugin_conf_path = plugin_conf_path_get(plugin_name);
+
+    item->queue_len = DEFAULT_QUEUE_LEN;
+    item->queue_tmo = DEFAULT_QUEUE_TMO;
+    parse_conf_int(plugin_conf_path, LSM_CONF_MAX_SESSIONS_OPT_NAME,
+                   &item->max_sessions);
+    parse_conf_int(plugin_conf_path, LSM_CONF_MAX_USER_OPT_NAME,
+                   &item->max_user);
+    parse_conf_int(plugin_conf_path, LSM_CONF_QUEUE_LEN_OPT_NAME,
+                   &item->queue_len);
+    parse_conf_int(plugin_conf_path, LSM_CONF_QUEUE_TMO_OPT_NAME,
+                   &item->queue_tmo);
+    free(plugin_conf_path);
+}
+
+/**
+ * Checks if the plug-in will always run with dropped privileges, see
+ * exec_plugin() for the rules.
+ * @param require_root  int, indicate whether this plugin require root
+ *                      privilege or not
+ * @return 1 if plug-in never runs as root, else 0
+ */
+int plugin_runs_unprivileged(int require_root) {
+    return (require_root == 0 || getuid() || allow_root_plugin == 0);
+}
+
+/**
+ * Checks the interpreter line of the plug-in for python.
+ * @param file_path     Full path of plug-in
+ * @return 1 if plug-in is a python script, else 0
+ */
+int is_python_plugin(const char *file_path) {
+    char line[128];
+    int rc = 0;
+    FILE *f = fopen(file_path, "r");
+
+    if (f) {
+        if (fgets(line, sizeof(line), f) && strncmp(line, "#!", 2) == 0 &&
+            strstr(line, "python")) {
+            rc = 1;
+        }
+        fclose(f);
+    }
+    return rc;
+}
+
+/**
+ * What spawn_child() does between clone() and execve().
+ */
+struct spawn_args {
+    const char *path;
+    char *const *argv;
+    int keep_fd;   /* Inherited by the plug-in */
+    int set_ids;   /* Drop privileges to uid and gid */
+    uid_t uid;
+    gid_t gid;
+    int err;       /* errno of the failed step, 0 on success */
+};
+
+/**
+ * Child side of spawn(). Runs on the memory of lsmd until execve(), so it
+ * must neither allocate nor touch lsmd state other than its arguments, and
+ * only makes raw system calls.
+ * @param arg       struct spawn_args
+ * @return Does not return
+ */
+static int spawn_child(void *arg) {
+    struct spawn_args *a = (struct spawn_args *)arg;
+    extern char **environ;
+    struct sigaction sa;
+    int flags = 0;
+    int sig = 0;
+
+    /* Our handlers would run on lsmd memory, ignored signals stay ignored */
+    for (sig = 1; sig < NSIG; sig++) {
+        if (0 == sigaction(sig, NULL, &sa) && SIG_IGN != sa.sa_handler &&
+            SIG_DFL != sa.sa_handler) {
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = SIG_DFL;
+            sigaction(sig, &sa, NULL);
+        }
+    }
+
+    if (a->set_ids) {
+        if (syscall(SYS_SETGID, a->gid) ||
+            syscall(SYS_SETGROUPS, 1, &a->gid) ||
+            syscall(SYS_SETUID, a->uid)) {
+            a->err = errno;
+            _exit(127);
+        }
+    }
+
+    flags = fcntl(a->keep_fd, F_GETFD);
+    if (-1 == flags ||
+        -1 == fcntl(a->keep_fd, F_SETFD, flags & ~FD_CLOEXEC)) {
+        a->err = errno;
+        _exit(127);
+    }
+
+    sigprocmask(SIG_SETMASK, &orig_sigmask, NULL);
+    execve(a->path, a->argv, environ);
+    a->err = errno;
+    _exit(127);
+}
+
+/**
+ * Starts a plug-in process. Instead of fork() copying our page tables, the
+ * child borrows our memory (CLONE_VM) while we wait for its execve()
+ * (CLONE_VFORK). Every other descriptor of ours is close-on-exec, so the
+ * plug-in inherits stdio and a->keep_fd only.
+ * @param a         Program, arguments and ids to run it with. a->err gets
+ *                  the errno if the child fails before or on execve().
+ * @return Process id, -1 on failure with a->err set
+ */
+pid_t spawn(struct spawn_args *a) {
+    static char *stack = NULL;
+    sigset_t all;
+    sigset_t prev;
+    pid_t pid = -1;
+
+    a->err = 0;
+
+    if (!stack) {
+        stack = mmap(NULL, SPAWN_STACK_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (MAP_FAILED == stack) {
+            stack = NULL;
+            a->err = errno;
+            return -1;
+        }
+    }
+
+    /* No handler may run in the child before it resets them */
+    sigfillset(&all);
+    sigprocmask(SIG_SETMASK, &all, &prev);
+    /* Stack grows down on all archs we build for */
+    pid = clone(spawn_child, stack + SPAWN_STACK_SIZE,
+                CLONE_VM | CLONE_VFORK | SIGCHLD, a);
+    if (-1 == pid) {
+        a->err = errno;
+    }
+    sigprocmask(SIG_SETMASK, &prev, NULL);
+
+    if (pid > 0 && a->err) {
+        /* Reaped by signal handling like any other plug-in exit */
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * Starts a zygote for a plug-in, which loads the plug-in once and then serves
+ * each client connection we pass it over the control socket:
+ *  - python plug-in: forks a child per connection, see
+ *    PluginRunner._zygote().
+ *  - python plug-in with 'session-multiplexing': serves all connections
+ *    itself, see PluginRunner._mux_run().
+ *  - plug-in with 'in-process-library': lsm_plugin_host serves connections
+ *    on worker threads, see lsm_plugin_host_v1().
+ * Until the zygote reports READY (or if it fails) we keep on fork and
+ * exec'ing the plug-in.
+ * @param item      Plug-in to start zygote for
+ */
+void zygote_start(struct plugin *item) {
+    int sv[2];
+    int err = 0;
+
+    if (-1 == socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv)) {
+        err = errno;
+        warn("Error on creating zygote socket for %s: %s\n", item->file_path,
+             strerror(err));
+        return;
+    }
+
+    char fd_str[12];
+    char workers_str[12];
+    char idle_str[12];
+    const char *plugin_argv[5];
+    struct spawn_args a;
+    char *p_copy = NULL;
+
+    sprintf(fd_str, "%d", sv[1]);
+    sprintf(workers_str, "%d", item->so_workers);
+    sprintf(idle_str, "%d", item->mux_idle);
+
+    if (item->so_path) {
+        p_copy = strdup(LSM_PLUGIN_HOST_PATH);
+        plugin_argv[1] = item->so_path;
+        plugin_argv[2] = fd_str;
+        plugin_argv[3] = workers_str;
+        plugin_argv[4] = NULL;
+    } else if (item->mux) {
+        p_copy = strdup(item->file_path);
+        plugin_argv[1] = MUX_ARG;
+        plugin_argv[2] = fd_str;
+        plugin_argv[3] = idle_str;
+        plugin_argv[4] = NULL;
+    } else {
+        p_copy = strdup(item->file_path);
+        plugin_argv[1] = ZYGOTE_ARG;
+        plugin_argv[2] = fd_str;
+        plugin_argv[3] = NULL;
+    }
+    if (!p_copy) {
+        log_and_exit("Memory allocation failure!\n");
+    }
+
+    memset(&a, 0, sizeof(a));
+    a.path = item->so_path ? LSM_PLUGIN_HOST_PATH : item->file_path;
+    a.argv = (char *const *)plugin_argv;
+    a.keep_fd = sv[1];
+    a.set_ids = unprivileged_ids_get(&a.uid, &a.gid);
+    plugin_argv[0] = basename(p_copy);
+
+    pid_t process = spawn(&a);
+    close(sv[1]);
+    if (process > 0) {
+        item->zygote_fd = sv[0];
+        item->zygote_ready = 0;
+        info("Started zygote %d for plug-in %s\n", process, item->file_path);
+    } else {
+        err = a.err;
+        warn("Error on starting zygote of %s: %s\n", item->file_path,
+             strerror(err));
+        close(sv[0]);
+    }
+    free(p_copy);
+}
+
+/**
+ * Hands an accepted client connection to the plug-in zygote.
+ * @param item          Plug-in
+ * @param client_fd     Client connected file descriptor, closed on success
+ * @return 0 on success, else -1 and caller needs to exec the plug-in
+ */
+int zygote_fork(struct plugin *item, int client_fd) {
+    struct msghdr msg;
+    struct iovec iov;
+    char cmd[] = "FORK";
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } cmsg_buf;
+    struct cmsghdr *cmsg = NULL;
+
+    if (item->zygote_fd < 0 || !item->zygote_ready) {
+        return -1;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&cmsg_buf, 0, sizeof(cmsg_buf));
+    iov.iov_base = cmd;
+    iov.iov_len = sizeof(cmd) - 1;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf.buf;
+    msg.msg_controllen = sizeof(cmsg_buf.buf);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &client_fd, sizeof(int));
+
+    if (-1 == sendmsg(item->zygote_fd, &msg, MSG_NOSIGNAL)) {
+        int err = errno;
+        warn("Zygote of %s is gone (%s), falling back to exec\n",
+             item->file_path, strerror(err));
+        zygote_stop(item);
+        return -1;
+    }
+
+    info("Passed connection to zygote of plug-in = %s\n", item->file_path);
+    close(client_fd);
+    return 0;
+}
+
+/**
+ * Processes a message from a plug-in zygote.
+ * @param item      Plug-in owning the zygote
+ */
+void zygote_msg_handle(struct plugin *item) {
+    char buf[64];
+    int pid = 0;
+    int status = 0;
+    struct session *s = NULL;
+    ssize_t len = recv(item->zygote_fd, buf, sizeof(buf) - 1, 0);
+
+    if (len <= 0) {
+        item->stats.zygote_exits++;
+        warn("Zygote of %s exited, falling back to exec\n", item->file_path);
+        zygote_stop(item);
+        return;
+    }
+
+    buf[len] = '\0';
+    if (strcmp(buf, "READY") == 0) {
+        item->zygote_ready = 1;
+        info("Zygote of %s is ready\n", item->file_path);
+    } else if (sscanf(buf, "PID %d", &pid) == 1) {
+        /* Zygote replies in the order we passed connections to it */
+        s = session_lookup(item, 0, 1);
+        if (s) {
+            s->pid = pid;
+            spawn_record(item, s->start);
+        }
+    } else if (sscanf(buf, "EXIT %d %d", &pid, &status) == 2) {
+        s = session_lookup(item, pid, 1);
+        if (s) {
+            exit_record(item, status);
+            session_remove(item, s);
+        }
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+            info("Plug-in process %d exited with %d\n", pid,
+                 WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            info("Plug-in process %d killed by signal %d\n", pid,
+                 WTERMSIG(status));
+        }
+    }
+}
+
+/**
+ * Given a socket descriptor looks it up and returns the plug-in owning the
+ * zygote
+ * @param fd        Zygote control socket descriptor to lookup
+ * @return struct plugin
+ */
+struct plugin *zygote_lookup(int fd) {
+    struct plugin *plug = NULL;
+    LIST_FOREACH(plug, &head, pointers) {
+        if (plug->zygote_fd == fd) {
+            return plug;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Gets the plug-in name, which is also the URI scheme and the IPC socket file
+ * name, from the plug-in file name.
+ * @param full_name     Full path and file name
+ * @param plugin_name   Output buffer
+ * @param len           Size of plugin_name
+ * @return 1 if the file is a plug-in, else 0
+ */
+int plugin_name_get(char *full_name, char *plugin_name, size_t len) {
+    char *base_nm = NULL;
+    size_t base_nm_len = 0;
+    size_t no_ext_len = 0;
+    size_t ext_len = strlen(plugin_extension);
+
+    if (full_name == NULL)
+        return 0;
 
     base_nm = basename(full_name);
     base_nm_len = strlen(base_nm);
@@ -503,29 +1473,118 @@ int process_plugin(void *p, char *full_name) {
     if (strncmp(base_nm + base_nm_len - ext_len, plugin_extension, ext_len))
         return 0;
 
-    struct plugin *item = calloc(1, sizeof(struct plugin));
-    if (item == NULL) {
-        log_and_exit("Memory allocation failure!\n");
-        return 0; // no use, just trick covscan;
-    }
-
     /* Strip off _lsmplugin from the file name, not sure
      * why I chose to do this */
-    memset(plugin_name, 0, plugin_name_max_len);
-    strncpy(plugin_name, base_nm, plugin_name_max_len - 1);
+    memset(plugin_name, 0, len);
+    strncpy(plugin_name, base_nm, len - 1);
     no_ext_len = base_nm_len - ext_len;
     // Already check, no_ext_len is bigger than 0 here.
-    if (no_ext_len < plugin_name_max_len - 1)
+    if (no_ext_len < len - 1)
         plugin_name[no_ext_len] = '\0';
+    return 1;
+}
 
-    item->file_path = strdup(full_name);
-    item->fd = setup_socket(plugin_name);
-    item->require_root = chk_pconf_root_pri(plugin_name);
+/**
+ * Loads, or re-loads, the plugin config of plug-in.
+ * @param item      Plug-in
+ */
+void plugin_conf_load(struct plugin *item) {
+    free(item->so_path);
+    item->so_path = NULL;
+    item->so_workers = 0;
+    item->mux = 0;
+    item->max_sessions = 0;
+    item->max_user = 0;
+
+    item->require_root = chk_pconf_root_pri(item->name);
+    chk_pconf_in_process(item->name, item);
+    chk_pconf_sessions(item->name, item);
     has_root_plugin |= item->require_root;
+}
 
-    if (item->file_path && item->fd >= 0) {
-        LIST_INSERT_HEAD((struct plugin_list *)p, item, pointers);
+/**
+ * Records the inode and modification time of plug-in file, which tell us
+ * when the plug-in gets replaced.
+ * @param item      Plug-in
+ * @return 1 if they changed since last call, else 0
+ */
+int plugin_stat(struct plugin *item) {
+    struct stat st;
+    int changed = 0;
+
+    if (stat(item->file_path, &st)) {
+        return 0;
+    }
+
+    changed = (st.st_ino != item->ino ||
+               st.st_mtim.tv_sec != item->mtime.tv_sec ||
+               st.st_mtim.tv_nsec != item->mtime.tv_nsec);
+    item->ino = st.st_ino;
+    item->mtime = st.st_mtim;
+    return changed;
+}
+
+/**
+ * Checks if plug-in should be served by a zygote, see zygote_start().
+ * @param item      Plug-in
+ * @return 1 if so, else 0
+ */
+int plugin_zygote_wanted(struct plugin *item) {
+    return (!plugin_mem_debug && plugin_runs_unprivileged(item->require_root) &&
+            (item->so_path ||
+             ((python_zygote || item->mux) &&
+              is_python_plugin(item->file_path))));
+}
+
+/**
+ * Looks up plug-in by name.
+ * @param name      Plug-in name, the URI scheme
+ * @return struct plugin or NULL
+ */
+struct plugin *plugin_lookup_name(const char *name) {
+    struct plugin *plug = NULL;
+    LIST_FOREACH(plug, &head, pointers) {
+        if (strcmp(plug->name, name) == 0) {
+            return plug;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Adds a plug-in to a plug-in list.
+ * @param list          Plug-in list
+ * @param full_name     Full path and file name
+ * @return Plug-in added, NULL if full_name is no plug-in
+ */
+struct plugin *plugin_add(struct plugin_list *list, char *full_name) {
+    char plugin_name[128];
+
+    if (!plugin_name_get(full_name, plugin_name, sizeof(plugin_name)))
+        return NULL;
+
+    struct plugin *item = calloc(1, sizeof(struct plugin));
+    if (item == NULL) {
+        log_and_exit("Memory allocation failure!\n");
+        return NULL; // no use, just trick covscan;
+    }
+
+    item->name = strdup(plugin_name);
+    item->file_path = strdup(full_name);
+    item->fd = setup_socket(plugin_name);
+    item->zygote_fd = -1;
+    TAILQ_INIT(&item->sessions);
+    TAILQ_INIT(&item->waiters);
+    plugin_conf_load(item);
+    plugin_stat(item);
+
+    if (item->name && item->file_path && item->fd >= 0) {
+        LIST_INSERT_HEAD(list, item, pointers);
         info("Plugin %s added\n", full_name);
+
+        if (plugin_zygote_wanted(item)) {
+            zygote_start(item);
+        }
     } else {
         /* The only real way to get here is failed strdup as
            setup_socket will exit on error. */
@@ -533,9 +1592,45 @@ int process_plugin(void *p, char *full_name) {
         item = NULL;
         log_and_exit("strdup failed %s\n", full_name);
     }
+    return item;
+}
+
+/**
+ * Call back for plug-in processing.
+ * @param p             Private data
+ * @param full_name     Full path and file name
+ * @return 0 to continue, else abort directory processing
+ */
+int process_plugin(void *p, char *full_name) {
+    plugin_add((struct plugin_list *)p, full_name);
     return 0;
 }
 
+/**
+ * Ends the session served by an exited plug-in process.
+ * @param si        Exited child process as returned by waitid()
+ */
+void session_reaped(siginfo_t *si) {
+    struct plugin *plug = NULL;
+    struct session *s = NULL;
+    int status = 0;
+
+    if (si->si_code == CLD_EXITED) {
+        status = W_EXITCODE(si->si_status, 0);
+    } else {
+        status = W_EXITCODE(0, si->si_status);
+    }
+
+    LIST_FOREACH(plug, &head, pointers) {
+        s = session_lookup(plug, si->si_pid, 0);
+        if (s) {
+            exit_record(plug, status);
+            session_remove(plug, s);
+            return;
+        }
+    }
+}
+
 /**
  * Cleans up any children that have exited.
  */
@@ -559,6 +1654,8 @@ void child_cleanup(void) {
             if (0 == rc && si.si_pid == 0) {
                 break;
             } else {
+                session_reaped(&si);
+
                 if (si.si_code == CLD_EXITED && si.si_status != 0) {
                     info("Plug-in process %d exited with %d\n", si.si_pid,
                          si.si_status);
@@ -572,6 +1669,7 @@ void child_cleanup(void) {
  * Closes and frees memory and removes Unix domain sockets.
  */
 void clean_up(void) {
+    rejected_clear();
     empty_plugin_list(&head);
     clean_sockets();
 }
@@ -583,6 +1681,7 @@ void clean_up(void) {
 int process_plugins(void) {
     clean_up();
     info("Scanning plug-in directory %s\n", plugin_dir);
+    stats_start = now_us();
     process_directory(plugin_dir, &head, process_plugin);
     if (allow_root_plugin == 1 && has_root_plugin == 0) {
         info("No plugin requires root privilege, dropping root privilege\n");
@@ -592,6 +1691,227 @@ int process_plugins(void) {
     return 0;
 }
 
+/**
+ * Stops serving a plug-in which got removed from plug-in directory.  Queued
+ * clients get busy error, sessions carry on.
+ * @param item      Plug-in
+ */
+void plugin_remove(struct plugin *item) {
+    struct waiter *w = NULL;
+    char *socket_file = path_form(socket_dir, item->name);
+
+    LIST_REMOVE(item, pointers);
+    info("Plugin %s removed\n", item->file_path);
+
+    while (!TAILQ_EMPTY(&item->waiters)) {
+        w = TAILQ_FIRST(&item->waiters);
+        TAILQ_REMOVE(&item->waiters, w, pointers);
+        client_reject(w->fd, "Plug-in removed");
+        free(w);
+    }
+    item->queued = 0;
+
+    delete_socket(NULL, socket_file);
+    free(socket_file);
+    plugin_free(item);
+}
+
+/**
+ * Restarts the zygote of plug-in, or stops it if no longer wanted.
+ * @param item      Plug-in
+ */
+void zygote_restart(struct plugin *item) {
+    zygote_stop(item);
+    if (plugin_zygote_wanted(item)) {
+        zygote_start(item);
+    }
+}
+
+/**
+ * Re-loads the plugin config of plug-in, restarting its zygote if needed.
+ * @param item      Plug-in
+ */
+void plugin_conf_reload(struct plugin *item) {
+    char *so_path = item->so_path;
+    int so_workers = item->so_workers;
+    int mux = item->mux;
+    int mux_idle = item->mux_idle;
+    int require_root = item->require_root;
+
+    item->so_path = NULL;
+    plugin_conf_load(item);
+    info("Plugin %s config reloaded\n", item->file_path);
+
+    if (require_root != item->require_root || so_workers != item->so_workers ||
+        mux != item->mux || mux_idle != item->mux_idle ||
+        (so_path == NULL) != (item->so_path == NULL) ||
+        (so_path && strcmp(so_path, item->so_path))) {
+        zygote_restart(item);
+    }
+    free(so_path);
+}
+
+/**
+ * Call back for plugins_rescan(), adds new plug-ins and restarts the zygote
+ * of replaced ones.
+ * @param p             Plug-in list
+ * @param full_name     Full path and file name
+ * @return 0 to continue
+ */
+int rescan_plugin(void *p, char *full_name) {
+    char plugin_name[128];
+    struct plugin *item = NULL;
+
+    if (!plugin_name_get(full_name, plugin_name, sizeof(plugin_name)))
+        return 0;
+
+    item = plugin_lookup_name(plugin_name);
+    if (item && strcmp(item->file_path, full_name) != 0) {
+        if (access(item->file_path, F_OK) == 0) {
+            warn("Plugin %s ignored, %s has the same name\n", full_name,
+                 item->file_path);
+            return 0;
+        }
+        /* Moved */
+        plugin_remove(item);
+        item = NULL;
+    }
+
+    if (!item) {
+        item = plugin_add((struct plugin_list *)p, full_name);
+        if (!item) {
+            return 0;
+        }
+    } else if (plugin_stat(item)) {
+        info("Plugin %s updated\n", full_name);
+        zygote_restart(item);
+    }
+    item->seen = 1;
+    return 0;
+}
+
+/**
+ * Applies the changes of plug-in directory and plugin config directory
+ * without touching the IPC sockets of unchanged plug-ins.
+ */
+void plugins_rescan(void) {
+    struct plugin *plug = NULL;
+    struct plugin *next = NULL;
+
+    int err = 0;
+
+    LIST_FOREACH(plug, &head, pointers) { plug->seen = 0; }
+
+    err = rescan_directory(plugin_dir, &head, rescan_plugin);
+    if (err) {
+        /* Keep what we have rather than dropping every plug-in */
+        LIST_FOREACH(plug, &head, pointers) { plug->seen = 1; }
+    }
+
+    for (plug = LIST_FIRST(&head); plug; plug = next) {
+        next = LIST_NEXT(plug, pointers);
+        if (!plug->seen) {
+            plugin_remove(plug);
+        } else if (plug->conf_changed) {
+            plug->conf_changed = 0;
+            plugin_conf_reload(plug);
+        }
+    }
+}
+
+/**
+ * Starts watching plug-in and plugin config directories, on failure changes
+ * only get picked up on SIGHUP.
+ */
+void watch_setup(void) {
+    int err = 0;
+    char *conf_path = path_form(conf_dir, LSM_PLUGIN_CONF_DIR_NAME);
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (-1 == inotify_fd) {
+        err = errno;
+        warn("Error on inotify_init1: %s, reload plug-ins via SIGHUP\n",
+             strerror(err));
+        free(conf_path);
+        return;
+    }
+
+    plugin_wd = inotify_add_watch(inotify_fd, plugin_dir, PLUGIN_DIR_EVENTS);
+    if (-1 == plugin_wd) {
+        err = errno;
+        warn("Error on watching %s: %s, reload plug-ins via SIGHUP\n",
+             plugin_dir, strerror(err));
+    }
+
+    conf_wd = inotify_add_watch(inotify_fd, conf_path, CONF_DIR_EVENTS);
+    if (-1 == conf_wd) {
+        err = errno;
+        info("Error on watching %s: %s\n", conf_path, strerror(err));
+    }
+    free(conf_path);
+}
+
+/**
+ * Stops watching directories.
+ */
+void watch_close(void) {
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+    inotify_fd = plugin_wd = conf_wd = -1;
+}
+
+/**
+ * Reads inotify events, marks plug-ins with changed config and schedules
+ * plugins_rescan() once the directories settled for RESCAN_DELAY_MS. Only
+ * events of plug-in files and of config files of known plug-ins count.
+ */
+void watch_process(void) {
+    char buf[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev = NULL;
+    char plugin_name[128];
+    struct plugin *item = NULL;
+    size_t ext_len = strlen(plugin_conf_extension);
+    size_t name_len = 0;
+    ssize_t len = 0;
+    char *ptr = NULL;
+
+    while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for (ptr = buf; ptr < buf + len;
+             ptr += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event *)ptr;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                LIST_FOREACH(item, &head, pointers) { item->conf_changed = 1; }
+            } else if (ev->wd == plugin_wd && ev->len) {
+                /* Plug-in dir is usually /usr/bin, skip unrelated files */
+                if (!plugin_name_get((char *)ev->name, plugin_name,
+                                     sizeof(plugin_name))) {
+                    continue;
+                }
+            } else if (ev->wd == conf_wd && ev->len) {
+                name_len = strlen(ev->name);
+                if (name_len <= ext_len ||
+                    strcmp(ev->name + name_len - ext_len,
+                           plugin_conf_extension) != 0) {
+                    continue;
+                }
+                snprintf(plugin_name, sizeof(plugin_name), "%.*s",
+                         (int)(name_len - ext_len), ev->name);
+                item = plugin_lookup_name(plugin_name);
+                if (!item) {
+                    continue;
+                }
+                item->conf_changed = 1;
+            } else {
+                continue;
+            }
+            rescan_deadline = now_ms() + RESCAN_DELAY_MS;
+        }
+    }
+}
+
 /**
  * Given a socket descriptor looks it up and returns the plug-in
  * @param fd        Socket descriptor to lookup
@@ -608,163 +1928,691 @@ struct plugin *plugin_lookup(int fd) {
 }
 
 /**
- * Does the actual fork and exec of the plug-in
- * @param plugin        Full filename and path of plug-in to exec.
+ * Decides whether a plug-in runs as root. The plug-in will still run no
+ * matter with root privilege or not, so that client could get detailed
+ * error message.
+ * @param plugin        Full filename and path of plug-in
  * @param client_fd     Client connected file descriptor
  * @param require_root  int, indicate whether this plugin require root
  *                      privilege or not
+ * @return 1 if plug-in keeps root privilege, else 0
+ */
+int plugin_root_allowed(char *plugin, int client_fd, int require_root) {
+    struct ucred cli_user_cred;
+    socklen_t cli_user_cred_len = sizeof(cli_user_cred);
+
+    if (require_root == 0) {
+        return 0;
+    }
+
+    if (getuid()) {
+        warn("Plugin %s requires root privileges, but lsmd daemon "
+             "is not running as root user\n",
+             plugin);
+    } else if (allow_root_plugin == 0) {
+        warn("Plugin %s requires root privileges, but %s disables "
+             "it globally\n",
+             plugin, LSMD_CONF_FILE);
+    } else {
+        /* Check socket client uid */
+        int rc_get_cli_uid = getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED,
+                                        &cli_user_cred, &cli_user_cred_len);
+        if (0 == rc_get_cli_uid) {
+            if (cli_user_cred.uid != 0) {
+                warn("Plugin %s requires root privileges, but "
+                     "client is not running as root user\n",
+                     plugin);
+            } else {
+                info("Plugin %s is running as root privilege\n", plugin);
+                return 1;
+            }
+        } else {
+            warn("Failed to get client socket uid, getsockopt() "
+                 "error: %d\n",
+                 errno);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Does the actual spawn and exec of the plug-in, see spawn().
+ * @param plugin        Full filename and path of plug-in to exec.
+ * @param client_fd     Client connected file descriptor, closed
+ * @param require_root  int, indicate whether this plugin require root
+ *                      privilege or not
+ * @return Plug-in process, -1 on failure
  */
-void exec_plugin(char *plugin, int client_fd, int require_root) {
+pid_t exec_plugin(char *plugin, int client_fd, int require_root) {
     int err = 0;
+    char fd_str[12];
+    char debug_out[64];
+    const char *plugin_argv[7];
+    struct spawn_args a;
+    char *p_copy = strdup(plugin);
+
+    if (!p_copy) {
+        log_and_exit("Memory allocation failure!\n");
+    }
 
     info("Exec'ing plug-in = %s\n", plugin);
 
-    pid_t process = fork();
-    if (process) {
-        /* Parent */
-        int rc = close(client_fd);
-        if (-1 == rc) {
-            err = errno;
-            info("Error on closing accepted socket in parent: %s\n",
-                 strerror(err));
-        }
+    memset(&a, 0, sizeof(a));
+    a.keep_fd = client_fd;
+    if (!plugin_root_allowed(plugin, client_fd, require_root)) {
+        a.set_ids = unprivileged_ids_get(&a.uid, &a.gid);
+    }
+    sprintf(fd_str, "%d", client_fd);
+
+    if (plugin_mem_debug) {
+        /* valgrind expands %p to the plug-in process id */
+        snprintf(debug_out, (sizeof(debug_out) - 1),
+                 "--log-file=/tmp/leaking_%d-%%p", getpid());
+
+        plugin_argv[0] = "valgrind";
+        plugin_argv[1] = "--leak-check=full";
+        plugin_argv[2] = "--show-reachable=no";
+        plugin_argv[3] = debug_out;
+        plugin_argv[4] = plugin;
+        plugin_argv[5] = fd_str;
+        plugin_argv[6] = NULL;
+        a.path = "/usr/bin/valgrind";
+    } else {
+        plugin_argv[0] = basename(p_copy);
+        plugin_argv[1] = fd_str;
+        plugin_argv[2] = NULL;
+        a.path = plugin;
+    }
+    a.argv = (char *const *)plugin_argv;
+
+    pid_t process = spawn(&a);
+    if (-1 == process) {
+        err = a.err;
+        warn("Error on exec'ing Plugin: %s: %s\n", a.path, strerror(err));
+    }
 
+    if (-1 == close(client_fd)) {
+        err = errno;
+        info("Error on closing accepted socket in parent: %s\n",
+             strerror(err));
+    }
+    free(p_copy);
+    return process;
+}
+
+/**
+ * Starts serving a client connection, via the plug-in zygote if there is one.
+ * @param p             Plug-in
+ * @param client_fd     Client connected file descriptor
+ * @param uid           Client user
+ */
+void session_start(struct plugin *p, int client_fd, uid_t uid) {
+    pid_t pid;
+    unsigned long long start = now_us();
+
+    if (0 == zygote_fork(p, client_fd)) {
+        p->stats.handoffs++;
+        session_add(p, 0, uid, 1, start);
     } else {
-        /* Child */
-        int exec_rc = 0;
-        char fd_str[12];
-        const char *plugin_argv[7];
-        extern char **environ;
-        struct ucred cli_user_cred;
-        socklen_t cli_user_cred_len = sizeof(cli_user_cred);
-
-        /*
-         * The plugin will still run no matter with root privilege or not.
-         * so that client could get detailed error message.
-         */
-        if (require_root == 0) {
-            drop_privileges();
-        } else {
-            if (getuid()) {
-                warn("Plugin %s requires root privileges, but lsmd daemon "
-                     "is not running as root user\n",
-                     plugin);
-            } else if (allow_root_plugin == 0) {
-                warn("Plugin %s requires root privileges, but %s disables "
-                     "it globally\n",
-                     plugin, LSMD_CONF_FILE);
-                drop_privileges();
+        pid = exec_plugin(p->file_path, client_fd, p->require_root);
+        if (pid > 0) {
+            p->stats.forks++;
+            spawn_record(p, start);
+            session_add(p, pid, uid, 0, start);
+        }
+    }
+}
+
+/**
+ * Returns the user of the client connection.
+ * @param client_fd     Client connected file descriptor
+ * @return uid, (uid_t)-1 if unknown
+ */
+uid_t client_uid(int client_fd) {
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+
+    if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len)) {
+        return (uid_t)-1;
+    }
+    return cred.uid;
+}
+
+/**
+ * Starts a session for the accepted connection if plug-in limits allow, else
+ * queues it, or rejects it with a busy error if the queue is full.
+ * @param p             Plug-in
+ * @param client_fd     Client connected file descriptor
+ */
+void session_request(struct plugin *p, int client_fd) {
+    uid_t uid = client_uid(client_fd);
+    struct waiter *w = NULL;
+
+    p->stats.accepts++;
+
+    if (p->draining) {
+        p->stats.rejects++;
+        client_reject(client_fd, "Plug-in is drained by administrator");
+        return;
+    }
+
+    if (session_allowed(p, uid)) {
+        session_start(p, client_fd, uid);
+        return;
+    }
+
+    if (p->queued >= p->queue_len) {
+        warn("Plug-in %s busy: %d sessions, %d queued, rejecting client\n",
+             p->file_path, p->active, p->queued);
+        p->stats.rejects++;
+        client_reject(client_fd, "Too many sessions, queue of plug-in is full");
+        return;
+    }
+
+    w = calloc(1, sizeof(struct waiter));
+    if (!w) {
+        log_and_exit("Memory allocation failure!\n");
+        return;
+    }
+    w->fd = client_fd;
+    w->uid = uid;
+    w->deadline = now_ms() + (unsigned long long)p->queue_tmo * 1000;
+    TAILQ_INSERT_TAIL(&p->waiters, w, pointers);
+    p->queued++;
+    info("Queued client of plug-in %s, %d queued\n", p->file_path, p->queued);
+}
+
+/**
+ * Starts sessions for queued connections which are now within limits and
+ * rejects those which waited too long, or all of them if plug-in is drained.
+ * Connections of a user blocked by max-sessions-per-user do not hold back
+ * the ones of other users.
+ * @param p         Plug-in
+ * @param now       Current time in ms of CLOCK_MONOTONIC
+ */
+void sessions_admit(struct plugin *p, unsigned long long now) {
+    struct waiter *w = NULL;
+    struct waiter *next = NULL;
+    char c;
+
+    for (w = TAILQ_FIRST(&p->waiters); w; w = next) {
+        next = TAILQ_NEXT(w, pointers);
+
+        if (p->draining) {
+            TAILQ_REMOVE(&p->waiters, w, pointers);
+            p->queued--;
+            p->stats.rejects++;
+            client_reject(w->fd, "Plug-in is drained by administrator");
+            free(w);
+        } else if (session_allowed(p, w->uid)) {
+            TAILQ_REMOVE(&p->waiters, w, pointers);
+            p->queued--;
+
+            /* Don't spend a session on a client which has given up */
+            if (0 == recv(w->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT)) {
+                close(w->fd);
             } else {
-                /* Check socket client uid */
-                int rc_get_cli_uid =
-                    getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED,
-                               &cli_user_cred, &cli_user_cred_len);
-                if (0 == rc_get_cli_uid) {
-                    if (cli_user_cred.uid != 0) {
-                        warn("Plugin %s requires root privileges, but "
-                             "client is not running as root user\n",
-                             plugin);
-                        drop_privileges();
-                    } else {
-                        info("Plugin %s is running as root privilege\n",
-                             plugin);
-                    }
-                } else {
-                    warn("Failed to get client socket uid, getsockopt() "
-                         "error: %d\n",
-                         errno);
-                    drop_privileges();
-                }
+                session_start(p, w->fd, w->uid);
             }
+            free(w);
+        } else if (now >= w->deadline) {
+            TAILQ_REMOVE(&p->waiters, w, pointers);
+            p->queued--;
+            warn("Client of plug-in %s timed out in queue\n", p->file_path);
+            p->stats.rejects++;
+            client_reject(w->fd, "Too many sessions, timed out in queue");
+            free(w);
         }
+    }
+}
+
+/**
+ * Logs active sessions and queue depth of each plug-in, on SIGUSR1.
+ */
+void sessions_dump(void) {
+    struct plugin *plug = NULL;
 
-        /* Make copy of plug-in string as once we call empty_plugin_list it
-         * will be deleted :-) */
-        char *p_copy = strdup(plugin);
+    LIST_FOREACH(plug, &head, pointers) {
+        notice("Plug-in %s: %d active sessions (limit %d, per user %d), "
+               "%d queued (limit %d)\n",
+               plug->file_path, plug->active, plug->max_sessions,
+               plug->max_user, plug->queued, plug->queue_len);
+    }
+}
+
+/**
+ * Creates the admin socket, warns and leaves it disabled on failure.
+ */
+void admin_setup(void) {
+    struct sockaddr_un addr;
+    struct stat statbuf;
+    int err = 0;
 
-        empty_plugin_list(&head);
-        sprintf(fd_str, "%d", client_fd);
+    if (!admin_socket || !strlen(admin_socket)) {
+        return;
+    }
 
-        if (plugin_mem_debug) {
-            char debug_out[64];
-            snprintf(debug_out, (sizeof(debug_out) - 1),
-                     "--log-file=/tmp/leaking_%d-%d", getppid(), getpid());
+    if (!lstat(admin_socket, &statbuf) && S_ISSOCK(statbuf.st_mode)) {
+        unlink(admin_socket);
+    }
 
-            plugin_argv[0] = "valgrind";
-            plugin_argv[1] = "--leak-check=full";
-            plugin_argv[2] = "--show-reachable=no";
-            plugin_argv[3] = debug_out;
-            plugin_argv[4] = p_copy;
-            plugin_argv[5] = fd_str;
-            plugin_argv[6] = NULL;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, admin_socket, sizeof(addr.sun_path) - 1);
 
-            exec_rc = execve("/usr/bin/valgrind", (char *const *)plugin_argv,
-                             environ);
-        } else {
-            plugin_argv[0] = basename(p_copy);
-            plugin_argv[1] = fd_str;
-            plugin_argv[2] = NULL;
-            exec_rc = execve(p_copy, (char *const *)plugin_argv, environ);
+    admin_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (-1 == admin_fd ||
+        -1 == bind(admin_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        -1 == chmod(admin_socket, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) ||
+        -1 == listen(admin_fd, 5)) {
+        err = errno;
+        warn("Error on creating admin socket %s: %s, admin socket disabled\n",
+             admin_socket, strerror(err));
+        if (-1 != admin_fd) {
+            close(admin_fd);
         }
+        admin_fd = -1;
+    }
+}
 
-        /*
-         * The only reason we would get here is if execve fails as execve
-         * does not return on success.
-         */
+/**
+ * Closes and removes the admin socket.
+ */
+void admin_close(void) {
+    struct admin_conn *a = NULL;
+
+    while (!TAILQ_EMPTY(&admin_conns)) {
+        a = TAILQ_FIRST(&admin_conns);
+        TAILQ_REMOVE(&admin_conns, a, pointers);
+        close(a->fd);
+        free(a);
+    }
+
+    if (admin_fd >= 0) {
+        close(admin_fd);
+        unlink(admin_socket);
+        admin_fd = -1;
+    }
+}
+
+/**
+ * Accepts a connection on the admin socket.  Sending the reply blocks for
+ * ADMIN_TMO_MS at most.
+ */
+void admin_accept(void) {
+    struct admin_conn *a = NULL;
+    struct timeval tv = {ADMIN_TMO_MS / 1000, (ADMIN_TMO_MS % 1000) * 1000};
+    int err = 0;
+    int fd = accept4(admin_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+    if (-1 == fd) {
         err = errno;
-        warn("Error on exec'ing Plugin: %s: %s (execve rc: %d)\n",
-            p_copy, strerror(err), exec_rc);
-        free(p_copy);
-        exit(1);
+        info("Error on accepting admin request: %s\n", strerror(err));
+        return;
+    }
+
+    if (-1 == setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv))) {
+        err = errno;
+        info("Error on setting admin send timeout: %s\n", strerror(err));
+        close(fd);
+        return;
+    }
+
+    a = calloc(1, sizeof(struct admin_conn));
+    if (!a) {
+        log_and_exit("Memory allocation failure!\n");
+        return;
+    }
+    a->fd = fd;
+    a->deadline = now_ms() + ADMIN_TMO_MS;
+    TAILQ_INSERT_TAIL(&admin_conns, a, pointers);
+}
+
+/**
+ * Prints a JSON object of non-zero counters, keyed by index.
+ * @param f         Output
+ * @param name      Key of the object
+ * @param counters  Counters
+ * @param count     Number of counters
+ */
+void admin_counters_print(FILE *f, const char *name,
+                          const unsigned long *counters, int count) {
+    int i = 0;
+    int first = 1;
+
+    fprintf(f, ", \"%s\": {", name);
+    for (i = 0; i < count; i++) {
+        if (counters[i]) {
+            fprintf(f, "%s\"%d\": %lu", first ? "" : ", ", i, counters[i]);
+            first = 0;
+        }
+    }
+    fprintf(f, "}");
+}
+
+/**
+ * Prints the stats of lsmd and each plug-in as JSON.
+ * @param f         Output
+ */
+void admin_stats_print(FILE *f) {
+    struct plugin *plug = NULL;
+    struct plugin_stats *st = NULL;
+    unsigned long accepts = 0;
+    unsigned long forks = 0;
+    int i = 0;
+
+    LIST_FOREACH(plug, &head, pointers) {
+        accepts += plug->stats.accepts;
+        forks += plug->stats.forks;
+    }
+
+    fprintf(f, "{\"uptime\": %llu, \"accepts\": %lu, \"forks\": %lu, "
+               "\"plugins\": {",
+            (now_us() - stats_start) / 1000000, accepts, forks);
+
+    LIST_FOREACH(plug, &head, pointers) {
+        st = &plug->stats;
+        fprintf(f,
+                "%s\"%s\": {\"active\": %d, \"queued\": %d, "
+                "\"max_sessions\": %d, \"max_sessions_per_user\": %d, "
+                "\"draining\": %s, \"zygote\": %s, \"accepts\": %lu, "
+                "\"forks\": %lu, \"zygote_handoffs\": %lu, "
+                "\"rejects\": %lu, \"exits\": %lu, \"crashes\": %lu, "
+                "\"zygote_exits\": %lu",
+                plug == LIST_FIRST(&head) ? "" : ", ", plug->name,
+                plug->active, plug->queued, plug->max_sessions,
+                plug->max_user, plug->draining ? "true" : "false",
+                plug->zygote_ready ? "true" : "false", st->accepts, st->forks,
+                st->handoffs, st->rejects, st->exits, st->crashes,
+                st->zygote_exits);
+        admin_counters_print(f, "exit_codes", st->exit_codes, 256);
+        admin_counters_print(f, "signals", st->signals, NSIG);
+
+        fprintf(f, ", \"spawn_latency_us\": {");
+        for (i = 0; i < SPAWN_HIST_BUCKETS - 1; i++) {
+            fprintf(f, "\"%llu\": %lu, ", spawn_hist_us[i],
+                    st->spawn_hist[i]);
+        }
+        fprintf(f, "\"+Inf\": %lu}}", st->spawn_hist[i]);
+    }
+    fprintf(f, "}}\n");
+}
+
+/**
+ * Sends the whole reply to an admin command, giving up once ADMIN_TMO_MS
+ * passed.
+ * @param fd        Admin connection
+ * @param reply     Reply
+ * @param len       Length of reply
+ */
+void admin_reply_send(int fd, const char *reply, size_t len) {
+    unsigned long long deadline = now_ms() + ADMIN_TMO_MS;
+    int flags = fcntl(fd, F_GETFL);
+    ssize_t sent = 0;
+    int err = 0;
+
+    /* Blocking, for SO_SNDTIMEO to apply */
+    if (-1 == flags || -1 == fcntl(fd, F_SETFL, flags & ~O_NONBLOCK)) {
+        err = errno;
+        info("Error on sending admin reply: %s\n", strerror(err));
+        return;
+    }
+
+    while (len > 0) {
+        if (now_ms() >= deadline) {
+            info("Timeout on sending admin reply, %zu bytes left\n", len);
+            return;
+        }
+        sent = send(fd, reply, len, MSG_NOSIGNAL);
+        if (-1 == sent) {
+            err = errno;
+            if (EINTR == err) {
+                continue;
+            }
+            info("Error on sending admin reply: %s\n", strerror(err));
+            return;
+        }
+        reply += sent;
+        len -= sent;
     }
 }
 
+/**
+ * Runs a command received on admin socket and sends the JSON reply:
+ *  - stats             Counters of lsmd and each plug-in
+ *  - drain <plugin>    Reject new clients of plug-in, existing sessions
+ *                      carry on
+ *  - resume <plugin>   Undo drain
+ *  - reload            Same as SIGHUP
+ * @param fd        Admin connection
+ * @param cmd       Command line
+ */
+void admin_command(int fd, char *cmd) {
+    char *reply = NULL;
+    size_t reply_len = 0;
+    char *arg = NULL;
+    struct plugin *plug = NULL;
+    FILE *f = open_memstream(&reply, &reply_len);
+
+    if (!f) {
+        log_and_exit("Memory allocation failure!\n");
+        return;
+    }
+
+    cmd[strcspn(cmd, "\r\n")] = '\0';
+    arg = strchr(cmd, ' ');
+    if (arg) {
+        *arg++ = '\0';
+    }
+    info("Admin command: %s %s\n", cmd, arg ? arg : "");
+
+    if (strcmp(cmd, "stats") == 0) {
+        admin_stats_print(f);
+    } else if (strcmp(cmd, "reload") == 0) {
+        serve_state = RESTART;
+        fprintf(f, "{\"result\": \"ok\"}\n");
+    } else if (strcmp(cmd, "drain") == 0 || strcmp(cmd, "resume") == 0) {
+        plug = arg ? plugin_lookup_name(arg) : NULL;
+        if (plug) {
+            plug->draining = (strcmp(cmd, "drain") == 0);
+            warn("Plug-in %s %s by administrator\n", plug->file_path,
+                 plug->draining ? "drained" : "resumed");
+            fprintf(f, "{\"result\": \"ok\"}\n");
+        } else {
+            fprintf(f, "{\"error\": \"plug-in not found\"}\n");
+        }
+    } else {
+        fprintf(f, "{\"error\": \"unknown command\"}\n");
+    }
+
+    fclose(f);
+    admin_reply_send(fd, reply, reply_len);
+    free(reply);
+}
+
+/**
+ * Reads what admin connections sent, runs their command once its line is
+ * complete, or the client stopped sending, or ADMIN_TMO_MS passed, then
+ * drops them.
+ * @param readfds   Readable file descriptors
+ * @param now       Current time in ms of CLOCK_MONOTONIC
+ */
+void admin_process(fd_set *readfds, unsigned long long now) {
+    static const char too_long[] = "{\"error\": \"command too long\"}\n";
+    struct admin_conn *a = NULL;
+    struct admin_conn *next = NULL;
+    ssize_t len = 0;
+    int done = 0;
+    int i = 0;
+
+    for (a = TAILQ_FIRST(&admin_conns); a; a = next) {
+        next = TAILQ_NEXT(a, pointers);
+        done = now >= a->deadline;
+        if (FD_ISSET(a->fd, readfds)) {
+            len = recv(a->fd, a->cmd + a->len, sizeof(a->cmd) - 1 - a->len,
+                       MSG_DONTWAIT);
+            if (len > 0) {
+                a->len += len;
+                a->cmd[a->len] = '\0';
+            } else if (0 == len ||
+                       (EAGAIN != errno && EWOULDBLOCK != errno &&
+                        EINTR != errno)) {
+                /* Shut down or broken, nothing more to come */
+                done = 1;
+            }
+        }
+
+        if (memchr(a->cmd, '\n', a->len)) {
+            admin_command(a->fd, a->cmd);
+        } else if (a->len == sizeof(a->cmd) - 1) {
+            admin_reply_send(a->fd, too_long, sizeof(too_long) - 1);
+        } else if (done && a->len) {
+            admin_command(a->fd, a->cmd);
+        } else if (!done) {
+            continue;
+        }
+
+        /* Unread input would reset the connection before the reply is read */
+        for (i = 0; i < ADMIN_DRAIN_MAX; i++) {
+            if (recv(a->fd, a->cmd, sizeof(a->cmd), MSG_DONTWAIT) <= 0) {
+                break;
+            }
+        }
+        TAILQ_REMOVE(&admin_conns, a, pointers);
+        close(a->fd);
+        free(a);
+    }
+}
+
+/**
+ * Shortens the time to wait for events to given deadline.
+ * @param deadline  ms of CLOCK_MONOTONIC
+ * @param now       Current time in ms of CLOCK_MONOTONIC
+ * @param wait_ms   Time to wait so far
+ * @return Time to wait in ms
+ */
+unsigned long long deadline_wait(unsigned long long deadline,
+                                 unsigned long long now,
+                                 unsigned long long wait_ms) {
+    if (deadline <= now) {
+        return 0;
+    }
+    return (deadline - now < wait_ms) ? deadline - now : wait_ms;
+}
+
 /**
  * Main event loop
  */
 void _serving(void) {
     struct plugin *plug = NULL;
-    struct timeval tmo;
+    struct waiter *w = NULL;
+    struct admin_conn *a = NULL;
+    struct timespec tmo;
     fd_set readfds;
     int nfds = 0;
     int err = 0;
+    unsigned long long now = 0;
+    unsigned long long wait_ms = 0;
 
     process_plugins();
 
+    if (LIST_EMPTY(&head)) {
+        log_and_exit("No plugins found in directory %s\n", plugin_dir);
+    }
+
     while (serve_state == RUNNING) {
         FD_ZERO(&readfds);
         nfds = 0;
-
-        tmo.tv_sec = 15;
-        tmo.tv_usec = 0;
+        now = now_ms();
+        wait_ms = 15000;
 
         LIST_FOREACH(plug, &head, pointers) {
+            /* Queue is in deadline order */
+            if (!TAILQ_EMPTY(&plug->waiters)) {
+                wait_ms = deadline_wait(TAILQ_FIRST(&plug->waiters)->deadline,
+                                        now, wait_ms);
+            }
+
             nfds = max(plug->fd, nfds);
             FD_SET(plug->fd, &readfds);
+            if (plug->zygote_fd >= 0) {
+                nfds = max(plug->zygote_fd, nfds);
+                FD_SET(plug->zygote_fd, &readfds);
+            }
         }
 
-        if (!nfds) {
+        /* With inotify, plug-ins may come back after all being removed */
+        if (!nfds && inotify_fd < 0) {
             log_and_exit("No plugins found in directory %s\n", plugin_dir);
         }
 
+        TAILQ_FOREACH(w, &rejected, pointers) {
+            wait_ms = deadline_wait(w->deadline, now, wait_ms);
+            nfds = max(w->fd, nfds);
+            FD_SET(w->fd, &readfds);
+        }
+
+        if (admin_fd >= 0) {
+            nfds = max(admin_fd, nfds);
+            FD_SET(admin_fd, &readfds);
+        }
+
+        if (inotify_fd >= 0) {
+            nfds = max(inotify_fd, nfds);
+            FD_SET(inotify_fd, &readfds);
+        }
+
+        if (rescan_deadline) {
+            wait_ms = deadline_wait(rescan_deadline, now, wait_ms);
+        }
+
+        TAILQ_FOREACH(a, &admin_conns, pointers) {
+            wait_ms = deadline_wait(a->deadline, now, wait_ms);
+            nfds = max(a->fd, nfds);
+            FD_SET(a->fd, &readfds);
+        }
+
+        tmo.tv_sec = wait_ms / 1000;
+        tmo.tv_nsec = (wait_ms % 1000) * 1000000;
+
+        /* SIGCHLD and SIGUSR1 are only delivered while in pselect() */
         nfds += 1;
-        int ready = select(nfds, &readfds, NULL, NULL, &tmo);
+        int ready = pselect(nfds, &readfds, NULL, NULL, &tmo, &orig_sigmask);
 
         if (-1 == ready) {
             if (serve_state != RUNNING) {
                 return;
-            } else {
+            } else if (EINTR != errno) {
                 err = errno;
                 log_and_exit("Error on selecting Plugin: %s", strerror(err));
             }
+            FD_ZERO(&readfds);
         } else if (ready > 0) {
             int fd = 0;
             for (fd = 0; fd < nfds; fd++) {
                 if (FD_ISSET(fd, &readfds)) {
-                    int cfd = accept(fd, NULL, NULL);
+                    if (fd == admin_fd) {
+                        admin_accept();
+                        continue;
+                    }
+
+                    if (fd == inotify_fd) {
+                        watch_process();
+                        continue;
+                    }
+
+                    struct plugin *p = plugin_lookup(fd);
+                    if (!p) {
+                        p = zygote_lookup(fd);
+                        if (p) {
+                            zygote_msg_handle(p);
+                        }
+                        continue;
+                    }
+
+                    int cfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
                     if (-1 != cfd) {
-                        struct plugin *p = plugin_lookup(fd);
-                        exec_plugin(p->file_path, cfd, p->require_root);
+                        session_request(p, cfd);
                     } else {
                         err = errno;
                         info("Error on accepting request: %s", strerror(err));
@@ -773,6 +2621,23 @@ void _serving(void) {
             }
         }
         child_cleanup();
+
+        now = now_ms();
+        rejected_process(&readfds, now);
+        admin_process(&readfds, now);
+
+        if (rescan_deadline && now >= rescan_deadline) {
+            rescan_deadline = 0;
+            plugins_rescan();
+        }
+        LIST_FOREACH(plug, &head, pointers) {
+            sessions_admit(plug, now);
+        }
+
+        if (dump_stats) {
+            dump_stats = 0;
+            sessions_dump();
+        }
     }
     clean_up();
 }
@@ -781,6 +2646,8 @@ void _serving(void) {
  * Main entry for daemon to work
  */
 void serve(void) {
+    admin_setup();
+    watch_setup();
     while (serve_state != EXIT) {
         if (serve_state == RESTART) {
             info("Reloading plug-ins\n");
@@ -789,6 +2656,8 @@ void serve(void) {
         _serving();
     }
     clean_up();
+    admin_close();
+    watch_close();
 }
 
 int ipc_lock_file() {
@@ -823,6 +2692,7 @@ int main(int argc, char *argv[]) {
             {"plugindir", required_argument, 0, 0}, // Index 1
             {"socketdir", required_argument, 0, 0}, // Index 2
             {"confdir", required_argument, 0, 0},   // Index 3
+            {"adminsocket", required_argument, 0, 0}, // Index 4
             {0, 0, 0, 0}};
 
         int option_index = 0;
@@ -844,6 +2714,9 @@ int main(int argc, char *argv[]) {
             case 3:
                 conf_dir = optarg;
                 break;
+            case 4:
+                admin_socket = optarg;
+                break;
             }
             break;
 
@@ -886,6 +2759,8 @@ int main(int argc, char *argv[]) {
     char *lsmd_conf_path = path_form(conf_dir, LSMD_CONF_FILE);
     parse_conf_bool(lsmd_conf_path, (char *)LSM_CONF_ALLOW_ROOT_OPT_NAME,
                     &allow_root_plugin);
+    parse_conf_bool(lsmd_conf_path, (char *)LSM_CONF_PY_ZYGOTE_OPT_NAME,
+                    &python_zygote);
     free(lsmd_conf_path);
 
     /* Check to see if we want to check plugin for memory errors */
@@ -893,6 +2768,7 @@ int main(int argc, char *argv[]) {
         plugin_mem_debug = 1;
     }
 
+    fds_cloexec();
     install_sh();
     if (allow_root_plugin == 0) {
         drop_privileges();
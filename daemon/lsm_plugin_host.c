@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2021 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Started by lsmd for plug-ins configured with 'in-process-library', see
+ * lsm_plugin_host_v1().
+ */
+
+#include <libstoragemgmt/libstoragemgmt_plug_interface.h>
+
+int main(int argc, char *argv[]) { return lsm_plugin_host_v1(argc, argv); }
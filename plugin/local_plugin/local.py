@@ -14,10 +14,12 @@
 #
 # Author: Gris Ge <fge@redhat.com>
 
+import errno
 import os
+import socket
 
 from lsm import (uri_parse, search_property, LsmError, ErrorNumber, Client,
-                 VERSION, IPlugin, NfsExport)
+                 VERSION, IPlugin, NfsExport, Event)
 
 from hpsa_plugin import SmartArray
 from arcconf_plugin import Arcconf
@@ -37,6 +39,13 @@ def _wrapper(*args, **kwargs):
     return _wrapper
 
 
+# NETLINK_KOBJECT_UEVENT of linux/netlink.h, not in the socket module.
+_NETLINK_KOBJECT_UEVENT = 15
+# Kernel uevents which could change disks, pools or volumes.
+_UEVENT_SUBSYSTEMS = [b'SUBSYSTEM=block', b'SUBSYSTEM=scsi',
+                      b'SUBSYSTEM=scsi_disk']
+
+
 class LocalPlugin(IPlugin):
     _KMOD_PLUGIN_MAP = {
         "megaraid_sas": "megaraid",
@@ -52,6 +61,7 @@ def __init__(self):
         self.sys_con_map = {}
         self.unregistered = False
         self.nfs_conn = None
+        self.uevent_sock = None
 
     def __del__(self):
         if not self.unregistered:
@@ -168,8 +178,58 @@ def plugin_register(self, uri, password, timeout, flags=Client.FLAG_RSVD):
     def plugin_unregister(self, flags=Client.FLAG_RSVD):
         for conn in self.conns:
             conn.plugin_unregister()
+        if self.uevent_sock is not None:
+            self.uevent_sock.close()
+            self.uevent_sock = None
         self.unregistered = True
 
+    def _uevent_read(self):
+        """
+        Returns True if any of the pending kernel uevents is about
+        _UEVENT_SUBSYSTEMS.
+        """
+        found = False
+        while True:
+            try:
+                msg = self.uevent_sock.recv(8192)
+            except socket.error as sock_err:
+                if sock_err.errno in (errno.EAGAIN, errno.EWOULDBLOCK):
+                    return found
+                raise
+            for field in msg.split(b'\0'):
+                if field in _UEVENT_SUBSYSTEMS:
+                    found = True
+
+    @_handle_errors
+    def changes(self, start, flags=Client.FLAG_RSVD):
+        """
+        Storage of local controllers changes along with the kernel devices,
+        so kernel uevents tell when to look again.  The controller tools
+        cannot tell which object changed.
+        """
+        if start:
+            if self.uevent_sock is None:
+                try:
+                    s = socket.socket(socket.AF_NETLINK, socket.SOCK_DGRAM,
+                                      _NETLINK_KOBJECT_UEVENT)
+                    # Multicast group 1 is the kernel one
+                    s.bind((0, 1))
+                    s.setblocking(False)
+                except (AttributeError, socket.error) as sock_err:
+                    raise LsmError(ErrorNumber.NO_SUPPORT,
+                                   "No kernel uevents: %s" % sock_err)
+                self.uevent_sock = s
+            self._uevent_read()
+            return []
+
+        if not self._uevent_read():
+            return []
+        return [(Event.CLASS_DISK, None), (Event.CLASS_POOL, None),
+                (Event.CLASS_VOLUME, None)]
+
+    def changes_fd(self):
+        return self.uevent_sock.fileno()
+
     @_handle_errors
     def job_status(self, job_id, flags=Client.FLAG_RSVD):
         raise LsmError(ErrorNumber.NO_SUPPORT, "Not supported yet")
@@ -48,8 +48,6 @@
 #define _VOLUME_RAID_TYPE_OTHER_STR     "22"
 #define _DEFAULT_SYS_READ_CACHE_PCT_STR "10"
 
-static char _SYS_VERSION[_BUFF_SIZE];
-
 static const lsm_volume_raid_type _SUPPORTED_RAID_TYPES[] = {
     LSM_VOLUME_RAID_TYPE_RAID0,  LSM_VOLUME_RAID_TYPE_RAID1,
     LSM_VOLUME_RAID_TYPE_RAID5,  LSM_VOLUME_RAID_TYPE_RAID6,
@@ -353,10 +351,12 @@ out:
     return rc;
 }
 
+/*
+ * Constant string, so that plug-in instances hosted as threads in
+ * lsm_plugin_host do not share a scratch buffer.
+ */
 static const char *_sys_version(void) {
-    snprintf(_SYS_VERSION, _BUFF_SIZE, "%s_%s", _DB_VERSION_STR_PREFIX,
-        _DB_VERSION);
-    return _SYS_VERSION;
+    return _DB_VERSION_STR_PREFIX "_" _DB_VERSION;
 }
 
 int _db_pool_create_from_disk(char *err_msg, sqlite3 *db, const char *name,
@@ -598,6 +598,8 @@ int _db_init(char *err_msg, sqlite3 **db, const char *db_file,
         goto out;
     }
 
+    _good(_db_sql_exec(err_msg, *db, _CHANGES_INIT, NULL), rc, out);
+
     _good(_db_sql_trans_commit(err_msg, *db), rc, out);
 
 out:
@@ -613,6 +615,42 @@ out:
     return rc;
 }
 
+int _db_open_read_only(char *err_msg, sqlite3 **db, const char *db_file,
+                       uint32_t timeout) {
+    int rc = LSM_ERR_OK;
+    int db_rc = SQLITE_OK;
+
+    assert(db != NULL);
+
+    db_rc = sqlite3_open_v2(db_file, db, SQLITE_OPEN_READONLY, NULL);
+    if (db_rc != SQLITE_OK) {
+        rc = LSM_ERR_PLUGIN_BUG;
+        _lsm_err_msg_set(err_msg,
+                         "Failed to open SQLite database file '%s' "
+                         "read only, error %d: %s",
+                         db_file, db_rc, sqlite3_errmsg(*db));
+        goto out;
+    }
+
+    db_rc = sqlite3_busy_timeout(*db, timeout & INT_MAX);
+    if (db_rc != SQLITE_OK) {
+        rc = LSM_ERR_PLUGIN_BUG;
+        _lsm_err_msg_set(err_msg,
+                         "Failed to set timeout %" PRIu32 ", "
+                         "sqlite error %d %s",
+                         timeout, db_rc, sqlite3_errmsg(*db));
+        goto out;
+    }
+
+out:
+    if (rc != LSM_ERR_OK) {
+        sqlite3_close(*db);
+        *db = NULL;
+    }
+
+    return rc;
+}
+
 int _db_sql_exec(char *err_msg, sqlite3 *db, const char *cmd,
                  struct _vector **vec) {
     int rc = LSM_ERR_OK;
@@ -673,6 +711,10 @@ void _db_close(sqlite3 *db) {
 
 int _db_sql_trans_begin(char *err_msg, sqlite3 *db) {
     assert(db != NULL);
+    /* Read only connections never write, no need to hold out other ones */
+    if (sqlite3_db_readonly(db, "main") == 1)
+        return _db_sql_exec(err_msg, db, "BEGIN TRANSACTION;",
+                            NULL /* don't parse output */);
     return _db_sql_exec(err_msg, db, "BEGIN IMMEDIATE TRANSACTION;",
                         NULL /* don't parse output */);
 }
@@ -844,6 +886,98 @@ uint64_t _db_last_rowid(sqlite3 *db) {
     return rowid > 0 ? rowid : 0;
 }
 
+int _db_changes_last(char *err_msg, sqlite3 *db, uint64_t *seq) {
+    int rc = LSM_ERR_OK;
+    struct _vector *vec = NULL;
+
+    assert(db != NULL);
+    assert(seq != NULL);
+
+    _good(_db_sql_exec(err_msg, db,
+                       "SELECT IFNULL(MAX(seq), 0) AS seq "
+                       "FROM " _DB_TABLE_CHANGES ";",
+                       &vec),
+          rc, out);
+
+    if (_vector_size(vec) != 1) {
+        rc = LSM_ERR_PLUGIN_BUG;
+        _lsm_err_msg_set(err_msg, "BUG: No last change found");
+        goto out;
+    }
+    _good(_str_to_uint64(err_msg,
+                         lsm_hash_string_get(_vector_get(vec, 0), "seq"), seq),
+          rc, out);
+
+out:
+    _db_sql_exec_vec_free(vec);
+    return rc;
+}
+
+int _db_changes_report(char *err_msg, sqlite3 *db, lsm_plugin_ptr c,
+                       uint64_t *seq) {
+    int rc = LSM_ERR_OK;
+    struct _vector *vec = NULL;
+    lsm_hash *change = NULL;
+    uint32_t i = 0;
+    uint64_t cur_seq = 0;
+    uint64_t event_class = 0;
+    const char *sim_id_str = NULL;
+    const char *prefix = NULL;
+    char sql_cmd[_BUFF_SIZE];
+    char lsm_id[_BUFF_SIZE];
+
+    assert(db != NULL);
+    assert(seq != NULL);
+
+    _snprintf_buff(err_msg, rc, out, sql_cmd,
+                   "SELECT seq, class, sim_id FROM " _DB_TABLE_CHANGES
+                   " WHERE seq > %" PRIu64 " ORDER BY seq;",
+                   *seq);
+    _good(_db_sql_exec(err_msg, db, sql_cmd, &vec), rc, out);
+
+    _vector_for_each(vec, i, change) {
+        _good(_str_to_uint64(err_msg, lsm_hash_string_get(change, "seq"),
+                             &cur_seq),
+              rc, out);
+        if ((i == 0) && (cur_seq != *seq + 1)) {
+            /* Pruned before we got to read it */
+            lsm_plug_object_changed(c, LSM_EVENT_CLASS_ALL, NULL);
+        }
+        _good(_str_to_uint64(err_msg, lsm_hash_string_get(change, "class"),
+                             &event_class),
+              rc, out);
+        switch (event_class) {
+        case LSM_EVENT_CLASS_POOL:
+            prefix = "POOL_ID";
+            break;
+        case LSM_EVENT_CLASS_VOLUME:
+            prefix = "VOL_ID";
+            break;
+        case LSM_EVENT_CLASS_DISK:
+            prefix = "DISK_ID";
+            break;
+        default:
+            prefix = NULL;
+            break;
+        }
+        sim_id_str = lsm_hash_string_get(change, "sim_id");
+        if ((prefix == NULL) || (sim_id_str == NULL) ||
+            (strlen(sim_id_str) == 0)) {
+            lsm_plug_object_changed(c, event_class, NULL);
+        } else {
+            lsm_plug_object_changed(
+                c, event_class,
+                _db_sim_id_to_lsm_id(lsm_id, prefix,
+                                     strtoull(sim_id_str, NULL, 10)));
+        }
+        *seq = cur_seq;
+    }
+
+out:
+    _db_sql_exec_vec_free(vec);
+    return rc;
+}
+
 uint64_t _db_blk_size_rounding(uint64_t size_bytes) {
     return (size_bytes + _BLOCK_SIZE - 1) / _BLOCK_SIZE * _BLOCK_SIZE;
 }
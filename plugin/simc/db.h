@@ -72,6 +72,15 @@
 #define _DB_TABLE_NFS_EXP_RO_HOSTS   "exp_ro_hosts"
 #define _DB_TABLE_BATS               "batteries"
 #define _DB_TABLE_BATS_VIEW          "bats_view"
+#define _DB_TABLE_CHANGES            "changes"
+
+/* Rows of the changes table kept for subscribed plug-in instances to read */
+#define _DB_CHANGES_KEEP "1024"
+/* Values of changes.class, the LSM_EVENT_CLASS_XXX of changed object */
+#define _DB_CHANGES_SYSTEM "1"
+#define _DB_CHANGES_POOL   "2"
+#define _DB_CHANGES_VOLUME "4"
+#define _DB_CHANGES_DISK   "8"
 
 #define _DB_SIM_ID_NONE 0
 
@@ -88,6 +97,13 @@
 int _db_init(char *err_msg, sqlite3 **db, const char *db_file,
              uint32_t timeout);
 
+/*
+ * Open a read only connection to db_file initialized by _db_init(). Its
+ * transactions don't lock out each other, only writers.
+ */
+int _db_open_read_only(char *err_msg, sqlite3 **db, const char *db_file,
+                       uint32_t timeout);
+
 int _db_sql_exec(char *err_msg, sqlite3 *db, const char *cmd,
                  struct _vector **vec);
 
@@ -130,6 +146,18 @@ uint64_t _db_last_rowid(sqlite3 *db);
 
 uint64_t _db_blk_size_rounding(uint64_t size_bytes);
 
+/*
+ * Set *seq to the sequence number of the last change.
+ */
+int _db_changes_last(char *err_msg, sqlite3 *db, uint64_t *seq);
+
+/*
+ * Report the systems, pools, volumes and disks changed after sequence number
+ * *seq through lsm_plug_object_changed() and update *seq.
+ */
+int _db_changes_report(char *err_msg, sqlite3 *db, lsm_plugin_ptr c,
+                       uint64_t *seq);
+
 int _db_sim_pool_of_sim_id(char *err_msg, sqlite3 *db, uint64_t sim_pool_id,
                            lsm_hash **sim_pool);
 
@@ -517,4 +517,68 @@ static const char *_TABLE_INIT =
     "    GROUP BY\n"
     "        exp.id;\n";
 
+/*
+ * Journal of changed systems, pools, volumes and disks, filled by triggers so
+ * that every write path is covered.  Executed on every open, so that state
+ * files created by older versions get it too.  A sim_id of NULL stands for
+ * any object of the class.
+ */
+#define _CHANGES_TRIGGER(table, event, body)                                   \
+    "CREATE TRIGGER IF NOT EXISTS " table "_" event "_changes\n"               \
+    "    AFTER " event " ON " table "\n"                                      \
+    "    BEGIN\n" body "    END;\n"
+
+#define _CHANGES_ADD(class, sim_id)                                            \
+    "        INSERT INTO " _DB_TABLE_CHANGES " (class, sim_id)\n"              \
+    "            SELECT " class ", " sim_id " WHERE " sim_id " IS NOT NULL;\n"
+
+static const char *_CHANGES_INIT =
+    "CREATE TABLE IF NOT EXISTS " _DB_TABLE_CHANGES " (\n"
+    "    seq INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+    "    class INTEGER NOT NULL,\n"
+    "    sim_id INTEGER);\n"
+    _CHANGES_TRIGGER(
+        _DB_TABLE_CHANGES, "INSERT",
+        "        DELETE FROM " _DB_TABLE_CHANGES "\n"
+        "            WHERE seq <= NEW.seq - " _DB_CHANGES_KEEP ";\n")
+    _CHANGES_TRIGGER(_DB_TABLE_SYS, "UPDATE",
+                     "        INSERT INTO " _DB_TABLE_CHANGES " (class)\n"
+                     "            VALUES (" _DB_CHANGES_SYSTEM ");\n")
+    _CHANGES_TRIGGER(_DB_TABLE_POOLS, "INSERT",
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.parent_pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_POOLS, "UPDATE",
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.parent_pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_POOLS, "DELETE",
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.parent_pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_DISKS, "INSERT",
+                     _CHANGES_ADD(_DB_CHANGES_DISK, "NEW.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.owner_pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_DISKS, "UPDATE",
+                     _CHANGES_ADD(_DB_CHANGES_DISK, "NEW.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.owner_pool_id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.owner_pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_DISKS, "DELETE",
+                     _CHANGES_ADD(_DB_CHANGES_DISK, "OLD.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.owner_pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_VOLS, "INSERT",
+                     _CHANGES_ADD(_DB_CHANGES_VOLUME, "NEW.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_VOLS, "UPDATE",
+                     _CHANGES_ADD(_DB_CHANGES_VOLUME, "NEW.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.pool_id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_VOLS, "DELETE",
+                     _CHANGES_ADD(_DB_CHANGES_VOLUME, "OLD.id")
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.pool_id"))
+    /* File systems take space from pools */
+    _CHANGES_TRIGGER(_DB_TABLE_FSS, "INSERT",
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_FSS, "UPDATE",
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "NEW.pool_id"))
+    _CHANGES_TRIGGER(_DB_TABLE_FSS, "DELETE",
+                     _CHANGES_ADD(_DB_CHANGES_POOL, "OLD.pool_id"));
+
 #endif /* End of _SIMC_DB_TABLE_INIT_H_ */
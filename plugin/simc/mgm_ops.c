@@ -438,6 +438,36 @@ out:
     return rc;
 }
 
+/*
+ * Every write to the tables we report goes through the triggers of the
+ * 'changes' table, so we only need to replay the rows newer than the last
+ * one we have seen.
+ */
+int changes_get(lsm_plugin_ptr c, int start, lsm_flag flags) {
+    int rc = LSM_ERR_OK;
+    sqlite3 *db = NULL;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    struct _simc_private_data *pri_data = NULL;
+
+    _UNUSED(flags);
+    _lsm_err_msg_clear(err_msg);
+
+    _good(_get_db_from_plugin_ptr(err_msg, c, &db), rc, out);
+    pri_data = lsm_private_data_get(c);
+
+    if (start)
+        _good(_db_changes_last(err_msg, db, &pri_data->change_seq), rc, out);
+    else
+        _good(_db_changes_report(err_msg, db, c, &pri_data->change_seq), rc,
+              out);
+
+out:
+    if (rc != LSM_ERR_OK)
+        lsm_log_error_basic(c, rc, err_msg);
+
+    return rc;
+}
+
 int system_list(lsm_plugin_ptr c, lsm_system **systems[],
                 uint32_t *system_count, lsm_flag flags) {
     int rc = LSM_ERR_OK;
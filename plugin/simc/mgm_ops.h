@@ -48,6 +48,8 @@ int pool_list(lsm_plugin_ptr c, const char *search_key,
 int system_list(lsm_plugin_ptr c, lsm_system **systems[],
                 uint32_t *system_count, lsm_flag flags);
 
+int changes_get(lsm_plugin_ptr c, int start, lsm_flag flags);
+
 int _job_create(char *err_msg, sqlite3 *db, lsm_data_type data_type,
                 uint64_t sim_id, char **lsm_job_id);
 
@@ -22,6 +22,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <libstoragemgmt/libstoragemgmt.h>
 #include <libstoragemgmt/libstoragemgmt_plug_interface.h>
@@ -34,6 +36,16 @@
 #define _VOLUME_ADMIN_STATE_ENABLE_STR  "1"
 #define _VOLUME_ADMIN_STATE_DISABLE_STR "0"
 
+/* Volume resizing reports its progress ten times over LSM_SIM_TIME */
+#define _VOLUME_RESIZE_JOB_STEPS 10
+
+struct _volume_resize_job {
+    char *statefile;
+    uint32_t timeout;
+    uint64_t sim_vol_id;
+    uint64_t new_size;
+};
+
 static lsm_disk *_sim_disk_to_lsm(char *err_msg, lsm_hash *sim_disk);
 lsm_access_group *_sim_ag_to_lsm(char *err_msg, lsm_hash *sim_ag);
 static lsm_target_port *_sim_tgt_to_lsm(char *err_msg, lsm_hash *sim_tgt);
@@ -535,32 +547,21 @@ out:
     return rc;
 }
 
-int volume_resize(lsm_plugin_ptr c, lsm_volume *volume, uint64_t new_size,
-                  lsm_volume **resized_volume, char **job, lsm_flag flags) {
+/*
+ * Checks that the volume still exists and that its pool has room to grow it
+ * to new_size, which has to be rounded already.
+ */
+static int _volume_resize_check(char *err_msg, sqlite3 *db, uint64_t sim_vol_id,
+                                uint64_t new_size) {
     int rc = LSM_ERR_OK;
-    char err_msg[_LSM_ERR_MSG_LEN];
-    uint64_t sim_vol_id = 0;
     lsm_hash *sim_vol = NULL;
-    uint64_t increment_size = 0;
     uint64_t cur_size = 0;
     uint64_t sim_pool_id = 0;
-    char new_size_str[_BUFF_SIZE];
-    sqlite3 *db = NULL;
 
-    _UNUSED(flags);
-    _lsm_err_msg_clear(err_msg);
-    _good(_check_null_ptr(err_msg, 3 /* argument count */, volume,
-                          resized_volume, job),
-          rc, out);
-    _good(_get_db_from_plugin_ptr(err_msg, c, &db), rc, out);
-    _good(_db_sql_trans_begin(err_msg, db), rc, out);
-
-    sim_vol_id = _db_lsm_id_to_sim_id(lsm_volume_id_get(volume));
     _good(_db_sim_vol_of_sim_id(err_msg, db, sim_vol_id, &sim_vol), rc, out);
     _good(_str_to_uint64(err_msg, lsm_hash_string_get(sim_vol, "total_space"),
                          &cur_size),
           rc, out);
-    new_size = _db_blk_size_rounding(new_size);
     if (cur_size == new_size) {
         rc = LSM_ERR_NO_STATE_CHANGE;
         _lsm_err_msg_set(err_msg, "Specified new size is identical to "
@@ -568,40 +569,161 @@ int volume_resize(lsm_plugin_ptr c, lsm_volume *volume, uint64_t new_size,
         goto out;
     }
     if (new_size > cur_size) {
-        increment_size = new_size - cur_size;
-        sim_pool_id = _db_lsm_id_to_sim_id(lsm_volume_pool_id_get(volume));
+        sim_pool_id =
+            _db_lsm_id_to_sim_id(lsm_hash_string_get(sim_vol, "lsm_pool_id"));
 
-        if (_pool_has_enough_free_size(db, sim_pool_id, increment_size) ==
+        if (_pool_has_enough_free_size(db, sim_pool_id, new_size - cur_size) ==
             false) {
             rc = LSM_ERR_NOT_ENOUGH_SPACE;
             _lsm_err_msg_set(err_msg, "Insufficient space in pool");
             goto out;
         }
     }
+
+out:
+    if (sim_vol != NULL)
+        lsm_hash_free(sim_vol);
+
+    return rc;
+}
+
+static void _volume_resize_job_free(void *data) {
+    struct _volume_resize_job *vr_job = data;
+
+    if (vr_job != NULL) {
+        free(vr_job->statefile);
+        free(vr_job);
+    }
+}
+
+/*
+ * Runs on a worker thread of the plugin runtime, hence uses a SQLite
+ * connection of its own.  Emulates a backend taking LSM_SIM_TIME seconds to
+ * resize the volume, then checks again as the volume or the free space of
+ * its pool might be gone meanwhile.
+ */
+static int _volume_resize_job_work(lsm_plug_job *job, void *data,
+                                   lsm_data_type *type, void **value) {
+    int rc = LSM_ERR_OK;
+    struct _volume_resize_job *vr_job = data;
+    sqlite3 *db = NULL;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    const char *duration_str = NULL;
+    double duration = 0;
+    char new_size_str[_BUFF_SIZE];
+    lsm_hash *sim_vol = NULL;
+    uint32_t i = 0;
+
+    _lsm_err_msg_clear(err_msg);
+    *type = LSM_DATA_TYPE_VOLUME;
+    *value = NULL;
+
+    duration_str = getenv("LSM_SIM_TIME");
+    if (duration_str == NULL)
+        duration_str = _DB_DEFAULT_JOB_DURATION;
+    duration = strtod(duration_str, NULL);
+    for (i = 0; i < _VOLUME_RESIZE_JOB_STEPS; ++i) {
+        lsm_plug_job_progress_set(job, i * 100 / _VOLUME_RESIZE_JOB_STEPS);
+        if (duration > 0)
+            usleep(duration * 1000000 / _VOLUME_RESIZE_JOB_STEPS);
+    }
+
+    rc = _db_init(err_msg, &db, vr_job->statefile, vr_job->timeout);
+    if (rc != LSM_ERR_OK) {
+        /* Closed by _db_init() already */
+        db = NULL;
+        goto out;
+    }
+    _good(_db_sql_trans_begin(err_msg, db), rc, out);
+    _good(_volume_resize_check(err_msg, db, vr_job->sim_vol_id,
+                               vr_job->new_size),
+          rc, out);
     /*
      * TODO(Gris Ge): If a volume is in a replication relationship, resize
      *                should be handled properly.
      */
-    _snprintf_buff(err_msg, rc, out, new_size_str, "%" PRIu64, new_size);
-    _good(_db_data_update(err_msg, db, _DB_TABLE_VOLS, sim_vol_id,
+    _snprintf_buff(err_msg, rc, out, new_size_str, "%" PRIu64,
+                   vr_job->new_size);
+    _good(_db_data_update(err_msg, db, _DB_TABLE_VOLS, vr_job->sim_vol_id,
                           "total_space", new_size_str),
           rc, out);
-    _good(_db_data_update(err_msg, db, _DB_TABLE_VOLS, sim_vol_id,
+    _good(_db_data_update(err_msg, db, _DB_TABLE_VOLS, vr_job->sim_vol_id,
                           "consumed_size", new_size_str),
           rc, out);
-
-    _good(_job_create(err_msg, db, LSM_DATA_TYPE_VOLUME, sim_vol_id, job), rc,
+    _good(_db_sim_vol_of_sim_id(err_msg, db, vr_job->sim_vol_id, &sim_vol), rc,
           out);
+    *value = _sim_vol_to_lsm(err_msg, sim_vol);
+    _alloc_null_check(err_msg, *value, rc, out);
     _good(_db_sql_trans_commit(err_msg, db), rc, out);
 
 out:
-    if (resized_volume != NULL)
-        *resized_volume = NULL;
     if (sim_vol != NULL)
         lsm_hash_free(sim_vol);
+    if (db != NULL) {
+        if (rc != LSM_ERR_OK)
+            _db_sql_trans_rollback(db);
+        _db_close(db);
+    }
+    if (rc != LSM_ERR_OK) {
+        if (*value != NULL) {
+            lsm_volume_record_free(*value);
+            *value = NULL;
+        }
+        lsm_plug_job_error_set(job, rc, err_msg);
+    }
+    return rc;
+}
+
+/*
+ * Resizes the volume from a job of the plugin runtime, see
+ * lsm_plug_job_submit(), after failing early on what can be told right away.
+ */
+int volume_resize(lsm_plugin_ptr c, lsm_volume *volume, uint64_t new_size,
+                  lsm_volume **resized_volume, char **job, lsm_flag flags) {
+    int rc = LSM_ERR_OK;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    uint64_t sim_vol_id = 0;
+    sqlite3 *db = NULL;
+    struct _simc_private_data *pri_data = NULL;
+    struct _volume_resize_job *vr_job = NULL;
+
+    _UNUSED(flags);
+    _lsm_err_msg_clear(err_msg);
+    _good(_check_null_ptr(err_msg, 3 /* argument count */, volume,
+                          resized_volume, job),
+          rc, out);
+    _good(_get_db_from_plugin_ptr(err_msg, c, &db), rc, out);
+    pri_data = lsm_private_data_get(c);
+
+    sim_vol_id = _db_lsm_id_to_sim_id(lsm_volume_id_get(volume));
+    new_size = _db_blk_size_rounding(new_size);
+    _good(_volume_resize_check(err_msg, db, sim_vol_id, new_size), rc, out);
+
+    vr_job = calloc(1, sizeof(struct _volume_resize_job));
+    _alloc_null_check(err_msg, vr_job, rc, out);
+    vr_job->statefile = strdup(pri_data->statefile);
+    vr_job->timeout = pri_data->timeout;
+    vr_job->sim_vol_id = sim_vol_id;
+    vr_job->new_size = new_size;
+    if (vr_job->statefile == NULL) {
+        _volume_resize_job_free(vr_job);
+        rc = LSM_ERR_NO_MEMORY;
+        _lsm_err_msg_set(err_msg, "No memory");
+        goto out;
+    }
+
+    rc = lsm_plug_job_submit(c, _volume_resize_job_work, vr_job,
+                             _volume_resize_job_free, job);
+    if (rc == LSM_ERR_JOB_STARTED)
+        rc = LSM_ERR_OK;
+    else
+        _lsm_err_msg_set(err_msg, "Failed to queue volume resizing job");
+
+out:
+    if (resized_volume != NULL)
+        *resized_volume = NULL;
 
     if (rc != LSM_ERR_OK) {
-        _db_sql_trans_rollback(db);
         if (job != NULL)
             *job = NULL;
         lsm_log_error_basic(c, rc, err_msg);
@@ -39,6 +39,7 @@
 
 #define PLUGIN_NAME             "Compiled plug-in example"
 #define DEFAULT_STATE_FILE_PATH "/tmp/lsm_sim_data"
+#define REQUEST_WORKERS         4
 
 int plugin_register(lsm_plugin_ptr c, const char *uri, const char *password,
                     uint32_t timeout, lsm_flag flags);
@@ -115,6 +116,32 @@ static struct lsm_ops_v1_3 ops_v1_3 = {
     volume_read_cache_policy_update,
 };
 
+/*
+ * Each request worker lists through its own read only connection, so they
+ * don't take turns on pri_data->db.
+ */
+static int worker_init(lsm_plugin_ptr c, void **data) {
+    int rc = LSM_ERR_OK;
+    char err_msg[_LSM_ERR_MSG_LEN];
+    struct _simc_private_data *pri_data = lsm_private_data_get(c);
+    sqlite3 *db = NULL;
+
+    _lsm_err_msg_clear(err_msg);
+
+    rc = _db_open_read_only(err_msg, &db, pri_data->statefile,
+                            pri_data->timeout);
+    if (rc != LSM_ERR_OK)
+        lsm_log_error_basic(c, rc, err_msg);
+
+    *data = db;
+    return rc;
+}
+
+static void worker_cleanup(lsm_plugin_ptr c, void *data) {
+    _UNUSED(c);
+    _db_close((sqlite3 *)data);
+}
+
 int plugin_register(lsm_plugin_ptr c, const char *uri, const char *password,
                     uint32_t timeout, lsm_flag flags) {
     int rc = LSM_ERR_OK;
@@ -173,10 +200,23 @@ int plugin_register(lsm_plugin_ptr c, const char *uri, const char *password,
     _alloc_null_check(err_msg, pri_data, rc, out);
 
     pri_data->db = db;
+    pri_data->statefile = strdup(statefile);
     pri_data->timeout = timeout;
+    pri_data->change_seq = 0;
+    if (pri_data->statefile == NULL) {
+        free(pri_data);
+        rc = LSM_ERR_NO_MEMORY;
+        _lsm_err_msg_set(err_msg, "No memory");
+        goto out;
+    }
 
     rc = lsm_register_plugin_v1_3(c, pri_data, &mgm_ops, &san_ops, &fs_ops,
                                   &nfs_ops, &ops_v1_2, &ops_v1_3);
+    if (rc == LSM_ERR_OK)
+        rc = lsm_plug_changes_register(c, changes_get, -1);
+    if (rc == LSM_ERR_OK)
+        rc = lsm_plug_concurrency_register(c, REQUEST_WORKERS, worker_init,
+                                           worker_cleanup);
 
 out:
     free(scheme);
@@ -203,12 +243,17 @@ int plugin_unregister(lsm_plugin_ptr c, lsm_flag flags) {
         pri_data = lsm_private_data_get(c);
         if ((pri_data != NULL) && (pri_data->db != NULL))
             _db_close(pri_data->db);
+        if (pri_data != NULL)
+            free(pri_data->statefile);
         free(pri_data);
     }
 
     return rc;
 }
 
+LSM_PLUGIN_SO_DEFINE(plugin_register, plugin_unregister, PLUGIN_NAME,
+                     _DB_VERSION);
+
 int main(int argc, char *argv[]) {
     return lsm_plugin_init_v1(argc, argv, plugin_register, plugin_unregister,
                               PLUGIN_NAME, _DB_VERSION);
@@ -42,6 +42,11 @@ int _get_db_from_plugin_ptr(char *err_msg, lsm_plugin_ptr c, sqlite3 **db) {
         rc = LSM_ERR_PLUGIN_BUG;
         _lsm_err_msg_set(err_msg, "BUG: Got NULL db pointer");
         *db = NULL;
+    } else if ((*db = lsm_plug_worker_data_get(c)) != NULL) {
+        /* Request worker, with its own read only connection. tmo_set()
+         * only changes the timeout of pri_data->db.
+         */
+        sqlite3_busy_timeout(*db, pri_data->timeout & INT_MAX);
     } else {
         *db = pri_data->db;
     }
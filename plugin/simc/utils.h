@@ -30,7 +30,9 @@
 
 struct _simc_private_data {
     struct sqlite3 *db;
+    char *statefile;
     uint32_t timeout;
+    uint64_t change_seq;
 };
 
 #define _UNUSED(x)        (void)(x)
@@ -183,8 +183,14 @@ def op_status_list_conv(conv_dict, dmtf_op_status_list,
 JOB_STATE_NEW = 2
 JOB_STATE_STARTING = 3
 JOB_STATE_RUNNING = 4
+JOB_STATE_SUSPENDED = 5
+JOB_STATE_SHUTTING_DOWN = 6
 JOB_STATE_COMPLETED = 7
 
+# CIM_ConcreteJob['JobState'] of jobs still changing
+JOB_STATES_UNFINISHED = (JOB_STATE_NEW, JOB_STATE_STARTING, JOB_STATE_RUNNING,
+                         JOB_STATE_SUSPENDED, JOB_STATE_SHUTTING_DOWN)
+
 # CIM_Synchronized['SyncType'] also used by
 # CIM_ReplicationService.CreateElementReplica() 'SyncType' parameter.
 SYNC_TYPE_MIRROR = pywbem.Uint16(6)
@@ -161,9 +161,32 @@ def plugin_register(self, uri, password, timeout, flags=0):
                                "ca_cert_file: '%s' does not exists")
             no_ssl_verify = False
 
+        cache_ttl = SmisCommon.DEFAULT_CACHE_TTL
+        if 'cache_ttl' in u['parameters']:
+            try:
+                cache_ttl = float(u['parameters']['cache_ttl'])
+            except ValueError:
+                raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                               "cache_ttl: '%s' is not a number" %
+                               u['parameters']['cache_ttl'])
+
+        indication_port = None
+        if 'indication_port' in u['parameters']:
+            try:
+                indication_port = int(u['parameters']['indication_port'])
+            except ValueError:
+                raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                               "indication_port: '%s' is not a number" %
+                               u['parameters']['indication_port'])
+
+        indication_host = None
+        if 'indication_host' in u['parameters']:
+            indication_host = u['parameters']['indication_host']
+
         self._c = SmisCommon(
             url, u['username'], password, namespace, no_ssl_verify,
-            debug_path, system_list, ca_cert_file)
+            debug_path, system_list, ca_cert_file, cache_ttl,
+            indication_port, indication_host)
 
         self.tmo = timeout
 
@@ -177,8 +200,24 @@ def time_out_get(self, flags=0):
 
     @handle_cim_errors
     def plugin_unregister(self, flags=0):
+        if self._c is not None:
+            self._c.close()
         self._c = None
 
+    @handle_cim_errors
+    def changes(self, start, flags=0):
+        """
+        With indication_port, lifecycle indications tell which kinds of
+        objects changed, they are not matched to the lsm ids.
+        """
+        if start:
+            self._c.changes_watch()
+            return []
+        return list((c, None) for c in self._c.changes_take())
+
+    def changes_fd(self):
+        return self._c.changes_fd()
+
     @handle_cim_errors
     def capabilities(self, system, flags=0):
         cim_sys = smis_sys.cim_sys_of_sys_id(self._c, system.id)
@@ -315,32 +354,39 @@ def volumes(self, search_key=None, search_value=None, flags=0):
         As 'Block Services Package' is mandatory for 'Array' profile, we
         don't check support status here as startup() already checked 'Array'
         profile.
+        Pools and volumes of all systems are enumerated once and joined in
+        memory rather than walking associations of each system and pool.
         """
         rc = []
         cim_sys_pros = smis_sys.cim_sys_id_pros()
         cim_syss = smis_sys.root_cim_sys(self._c, cim_sys_pros)
         cim_vol_pros = smis_vol.cim_vol_pros()
-        for cim_sys in cim_syss:
+        pool_pros = smis_pool.cim_pool_id_pros()
+        sys_cim_pools = smis_pool.cim_pools_of_cim_syss(
+            self._c, cim_syss, pool_pros)
+        all_cim_pools = list(
+            p for _, cim_pools in sys_cim_pools for p in cim_pools)
+        cim_vols_list = iter(smis_vol.cim_vols_of_cim_pools(
+            self._c, all_cim_pools, cim_vol_pros))
+        for cim_sys, cim_pools in sys_cim_pools:
             sys_id = smis_sys.sys_id_of_cim_sys(cim_sys)
-            pool_pros = smis_pool.cim_pool_id_pros()
-            cim_pools = smis_pool.cim_pools_of_cim_sys_path(
-                self._c, cim_sys.path, pool_pros)
             for cim_pool in cim_pools:
                 pool_id = smis_pool.pool_id_of_cim_pool(cim_pool)
-                cim_vols = smis_vol.cim_vol_of_cim_pool_path(
-                    self._c, cim_pool.path, cim_vol_pros)
-                for cim_vol in cim_vols:
+                for cim_vol in next(cim_vols_list):
                     rc.append(
                         smis_vol.cim_vol_to_lsm_vol(cim_vol, pool_id, sys_id))
         return search_property(rc, search_key, search_value)
 
     @handle_cim_errors
-    def pools(self, search_key=None, search_value=None, flags=0):
+    def pools(self, search_key=None, search_value=None, flags=0,
+              fields=None):
         """
         Convert CIM_StoragePool to lsm.Pool.
         To list all CIM_StoragePool:
             1. List all root CIM_ComputerSystem.
             2. List all CIM_StoragePool associated to CIM_ComputerSystem.
+        The capabilities of the pools are only queried when fields has
+        'element_type' or 'unsupported_actions'.
         """
         rc = []
         cim_pool_pros = smis_pool.cim_pool_pros()
@@ -348,14 +394,22 @@ def pools(self, search_key=None, search_value=None, flags=0):
         cim_sys_pros = smis_sys.cim_sys_id_pros()
         cim_syss = smis_sys.root_cim_sys(self._c, cim_sys_pros)
 
-        for cim_sys in cim_syss:
+        sys_cim_pools = smis_pool.cim_pools_of_cim_syss(
+            self._c, cim_syss, cim_pool_pros)
+        element_type_wanted = fields is None or \
+            'element_type' in fields or 'unsupported_actions' in fields
+        cim_sccs_dict = None
+        if element_type_wanted and \
+           any(cim_pools for _, cim_pools in sys_cim_pools):
+            cim_sccs_dict = smis_pool.cim_sccs_of_all_pools(self._c)
+
+        for cim_sys, cim_pools in sys_cim_pools:
             system_id = smis_sys.sys_id_of_cim_sys(cim_sys)
-            cim_pools = smis_pool.cim_pools_of_cim_sys_path(
-                self._c, cim_sys.path, cim_pool_pros)
             for cim_pool in cim_pools:
                 rc.append(
                     smis_pool.cim_pool_to_lsm_pool(
-                        self._c, cim_pool, system_id))
+                        self._c, cim_pool, system_id, cim_sccs_dict,
+                        element_type_wanted))
 
         return search_property(rc, search_key, search_value)
 
@@ -1491,7 +1545,8 @@ def job_free(self, job_id, flags=0):
                 pass
 
     @handle_cim_errors
-    def disks(self, search_key=None, search_value=None, flags=0):
+    def disks(self, search_key=None, search_value=None, flags=0,
+              fields=None):
         """
         return all object of data.Disk.
         We are using "Disk Drive Lite Subprofile" v1.4 of SNIA SMI-S for these
@@ -1502,21 +1557,20 @@ def disks(self, search_key=None, search_value=None, flags=0):
         sub ComputerSystem. To improve performance of listing disks, we will
         use EnumerateInstances(). Which means we have to filter the results
         by ourselves in case URI contain 'system=xxx'.
+        The Primordial CIM_StorageExtent is skipped when fields has no
+        property needing it.
         """
-        rc = []
         self._c.profile_check(SmisCommon.SNIA_DISK_LITE_PROFILE,
                               SmisCommon.SMIS_SPEC_VER_1_4,
                               raise_error=True)
         cim_disk_pros = smis_disk.cim_disk_pros()
-        cim_disks = self._c.EnumerateInstances(
-            'CIM_DiskDrive', PropertyList=cim_disk_pros)
-        for cim_disk in cim_disks:
-            if self._c.system_list and \
-               smis_disk.sys_id_of_cim_disk(cim_disk) not in \
-               self._c.system_list:
-                continue
+        cim_disks = self._c.enumerate_cached('CIM_DiskDrive', cim_disk_pros)
+        if self._c.system_list:
+            cim_disks = [
+                d for d in cim_disks
+                if smis_disk.sys_id_of_cim_disk(d) in self._c.system_list]
 
-            rc.extend([smis_disk.cim_disk_to_lsm_disk(self._c, cim_disk)])
+        rc = smis_disk.cim_disks_to_lsm_disks(self._c, cim_disks, fields)
         return search_property(rc, search_key, search_value)
 
     @staticmethod
@@ -27,11 +27,12 @@
 import sys
 import six
 
-from lsm import LsmError, ErrorNumber, md5
+from lsm import LsmError, ErrorNumber, md5, error
 
 import pywbem
-from smispy_plugin.utils import merge_list
+from smispy_plugin.utils import merge_list, cim_path_key
 from smispy_plugin import dmtf
+from smispy_plugin import smis_indication
 
 
 def _profile_register_load(wbem_conn):
@@ -185,11 +186,20 @@ class SmisCommon(object):
 
     _INVOKE_MAX_LOOP_COUNT = 60
     _INVOKE_CHECK_INTERVAL = 5
+    _INVOKE_CHECK_INTERVAL_MIN = 0.1
+
+    # Seconds all CIM_ConcreteJob enumerated by cim_job_of_job_id() are
+    # reused for other jobs.
+    _JOB_SNAPSHOT_TTL = 0.5
+
+    DEFAULT_CACHE_TTL = 2
+    _PULL_MAX_OBJECT_COUNT = 1000
 
     def __init__(self, url, username, password,
                  namespace=dmtf.DEFAULT_NAMESPACE,
                  no_ssl_verify=False, debug_path=None, system_list=None,
-                 ca_cert_file=None):
+                 ca_cert_file=None, cache_ttl=DEFAULT_CACHE_TTL,
+                 indication_port=None, indication_host=None):
         self._wbem_conn = None
         self._profile_dict = {}
         self.root_blk_cim_rp = None    # For root_cim_
@@ -197,6 +207,19 @@ def __init__(self, url, username, password,
         self.system_list = system_list
         self._debug_path = debug_path
         self._ca_cert_file = ca_cert_file
+        self.cache_ttl = cache_ttl
+        self._cache = {}                # For enumerate_cached()
+        self._no_prefetch = set()       # Association classes failed to
+                                        # enumerate.
+        self._url = url
+        self._indication_port = indication_port
+        self._indication_host = indication_host
+        self._job_listener = None       # For job indications
+        self._job_subscription = []
+        self._indication_providers = set()
+        self._job_snapshot = (0, set(), {})
+        self._change_watcher = None     # For lifecycle indications
+        self._change_subscription = []
 
         if namespace is None:
             namespace = dmtf.DEFAULT_NAMESPACE
@@ -216,6 +239,11 @@ def __init__(self, url, username, password,
         if debug_path is not None:
             self._wbem_conn.debug = True
 
+        # Pull operations were added in pywbem 0.9 and DMTF DSP0200 1.4,
+        # they are checked on the provider at the first use.
+        self._pull_supported = hasattr(
+            self._wbem_conn, 'OpenEnumerateInstances')
+
         if namespace.lower() == SmisCommon._MEGARAID_NAMESPACE.lower():
             # Skip profile register check on MegaRAID for better performance.
             # MegaRAID SMI-S profile support status will not change for a
@@ -288,18 +316,19 @@ def _vendor_namespace(self):
                 ErrorNumber.PLUGIN_BUG,
                 "_vendor_namespace(): self.root_blk_cim_rp not set yet")
 
-    def EnumerateInstances(self, ClassName, namespace=None, **params):
+    def _vendor_namespace_switch(self):
         if self._wbem_conn.default_namespace in dmtf.INTEROP_NAMESPACES:
             # We have to enumerate in vendor namespace
             self._wbem_conn.default_namespace = self._vendor_namespace()
+
+    def EnumerateInstances(self, ClassName, namespace=None, **params):
+        self._vendor_namespace_switch()
         params['LocalOnly'] = False
         return self._wbem_conn.EnumerateInstances(
             ClassName, namespace, **params)
 
     def EnumerateInstanceNames(self, ClassName, namespace=None, **params):
-        if self._wbem_conn.default_namespace in dmtf.INTEROP_NAMESPACES:
-            # We have to enumerate in vendor namespace
-            self._wbem_conn.default_namespace = self._vendor_namespace()
+        self._vendor_namespace_switch()
         params['LocalOnly'] = False
         return self._wbem_conn.EnumerateInstanceNames(
             ClassName, namespace, **params)
@@ -315,11 +344,115 @@ def GetInstance(self, InstanceName, **params):
         return self._wbem_conn.GetInstance(InstanceName, **params)
 
     def DeleteInstance(self, InstanceName, **params):
+        self.cache_clear()
+        self._job_snapshot = (0, set(), {})
         return self._wbem_conn.DeleteInstance(InstanceName, **params)
 
     def References(self, ObjectName, **params):
         return self._wbem_conn.References(ObjectName, **params)
 
+    def _pull_instances(self, ClassName, PropertyList):
+        """
+        Enumerate instances with OpenEnumerateInstances() and
+        PullInstancesWithPath(), so that the provider returns
+        _PULL_MAX_OBJECT_COUNT instances at most in each reply instead of
+        building one reply for all of them.
+        """
+        self._vendor_namespace_switch()
+        result = self._wbem_conn.OpenEnumerateInstances(
+            ClassName, PropertyList=PropertyList,
+            MaxObjectCount=SmisCommon._PULL_MAX_OBJECT_COUNT)
+        cim_insts = list(result.instances)
+        while not result.eos:
+            result = self._wbem_conn.PullInstancesWithPath(
+                result.context,
+                MaxObjectCount=SmisCommon._PULL_MAX_OBJECT_COUNT)
+            cim_insts.extend(result.instances)
+        return cim_insts
+
+    def enumerate_cached(self, ClassName, PropertyList):
+        """
+        Usage:
+            Enumerate all instances of ClassName in vendor namespace, using
+            pull operations when provider supports them.
+            The result is kept for cache_ttl seconds. Later calls asking
+            for a subset of the cached properties reuse it, the others
+            enumerate again for the union of both property lists.
+            Any InvokeMethod() or DeleteInstance() drops the cache.
+        Parameter:
+            ClassName       # string
+            PropertyList    # a list of property names, never None as
+                            # it is pointless to transfer all of them.
+        Returns:
+            [CIMInstance]   # Do not modify them, they are shared.
+        """
+        now = time.time()
+        cache_key = ClassName.lower()
+        if cache_key in self._cache:
+            (cache_time, cache_pros, cim_insts) = self._cache[cache_key]
+            if now - cache_time < self.cache_ttl:
+                if set(PropertyList) <= cache_pros:
+                    return list(cim_insts)
+                PropertyList = merge_list(PropertyList, list(cache_pros))
+
+        cim_insts = None
+        if self._pull_supported:
+            try:
+                cim_insts = self._pull_instances(ClassName, PropertyList)
+            except pywbem.CIMError as ce:
+                if ce.args[0] != pywbem.CIM_ERR_NOT_SUPPORTED:
+                    raise
+                self._pull_supported = False
+        if cim_insts is None:
+            cim_insts = self.EnumerateInstances(
+                ClassName, PropertyList=PropertyList)
+
+        if self.cache_ttl > 0:
+            self._cache[cache_key] = (now, set(PropertyList), cim_insts)
+        return list(cim_insts)
+
+    def associated_paths(self, AssocClass, Role, ResultRole):
+        """
+        Usage:
+            Enumerate all instances of association class AssocClass once,
+            so that callers could join instances in memory instead of
+            calling Associators() for each of them.
+        Parameter:
+            AssocClass      # string, like 'CIM_HostedStoragePool'
+            Role            # string, reference property of the source,
+                            # like 'GroupComponent'
+            ResultRole      # string, reference property of the result,
+                            # like 'PartComponent'
+        Returns:
+            {cim_path_key(source path): [CIMInstanceName of result]}
+                or
+            None            # Provider failed to enumerate AssocClass,
+                            # caller should use Associators() instead.
+        """
+        if AssocClass in self._no_prefetch:
+            return None
+        try:
+            cim_assocs = self.enumerate_cached(AssocClass, [Role, ResultRole])
+        except pywbem.CIMError as ce:
+            if ce.args[0] not in (pywbem.CIM_ERR_NOT_SUPPORTED,
+                                  pywbem.CIM_ERR_INVALID_CLASS,
+                                  pywbem.CIM_ERR_FAILED):
+                raise
+            self._no_prefetch.add(AssocClass)
+            return None
+
+        rc = {}
+        for cim_assoc in cim_assocs:
+            if cim_assoc.get(Role) is None or \
+               cim_assoc.get(ResultRole) is None:
+                continue
+            rc.setdefault(cim_path_key(cim_assoc[Role]), []).append(
+                cim_assoc[ResultRole])
+        return rc
+
+    def cache_clear(self):
+        self._cache = {}
+
     def is_megaraid(self):
         return self._vendor_product == SmisCommon._PRODUCT_MEGARAID
 
@@ -333,25 +466,153 @@ def cim_job_pros():
     def cim_job_of_job_id(self, job_id, property_list=None):
         """
         Return CIM_ConcreteJob for given job_id.
+        All CIM_ConcreteJob are enumerated at once and reused for
+        _JOB_SNAPSHOT_TTL seconds, so that checking many jobs does not take
+        an enumeration for each.
+        With job indications, a job the indication of which tells finished
+        is got again from the provider at once, and the enumeration of
+        unfinished ones is reused for _INVOKE_CHECK_INTERVAL seconds.
         """
+        # The job might have changed what enumerate_cached() holds.
+        self.cache_clear()
         if property_list is None:
             property_list = SmisCommon.cim_job_pros()
         else:
             property_list = merge_list(
                 property_list, SmisCommon.cim_job_pros())
-
-        cim_jobs = self.EnumerateInstances(
-            'CIM_ConcreteJob',
-            PropertyList=property_list)
         real_job_id = SmisCommon.parse_job_id(job_id)[0]
-        for cim_job in cim_jobs:
-            if md5(cim_job['InstanceID']) == real_job_id:
-                return cim_job
+
+        snapshot_ttl = SmisCommon._JOB_SNAPSHOT_TTL
+        (snapshot_time, snapshot_pros, cim_jobs) = self._job_snapshot
+        if self._job_listener is not None:
+            snapshot_ttl = SmisCommon._INVOKE_CHECK_INTERVAL
+            cim_job = cim_jobs.get(real_job_id)
+            if cim_job is not None and \
+               not smis_indication.job_finished(cim_job) and \
+               set(property_list) <= snapshot_pros and \
+               self._job_listener.job_finished_since(real_job_id,
+                                                     snapshot_time):
+                try:
+                    cim_job = self.GetInstance(
+                        cim_job.path, PropertyList=list(snapshot_pros))
+                    cim_jobs[real_job_id] = cim_job
+                    return cim_job
+                except pywbem.CIMError:
+                    # Gone, or not to be got alone, look it up again.
+                    snapshot_time = 0
+
+        if time.time() - snapshot_time >= snapshot_ttl or \
+           not set(property_list) <= snapshot_pros or \
+           real_job_id not in cim_jobs:
+            property_list = merge_list(property_list, list(snapshot_pros))
+            cim_jobs = dict(
+                (md5(j['InstanceID']), j) for j in self.EnumerateInstances(
+                    'CIM_ConcreteJob', PropertyList=property_list))
+            self._job_snapshot = (time.time(), set(property_list), cim_jobs)
+
+        if real_job_id in cim_jobs:
+            return cim_jobs[real_job_id]
 
         raise LsmError(
             ErrorNumber.NOT_FOUND_JOB,
             "Job %s not found" % job_id)
 
+    def _interop_namespace(self):
+        if self.root_blk_cim_rp:
+            return self.root_blk_cim_rp.path.namespace
+        return dmtf.DEFAULT_NAMESPACE
+
+    def _job_indication_subscribe(self):
+        """
+        Subscribe to indications of CIM_ConcreteJob changes if
+        indication_port is set, once for this session. Jobs are polled
+        without them if the provider or pywbem does not support them.
+        """
+        if self._indication_port is None or self._job_listener is not None:
+            return
+
+        listener = None
+        try:
+            if not hasattr(pywbem, 'WBEMListener'):
+                raise LsmError(ErrorNumber.NO_SUPPORT,
+                               "pywbem has no WBEMListener")
+            self._indication_providers = \
+                smis_indication.provider_addresses(self._url)
+            listener = smis_indication.listener_get(
+                self._url, self._indication_host, self._indication_port,
+                self._indication_providers)
+            self._vendor_namespace_switch()
+            self._job_subscription = smis_indication.subscribe(
+                self._wbem_conn, self._interop_namespace(),
+                self._wbem_conn.default_namespace, listener.destination)
+            self._job_listener = listener
+        except Exception as e:
+            error("Job indications disabled: %s" % str(e))
+            if listener is not None:
+                smis_indication.listener_put(listener,
+                                             self._indication_providers)
+            self._indication_port = None
+
+    def _job_wait(self, cim_job_path, since, timeout):
+        """
+        Sleep timeout seconds, or less when an indication telling of the
+        job finished after since comes earlier.  The job has to be checked
+        with the provider in any case.
+        """
+        if self._job_listener is None:
+            time.sleep(timeout)
+        else:
+            self._job_listener.job_wait(
+                md5(cim_job_path['InstanceID']), since, timeout)
+
+    def changes_watch(self):
+        """
+        Subscribe to lifecycle indications of systems, pools, volumes and
+        disks, once for this session.  Raise LsmError NO_SUPPORT if
+        indication_port is not set or the provider does not support them.
+        """
+        if self._change_watcher is not None:
+            return
+        self._job_indication_subscribe()
+        if self._job_listener is None:
+            raise LsmError(ErrorNumber.NO_SUPPORT,
+                           "Indications are not enabled")
+        try:
+            self._change_subscription = smis_indication.subscribe(
+                self._wbem_conn, self._interop_namespace(),
+                self._wbem_conn.default_namespace,
+                self._job_listener.destination,
+                smis_indication.CHANGE_QUERY)
+        except Exception as e:
+            raise LsmError(ErrorNumber.NO_SUPPORT,
+                           "Lifecycle indications not supported: %s" % e)
+        self._change_watcher = self._job_listener.watch()
+
+    def changes_fd(self):
+        return self._change_watcher.fileno()
+
+    def changes_take(self):
+        """
+        Return the set of lsm.Event classes which had lifecycle indications
+        since last call.
+        """
+        return self._job_listener.changes_take(self._change_watcher)
+
+    def close(self):
+        if self._change_watcher is not None:
+            smis_indication.unsubscribe(self._wbem_conn,
+                                        self._change_subscription)
+            self._job_listener.unwatch(self._change_watcher)
+            self._change_watcher = None
+            self._change_subscription = []
+        if self._job_listener is not None:
+            smis_indication.unsubscribe(self._wbem_conn,
+                                        self._job_subscription)
+            smis_indication.listener_put(self._job_listener,
+                                         self._indication_providers)
+            self._job_listener = None
+            self._job_subscription = []
+
     @staticmethod
     def _job_id_of_cim_job(cim_job, retrieve_data, method_data):
         """
@@ -437,6 +698,8 @@ def invoke_method(self, cmd, cim_path, in_params, out_handler=None,
         """
         if retrieve_data is None:
             retrieve_data = SmisCommon.JOB_RETRIEVE_NONE
+        self.cache_clear()
+        self._job_indication_subscribe()
         try:
             (rc, out) = self._wbem_conn.InvokeMethod(
                 cmd, cim_path, **in_params)
@@ -486,6 +749,8 @@ def invoke_method_wait(self, cmd, cim_path, in_params,
         If flag_out_array is True, return the first element of out[out_key].
         """
         cim_job = dict()
+        self.cache_clear()
+        self._job_indication_subscribe()
         (rc, out) = self._wbem_conn.InvokeMethod(cmd, cim_path, **in_params)
 
         try:
@@ -511,19 +776,33 @@ def invoke_method_wait(self, cmd, cim_path, in_params,
             elif rc == SmisCommon.SNIA_INVOKE_ASYNC:
                 cim_job = {}
                 cim_job_path = out['Job']
-                loop_counter = 0
                 job_pros = ['JobState', 'ErrorDescription',
                             'OperationalStatus']
                 cim_xxxs_path = []
-                while loop_counter <= SmisCommon._INVOKE_MAX_LOOP_COUNT:
+                # Check quickly first for short jobs, then back off to
+                # _INVOKE_CHECK_INTERVAL. The indication of job finished,
+                # if subscribed, ends the wait at once.
+                interval = SmisCommon._INVOKE_CHECK_INTERVAL_MIN
+                deadline = time.time() + \
+                    SmisCommon._INVOKE_CHECK_INTERVAL * \
+                    SmisCommon._INVOKE_MAX_LOOP_COUNT
+                timed_out = False
+                while True:
+                    checked = time.time()
                     cim_job = self.GetInstance(cim_job_path,
                                                PropertyList=job_pros)
                     job_state = cim_job['JobState']
                     if job_state in (dmtf.JOB_STATE_NEW,
                                      dmtf.JOB_STATE_STARTING,
                                      dmtf.JOB_STATE_RUNNING):
-                        loop_counter += 1
-                        time.sleep(SmisCommon._INVOKE_CHECK_INTERVAL)
+                        remaining = deadline - time.time()
+                        if remaining <= 0:
+                            timed_out = True
+                            break
+                        self._job_wait(cim_job_path, checked,
+                                       min(interval, remaining))
+                        interval = min(interval * 2,
+                                       SmisCommon._INVOKE_CHECK_INTERVAL)
                         continue
                     elif job_state == dmtf.JOB_STATE_COMPLETED:
                         if not SmisCommon.cim_job_completed_ok(cim_job):
@@ -543,7 +822,7 @@ def invoke_method_wait(self, cmd, cim_path, in_params,
                             "invoke_method_wait(): Got unknown job state "
                             "%d: %s" % (job_state, list(cim_job.items())))
 
-                if loop_counter > SmisCommon._INVOKE_MAX_LOOP_COUNT:
+                if timed_out:
                     raise LsmError(
                         ErrorNumber.TIMEOUT,
                         "The job generated by %s() failed to finish in %ds" %
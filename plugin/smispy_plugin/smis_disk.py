@@ -16,7 +16,7 @@
 
 from lsm import Disk, md5, LsmError, ErrorNumber
 from smispy_plugin.smis_common import SmisCommon
-from smispy_plugin.utils import merge_list
+from smispy_plugin.utils import merge_list, cim_path_key
 from smispy_plugin import dmtf
 
 
@@ -138,6 +138,58 @@ def _pri_cim_ext_of_cim_disk(smis_common, cim_disk_path, property_list=None):
                        (cim_disk_path, cim_exts))
 
 
+def _pri_cim_exts_of_cim_disks(smis_common, property_list):
+    """
+    Do _pri_cim_ext_of_cim_disk() for all CIM_DiskDrive at once:
+    enumerate CIM_MediaPresent and CIM_StorageExtent and join them in
+    memory.
+    Return a dictionary:
+        {cim_path_key(cim_disk.path): cim_pri_ext}
+    Disks not in it, all of them if provider fails to enumerate
+    CIM_MediaPresent, should use _pri_cim_ext_of_cim_disk().
+    """
+    property_list = merge_list(property_list, ['Primordial'])
+
+    ext_paths_of_disk = smis_common.associated_paths(
+        'CIM_MediaPresent', 'Antecedent', 'Dependent')
+    if not ext_paths_of_disk:
+        return {}
+
+    cim_ext_dict = dict(
+        (cim_path_key(e.path), e) for e in
+        smis_common.enumerate_cached('CIM_StorageExtent', property_list)
+        if e.get('Primordial'))
+
+    rc = {}
+    for disk_key, cim_ext_paths in ext_paths_of_disk.items():
+        cim_exts = list(
+            cim_ext_dict[cim_path_key(p)] for p in cim_ext_paths
+            if cim_path_key(p) in cim_ext_dict)
+        if len(cim_exts) == 1:
+            rc[disk_key] = cim_exts[0]
+    return rc
+
+
+def _spare_cim_ext_keys(smis_common):
+    """
+    Return a set of cim_path_key() of CIM_StorageExtent associated to
+    CIM_StorageRedundancySet via CIM_IsSpare, or None if provider fails to
+    enumerate CIM_IsSpare or has no spare at all, as some providers only
+    support it via AssociatorNames().
+    """
+    srs_paths_of_ext = smis_common.associated_paths(
+        'CIM_IsSpare', 'Antecedent', 'Dependent')
+    if not srs_paths_of_ext:
+        return None
+
+    srs_keys = set(
+        cim_path_key(s.path) for s in
+        smis_common.enumerate_cached('CIM_StorageRedundancySet', []))
+    return set(
+        ext_key for ext_key, srs_paths in srs_paths_of_ext.items()
+        if any(cim_path_key(p) in srs_keys for p in srs_paths))
+
+
 # LSIESG_DiskDrive['MediaType']
 # Value was retrieved from MOF file of MegaRAID SMI-S provider.
 _MEGARAID_DISK_MEDIA_TYPE_SSD = 1
@@ -168,25 +220,70 @@ def _disk_type_megaraid(cim_disk):
     return Disk.TYPE_UNKNOWN
 
 
-def cim_disk_to_lsm_disk(smis_common, cim_disk):
+def _wanted(fields, *names):
+    """
+    Returns True if any of the lsm.Disk properties is in the fields of
+    Smis.disks(), None being all of them.
+    """
+    return fields is None or any(n in fields for n in names)
+
+
+def cim_disks_to_lsm_disks(smis_common, cim_disks, fields=None):
+    """
+    Convert a list of CIM_DiskDrive to lsm.Disk, finding out the
+    Primordial CIM_StorageExtent and spare status of all disks at once,
+    unless no property needing them is in fields.
+    """
+    cim_ext_pros = ['BlockSize', 'NumberOfBlocks']
+    cim_ext_dict = {}
+    spare_ext_keys = None
+    if cim_disks and _wanted(fields, 'block_size', 'num_of_blocks',
+                             'status'):
+        cim_ext_dict = _pri_cim_exts_of_cim_disks(smis_common, cim_ext_pros)
+        if _wanted(fields, 'status') and \
+           smis_common.profile_check(SmisCommon.SNIA_SPARE_DISK_PROFILE,
+                                     SmisCommon.SMIS_SPEC_VER_1_4,
+                                     raise_error=False):
+            spare_ext_keys = _spare_cim_ext_keys(smis_common)
+
+    return list(
+        cim_disk_to_lsm_disk(
+            smis_common, cim_disk,
+            cim_ext_dict.get(cim_path_key(cim_disk.path)), spare_ext_keys,
+            fields)
+        for cim_disk in cim_disks)
+
+
+def cim_disk_to_lsm_disk(smis_common, cim_disk, cim_ext=None,
+                         spare_ext_keys=None, fields=None):
     """
     Convert CIM_DiskDrive to lsm.Disk.
+    The cim_ext and spare_ext_keys are from cim_disks_to_lsm_disks(), when
+    None, they are queried from provider for this disk if a property of
+    fields needs them.
     """
     # CIM_DiskDrive does not have disk size information.
     # We have to find out the Primordial CIM_StorageExtent for that.
-    cim_ext = _pri_cim_ext_of_cim_disk(
-        smis_common, cim_disk.path,
-        property_list=['BlockSize', 'NumberOfBlocks'])
+    if cim_ext is None and _wanted(fields, 'block_size', 'num_of_blocks',
+                                   'status'):
+        cim_ext = _pri_cim_ext_of_cim_disk(
+            smis_common, cim_disk.path,
+            property_list=['BlockSize', 'NumberOfBlocks'])
 
     status = _disk_status_of_cim_disk(cim_disk)
-    if smis_common.profile_check(SmisCommon.SNIA_SPARE_DISK_PROFILE,
+    if _wanted(fields, 'status') and \
+       smis_common.profile_check(SmisCommon.SNIA_SPARE_DISK_PROFILE,
                                  SmisCommon.SMIS_SPEC_VER_1_4,
                                  raise_error=False):
-        cim_srss = smis_common.AssociatorNames(
-            cim_ext.path, AssocClass='CIM_IsSpare',
-            ResultClass='CIM_StorageRedundancySet')
-        if len(cim_srss) >= 1:
-            status |= Disk.STATUS_SPARE_DISK
+        if spare_ext_keys is not None:
+            if cim_path_key(cim_ext.path) in spare_ext_keys:
+                status |= Disk.STATUS_SPARE_DISK
+        else:
+            cim_srss = smis_common.AssociatorNames(
+                cim_ext.path, AssocClass='CIM_IsSpare',
+                ResultClass='CIM_StorageRedundancySet')
+            if len(cim_srss) >= 1:
+                status |= Disk.STATUS_SPARE_DISK
 
     if 'EMCInUse' in list(cim_disk.keys()) and cim_disk['EMCInUse'] is False:
         status |= Disk.STATUS_FREE
@@ -201,9 +298,9 @@ def cim_disk_to_lsm_disk(smis_common, cim_disk):
     # we do not check whether they follow the SNIA standard.
     if 'Name' in cim_disk:
         name = cim_disk["Name"]
-    if 'BlockSize' in cim_ext:
+    if cim_ext is not None and 'BlockSize' in cim_ext:
         block_size = cim_ext['BlockSize']
-    if 'NumberOfBlocks' in cim_ext:
+    if cim_ext is not None and 'NumberOfBlocks' in cim_ext:
         num_of_block = cim_ext['NumberOfBlocks']
 
     if smis_common.is_megaraid():
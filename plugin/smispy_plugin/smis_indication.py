@@ -0,0 +1,339 @@
+# Copyright (C) 2026 Red Hat, Inc.
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; If not, see <http://www.gnu.org/licenses/>.
+
+# This file stores:
+# 1. A CIM indication listener telling when CIM_ConcreteJob got finished,
+#    shared by all sessions of the plugin process.  The listener takes
+#    plain HTTP without authentication, so indications only wake up the
+#    sessions, which then check the job with the provider, and only the ones
+#    sent from the address of a provider in use are taken.
+# 2. Subscribing the listener to CIM_ConcreteJob changes on a provider, as
+#    SNIA SMI-S 1.4 'Indication' profile and DMTF DSP1054 describe.
+# 3. Watchers telling sessions which kinds of storage objects had lifecycle
+#    indications, for lsm.Client.subscribe().
+
+import errno
+import fcntl
+import os
+import socket
+import threading
+import time
+import uuid
+
+from six.moves.urllib.parse import urlparse
+import pywbem
+
+from lsm import md5, Event
+from smispy_plugin import dmtf
+
+# Seconds the indication of a finished job is kept.
+_JOB_INDICATION_KEEP = 3600
+
+_JOB_QUERY = \
+    "SELECT * FROM CIM_InstModification WHERE SourceInstance ISA " \
+    "CIM_ConcreteJob"
+# SMI-S 1.5 requires 'DMTF:CQL', older providers only know 'WQL'.
+_JOB_QUERY_LANGUAGES = ['DMTF:CQL', 'WQL']
+
+CHANGE_QUERY = \
+    "SELECT * FROM CIM_InstIndication WHERE " \
+    "SourceInstance ISA CIM_ComputerSystem OR " \
+    "SourceInstance ISA CIM_StoragePool OR " \
+    "SourceInstance ISA CIM_StorageVolume OR " \
+    "SourceInstance ISA CIM_DiskDrive"
+
+# Suffix of CIM class name -> lsm.Event class, vendors prefix their own.
+_CHANGE_CLASSES = [
+    ('ComputerSystem', Event.CLASS_SYSTEM),
+    ('StoragePool', Event.CLASS_POOL),
+    ('StorageVolume', Event.CLASS_VOLUME),
+    ('LogicalDisk', Event.CLASS_VOLUME),
+    ('DiskDrive', Event.CLASS_DISK),
+]
+
+# CIM_ListenerDestination['PersistenceType'], the provider could drop the
+# subscription once delivery failed.
+_PERSISTENCE_TYPE_TRANSIENT = pywbem.Uint16(3)
+
+_listeners = {}
+_listeners_lock = threading.Lock()
+
+
+def job_finished(cim_job):
+    return cim_job['JobState'] not in dmtf.JOB_STATES_UNFINISHED
+
+
+class ChangeWatcher(object):
+    """
+    Kinds of storage objects which had lifecycle indications since last
+    take(), with a pipe readable when there are some.
+    """
+
+    def __init__(self):
+        self._classes = set()
+        (self._pipe_r, self._pipe_w) = os.pipe()
+        for fd in (self._pipe_r, self._pipe_w):
+            flags = fcntl.fcntl(fd, fcntl.F_GETFL)
+            fcntl.fcntl(fd, fcntl.F_SETFL, flags | os.O_NONBLOCK)
+
+    def fileno(self):
+        return self._pipe_r
+
+    def add(self, lsm_class):
+        # Called with the lock of JobListener held.
+        self._classes.add(lsm_class)
+        try:
+            os.write(self._pipe_w, b'x')
+        except OSError as os_err:
+            if os_err.errno != errno.EAGAIN:
+                raise
+
+    def take(self):
+        # Called with the lock of JobListener held.
+        try:
+            while os.read(self._pipe_r, 512):
+                pass
+        except OSError as os_err:
+            if os_err.errno != errno.EAGAIN:
+                raise
+        classes = self._classes
+        self._classes = set()
+        return classes
+
+    def close(self):
+        os.close(self._pipe_r)
+        os.close(self._pipe_w)
+
+
+def provider_addresses(url):
+    """
+    Return the set of IP addresses of the provider at url, the ones its
+    indications come from.
+    """
+    u = urlparse(url)
+    return set(a[4][0] for a in socket.getaddrinfo(u.hostname, u.port, 0,
+                                                   socket.SOCK_STREAM))
+
+
+def _sender_address(host):
+    """
+    Return the IP address of host given to the callbacks of
+    pywbem.WBEMListener, which might come with a port.
+    """
+    if host.startswith('['):
+        host = host[1:host.find(']')]
+    elif host.count(':') == 1:
+        host = host.split(':')[0]
+    if host.lower().startswith('::ffff:') and '.' in host:
+        host = host[len('::ffff:'):]
+    return host
+
+
+class JobListener(object):
+    """
+    pywbem.WBEMListener on given address and port, keeping when it was told
+    of each job finished, by md5 of CIM_ConcreteJob['InstanceID'] like job
+    id of SmisCommon.  Indications not sent from one of the addresses given
+    to provider_add() are dropped.
+    """
+
+    def __init__(self, host, port):
+        self.destination = 'http://%s:%d' % (
+            ':' in host and '[%s]' % host or host, port)
+        self._users = 0
+        self._cond = threading.Condition()
+        self._finished = {}
+        self._providers = {}
+        self._watchers = []
+        self._listener = pywbem.WBEMListener(host, http_port=port)
+        self._listener.add_callback(self._deliver)
+        self._listener.start()
+
+    def provider_add(self, addresses):
+        with self._cond:
+            for address in addresses:
+                self._providers[address] = \
+                    self._providers.get(address, 0) + 1
+
+    def provider_remove(self, addresses):
+        with self._cond:
+            for address in addresses:
+                self._providers[address] -= 1
+                if self._providers[address] == 0:
+                    del self._providers[address]
+
+    def _deliver(self, indication, host):
+        with self._cond:
+            if _sender_address(host) not in self._providers:
+                return
+        cim_job = indication.get('SourceInstance')
+        if not isinstance(cim_job, pywbem.CIMInstance):
+            return
+        if 'InstanceID' not in cim_job or 'JobState' not in cim_job:
+            self._deliver_change(cim_job.classname)
+            return
+        if not job_finished(cim_job):
+            return
+        now = time.time()
+        with self._cond:
+            self._finished[md5(cim_job['InstanceID'])] = now
+            for job_id in list(self._finished.keys()):
+                if now - self._finished[job_id] > _JOB_INDICATION_KEEP:
+                    del self._finished[job_id]
+            self._cond.notify_all()
+
+    def _deliver_change(self, class_name):
+        for (suffix, lsm_class) in _CHANGE_CLASSES:
+            if class_name.lower().endswith(suffix.lower()):
+                with self._cond:
+                    for watcher in self._watchers:
+                        watcher.add(lsm_class)
+                return
+
+    def watch(self):
+        """
+        Return a new ChangeWatcher for the lifecycle indications.
+        """
+        watcher = ChangeWatcher()
+        with self._cond:
+            self._watchers.append(watcher)
+        return watcher
+
+    def unwatch(self, watcher):
+        with self._cond:
+            self._watchers.remove(watcher)
+        watcher.close()
+
+    def changes_take(self, watcher):
+        """
+        Return the set of lsm.Event classes of the watcher since last call.
+        """
+        with self._cond:
+            return watcher.take()
+
+    def job_finished_since(self, real_job_id, since):
+        """
+        Return True if an indication told of given job finished after since.
+        """
+        with self._cond:
+            return self._finished.get(real_job_id, 0) > since
+
+    def job_wait(self, real_job_id, since, timeout):
+        """
+        Wait up to timeout seconds for an indication telling of given job
+        finished after since.  Return True if one came.
+        """
+        deadline = time.time() + timeout
+        with self._cond:
+            while True:
+                if self._finished.get(real_job_id, 0) > since:
+                    return True
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    return False
+                self._cond.wait(remaining)
+
+
+def listener_get(url, host, port, providers):
+    """
+    Return the JobListener for given port, starting it on first use, taking
+    indications from the providers addresses as well.
+    The host is the address the provider at url could connect to, found
+    out from the route to the provider when None.
+    """
+    if host is None:
+        u = urlparse(url)
+        addr_info = socket.getaddrinfo(u.hostname, u.port, 0,
+                                       socket.SOCK_DGRAM)[0]
+        s = socket.socket(addr_info[0], socket.SOCK_DGRAM)
+        try:
+            # No packet is sent for connect() of UDP socket.
+            s.connect(addr_info[4])
+            host = s.getsockname()[0]
+        finally:
+            s.close()
+
+    with _listeners_lock:
+        if (host, port) not in _listeners:
+            _listeners[(host, port)] = JobListener(host, port)
+        listener = _listeners[(host, port)]
+        listener._users += 1
+    listener.provider_add(providers)
+    return listener
+
+
+def listener_put(listener, providers):
+    listener.provider_remove(providers)
+    with _listeners_lock:
+        listener._users -= 1
+        if listener._users == 0:
+            for key, value in list(_listeners.items()):
+                if value is listener:
+                    del _listeners[key]
+            listener._listener.stop()
+
+
+def _create(wbem_conn, class_name, namespace, **properties):
+    return wbem_conn.CreateInstance(pywbem.CIMInstance(
+        class_name, properties=properties,
+        path=pywbem.CIMInstanceName(class_name, namespace=namespace)))
+
+
+def subscribe(wbem_conn, interop_namespace, source_namespace, destination,
+              query=_JOB_QUERY):
+    """
+    Create CIM_ListenerDestinationCIMXML, CIM_IndicationFilter and
+    CIM_IndicationSubscription for indications of given query, by default
+    CIM_ConcreteJob changes, in source_namespace sent to destination URL.
+    Return a list of CIMInstanceName for unsubscribe().
+    """
+    name = 'libstoragemgmt-%s' % uuid.uuid4()
+    cim_paths = []
+    try:
+        cim_dest_path = _create(
+            wbem_conn, 'CIM_ListenerDestinationCIMXML', interop_namespace,
+            CreationClassName='CIM_ListenerDestinationCIMXML', Name=name,
+            Destination=destination,
+            PersistenceType=_PERSISTENCE_TYPE_TRANSIENT)
+        cim_paths.append(cim_dest_path)
+
+        for query_language in _JOB_QUERY_LANGUAGES:
+            try:
+                cim_filter_path = _create(
+                    wbem_conn, 'CIM_IndicationFilter', interop_namespace,
+                    CreationClassName='CIM_IndicationFilter', Name=name,
+                    Query=query, QueryLanguage=query_language,
+                    SourceNamespace=source_namespace)
+                break
+            except pywbem.CIMError:
+                if query_language == _JOB_QUERY_LANGUAGES[-1]:
+                    raise
+        cim_paths.append(cim_filter_path)
+
+        cim_paths.append(_create(
+            wbem_conn, 'CIM_IndicationSubscription', interop_namespace,
+            Filter=cim_filter_path, Handler=cim_dest_path))
+    except Exception:
+        unsubscribe(wbem_conn, cim_paths)
+        raise
+    return cim_paths
+
+
+def unsubscribe(wbem_conn, cim_paths):
+    for cim_path in reversed(cim_paths):
+        try:
+            wbem_conn.DeleteInstance(cim_path)
+        except Exception:
+            # Provider drops transient ones itself sooner or later.
+            pass
@@ -15,7 +15,7 @@
 # Author: Gris Ge <fge@redhat.com>
 
 from smispy_plugin.utils import (merge_list, path_str_to_cim_path,
-                                     cim_path_to_path_str)
+                                     cim_path_to_path_str, cim_path_key)
 from smispy_plugin import dmtf
 
 
@@ -50,6 +50,48 @@ def cim_pools_of_cim_sys_path(smis_common, cim_sys_path, property_list=None):
         ResultClass='CIM_StoragePool',
         PropertyList=property_list)
 
+    return _cim_pools_filter(cim_pools)
+
+
+def cim_pools_of_cim_syss(smis_common, cim_syss, property_list=None):
+    """
+    Do cim_pools_of_cim_sys_path() for all cim_syss at once:
+    enumerate CIM_HostedStoragePool and CIM_StoragePool and join them in
+    memory instead of one Associators() call for each CIM_ComputerSystem.
+    Fall back to cim_pools_of_cim_sys_path() if provider fails to
+    enumerate CIM_HostedStoragePool.
+    Return a list of (cim_sys, [cim_pool]) in the order of cim_syss.
+    """
+    if property_list is None:
+        property_list = ['Primordial', 'Usage']
+    else:
+        property_list = merge_list(property_list, ['Primordial', 'Usage'])
+
+    pool_paths_of_sys = smis_common.associated_paths(
+        'CIM_HostedStoragePool', 'GroupComponent', 'PartComponent')
+
+    if not pool_paths_of_sys:
+        return list(
+            (cim_sys, cim_pools_of_cim_sys_path(
+                smis_common, cim_sys.path, property_list))
+            for cim_sys in cim_syss)
+
+    cim_pool_dict = dict(
+        (cim_path_key(p.path), p) for p in
+        smis_common.enumerate_cached('CIM_StoragePool', property_list))
+    rc = []
+    for cim_sys in cim_syss:
+        cim_pools = []
+        for cim_pool_path in pool_paths_of_sys.get(
+                cim_path_key(cim_sys.path), []):
+            cim_pool = cim_pool_dict.get(cim_path_key(cim_pool_path))
+            if cim_pool is not None:
+                cim_pools.append(cim_pool)
+        rc.append((cim_sys, _cim_pools_filter(cim_pools)))
+    return rc
+
+
+def _cim_pools_filter(cim_pools):
     rc = []
     for cim_pool in cim_pools:
         if 'Primordial' in cim_pool and cim_pool['Primordial']:
@@ -111,12 +153,49 @@ def cim_pool_pros():
     return pool_pros
 
 
-def _pool_element_type(smis_common, cim_pool):
+def _cim_scc_pros():
+    return ['SupportedStorageElementFeatures', 'SupportedStorageElementTypes']
+
+
+def cim_sccs_of_all_pools(smis_common):
+    """
+    Enumerate CIM_ElementCapabilities and
+    CIM_StorageConfigurationCapabilities for _pool_element_type() of all
+    pools at once.
+    Return a dictionary:
+        {cim_path_key(cim_pool.path): [cim_scc]}
+    or None if not needed or provider fails to enumerate
+    CIM_ElementCapabilities.
+    """
+    if smis_common.is_megaraid():
+        return None
+
+    scc_paths_of_element = smis_common.associated_paths(
+        'CIM_ElementCapabilities', 'ManagedElement', 'Capabilities')
+    if not scc_paths_of_element:
+        return None
+
+    cim_scc_dict = dict(
+        (cim_path_key(s.path), s) for s in
+        smis_common.enumerate_cached(
+            'CIM_StorageConfigurationCapabilities', _cim_scc_pros()))
+
+    rc = {}
+    for element_key, cim_scc_paths in scc_paths_of_element.items():
+        cim_sccs = list(
+            cim_scc_dict[cim_path_key(p)] for p in cim_scc_paths
+            if cim_path_key(p) in cim_scc_dict)
+        if cim_sccs:
+            rc[element_key] = cim_sccs
+    return rc
+
+
+def _pool_element_type(smis_common, cim_pool, cim_sccs_dict=None):
     """
     Return a set (Pool.element_type, Pool.unsupported)
     Using CIM_StorageConfigurationCapabilities
     'SupportedStorageElementFeatures' and 'SupportedStorageElementTypes'
-    property.
+    property, from cim_sccs_dict of cim_sccs_of_all_pools() if provided.
     For MegaRAID, just return (Pool.ELEMENT_TYPE_VOLUME, 0)
     """
     if smis_common.is_megaraid():
@@ -126,12 +205,14 @@ def _pool_element_type(smis_common, cim_pool):
     unsupported = 0
 
     # check whether current pool support create volume or not.
-    cim_sccs = smis_common.Associators(
-        cim_pool.path,
-        AssocClass='CIM_ElementCapabilities',
-        ResultClass='CIM_StorageConfigurationCapabilities',
-        PropertyList=['SupportedStorageElementFeatures',
-                      'SupportedStorageElementTypes'])
+    if cim_sccs_dict is not None:
+        cim_sccs = cim_sccs_dict.get(cim_path_key(cim_pool.path), [])
+    else:
+        cim_sccs = smis_common.Associators(
+            cim_pool.path,
+            AssocClass='CIM_ElementCapabilities',
+            ResultClass='CIM_StorageConfigurationCapabilities',
+            PropertyList=_cim_scc_pros())
     # Associate StorageConfigurationCapabilities to StoragePool
     # is experimental in SNIA 1.6rev4, Block Book PDF Page 68.
     # Section 5.1.6 StoragePool, StorageVolume and LogicalDisk
@@ -201,10 +282,14 @@ def _pool_status_of_cim_pool(dmtf_op_status_list):
         Pool.STATUS_UNKNOWN, Pool.STATUS_OTHER)
 
 
-def cim_pool_to_lsm_pool(smis_common, cim_pool, system_id):
+def cim_pool_to_lsm_pool(smis_common, cim_pool, system_id,
+                         cim_sccs_dict=None, element_type_wanted=True):
     """
     Return a Pool object base on information of cim_pool.
     Assuming cim_pool already holding correct properties.
+    The cim_sccs_dict is the return of cim_sccs_of_all_pools() or None.
+    Without element_type_wanted, the queries for the element type and
+    unsupported actions are skipped and both are 0.
     """
     status_info = ''
     pool_id = pool_id_of_cim_pool(cim_pool)
@@ -222,7 +307,10 @@ def cim_pool_to_lsm_pool(smis_common, cim_pool, system_id):
         (status, status_info) = _pool_status_of_cim_pool(
             cim_pool['OperationalStatus'])
 
-    element_type, unsupported = _pool_element_type(smis_common, cim_pool)
+    element_type, unsupported = 0, 0
+    if element_type_wanted:
+        element_type, unsupported = _pool_element_type(
+            smis_common, cim_pool, cim_sccs_dict)
 
     plugin_data = cim_path_to_path_str(cim_pool.path)
 
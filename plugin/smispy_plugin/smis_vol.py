@@ -24,7 +24,7 @@
 
 from lsm import md5, Volume, LsmError, ErrorNumber
 from smispy_plugin.utils import (
-    merge_list, cim_path_to_path_str, path_str_to_cim_path)
+    merge_list, cim_path_to_path_str, path_str_to_cim_path, cim_path_key)
 from smispy_plugin import dmtf
 
 
@@ -86,6 +86,55 @@ def cim_vol_of_cim_pool_path(smis_common, cim_pool_path, property_list=None):
         ResultClass='CIM_StorageVolume',
         PropertyList=property_list)
 
+    return _cim_vols_filter(cim_vols)
+
+
+def cim_vols_of_cim_pools(smis_common, cim_pools, property_list=None):
+    """
+    Do cim_vol_of_cim_pool_path() for all cim_pools at once:
+    enumerate CIM_AllocatedFromStoragePool and CIM_StorageVolume and join
+    them in memory instead of one Associators() call for each
+    CIM_StoragePool.
+    Fall back to cim_vol_of_cim_pool_path() if provider fails to enumerate
+    CIM_AllocatedFromStoragePool.
+    Return a list of [cim_vol] in the order of cim_pools.
+    """
+    if property_list is None:
+        property_list = ['Usage']
+    else:
+        property_list = merge_list(property_list, ['Usage'])
+
+    vol_paths_of_pool = None
+    if cim_pools:
+        vol_paths_of_pool = smis_common.associated_paths(
+            'CIM_AllocatedFromStoragePool', 'Antecedent', 'Dependent')
+
+    if not vol_paths_of_pool:
+        return list(
+            cim_vol_of_cim_pool_path(smis_common, p.path, property_list)
+            for p in cim_pools)
+
+    # CIM_AllocatedFromStoragePool also links child pools to their parent
+    # pool, they are not in CIM_StorageVolume.
+    cim_vol_dict = dict(
+        (cim_path_key(v.path), v) for v in
+        smis_common.enumerate_cached('CIM_StorageVolume', property_list))
+    rc = []
+    for cim_pool in cim_pools:
+        cim_vols = []
+        for cim_vol_path in vol_paths_of_pool.get(
+                cim_path_key(cim_pool.path), []):
+            cim_vol = cim_vol_dict.get(cim_path_key(cim_vol_path))
+            if cim_vol is not None:
+                cim_vols.append(cim_vol)
+        rc.append(_cim_vols_filter(cim_vols))
+    return rc
+
+
+def _cim_vols_filter(cim_vols):
+    """
+    Filter out CIM_StorageVolume['Usage'] == dmtf.VOL_USAGE_SYS_RESERVED.
+    """
     needed_cim_vols = []
     for cim_vol in cim_vols:
         if 'Usage' not in cim_vol or \
@@ -14,6 +14,7 @@
 #
 # Author: Gris Ge <fge@redhat.com>
 
+import functools
 import traceback
 import json
 from lsm import (LsmError, ErrorNumber, error)
@@ -34,6 +35,7 @@ def merge_list(list_a, list_b):
 
 
 def handle_cim_errors(method):
+    @functools.wraps(method)
     def cim_wrapper(*args, **kwargs):
         try:
             return method(*args, **kwargs)
@@ -98,6 +100,18 @@ def cim_path_to_path_str(cim_path):
     })
 
 
+def cim_path_key(cim_path):
+    """
+    Return a hashable key of CIMInstanceName for joining instances and the
+    references of association instances in memory. Host and namespace are
+    not included as providers do not fill them the same way everywhere.
+    Args:
+        cim_path: CIM path
+    """
+    return tuple(sorted(
+        (k.lower(), str(v)) for k, v in cim_path.keybindings.items()))
+
+
 def path_str_to_cim_path(path_str):
     """
     Convert a string into CIMInstanceName.
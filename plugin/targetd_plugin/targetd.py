@@ -31,13 +31,13 @@
                  common_urllib2_error_handler, search_property,
                  AccessGroup, int_div)
 
+from six.moves import http_client
+
 try:
-    from urllib.request import (Request,
-                                urlopen)
+    from urllib.error import (HTTPError, URLError)
     from urllib.parse import (urlunsplit)
 except ImportError:
-    from urllib2 import (Request,
-                         urlopen)
+    from urllib2 import (HTTPError, URLError)
     from urlparse import (urlunsplit)
 
 if six.PY3:
@@ -47,6 +47,17 @@
 DEFAULT_PORT = 18700
 PATH = "/targetrpc"
 
+# Seconds results of the list methods below are reused, unless we change
+# something on targetd ourselves.  The cache_ttl URI parameter overrides it.
+DEFAULT_CACHE_TTL = 2
+_CACHED_METHODS = ('pool_list', 'vol_list', 'export_list', 'initiator_list',
+                   'access_group_list', 'access_group_map_list', 'fs_list',
+                   'ss_list', 'nfs_export_list', 'nfs_export_auth_list')
+
+# Methods safe to send again when a kept-alive connection drops before we
+# read their response, as running them twice changes nothing on targetd.
+_READ_ONLY_METHODS = _CACHED_METHODS + ('async_list',)
+
 
 SSL_DEFAULT_CONTEXT = False
 
@@ -136,7 +147,12 @@ def __init__(self):
         self.headers = None
         self.no_ssl_verify = False
         self._flag_ag_support = True
+        self._flag_batch = True
         self.ca_cert_file = ""
+        self._ssl_ctx = None
+        self._conn = None
+        self.cache_ttl = DEFAULT_CACHE_TTL
+        self._cache = {}
         self.system = System("targetd", "targetd storage appliance",
                              System.STATUS_UNKNOWN, '')
 
@@ -185,6 +201,24 @@ def plugin_register(self, uri, password, timeout, flags=0):
             raise LsmError(ErrorNumber.INVALID_ARGUMENT,
                            "Cannot specify no_ssl_verify or ca_cert_file for this"
                            "version of python!")
+
+        if SSL_DEFAULT_CONTEXT:
+            if self.ca_cert_file:
+                self._ssl_ctx = ssl.create_default_context(
+                    cafile=self.ca_cert_file)
+            elif self.no_ssl_verify:
+                self._ssl_ctx = ssl.create_default_context()
+                self._ssl_ctx.check_hostname = False
+                self._ssl_ctx.verify_mode = ssl.CERT_NONE
+
+        if "cache_ttl" in self.uri["parameters"]:
+            try:
+                self.cache_ttl = float(self.uri["parameters"]["cache_ttl"])
+            except ValueError:
+                raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                               'cache_ttl URI parameter is not a number: %s' %
+                               self.uri["parameters"]["cache_ttl"])
+
         try:
             self._jsonrequest('access_group_list', default_error_handler=False)
         except TargetdError as te:
@@ -203,7 +237,8 @@ def time_out_get(self, flags=0):
 
     @handle_errors
     def plugin_unregister(self, flags=0):
-        pass
+        self._http_close()
+        self._cache = {}
 
     @handle_errors
     def capabilities(self, system, flags=0):
@@ -286,9 +321,12 @@ def _uuid_to_vpd83(uuid):
     @handle_errors
     def volumes(self, search_key=None, search_value=None, flags=0):
         volumes = []
-        for p_name in (p['name'] for p in self._jsonrequest("pool_list") if
-                       p['type'] == 'block'):
-            for vol in self._jsonrequest("vol_list", dict(pool=p_name)):
+        p_names = list(p['name'] for p in self._jsonrequest("pool_list")
+                       if p['type'] == 'block')
+        vol_lists = self._jsonrequests(
+            list(("vol_list", dict(pool=p_name)) for p_name in p_names))
+        for p_name, vol_list in zip(p_names, vol_lists):
+            for vol in vol_list:
                 vpd83 = TargetdStorage._uuid_to_vpd83(vol['uuid'])
                 volumes.append(
                     Volume(vol['uuid'], vol['name'], vpd83, 512,
@@ -332,8 +370,9 @@ def access_groups(self, search_key=None, search_value=None, flags=0):
 
         # For backward compatibility
         if self._flag_ag_support is True:
-            tgt_inits = self._jsonrequest(
-                'initiator_list', {'standalone_only': True})
+            (tgt_inits, tgt_ags) = self._jsonrequests(
+                [('initiator_list', {'standalone_only': True}),
+                 ('access_group_list', None)])
         else:
             tgt_inits = list(
                 {'init_id': x}
@@ -347,7 +386,7 @@ def access_groups(self, search_key=None, search_value=None, flags=0):
                 for i in tgt_inits))
 
         if self._flag_ag_support is True:
-            for tgt_ag in self._jsonrequest('access_group_list'):
+            for tgt_ag in tgt_ags:
                 rc_lsm_ags.append(
                     TargetdStorage._tgt_ag_to_lsm(
                         tgt_ag, self.system.id))
@@ -504,7 +543,14 @@ def _tgt_masks(self):
             }
         """
         tgt_masks = []
-        for tgt_exp in self._jsonrequest("export_list"):
+        if self._flag_ag_support:
+            (tgt_exps, tgt_ag_maps) = self._jsonrequests(
+                [("export_list", None), ("access_group_map_list", None)])
+        else:
+            tgt_exps = self._jsonrequest("export_list")
+            tgt_ag_maps = []
+
+        for tgt_exp in tgt_exps:
             tgt_masks.append({
                 'ag_id': "%s%s" % (
                     TargetdStorage._FAKE_AG_PREFIX,
@@ -513,14 +559,13 @@ def _tgt_masks(self):
                 'pool_name': tgt_exp['pool'],
                 'h_lun_id': tgt_exp['lun'],
             })
-        if self._flag_ag_support:
-            for tgt_ag_map in self._jsonrequest("access_group_map_list"):
-                tgt_masks.append({
-                    'ag_id': tgt_ag_map['ag_name'],
-                    'vol_name': tgt_ag_map['vol_name'],
-                    'pool_name': tgt_ag_map['pool_name'],
-                    'h_lun_id': tgt_ag_map['h_lun_id'],
-                })
+        for tgt_ag_map in tgt_ag_maps:
+            tgt_masks.append({
+                'ag_id': tgt_ag_map['ag_name'],
+                'vol_name': tgt_ag_map['vol_name'],
+                'pool_name': tgt_ag_map['pool_name'],
+                'h_lun_id': tgt_ag_map['h_lun_id'],
+            })
 
         return tgt_masks
 
@@ -835,11 +880,11 @@ def exports(self, search_key=None, search_value=None, flags=0):
         tmp_exports = {}
         exports = []
         fs_full_paths = {}
-        all_nfs_exports = self._jsonrequest("nfs_export_list")
+        (all_nfs_exports, fs_list) = self._jsonrequests(
+            [("nfs_export_list", None), ("fs_list", None)])
         nfs_exports = []
 
         # Remove those that are not of FS origin
-        fs_list = self._jsonrequest("fs_list")
         for f in fs_list:
             fs_full_paths[f['full_path']] = f
 
@@ -999,30 +1044,61 @@ def _default_error_handler(error_code, msg):
                 msg_d = msg
             raise LsmError(ec, msg_d)
 
-    def _jsonrequest(self, method, params=None, default_error_handler=True):
-        data = json.dumps(dict(id=self.rpc_id, method=method,
-                               params=params, jsonrpc="2.0"))
-        self.rpc_id += 1
-
-        request = Request(self.url, data.encode('utf-8'), self.headers)
+    def _http_close(self):
+        if self._conn is not None:
+            self._conn.close()
+            self._conn = None
 
-        if SSL_DEFAULT_CONTEXT:
-            if self.ca_cert_file:
-                ctx = ssl.create_default_context(cafile=self.ca_cert_file)
-            elif self.no_ssl_verify:
-                ctx = ssl.create_default_context()
-                ctx.check_hostname = False
-                ctx.verify_mode = ssl.CERT_NONE
-            else:
-                ctx = None
+    def _http_post(self, data, read_only=False):
+        """
+        Posts a JSON-RPC request body to targetd over the kept-alive
+        connection, connecting again if targetd closed it since our last
+        request.  Once the request is sent targetd may have run it, so a
+        dropped connection is only retried then if the request is
+        read_only.  Errors are raised like urlopen() does, for
+        common_urllib2_error_handler().
+        Returns the decoded response body.
+        """
+        while True:
+            reused = self._conn is not None
+            if not reused:
+                if self.scheme == 'https' and SSL_DEFAULT_CONTEXT:
+                    self._conn = http_client.HTTPSConnection(
+                        self.host_with_port, context=self._ssl_ctx)
+                elif self.scheme == 'https':
+                    self._conn = http_client.HTTPSConnection(
+                        self.host_with_port)
+                else:
+                    self._conn = http_client.HTTPConnection(
+                        self.host_with_port)
+
+            sent = False
+            try:
+                # Bytes, so that headers and body go out in one segment
+                self._conn.request('POST', PATH, data.encode('utf-8'),
+                                   self.headers)
+                sent = True
+                response_obj = self._conn.getresponse()
+                response_data = response_obj.read()
+            except (http_client.HTTPException, socket.error) as e:
+                self._http_close()
+                if reused and (not sent or read_only) and \
+                        not isinstance(e, socket.timeout):
+                    # Idle connection closed by targetd
+                    continue
+                if isinstance(e, socket.error):
+                    raise URLError(e)
+                raise
 
-            response_obj = urlopen(request, context=ctx)
-        else:
-            # Does not support context parameter
-            response_obj = urlopen(request)
+            if response_obj.will_close:
+                self._http_close()
+            if response_obj.status != 200:
+                self._http_close()
+                raise HTTPError(self.url, response_obj.status,
+                                response_obj.reason, response_obj.msg, None)
+            return response_data.decode('utf-8')
 
-        response_data = response_obj.read().decode('utf-8')
-        response = json.loads(response_data)
+    def _jsonresult(self, response, default_error_handler=True):
         if response.get('error', None) is None:
             return response.get('result')
         else:
@@ -1050,3 +1126,84 @@ def _jsonrequest(self, method, params=None, default_error_handler=True):
                             raise LsmError(
                                 ErrorNumber.PLUGIN_BUG,
                                 "%d has error %d" % (async_code, status[0]))
+
+    def _cache_key(self, method, params):
+        if self.cache_ttl <= 0 or method not in _CACHED_METHODS:
+            return None
+        return method, json.dumps(params, sort_keys=True)
+
+    def _cache_get(self, key):
+        if key in self._cache:
+            (expire, result) = self._cache[key]
+            if time.time() < expire:
+                # Callers are free to modify what they get
+                return True, copy.deepcopy(result)
+            del self._cache[key]
+        return False, None
+
+    def _cache_put(self, method, key, result):
+        if key is not None:
+            self._cache[key] = (time.time() + self.cache_ttl,
+                                copy.deepcopy(result))
+        elif method != 'async_list':
+            # We might have changed anything listed
+            self._cache = {}
+
+    def _jsonrequest(self, method, params=None, default_error_handler=True):
+        key = self._cache_key(method, params)
+        (found, result) = self._cache_get(key)
+        if found:
+            return result
+
+        data = json.dumps(dict(id=self.rpc_id, method=method,
+                               params=params, jsonrpc="2.0"))
+        self.rpc_id += 1
+
+        response = json.loads(self._http_post(
+            data, method in _READ_ONLY_METHODS))
+        result = self._jsonresult(response, default_error_handler)
+        self._cache_put(method, key, result)
+        return result
+
+    def _jsonrequests(self, calls):
+        """
+        Sends a list of (method, params) calls in one JSON-RPC batch,
+        falling back to one request per call if targetd does not support
+        batches or does not answer a call by its id.  Returns the list of
+        their results.
+        """
+        results = [None] * len(calls)
+        pending = {}
+        for i, (method, params) in enumerate(calls):
+            key = self._cache_key(method, params)
+            (found, results[i]) = self._cache_get(key)
+            if not found:
+                pending[self.rpc_id] = (i, method, key)
+                results[i] = dict(id=self.rpc_id, method=method,
+                                  params=params, jsonrpc="2.0")
+                self.rpc_id += 1
+
+        if len(pending) > 1 and self._flag_batch:
+            read_only = all(method in _READ_ONLY_METHODS
+                            for (_, method, _) in pending.values())
+            responses = json.loads(self._http_post(json.dumps(
+                list(results[i] for (i, _, _) in pending.values())),
+                read_only))
+            replies = {}
+            if isinstance(responses, list):
+                for response in responses:
+                    if isinstance(response, dict) and \
+                            response.get('id') in pending:
+                        replies[response['id']] = response
+            if not replies:
+                self._flag_batch = False
+            for (rpc_id, reply) in replies.items():
+                (i, method, key) = pending.pop(rpc_id)
+                results[i] = self._jsonresult(reply)
+                self._cache_put(method, key, results[i])
+
+        # Calls the batch reply did not answer by id, e.g. rejected with a
+        # null id, are retried one by one to get their own result or error.
+        for (i, method, _) in pending.values():
+            results[i] = self._jsonrequest(method, results[i]['params'])
+        return results
@@ -22,11 +22,14 @@
 
 from lsm._data import (Disk, Volume, Pool, System, FileSystem, FsSnapshot,
                     NfsExport, BlockRange, AccessGroup, TargetPort,
-                    Capabilities, Battery)
+                    Capabilities, Battery, Event)
 from lsm._iplugin import IPlugin, IStorageAreaNetwork, \
     INetworkAttachedStorage, INfs
 
 from lsm._client import Client
+from lsm._multi import MultiClient
+from lsm._record_set import (VolumeSet, DiskSet, PoolSet, AccessGroupSet,
+                             FileSystemSet)
 from lsm._pluginrunner import PluginRunner, search_property
 
 __all__ = []
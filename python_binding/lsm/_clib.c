@@ -18,8 +18,11 @@
  */
 
 #include <Python.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <libstoragemgmt/libstoragemgmt.h>
 
@@ -166,6 +169,26 @@ static const char local_disk_vpd83_search_docstring[] =
     "        err_msg (string)\n"
     "            Error message, empty if no error.\n";
 
+static const char local_disk_vpd83_search_all_docstring[] =
+    "INTERNAL USE ONLY!\n"
+    "\n"
+    "Usage:\n"
+    "    Find out the disk paths of each of given SCSI VPD page 0x83 NAA\n"
+    "    type IDs, querying the VPD83 of each local disk only once.\n"
+    "Parameters:\n"
+    "    vpd83s (list of string)\n"
+    "        The VPD83 NAA type IDs.\n"
+    "Returns:\n"
+    "    [disk_paths_list, rc, err_msg]\n"
+    "        disk_paths_list (list of list of string)\n"
+    "            Disk paths of vpd83s[i] in disk_paths_list[i], the\n"
+    "            multipath devices holding them are included after them.\n"
+    "            The string format: '/dev/sd[a-z]+' or '/dev/mapper/<name>'.\n"
+    "        rc (integer)\n"
+    "            Error code, lsm.ErrorNumber.OK if no error\n"
+    "        err_msg (string)\n"
+    "            Error message, empty if no error.\n";
+
 static const char local_disk_serial_num_get_docstring[] =
     "INTERNAL USE ONLY!\n"
     "\n"
@@ -374,8 +397,42 @@ static const char local_disk_link_speed_get_docstring[] =
     "        err_msg (string)\n"
     "            Error message, empty if no error.\n";
 
+static const char cbor_encode_docstring[] =
+    "INTERNAL USE ONLY!\n"
+    "\n"
+    "Usage:\n"
+    "    Encode an object as CBOR (RFC 8949) for the plug-in protocol, the\n"
+    "    way json.dumps() does as JSON. bytes and bytearray go as byte\n"
+    "    strings, integers need to fit 64 bits.\n"
+    "Parameters:\n"
+    "    obj (object)\n"
+    "        None, bool, integer, float, string, bytes, list, tuple or dict.\n"
+    "    default (callable)\n"
+    "        Called with any other object, returns one to encode instead.\n"
+    "Returns:\n"
+    "    encoded (bytes)\n";
+
+static const char cbor_decode_docstring[] =
+    "INTERNAL USE ONLY!\n"
+    "\n"
+    "Usage:\n"
+    "    Decode CBOR (RFC 8949) of the plug-in protocol, the way json.loads()\n"
+    "    does JSON.\n"
+    "Parameters:\n"
+    "    data (bytes)\n"
+    "        One encoded item.\n"
+    "    object_hook (callable)\n"
+    "        Called with each decoded dict, returns the object to use\n"
+    "        instead.\n"
+    "Returns:\n"
+    "    obj (object)\n";
+
 static PyObject *local_disk_serial_num_get(PyObject *self, PyObject *args,
                                            PyObject *kwargs);
+static PyObject *cbor_encode(PyObject *self, PyObject *args,
+                             PyObject *kwargs);
+static PyObject *cbor_decode(PyObject *self, PyObject *args,
+                             PyObject *kwargs);
 
 static PyObject *local_disk_vpd83_search(PyObject *self, PyObject *args,
                                          PyObject *kwargs);
@@ -391,6 +448,8 @@ static PyObject *local_disk_link_type_get(PyObject *self, PyObject *args,
                                           PyObject *kwargs);
 static PyObject *local_disk_link_speed_get(PyObject *self, PyObject *args,
                                            PyObject *kwargs);
+static PyObject *local_disk_vpd83_search_all(PyObject *self, PyObject *args,
+                                             PyObject *kwargs);
 static PyObject *_lsm_string_list_to_pylist(lsm_string_list *str_list);
 static PyObject *_c_str_to_py_str(const char *str);
 static PyObject *local_disk_led_status_get(PyObject *self, PyObject *args,
@@ -410,6 +469,8 @@ static PyMethodDef _methods[] = {
      METH_VARARGS | METH_KEYWORDS, local_disk_serial_num_get_docstring},
     {"_local_disk_vpd83_search", (PyCFunction)local_disk_vpd83_search,
      METH_VARARGS | METH_KEYWORDS, local_disk_vpd83_search_docstring},
+    {"_local_disk_vpd83_search_all", (PyCFunction)local_disk_vpd83_search_all,
+     METH_VARARGS | METH_KEYWORDS, local_disk_vpd83_search_all_docstring},
     {"_local_disk_vpd83_get", (PyCFunction)local_disk_vpd83_get,
      METH_VARARGS | METH_KEYWORDS, local_disk_vpd83_get_docstring},
     {"_local_disk_health_status_get", (PyCFunction)local_disk_health_status_get,
@@ -432,6 +493,10 @@ static PyMethodDef _methods[] = {
      METH_VARARGS | METH_KEYWORDS, local_disk_led_status_get_docstring},
     {"_local_disk_link_speed_get", (PyCFunction)local_disk_link_speed_get,
      METH_VARARGS | METH_KEYWORDS, local_disk_link_speed_get_docstring},
+    {"_cbor_encode", (PyCFunction)cbor_encode, METH_VARARGS | METH_KEYWORDS,
+     cbor_encode_docstring},
+    {"_cbor_decode", (PyCFunction)cbor_decode, METH_VARARGS | METH_KEYWORDS,
+     cbor_decode_docstring},
     {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
@@ -533,6 +598,582 @@ out:
     return rc_list;
 }
 
+static PyObject *local_disk_vpd83_search_all(PyObject *self, PyObject *args,
+                                             PyObject *kwargs) {
+    static const char *kwlist[] = {"vpd83s", NULL};
+    PyObject *vpd83s = NULL;
+    const char *vpd83 = NULL;
+    lsm_local_disk_index *index = NULL;
+    lsm_string_list *disk_paths = NULL;
+    lsm_error *lsm_err = NULL;
+    int rc = LSM_ERR_OK;
+    Py_ssize_t i = 0;
+    PyObject *rc_list = NULL;
+    PyObject *rc_obj = NULL;
+    PyObject *disk_paths_obj = NULL;
+    PyObject *err_msg_obj = NULL;
+    PyObject *err_no_obj = NULL;
+    bool flag_no_mem = false;
+
+    _UNUSED(self);
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!", (char **)kwlist,
+                                     &PyList_Type, &vpd83s))
+        return NULL;
+    for (i = 0; i < PyList_Size(vpd83s); ++i) {
+        if (!PyArg_Parse(PyList_GET_ITEM(vpd83s, i), "s", &vpd83))
+            return NULL;
+    }
+
+    rc_obj = PyList_New(0);
+    _alloc_check(rc_obj, flag_no_mem, out);
+
+    rc = lsm_local_disk_index_new(&index, &lsm_err);
+    for (i = 0; (rc == LSM_ERR_OK) && (i < PyList_Size(vpd83s)); ++i) {
+        PyArg_Parse(PyList_GET_ITEM(vpd83s, i), "s", &vpd83);
+        rc = lsm_local_disk_index_vpd83_search(index, vpd83, &disk_paths,
+                                               &lsm_err);
+        if (rc != LSM_ERR_OK)
+            break;
+        disk_paths_obj = _lsm_string_list_to_pylist(disk_paths);
+        if (disk_paths != NULL) {
+            lsm_string_list_free(disk_paths);
+            disk_paths = NULL;
+        }
+        _alloc_check(disk_paths_obj, flag_no_mem, out);
+        if (PyList_Append(rc_obj, disk_paths_obj) != 0) {
+            Py_XDECREF(disk_paths_obj);
+            flag_no_mem = true;
+            goto out;
+        }
+        Py_XDECREF(disk_paths_obj);
+    }
+
+    err_no_obj = PyInt_FromLong(rc);
+    _alloc_check(err_no_obj, flag_no_mem, out);
+    rc_list = PyList_New(3 /* rc_obj, errno, err_str*/);
+    _alloc_check(rc_list, flag_no_mem, out);
+    if (rc != LSM_ERR_OK) {
+        err_msg_obj = PyUnicode_FromString(lsm_error_message_get(lsm_err));
+        lsm_error_free(lsm_err);
+        lsm_err = NULL;
+        _alloc_check(err_msg_obj, flag_no_mem, out);
+    } else {
+        err_msg_obj = PyUnicode_FromString("");
+        _alloc_check(err_msg_obj, flag_no_mem, out);
+    }
+out:
+    if (lsm_err != NULL)
+        lsm_error_free(lsm_err);
+    if (index != NULL)
+        lsm_local_disk_index_free(index);
+    if (flag_no_mem == true) {
+        Py_XDECREF(rc_list);
+        Py_XDECREF(err_no_obj);
+        Py_XDECREF(err_msg_obj);
+        Py_XDECREF(rc_obj);
+        return PyErr_NoMemory();
+    }
+    PyList_SET_ITEM(rc_list, 0, rc_obj);
+    PyList_SET_ITEM(rc_list, 1, err_no_obj);
+    PyList_SET_ITEM(rc_list, 2, err_msg_obj);
+    return rc_list;
+}
+
+/*
+ * CBOR codec of the plug-in protocol, json.dumps() and json.loads() of the
+ * JSON one have C accelerators too.
+ */
+
+/* Deeper CBOR is taken for an attack on the stack rather than a message */
+#define _CBOR_DEPTH_MAX 512
+
+struct _cbor_out {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+static int _cbor_put(struct _cbor_out *out, const void *data, size_t len) {
+    if (out->len + len > out->size) {
+        size_t size = out->size ? out->size : 256;
+        char *data_new = NULL;
+
+        while (size < out->len + len)
+            size *= 2;
+        data_new = realloc(out->data, size);
+        if (data_new == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        out->data = data_new;
+        out->size = size;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    return 0;
+}
+
+static int _cbor_head(struct _cbor_out *out, int major, uint64_t n) {
+    unsigned char head[9];
+    int bytes = 0;
+    int i = 0;
+
+    if (n < 24) {
+        head[0] = (unsigned char)(major << 5 | n);
+    } else if (n <= 0xff) {
+        head[0] = (unsigned char)(major << 5 | 24);
+        bytes = 1;
+    } else if (n <= 0xffff) {
+        head[0] = (unsigned char)(major << 5 | 25);
+        bytes = 2;
+    } else if (n <= 0xffffffff) {
+        head[0] = (unsigned char)(major << 5 | 26);
+        bytes = 4;
+    } else {
+        head[0] = (unsigned char)(major << 5 | 27);
+        bytes = 8;
+    }
+    for (i = bytes; i > 0; --i) {
+        head[i] = (unsigned char)(n & 0xff);
+        n >>= 8;
+    }
+    return _cbor_put(out, head, bytes + 1);
+}
+
+static int _cbor_bytes(struct _cbor_out *out, int major, const char *data,
+                       Py_ssize_t len) {
+    if (_cbor_head(out, major, len) != 0)
+        return -1;
+    return _cbor_put(out, data, len);
+}
+
+static int _cbor_text(struct _cbor_out *out, PyObject *obj) {
+#if PY_MAJOR_VERSION >= 3
+    Py_ssize_t len = 0;
+    const char *data = PyUnicode_AsUTF8AndSize(obj, &len);
+
+    if (data == NULL)
+        return -1;
+    return _cbor_bytes(out, 3, data, len);
+#else
+    int rc = -1;
+    PyObject *utf8 = PyUnicode_AsUTF8String(obj);
+
+    if (utf8 == NULL)
+        return -1;
+    rc = _cbor_bytes(out, 3, PyString_AS_STRING(utf8),
+                     PyString_GET_SIZE(utf8));
+    Py_DECREF(utf8);
+    return rc;
+#endif
+}
+
+static int _cbor_int(struct _cbor_out *out, PyObject *obj) {
+    int overflow = 0;
+    long long n = PyLong_AsLongLongAndOverflow(obj, &overflow);
+    unsigned long long u = 0;
+    PyObject *inverted = NULL;
+
+    if (n == -1 && PyErr_Occurred())
+        return -1;
+    if (!overflow)
+        return n < 0 ? _cbor_head(out, 1, (uint64_t)(-1 - n))
+                     : _cbor_head(out, 0, (uint64_t)n);
+
+    /* Negative ones go as -1 - n, which is ~n */
+    if (overflow > 0) {
+        u = PyLong_AsUnsignedLongLong(obj);
+    } else {
+        inverted = PyNumber_Invert(obj);
+        if (inverted == NULL)
+            return -1;
+        u = PyLong_AsUnsignedLongLong(inverted);
+        Py_DECREF(inverted);
+    }
+    if (u == (unsigned long long)-1 && PyErr_Occurred()) {
+        PyErr_SetString(PyExc_ValueError, "CBOR integers are 64 bits at most");
+        return -1;
+    }
+    return _cbor_head(out, overflow > 0 ? 0 : 1, u);
+}
+
+static int _cbor_float(struct _cbor_out *out, double d) {
+    unsigned char buf[9];
+    uint64_t bits = 0;
+    int i = 0;
+
+    memcpy(&bits, &d, sizeof(bits));
+    buf[0] = 0xfb;
+    for (i = 8; i > 0; --i) {
+        buf[i] = (unsigned char)(bits & 0xff);
+        bits >>= 8;
+    }
+    return _cbor_put(out, buf, sizeof(buf));
+}
+
+static int _cbor_encode_obj(struct _cbor_out *out, PyObject *obj,
+                            PyObject *dflt);
+
+/* Keys which are no strings become ones the way json.dumps() does it */
+static int _cbor_key(struct _cbor_out *out, PyObject *key) {
+    int rc = -1;
+    PyObject *str = NULL;
+
+    if (PyUnicode_Check(key) || PyBytes_Check(key))
+        return _cbor_encode_obj(out, key, NULL);
+    if (key == Py_True || key == Py_False || key == Py_None) {
+        str = PyUnicode_FromString(key == Py_None   ? "null"
+                                   : key == Py_True ? "true"
+                                                    : "false");
+    } else if (PyLong_Check(key) || PyFloat_Check(key)
+#if PY_MAJOR_VERSION < 3
+               || PyInt_Check(key)
+#endif
+    ) {
+        str = PyObject_Str(key);
+    } else {
+        PyErr_SetString(PyExc_TypeError, "CBOR map key is not a string");
+        return -1;
+    }
+    if (str == NULL)
+        return -1;
+    rc = _cbor_encode_obj(out, str, NULL);
+    Py_DECREF(str);
+    return rc;
+}
+
+static int _cbor_encode_dict(struct _cbor_out *out, PyObject *obj,
+                             PyObject *dflt) {
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    Py_ssize_t pos = 0;
+
+    if (_cbor_head(out, 5, PyDict_Size(obj)) != 0)
+        return -1;
+    while (PyDict_Next(obj, &pos, &key, &value)) {
+        if (_cbor_key(out, key) != 0 || _cbor_encode_obj(out, value, dflt) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int _cbor_encode_seq(struct _cbor_out *out, PyObject *obj,
+                            PyObject *dflt) {
+    Py_ssize_t i = 0;
+    PyObject *seq = PySequence_Fast(obj, "");
+
+    if (seq == NULL)
+        return -1;
+    if (_cbor_head(out, 4, PySequence_Fast_GET_SIZE(seq)) != 0) {
+        Py_DECREF(seq);
+        return -1;
+    }
+    for (i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+        if (_cbor_encode_obj(out, PySequence_Fast_GET_ITEM(seq, i), dflt) !=
+            0) {
+            Py_DECREF(seq);
+            return -1;
+        }
+    }
+    Py_DECREF(seq);
+    return 0;
+}
+
+static int _cbor_encode_obj(struct _cbor_out *out, PyObject *obj,
+                            PyObject *dflt) {
+    int rc = -1;
+    PyObject *other = NULL;
+    unsigned char simple = 0;
+
+    if (obj == Py_None || obj == Py_True || obj == Py_False) {
+        simple = obj == Py_None ? 0xf6 : obj == Py_True ? 0xf5 : 0xf4;
+        return _cbor_put(out, &simple, 1);
+    }
+#if PY_MAJOR_VERSION < 3
+    /* Strings of Python 2 are text as far as json.dumps() is concerned */
+    if (PyString_Check(obj))
+        return _cbor_bytes(out, 3, PyString_AS_STRING(obj),
+                           PyString_GET_SIZE(obj));
+    if (PyInt_Check(obj))
+        return _cbor_int(out, obj);
+#else
+    if (PyBytes_Check(obj))
+        return _cbor_bytes(out, 2, PyBytes_AS_STRING(obj),
+                           PyBytes_GET_SIZE(obj));
+#endif
+    if (PyUnicode_Check(obj))
+        return _cbor_text(out, obj);
+    if (PyLong_Check(obj))
+        return _cbor_int(out, obj);
+    if (PyFloat_Check(obj))
+        return _cbor_float(out, PyFloat_AS_DOUBLE(obj));
+    if (PyByteArray_Check(obj))
+        return _cbor_bytes(out, 2, PyByteArray_AS_STRING(obj),
+                           PyByteArray_GET_SIZE(obj));
+
+    if (Py_EnterRecursiveCall(" while encoding CBOR"))
+        return -1;
+    if (PyDict_Check(obj)) {
+        rc = _cbor_encode_dict(out, obj, dflt);
+    } else if (PyList_Check(obj) || PyTuple_Check(obj)) {
+        rc = _cbor_encode_seq(out, obj, dflt);
+    } else if (dflt != NULL && dflt != Py_None) {
+        other = PyObject_CallFunctionObjArgs(dflt, obj, NULL);
+        if (other != NULL) {
+            rc = _cbor_encode_obj(out, other, dflt);
+            Py_DECREF(other);
+        }
+    } else {
+        PyErr_Format(PyExc_TypeError, "%s is not CBOR serializable",
+                     Py_TYPE(obj)->tp_name);
+    }
+    Py_LeaveRecursiveCall();
+    return rc;
+}
+
+static PyObject *cbor_encode(PyObject *self, PyObject *args,
+                             PyObject *kwargs) {
+    static const char *kwlist[] = {"obj", "default", NULL};
+    PyObject *obj = NULL;
+    PyObject *dflt = NULL;
+    PyObject *rc_obj = NULL;
+    struct _cbor_out out = {NULL, 0, 0};
+
+    _UNUSED(self);
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char **)kwlist,
+                                     &obj, &dflt))
+        return NULL;
+    if (_cbor_encode_obj(&out, obj, dflt) == 0)
+        rc_obj = PyBytes_FromStringAndSize(out.data, out.len);
+    free(out.data);
+    return rc_obj;
+}
+
+struct _cbor_in {
+    const unsigned char *p;
+    const unsigned char *end;
+    PyObject *hook;
+    int depth;
+};
+
+static int _cbor_argument(struct _cbor_in *in, int info, uint64_t *n) {
+    int bytes = 0;
+
+    if (info < 24) {
+        *n = info;
+        return 0;
+    }
+    if (info > 27) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Indefinite or reserved CBOR length");
+        return -1;
+    }
+    bytes = 1 << (info - 24);
+    if (in->end - in->p < bytes) {
+        PyErr_SetString(PyExc_ValueError, "Truncated CBOR");
+        return -1;
+    }
+    *n = 0;
+    while (bytes--)
+        *n = *n << 8 | *in->p++;
+    return 0;
+}
+
+static double _cbor_half(uint64_t bits) {
+    int exp = (bits >> 10) & 0x1f;
+    int mant = bits & 0x3ff;
+    double d = 0;
+
+    if (exp == 0)
+        d = ldexp(mant, -24);
+    else if (exp != 31)
+        d = ldexp(mant + 1024, exp - 25);
+    else
+        d = mant ? NAN : INFINITY;
+    return (bits & 0x8000) ? -d : d;
+}
+
+static PyObject *_cbor_simple(struct _cbor_in *in, int info) {
+    uint64_t bits = 0;
+    uint32_t bits32 = 0;
+    float f = 0;
+    double d = 0;
+
+    switch (info) {
+    case 20:
+        Py_RETURN_FALSE;
+    case 21:
+        Py_RETURN_TRUE;
+    case 22:
+    case 23:
+        Py_RETURN_NONE;
+    case 25:
+    case 26:
+    case 27:
+        if (_cbor_argument(in, info, &bits) != 0)
+            return NULL;
+        if (info == 25) {
+            d = _cbor_half(bits);
+        } else if (info == 26) {
+            bits32 = (uint32_t)bits;
+            memcpy(&f, &bits32, sizeof(f));
+            d = f;
+        } else {
+            memcpy(&d, &bits, sizeof(d));
+        }
+        return PyFloat_FromDouble(d);
+    default:
+        PyErr_SetString(PyExc_ValueError, "Unsupported CBOR simple value");
+        return NULL;
+    }
+}
+
+static PyObject *_cbor_decode_item(struct _cbor_in *in);
+
+static PyObject *_cbor_decode_array(struct _cbor_in *in, uint64_t n) {
+    uint64_t i = 0;
+    PyObject *item = NULL;
+    PyObject *list = PyList_New((Py_ssize_t)n);
+
+    if (list == NULL)
+        return NULL;
+    for (i = 0; i < n; ++i) {
+        item = _cbor_decode_item(in);
+        if (item == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t)i, item);
+    }
+    return list;
+}
+
+static PyObject *_cbor_decode_map(struct _cbor_in *in, uint64_t n) {
+    uint64_t i = 0;
+    int rc = 0;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    PyObject *hooked = NULL;
+    PyObject *dict = PyDict_New();
+
+    if (dict == NULL)
+        return NULL;
+    for (i = 0; i < n && rc == 0; ++i) {
+        key = _cbor_decode_item(in);
+        value = key ? _cbor_decode_item(in) : NULL;
+        rc = value ? PyDict_SetItem(dict, key, value) : -1;
+        Py_XDECREF(key);
+        Py_XDECREF(value);
+    }
+    if (rc != 0) {
+        Py_DECREF(dict);
+        return NULL;
+    }
+    if (in->hook == NULL || in->hook == Py_None)
+        return dict;
+    hooked = PyObject_CallFunctionObjArgs(in->hook, dict, NULL);
+    Py_DECREF(dict);
+    return hooked;
+}
+
+static PyObject *_cbor_decode_item(struct _cbor_in *in) {
+    int major = 0;
+    int info = 0;
+    uint64_t n = 0;
+    PyObject *rc_obj = NULL;
+
+    if (in->p >= in->end) {
+        PyErr_SetString(PyExc_ValueError, "Truncated CBOR");
+        return NULL;
+    }
+    major = *in->p >> 5;
+    info = *in->p++ & 0x1f;
+    if (major == 7)
+        return _cbor_simple(in, info);
+    if (_cbor_argument(in, info, &n) != 0)
+        return NULL;
+
+    switch (major) {
+    case 0:
+        return PyLong_FromUnsignedLongLong(n);
+    case 1:
+        if (n <= INT64_MAX)
+            return PyLong_FromLongLong(-1 - (long long)n);
+        rc_obj = PyLong_FromUnsignedLongLong(n);
+        if (rc_obj != NULL) {
+            PyObject *negative = PyNumber_Invert(rc_obj);
+            Py_DECREF(rc_obj);
+            rc_obj = negative;
+        }
+        return rc_obj;
+    case 2:
+    case 3:
+        if ((uint64_t)(in->end - in->p) < n) {
+            PyErr_SetString(PyExc_ValueError, "Truncated CBOR");
+            return NULL;
+        }
+        if (major == 2)
+            rc_obj = PyBytes_FromStringAndSize((const char *)in->p,
+                                               (Py_ssize_t)n);
+        else
+            rc_obj = PyUnicode_DecodeUTF8((const char *)in->p, (Py_ssize_t)n,
+                                          "strict");
+        in->p += n;
+        return rc_obj;
+    case 6:
+        /* Tags only qualify the item following them */
+        if (n == 2 || n == 3) {
+            PyErr_SetString(PyExc_ValueError,
+                            "CBOR integers are 64 bits at most");
+            return NULL;
+        }
+        return _cbor_decode_item(in);
+    default:
+        break;
+    }
+
+    /* Every item takes a byte at least */
+    if ((uint64_t)(in->end - in->p) < n) {
+        PyErr_SetString(PyExc_ValueError, "Truncated CBOR");
+        return NULL;
+    }
+    if (++in->depth > _CBOR_DEPTH_MAX) {
+        PyErr_SetString(PyExc_ValueError, "CBOR nested too deep");
+        return NULL;
+    }
+    rc_obj = (major == 4) ? _cbor_decode_array(in, n) : _cbor_decode_map(in, n);
+    --in->depth;
+    return rc_obj;
+}
+
+static PyObject *cbor_decode(PyObject *self, PyObject *args,
+                             PyObject *kwargs) {
+    static const char *kwlist[] = {"data", "object_hook", NULL};
+    PyObject *data = NULL;
+    PyObject *rc_obj = NULL;
+    Py_buffer view;
+    struct _cbor_in in;
+
+    _UNUSED(self);
+    memset(&in, 0, sizeof(in));
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char **)kwlist,
+                                     &data, &in.hook))
+        return NULL;
+    if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) != 0)
+        return NULL;
+
+    in.p = (const unsigned char *)view.buf;
+    in.end = in.p + view.len;
+    rc_obj = _cbor_decode_item(&in);
+    if (rc_obj != NULL && in.p != in.end) {
+        Py_DECREF(rc_obj);
+        rc_obj = NULL;
+        PyErr_SetString(PyExc_ValueError, "Trailing data after CBOR");
+    }
+    PyBuffer_Release(&view);
+    return rc_obj;
+}
+
 #if PY_MAJOR_VERSION >= 3
 #define MOD_DEF(name, methods)                                                 \
     static struct PyModuleDef moduledef = {PyModuleDef_HEAD_INIT,              \
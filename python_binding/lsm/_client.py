@@ -19,7 +19,7 @@
 from lsm import (Volume, NfsExport, Capabilities, Pool, System, Battery,
                  Disk, AccessGroup, FileSystem, FsSnapshot,
                  uri_parse, LsmError, ErrorNumber,
-                 INetworkAttachedStorage, TargetPort)
+                 INetworkAttachedStorage, TargetPort, Event)
 
 from lsm._common import return_requires as _return_requires
 from lsm._common import UDS_PATH as _UDS_PATH
@@ -45,6 +45,21 @@ def _check_search_key(search_key, supported_keys):
     if search_key and search_key not in supported_keys:
         raise LsmError(ErrorNumber.UNSUPPORTED_SEARCH_KEY,
                        "Unsupported search_key: '%s'" % search_key)
+
+
+def _check_fields(params, data_class):
+    """
+    Checks the "fields" of a list method, which is only sent when not None.
+    """
+    fields = params.pop('fields')
+    if fields is not None:
+        supported = data_class._field_names()
+        for field in fields:
+            if field not in supported:
+                raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                               "Unsupported field: '%s'" % field)
+        params['fields'] = list(fields)
+    return params
     return
 
 
@@ -74,6 +89,9 @@ class Client(INetworkAttachedStorage):
     FLAG_VOLUME_CREATE_DISABLE_SYSTEM_CACHE = 1 << 2
     FLAG_VOLUME_CREATE_DISABLE_IO_PASSTHROUGH = 1 << 3
 
+    # Deadline of the transport from connecting on, see TransPort.deadline
+    _deadline = None
+
     """
     Client side class used for managing storage that utilises RPC mechanism.
     """
@@ -93,7 +111,17 @@ def __start(self, uri, password, timeout, flags=0):
         """
         Instruct the plug-in to get ready
         """
-        self._tp.rpc('plugin_register', _del_self(locals()))
+        features = self._tp.rpc('plugin_register', _del_self(locals()))
+        # Plug-ins taking batches say so, older ones reply None
+        self._tp.batch_supported = \
+            isinstance(features, dict) and features.get('batch') is True
+        # Plug-ins taking CBOR list it, the exchange so far was json
+        self._tp.cbor = isinstance(features, dict) and \
+            'cbor' in (features.get('encodings') or [])
+        # Plug-ins serving all connections in one process take more
+        # sessions over this one, see session()
+        self._tp.sessions_supported = \
+            isinstance(features, dict) and features.get('sessions') is True
 
     # Checks to see if any unix domain sockets exist in the base directory
     # and opens a socket to one to see if the server is actually there.
@@ -153,6 +181,7 @@ def __init__(self, uri, plain_text_password=None, timeout_ms=30000,
 
         if os.path.exists(self.plugin_path):
             self._tp = _TransPort(_TransPort.get_socket(self.plugin_path))
+            self._tp.deadline = self._deadline
         else:
             # At this point we don't know if the user specified an incorrect
             # plug-in in the URI or the daemon isn't started.  We will check
@@ -306,28 +335,36 @@ def plugin_info(self, flags=FLAG_RSVD):
     # @param    search_key      Search key
     # @param    search_value    Search value
     # @param    flags           Reserved for future use, must be zero.
+    # @param    fields          Pool properties to retrieve, None for all.
     # @returns An array of pool objects.
     @_return_requires([Pool])
-    def pools(self, search_key=None, search_value=None, flags=FLAG_RSVD):
+    def pools(self, search_key=None, search_value=None, flags=FLAG_RSVD,
+              fields=None):
         """
         Returns an array of pool objects.  Pools are used in both block and
         file system interfaces, thus the reason they are in the base class.
+        With fields, a list of property names like ['name', 'free_space'],
+        the pools only have their id and those properties, reading any other
+        raises AttributeError.
         """
         _check_search_key(search_key, Pool.SUPPORTED_SEARCH_KEYS)
-        return self._tp.rpc('pools', _del_self(locals()))
+        return self._tp.rpc('pools', _check_fields(_del_self(locals()), Pool))
 
     # Returns an array of system objects.
     # @param    self    The this pointer
     # @param    flags   Reserved for future use, must be zero.
+    # @param    fields  System properties to retrieve, None for all.
     # @returns An array of system objects.
     @_return_requires([System])
-    def systems(self, flags=FLAG_RSVD):
+    def systems(self, flags=FLAG_RSVD, fields=None):
         """
         Returns an array of system objects.  System information is used to
         distinguish resources from on storage array to another when the plug=in
-        supports the ability to have more than one array managed by it
+        supports the ability to have more than one array managed by it.
+        With fields, the systems only have their id and the properties named.
         """
-        return self._tp.rpc('systems', _del_self(locals()))
+        return self._tp.rpc('systems',
+                            _check_fields(_del_self(locals()), System))
 
     # Changes the read cache percentage for a system.
     # @param    self            The this pointer
@@ -402,14 +439,18 @@ def iscsi_chap_auth(self, init_id, in_user, in_password,
     # @param    search_key      Search key to use
     # @param    search_value    Search value
     # @param    flags           Reserved for future use, must be zero.
+    # @param    fields          Volume properties to retrieve, None for all.
     # @returns An array of volume objects.
     @_return_requires([Volume])
-    def volumes(self, search_key=None, search_value=None, flags=FLAG_RSVD):
+    def volumes(self, search_key=None, search_value=None, flags=FLAG_RSVD,
+                fields=None):
         """
-        Returns an array of volume objects
+        Returns an array of volume objects.
+        With fields, the volumes only have their id and the properties named.
         """
         _check_search_key(search_key, Volume.SUPPORTED_SEARCH_KEYS)
-        return self._tp.rpc('volumes', _del_self(locals()))
+        return self._tp.rpc('volumes',
+                            _check_fields(_del_self(locals()), Volume))
 
     # Creates a volume
     # @param    self            The this pointer
@@ -557,14 +598,18 @@ def volume_disable(self, volume, flags=FLAG_RSVD):
     #                   returned objects will contain optional data.
     #                   If not defined, only the mandatory properties will
     #                   be returned.
+    # @param    fields  Disk properties to retrieve, None for all.
     # @returns An array of disk objects.
     @_return_requires([Disk])
-    def disks(self, search_key=None, search_value=None, flags=FLAG_RSVD):
+    def disks(self, search_key=None, search_value=None, flags=FLAG_RSVD,
+              fields=None):
         """
-        Returns an array of disk objects
+        Returns an array of disk objects.
+        With fields, the disks only have their id and the properties named,
+        plug-ins can then skip slow queries for the others.
         """
         _check_search_key(search_key, Disk.SUPPORTED_SEARCH_KEYS)
-        return self._tp.rpc('disks', _del_self(locals()))
+        return self._tp.rpc('disks', _check_fields(_del_self(locals()), Disk))
 
     # Access control for allowing an access group to access a volume
     # @param    self            The this pointer
@@ -1804,3 +1849,206 @@ def volume_read_cache_policy_update(self, volume, rcp, flags=FLAG_RSVD):
                            "Volume.READ_CACHE_POLICY_DISABLED")
         return self._tp.rpc('volume_read_cache_policy_update',
                             _del_self(locals()))
+
+    @_return_requires(None)
+    def subscribe(self, classes=None, interval=0, flags=FLAG_RSVD):
+        """
+        lsm.Client.subscribe(self, classes=None, interval=0,
+                             flags=lsm.Client.FLAG_RSVD)
+
+        Version:
+            1.10
+        Usage:
+            Start getting events for storage objects which got created,
+            modified or deleted or changed their status, see
+            lsm.Client.events().  Plug-ins which cannot tell what changed
+            compare all objects every interval seconds.  Subscribing again
+            replaces the previous subscription.
+        Parameters:
+            classes (list of string, optional)
+                Kinds of objects to watch, could be any of lsm.Event.CLASSES.
+                None for all the plug-in supports.
+            interval (int, optional)
+                Seconds between looking for changes when the plug-in has to
+                compare the objects, 0 for the default of 10 seconds.
+            flags (int, optional):
+                Reserved for future use. Should be set as lsm.Client.FLAG_RSVD
+        Returns:
+            N/A
+        SpecialExceptions:
+            LsmError
+                ErrorNumber.INVALID_ARGUMENT
+                    Unknown class in classes.
+                ErrorNumber.NO_SUPPORT
+                    Plug-in cannot list any of classes.
+        """
+        if classes is not None:
+            for c in classes:
+                if c not in Event.CLASSES:
+                    raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                                   "Unsupported class: '%s'" % c)
+        return self._tp.rpc('subscribe', _del_self(locals()))
+
+    @_return_requires(None)
+    def unsubscribe(self, flags=FLAG_RSVD):
+        """
+        lsm.Client.unsubscribe(self, flags=lsm.Client.FLAG_RSVD)
+
+        Version:
+            1.10
+        Usage:
+            Stop getting events.  Events already sent can still be retrieved
+            by lsm.Client.events().
+        Parameters:
+            flags (int, optional):
+                Reserved for future use. Should be set as lsm.Client.FLAG_RSVD
+        Returns:
+            N/A
+        """
+        return self._tp.rpc('unsubscribe', _del_self(locals()))
+
+    def events(self, timeout=None):
+        """
+        lsm.Client.events(self, timeout=None)
+
+        Version:
+            1.10
+        Usage:
+            Generator of the lsm.Event of the subscription, see
+            lsm.Client.subscribe().  Other methods can be called in between.
+        Parameters:
+            timeout (float, optional)
+                Seconds to wait for the next event before the generator
+                stops, None to wait forever.
+        Returns:
+            Generator of lsm.Event
+        """
+        while True:
+            event = self._tp.read_event(timeout)
+            if event is None:
+                return
+            yield Event(event['type'], event['object'])
+
+    def prefetch(self, call, *args, **kwargs):
+        """
+        lsm.Client.prefetch(self, call, *args, **kwargs)
+
+        Version:
+            1.10
+        Usage:
+            Runs call(*args, **kwargs) up to its first request to the
+            plug-in and sends that request without waiting for the response.
+            When the same request is made later, by this call or any other,
+            its response is taken from the ones read ahead.  This lets a
+            series of independent queries go out before the first response
+            comes back.  The call must not change anything before its first
+            request, that part is run again when it is called for real.
+            Responses nobody asked for can be dropped by
+            lsm.Client.prefetch_drain().
+        Parameters:
+            call (callable)
+                Code querying the plug-in through this client.
+        Returns:
+            N/A
+        SpecialExceptions:
+            Any exception call raises before its first request.
+        """
+        self._tp.prefetch(call, *args, **kwargs)
+
+    def batch(self, calls):
+        """
+        lsm.Client.batch(self, calls)
+
+        Version:
+            1.10
+        Usage:
+            Makes several independent calls with one message to the
+            plug-in and one back, instead of a round trip each.  The
+            plug-in may work on the calls at the same time.  Like
+            lsm.Client.prefetch(), each call runs up to its first request
+            before the batch is sent and runs again for its result, so it
+            must not change anything before that request.  Plug-ins not
+            taking batches get the requests pipelined instead.
+        Parameters:
+            calls (list of tuple)
+                (call, args) of each call, call being a callable querying
+                the plug-in through this client and args a tuple.
+        Returns:
+            [(result, error)]
+                result (object)
+                    What the call returned, None when it failed.
+                error (lsm.LsmError)
+                    Why the call failed, None when it did not.
+        SpecialExceptions:
+            Any exception a call raises before its first request.
+        """
+        self._tp.batch(calls)
+
+        results = []
+        for (call, args) in calls:
+            try:
+                results.append((call(*args), None))
+            except LsmError as le:
+                results.append((None, le))
+        return results
+
+    def prefetch_drain(self):
+        """
+        lsm.Client.prefetch_drain(self)
+
+        Version:
+            1.10
+        Usage:
+            Waits for the responses of requests sent by
+            lsm.Client.prefetch() which were not asked for yet and drops
+            them.
+        Parameters:
+            N/A
+        Returns:
+            N/A
+        """
+        self._tp.prefetch_drain()
+
+    def session(self, flags=FLAG_RSVD):
+        """
+        lsm.Client.session(self, flags=lsm.Client.FLAG_RSVD)
+
+        Version:
+            1.10
+        Usage:
+            Opens another session with the plug-in over the connection of
+            this client, registered with the same URI, password and
+            timeout.  The plug-in serves each session with a plug-in
+            instance of its own, and one does not wait for the calls of
+            another.  Only plug-ins configured with session-multiplexing in
+            lsmd.conf(5) take it.  The connection is closed once all of its
+            sessions are.
+        Parameters:
+            flags (int, optional):
+                Reserved for future use.
+                Should be set as lsm.Client.FLAG_RSVD.
+        Returns:
+            lsm.Client of the new session
+        SpecialExceptions:
+            LsmError
+                ErrorNumber.NO_SUPPORT
+                    The plug-in serves one session per connection.
+        """
+        if not self._tp.sessions_supported:
+            raise LsmError(ErrorNumber.NO_SUPPORT,
+                           "Plug-in does not take several sessions over "
+                           "one connection")
+
+        c = Client.__new__(Client)
+        c._uri = self._uri
+        c._password = self._password
+        c._timeout = self._timeout
+        c._uds_path = self._uds_path
+        c.plugin_path = self.plugin_path
+        c._tp = self._tp.session_open()
+        try:
+            c.__start(self._uri, self._password, self._timeout, flags)
+        except Exception:
+            c._tp.close()
+            raise
+        return c
@@ -462,6 +462,7 @@ class ErrorNumber(object):
     TIMEOUT = 11
     DAEMON_NOT_RUNNING = 12
     PERMISSION_DENIED = 13
+    DAEMON_BUSY = 14
 
     NAME_CONFLICT = 50
     EXISTS_INITIATOR = 52
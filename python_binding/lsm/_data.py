@@ -18,6 +18,7 @@
 #         Joe Handzik <joseph.t.handzik@hpe.com>
 
 from abc import ABCMeta as _ABCMeta
+import inspect
 import re
 import binascii
 from six import with_metaclass
@@ -96,6 +97,16 @@ def __decode(e):
     def decode(self, json_string, _w=WHITESPACE.match):
         return DataDecoder.__decode(json.loads(json_string))
 
+    @staticmethod
+    def object_hook(d):
+        """
+        Turns a dict decoded from CBOR into the object it stands for, the
+        ones nested in it come decoded already.
+        """
+        if 'class' in d:
+            return IData._factory(d)
+        return d
+
 
 class IData(with_metaclass(_ABCMeta, object)):
     """
@@ -137,7 +148,35 @@ def _factory(d):
                 else:
                     d['_' + k] = d.pop(k)
 
-            return c(**d)
+            (args, required) = IData._init_args(c)
+            if all(a in d for a in args[:required]):
+                return c(**d)
+
+            # Listed with "fields", only holds the properties asked for,
+            # the others raise AttributeError.
+            rc = c.__new__(c)
+            rc.__dict__.update(d)
+            return rc
+
+    @staticmethod
+    def _init_args(c):
+        """
+        Returns the __init__() arguments of an IData class and how many of
+        them are required.
+        """
+        if hasattr(inspect, 'getfullargspec'):
+            spec = inspect.getfullargspec(c.__init__)
+        else:
+            spec = inspect.getargspec(c.__init__)
+        args = spec.args[1:]
+        return args, len(args) - len(spec.defaults or ())
+
+    @classmethod
+    def _field_names(cls):
+        """
+        Returns the property names which list methods taking "fields" accept.
+        """
+        return [a[1:] for a in IData._init_args(cls)[0]]
 
     def __str__(self):
         """
@@ -1100,6 +1139,33 @@ def __init__(self, _id, _name, _type, _status, _system_id,
         self._plugin_data = _plugin_data
 
 
+class Event(object):
+    """
+    Change of a storage object a client subscribed to with
+    Client.subscribe().  For TYPE_DELETED, obj is the last known state of
+    the object.
+    """
+    TYPE_UNKNOWN = 0
+    TYPE_CREATED = 1
+    TYPE_MODIFIED = 2
+    TYPE_DELETED = 3
+    TYPE_HEALTH = 4
+
+    # Names of the classes which can be subscribed to
+    CLASS_SYSTEM = 'System'
+    CLASS_POOL = 'Pool'
+    CLASS_VOLUME = 'Volume'
+    CLASS_DISK = 'Disk'
+    CLASSES = [CLASS_SYSTEM, CLASS_POOL, CLASS_VOLUME, CLASS_DISK]
+
+    def __init__(self, _type, _obj):
+        self.type = _type
+        self.obj = _obj
+
+    def __str__(self):
+        return "%d %s" % (self.type, str(self.obj))
+
+
 if __name__ == '__main__':
     # TODO Need some unit tests that encode/decode all the types with nested
     pass
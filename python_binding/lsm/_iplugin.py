@@ -26,6 +26,11 @@ class IPlugin(with_metaclass(_ABCMeta, object)):
     operation.
     """
 
+    # Methods the plug-in runner may call from several threads at once when
+    # they come in one batch, the ones which change nothing and are thread
+    # safe in this plug-in.
+    BATCH_CONCURRENT = frozenset()
+
     @_abstractmethod
     def plugin_register(self, uri, password, timeout, flags=0):
         """
@@ -110,6 +115,11 @@ def pools(self, search_key=None, search_value=None, flags=0):
         Returns an array of pool objects.  Pools are used in both block and
         file system interfaces, thus the reason they are in the base class.
 
+        Like systems(), volumes() and disks(), may take a fields=None
+        argument: the names of the object properties the client asked for,
+        None for all of them.  The plug-in runner only sends those back,
+        plug-ins taking it can skip retrieving the others.
+
         Raises LsmError on error
         """
         pass
@@ -25,7 +25,8 @@
                        _local_disk_link_type_get, _local_disk_ident_led_on,
                        _local_disk_ident_led_off, _local_disk_fault_led_on,
                        _local_disk_fault_led_off, _local_disk_serial_num_get,
-                       _local_disk_led_status_get, _local_disk_link_speed_get)
+                       _local_disk_led_status_get, _local_disk_link_speed_get,
+                       _local_disk_vpd83_search_all)
 
 
 def _use_c_lib_function(func_ref, arg):
@@ -66,6 +67,45 @@ def vpd83_search(vpd83):
         """
         return _use_c_lib_function(_local_disk_vpd83_search, vpd83)
 
+    @staticmethod
+    def volume_join(volumes):
+        """
+        lsm.LocalDisk.volume_join(volumes)
+
+        Version:
+            1.10
+        Usage:
+            Find out the local disk paths of each given volume by its VPD83.
+            The VPD83 of every local disk is read only once regardless of the
+            number of volumes, so this is much cheaper than calling
+            vpd83_search() for each volume.
+        Parameters:
+            volumes ([lsm.Volume])
+                List of lsm.Volume objects.
+        Returns:
+            {volume_id: [disk_path]}
+                Dictionary keyed by the volume ID. Volumes without VPD83 or
+                not visible on this host are not included.
+                The disk_path string format is '/dev/sd[a-z]+' for SCSI and
+                ATA disks, followed by '/dev/mapper/<name>' for the multipath
+                devices holding them.
+        SpecialExceptions:
+            LsmError
+                ErrorNumber.LIB_BUG
+                    Internal bug.
+        Capability:
+            N/A
+                No capability required as this is a library level method.
+        """
+        volumes = [v for v in volumes if v.vpd83]
+        if len(volumes) == 0:
+            return {}
+        disk_paths_list = _use_c_lib_function(
+            _local_disk_vpd83_search_all, [v.vpd83 for v in volumes])
+        return dict((v.id, disk_paths)
+                    for v, disk_paths in zip(volumes, disk_paths_list)
+                    if disk_paths)
+
     @staticmethod
     def serial_num_get(disk_path):
         """
@@ -0,0 +1,221 @@
+# Copyright (C) 2026 Red Hat, Inc.
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; If not, see <http://www.gnu.org/licenses/>.
+
+import threading
+
+from six.moves import queue
+
+from lsm import LsmError, ErrorNumber
+from lsm._client import Client
+from lsm._transport import _now
+
+# Errors after which the replies of a connection cannot be trusted
+_BROKEN = (ErrorNumber.TIMEOUT, ErrorNumber.TRANSPORT_COMMUNICATION,
+           ErrorNumber.TRANSPORT_SERIALIZATION)
+
+
+class _ArrayClient(Client):
+    """
+    Client giving up on the plug-in at a deadline, connecting included.
+    """
+    def __init__(self, uri, password, timeout_ms, deadline):
+        self._deadline = deadline
+        Client.__init__(self, uri, password, timeout_ms)
+
+    def close(self, flags=Client.FLAG_RSVD):
+        if self._tp.deadline is not None and self._tp.deadline <= _now():
+            self._tp.close()
+        else:
+            Client.close(self, flags)
+
+
+def _error(e):
+    if isinstance(e, LsmError):
+        return e
+    return LsmError(ErrorNumber.LIB_BUG, str(e))
+
+
+class MultiClient(object):
+    """
+    Runs the same queries on many storage arrays at once.
+    """
+
+    LISTS = ('systems', 'pools', 'volumes', 'disks', 'access_groups', 'fs',
+             'exports', 'target_ports', 'batteries')
+
+    def __init__(self, arrays, workers=8, timeout_ms=30000):
+        """
+        lsm.MultiClient(arrays, workers=8, timeout_ms=30000)
+
+        Version:
+            1.10
+        Usage:
+            Prepares to query the given storage arrays, connecting to up to
+            'workers' of them at a time.  Each array gets 'timeout_ms'
+            milliseconds for all of its queries, connecting included, the
+            time is also passed to the plug-in as the timeout of the
+            connection.
+        Parameters:
+            arrays (list)
+                URI strings or (URI, password) tuples of the arrays.
+            workers (integer)
+                Most arrays to talk to at the same time.
+            timeout_ms (integer)
+                Milliseconds each array gets.
+        Returns:
+            MultiClient
+        SpecialExceptions:
+            LsmError
+                ErrorNumber.INVALID_ARGUMENT
+                    When workers or timeout_ms is not positive.
+        """
+        if workers < 1 or timeout_ms < 1:
+            raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                           "workers and timeout_ms have to be positive")
+        self._arrays = []
+        for a in arrays:
+            if isinstance(a, tuple):
+                self._arrays.append(a)
+            else:
+                self._arrays.append((a, None))
+        self._workers = workers
+        self._timeout_ms = timeout_ms
+
+    def run(self, work):
+        """
+        lsm.MultiClient.run(self, work)
+
+        Version:
+            1.10
+        Usage:
+            Calls work(client) for each array with an lsm.Client connected
+            to it, in worker threads.  Yields the outcome of each array as
+            soon as it is known, in no particular order.  Leaving the loop
+            early skips the arrays not started yet.
+        Parameters:
+            work (callable)
+                Queries an array through the lsm.Client it is given, its
+                return value is passed on.
+        Returns:
+            Generator of (uri, result, error) tuples, result is None when
+            error, an LsmError, is not.  ErrorNumber.TIMEOUT tells the
+            array ran out of time.
+        """
+        def array(uri, client):
+            return [(uri, work(client), None)]
+
+        def failed(uri, error):
+            return [(uri, None, error)]
+
+        return self._run(array, failed)
+
+    def lists(self, calls=LISTS):
+        """
+        lsm.MultiClient.lists(self, calls=lsm.MultiClient.LISTS)
+
+        Version:
+            1.10
+        Usage:
+            Lists the storage objects of all arrays, every list of an array
+            is asked for before waiting for the first one.  Yields each list
+            of each array as soon as it comes in.  Lists of an array which
+            could not be connected to, or ran out of time, carry the error.
+        Parameters:
+            calls (list)
+                Names of lsm.Client methods taking no argument, like
+                'volumes' or 'disks'.
+        Returns:
+            Generator of (uri, call, result, error) tuples, result is None
+            when error, an LsmError, is not.
+        """
+        def array(uri, client):
+            for call in calls:
+                client.prefetch(getattr(client, call))
+            error = None
+            for call in calls:
+                if error is None:
+                    try:
+                        yield (uri, call, getattr(client, call)(), None)
+                        continue
+                    except Exception as e:
+                        e = _error(e)
+                        if e.code not in _BROKEN:
+                            yield (uri, call, None, e)
+                            continue
+                        error = e
+                yield (uri, call, None, error)
+            if error is None:
+                # Only left when a call failed before its request
+                try:
+                    client.prefetch_drain()
+                except LsmError:
+                    pass
+
+        def failed(uri, error):
+            return [(uri, call, None, error) for call in calls]
+
+        return self._run(array, failed)
+
+    def _run(self, array, failed):
+        """
+        Starts the workers and yields the outcomes they queue, None marks
+        the end of an array.
+        """
+        todo = queue.Queue()
+        for a in self._arrays:
+            todo.put(a)
+        results = queue.Queue()
+        stop = threading.Event()
+
+        for i in range(min(self._workers, len(self._arrays))):
+            t = threading.Thread(target=self._worker,
+                                 args=(todo, results, stop, array, failed))
+            t.daemon = True
+            t.start()
+
+        try:
+            left = len(self._arrays)
+            while left:
+                r = results.get()
+                if r is None:
+                    left -= 1
+                else:
+                    yield r
+        finally:
+            stop.set()
+
+    def _worker(self, todo, results, stop, array, failed):
+        while not stop.is_set():
+            try:
+                (uri, password) = todo.get_nowait()
+            except queue.Empty:
+                return
+
+            deadline = _now() + self._timeout_ms / 1000.0
+            client = None
+            try:
+                client = _ArrayClient(uri, password, self._timeout_ms,
+                                      deadline)
+                for r in array(uri, client):
+                    results.put(r)
+            except Exception as e:
+                for r in failed(uri, _error(e)):
+                    results.put(r)
+
+            if client is not None:
+                try:
+                    client.close()
+                except Exception:
+                    client._tp.close()
+            results.put(None)
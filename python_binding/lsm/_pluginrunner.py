@@ -14,15 +14,28 @@
 #
 # Author: tasleson
 
+import array
+import fcntl
+import inspect
+import json
+import os
+import select
+import signal
 import socket
+import threading
+import time
 import traceback
 import sys
+from collections import deque
 from lsm import LsmError, error, ErrorNumber
 from lsm.lsmcli import cmd_line_wrapper
 import six
 import errno
 
 from lsm._common import SocketEOF as _SocketEOF
+from lsm._data import IData as _IData
+from lsm._data import DataEncoder as _DataEncoder
+from lsm._data import Event as _Event
 from lsm._transport import TransPort
 
 def search_property(lsm_objs, search_key, search_value):
@@ -36,12 +49,562 @@ def search_property(lsm_objs, search_key, search_value):
                 if getattr(lsm_obj, search_key) == search_value)
 
 
+def _takes_fields(func):
+    """
+    Returns True if the plug-in method has a "fields" argument, decorators
+    have to set __wrapped__ like functools.wraps() does.
+    """
+    if hasattr(inspect, 'signature'):
+        return 'fields' in inspect.signature(func).parameters
+    func = getattr(func, '__wrapped__', func)
+    return 'fields' in inspect.getargspec(func).args
+
+
+def _project(lsm_obj, fields):
+    """
+    Returns the dictionary sent for lsm_obj with only the id and the
+    properties in fields.
+    """
+    if not isinstance(lsm_obj, _IData):
+        return lsm_obj
+    return dict((k, v) for (k, v) in lsm_obj._to_dict().items()
+                if k in fields or k in ('class', 'id'))
+
+
+def _call(plugin, method, params):
+    """
+    Runs a plug-in method.  The "fields" of list requests is passed on to
+    methods taking it, and only the properties named are sent back.
+    """
+    if params is None:
+        return getattr(plugin, method)()
+
+    fields = params.pop('fields', None)
+    func = getattr(plugin, method)
+    if fields is not None and _takes_fields(func):
+        params['fields'] = fields
+
+    result = func(**params)
+    if fields is None or not isinstance(result, list):
+        return result
+    fields = frozenset(fields)
+    return [_project(r, fields) for r in result]
+
+
+# Reply to plugin_register, telling the client what the runner takes
+_FEATURES = {'batch': True, 'encodings': ['cbor']}
+
+# Reply to plugin_register of a plug-in serving all connections in one
+# process, which also takes several sessions over one connection
+_MUX_FEATURES = dict(_FEATURES, sessions=True)
+
+# Seconds a client of a multiplexing plug-in has to send the rest of a
+# message it started, or to take a reply, before it is dropped
+_MUX_IO_TIMEOUT = 30
+
+# Requests changing the state of the connection, which batches cannot hold
+_UNBATCHED = ('plugin_register', 'plugin_unregister', 'subscribe',
+              'unsubscribe')
+
+# Most threads answering the concurrent requests of a batch
+_BATCH_THREADS = 4
+
+
+def _batch_reply(plugin, msg, index):
+    """
+    Runs one request of a batch and returns its reply, with the id of the
+    request or else its index in the batch.
+    """
+    msg_id = msg.get('id', index) if isinstance(msg, dict) else index
+    try:
+        if not isinstance(msg, dict) or 'method' not in msg or \
+                'params' not in msg:
+            raise LsmError(ErrorNumber.TRANSPORT_INVALID_ARG,
+                           "Invalid request")
+        method = msg['method']
+        if method in _UNBATCHED:
+            raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                           "%s cannot be batched" % method)
+        if not hasattr(plugin, method):
+            raise LsmError(ErrorNumber.NO_SUPPORT, "Unsupported operation")
+        return {'id': msg_id, 'result': _call(plugin, method, msg['params'])}
+    except ValueError as ve:
+        error(traceback.format_exc())
+        e = {'code': -32700, 'message': str(ve), 'data': None}
+    except AttributeError as ae:
+        error(traceback.format_exc())
+        e = {'code': -32601, 'message': str(ae), 'data': None}
+    except LsmError as lsm_err:
+        e = {'code': lsm_err.code, 'message': lsm_err.msg,
+             'data': lsm_err.data}
+    except Exception:
+        # Other requests of the batch still get their replies
+        error("Unhandled exception in plug-in!\n" + traceback.format_exc())
+        e = {'code': ErrorNumber.PLUGIN_BUG,
+             'message': "Unhandled exception in plug-in",
+             'data': str(traceback.format_exc())}
+    return {'id': msg_id, 'error': e}
+
+
+def _batch_run(plugins, msgs):
+    """
+    Runs the requests of a batch on the plug-in of each and returns their
+    replies in order.  Consecutive requests in the BATCH_CONCURRENT of their
+    plug-in run in up to _BATCH_THREADS threads, any other one waits for the
+    ones before it.
+    """
+    replies = [None] * len(msgs)
+
+    def concurrent(k):
+        return isinstance(msgs[k], dict) and msgs[k].get('method') in \
+            getattr(plugins[k], 'BATCH_CONCURRENT', ())
+
+    def work(todo):
+        while True:
+            try:
+                k = todo.popleft()
+            except IndexError:
+                return
+            replies[k] = _batch_reply(plugins[k], msgs[k], k)
+
+    i = 0
+    while i < len(msgs):
+        todo = deque([i])
+        i += 1
+        if concurrent(todo[0]):
+            while i < len(msgs) and concurrent(i):
+                todo.append(i)
+                i += 1
+
+        # This thread takes requests too
+        threads = [threading.Thread(target=work, args=(todo,))
+                   for _ in range(min(_BATCH_THREADS, len(todo)) - 1)]
+        for t in threads:
+            t.start()
+        work(todo)
+        for t in threads:
+            t.join()
+    return replies
+
+
+class _Subscription(object):
+    """
+    Changes a client subscribed to.  Plug-ins which know what changed can
+    implement changes(start), which returns a list of (class name, id or
+    None for all of the class) tuples changed since the last call, or None
+    if that is not known this time.  With start True it begins tracking,
+    raising LsmError if it cannot.  They can also implement changes_fd(),
+    a file descriptor readable when there are changes, else changes() is
+    called every interval seconds.  For other plug-ins all objects are
+    compared every interval seconds.
+    """
+
+    DEFAULT_INTERVAL = 10
+
+    # Class name, plug-in method, method supports search_key 'id'
+    _CLASSES = ((_Event.CLASS_SYSTEM, 'systems', False),
+                (_Event.CLASS_POOL, 'pools', True),
+                (_Event.CLASS_VOLUME, 'volumes', True),
+                (_Event.CLASS_DISK, 'disks', True))
+
+    def __init__(self, plugin, params):
+        params = params or {}
+        classes = params.get('classes')
+        if classes is None:
+            classes = list(c[0] for c in _Subscription._CLASSES)
+        for c in classes:
+            if c not in _Event.CLASSES:
+                raise LsmError(ErrorNumber.INVALID_ARGUMENT,
+                               "Unsupported class: '%s'" % c)
+
+        self._plugin = plugin
+        self._classes = list(c for c in _Subscription._CLASSES
+                             if c[0] in classes and hasattr(plugin, c[1]))
+        if not self._classes:
+            raise LsmError(ErrorNumber.NO_SUPPORT,
+                           "Plug-in cannot list any of the classes")
+        self._interval = params.get('interval') or \
+            _Subscription.DEFAULT_INTERVAL
+
+        self._native = False
+        self._fd = None
+        if hasattr(plugin, 'changes'):
+            try:
+                plugin.changes(True)
+                self._native = True
+                if hasattr(plugin, 'changes_fd'):
+                    self._fd = plugin.changes_fd()
+            except LsmError as lsm_err:
+                if lsm_err.code != ErrorNumber.NO_SUPPORT:
+                    raise
+
+        # Class name -> {id: (json, object)}
+        self._objects = dict((c[0], {}) for c in self._classes)
+        for c in self._classes:
+            self._diff(c, None, [])
+        self._next = time.time() + self._interval
+
+    def fd(self):
+        """
+        Returns the file descriptor to wait for besides the client, or None.
+        """
+        return self._fd
+
+    def timeout(self):
+        """
+        Returns the seconds until the next check, or None.
+        """
+        if self._fd is not None:
+            return None
+        return max(0, self._next - time.time())
+
+    def _list(self, c, obj_id):
+        if obj_id is None:
+            return getattr(self._plugin, c[1])()
+        return getattr(self._plugin, c[1])(search_key='id',
+                                           search_value=obj_id)
+
+    def _diff(self, c, obj_id, events):
+        """
+        Compares the objects of class c, or only the one with obj_id, to
+        the last known state, appending an event for each difference.
+        """
+        known = self._objects[c[0]]
+        seen = set()
+        for obj in self._list(c, obj_id):
+            data = json.dumps(obj, cls=_DataEncoder, sort_keys=True)
+            seen.add(obj.id)
+            if obj.id not in known:
+                events.append({'type': _Event.TYPE_CREATED, 'object': obj})
+            elif known[obj.id][0] != data:
+                old = known[obj.id][1]
+                if getattr(obj, 'status', None) != \
+                        getattr(old, 'status', None):
+                    events.append({'type': _Event.TYPE_HEALTH,
+                                   'object': obj})
+                else:
+                    events.append({'type': _Event.TYPE_MODIFIED,
+                                   'object': obj})
+            else:
+                continue
+            known[obj.id] = (data, obj)
+
+        for k in list(known.keys()):
+            if (obj_id is None or k == obj_id) and k not in seen:
+                events.append({'type': _Event.TYPE_DELETED,
+                               'object': known.pop(k)[1]})
+
+    def check(self, fd_ready=False):
+        """
+        Returns the events since the last check, when fd_ready the
+        changes_fd() of the plug-in was readable.
+        """
+        if not fd_ready:
+            self._next = time.time() + self._interval
+
+        changed = None
+        if self._native:
+            try:
+                changed = self._plugin.changes(False)
+            except LsmError as lsm_err:
+                error("Plug-in failed to report changes: %s" % lsm_err.msg)
+
+        if changed is None:
+            changed = list((c[0], None) for c in self._classes)
+
+        dirty = {}
+        for (name, obj_id) in changed:
+            if name not in self._objects:
+                continue
+            if obj_id is None:
+                dirty[name] = None
+            elif name not in dirty:
+                dirty[name] = set([obj_id])
+            elif dirty[name] is not None:
+                dirty[name].add(obj_id)
+
+        events = []
+        for c in self._classes:
+            if c[0] not in dirty:
+                continue
+            try:
+                if dirty[c[0]] is None or not c[2]:
+                    self._diff(c, None, events)
+                else:
+                    for obj_id in dirty[c[0]]:
+                        self._diff(c, obj_id, events)
+            except LsmError as lsm_err:
+                error("Listing %s for subscription failed: %s" %
+                      (c[1], lsm_err.msg))
+        return events
+
+
+class _MuxConn(object):
+    """
+    Client connection of a multiplexing plug-in, read by a thread of its
+    own.  The workers of its sessions send their replies, one at a time.
+    """
+
+    def __init__(self, s, number):
+        s.settimeout(_MUX_IO_TIMEOUT)
+        self.tp = TransPort(s)
+        # Number lsmd knows the connection by
+        self.number = number
+        # Session -> _MuxWorker, only changed by the reading thread
+        self.sessions = {}
+        # A plug-in failed unexpectedly
+        self.failed = False
+        self.thread = None
+        self._lock = threading.Lock()
+        self._closed = False
+
+    def send(self, func, *args):
+        """
+        Sends a message with func of the transport, dropping the
+        connection if the client does not take it in time.
+        """
+        with self._lock:
+            if self._closed:
+                return
+            try:
+                func(*args)
+            except socket.error:
+                self.shutdown()
+
+    def shutdown(self):
+        """
+        Makes the reading thread see the end of the connection.
+        """
+        try:
+            self.tp.s.shutdown(socket.SHUT_RDWR)
+        except socket.error:
+            pass
+
+    def close(self):
+        with self._lock:
+            self._closed = True
+            self.tp.close()
+
+
+class _MuxBatch(object):
+    """
+    Batch of requests of a multiplexed connection.  The requests of each
+    session run on the worker of the session, the last one done sends all
+    the replies.
+    """
+
+    def __init__(self, conn, msgs, parts):
+        self.conn = conn
+        self.msgs = msgs
+        self._replies = [None] * len(msgs)
+        self._left = parts
+        self._lock = threading.Lock()
+
+    def done(self, indices, replies):
+        with self._lock:
+            for (i, reply) in zip(indices, replies):
+                msg = self.msgs[i]
+                if not isinstance(msg, dict) or 'id' not in msg:
+                    reply['id'] = i
+                elif msg.get('session') is not None:
+                    reply['session'] = msg['session']
+                self._replies[i] = reply
+            self._left -= 1
+            if self._left:
+                return
+        self.conn.send(self.conn.tp.send_batch, self._replies)
+
+
+class _MuxWorker(object):
+    """
+    Thread owning one plug-in instance, serving the requests of the session
+    using it in order.  Sessions do not wait for each other, and the
+    instance is only used by this thread, also once handed to another
+    session after being idle.
+    """
+
+    def __init__(self, runner):
+        self._runner = runner
+        self._plugin = None
+        self._todo = deque()
+        self._lock = threading.Lock()
+        self._done = False
+        (self._wake_r, self._wake_w) = os.pipe()
+        # (connection, session, _Subscription) or None
+        self._sub = None
+        # Registered instance handed over by PluginRunner._mux_idle_take()
+        self.reused = False
+        # Key of the plugin_register of the instance, None until registered
+        self.key = None
+        self._thread = threading.Thread(target=self._run)
+        self._thread.daemon = True
+        self._thread.start()
+
+    def post(self, item):
+        """
+        Queues ('request', connection, msg), ('batch', _MuxBatch, indices)
+        or None, which ends the worker and unregisters the instance.
+        """
+        with self._lock:
+            if not self._done:
+                self._todo.append(item)
+                os.write(self._wake_w, b'.')
+
+    def join(self):
+        self._thread.join()
+
+    def _next(self):
+        """
+        Returns the next item queued, sending the events of the
+        subscription meanwhile.
+        """
+        while True:
+            with self._lock:
+                if self._todo:
+                    return self._todo.popleft()
+
+            rlist = [self._wake_r]
+            tmo = None
+            if self._sub is not None:
+                if self._sub[2].fd() is not None:
+                    rlist.append(self._sub[2].fd())
+                else:
+                    tmo = self._sub[2].timeout()
+            readable = select.select(rlist, [], [], tmo)[0]
+            if self._wake_r in readable:
+                os.read(self._wake_r, 512)
+                continue
+
+            (conn, sid, sub) = self._sub
+            for event in sub.check(bool(readable)):
+                conn.send(conn.tp.send_event, event, sid)
+
+    def _run(self):
+        try:
+            while True:
+                item = self._next()
+                if item is None:
+                    break
+                if item[0] == 'batch':
+                    self._batch(item[1], item[2])
+                elif not self._request(item[1], item[2]):
+                    break
+        finally:
+            if self._plugin is not None:
+                PluginRunner._unregister(self._plugin)
+            with self._lock:
+                self._done = True
+                os.close(self._wake_r)
+                os.close(self._wake_w)
+            self._runner._mux_worker_done(self)
+
+    def _plugin_get(self):
+        if self._plugin is None:
+            self._plugin = self._runner.plugin()
+        return self._plugin
+
+    def _request(self, conn, msg):
+        """
+        Serves one request.  Returns False when the worker is done.
+        """
+        method = msg['method']
+        msg_id = msg['id']
+        params = msg['params'] or {}
+        sid = msg.get('session')
+        idle = False
+
+        try:
+            if method == 'plugin_unregister':
+                plugin = self._plugin
+            else:
+                plugin = self._plugin_get()
+            result = None
+            if method == 'plugin_register':
+                key = PluginRunner._reg_key(params)
+                if self.reused:
+                    self.reused = False
+                    try:
+                        # The previous session might have changed it
+                        plugin.time_out_set(key[2], key[3])
+                    except Exception:
+                        pass
+                else:
+                    plugin.plugin_register(**params)
+                self.key = key
+                result = _MUX_FEATURES
+            elif method == 'plugin_unregister':
+                self._sub = None
+                idle = self.key is not None and \
+                    self._runner._mux_idle_tmo > 0
+                if not idle and plugin is not None:
+                    self._plugin = None
+                    plugin.plugin_unregister(**params)
+            elif method == 'subscribe':
+                self._sub = (conn, sid, _Subscription(plugin, params))
+            elif method == 'unsubscribe':
+                self._sub = None
+            elif hasattr(plugin, method):
+                result = _call(plugin, method, params)
+            else:
+                raise LsmError(ErrorNumber.NO_SUPPORT,
+                               "Unsupported operation")
+            conn.send(conn.tp.send_resp, result, msg_id, sid)
+        except ValueError as ve:
+            error(traceback.format_exc())
+            conn.send(conn.tp.send_error, msg_id, -32700, str(ve), None, sid)
+        except AttributeError as ae:
+            error(traceback.format_exc())
+            conn.send(conn.tp.send_error, msg_id, -32601, str(ae), None, sid)
+        except LsmError as lsm_err:
+            conn.send(conn.tp.send_error, msg_id, lsm_err.code, lsm_err.msg,
+                      lsm_err.data, sid)
+        except Exception:
+            error("Unhandled exception in plug-in!\n" + traceback.format_exc())
+            conn.send(conn.tp.send_error, msg_id, ErrorNumber.PLUGIN_BUG,
+                      "Unhandled exception in plug-in",
+                      str(traceback.format_exc()), sid)
+            conn.failed = True
+            conn.shutdown()
+
+        if method != 'plugin_unregister':
+            return True
+        if sid is None and not conn.sessions:
+            # Clients which do not multiplex close after unregister
+            conn.shutdown()
+        if idle:
+            self._runner._mux_idle_put(self)
+        return idle
+
+    def _batch(self, batch, indices):
+        """
+        Runs the requests of a batch which belong to the session.
+        """
+        try:
+            plugin = self._plugin_get()
+        except Exception:
+            # Every request gets told the operation is unsupported
+            error("Unhandled exception in plug-in!\n" +
+                  traceback.format_exc())
+            plugin = None
+        msgs = list(batch.msgs[i] for i in indices)
+        batch.done(indices, _batch_run([plugin] * len(msgs), msgs))
+
+
 class PluginRunner(object):
     """
     Plug-in side common code which uses the passed in plugin to do meaningful
     work.
     """
 
+    # Command line argument lsmd uses to start a plug-in as a zygote, followed
+    # by the file descriptor of the control socket.
+    ZYGOTE_ARG = '--lsmd-zygote'
+
+    # Command line argument lsmd uses to start a plug-in serving all client
+    # connections in one process, followed by the file descriptor of the
+    # control socket and the session idle timeout in seconds.
+    MUX_ARG = '--lsmd-mux'
+
     @staticmethod
     def _is_number(val):
         """
@@ -53,8 +616,370 @@ def _is_number(val):
         except ValueError:
             return False
 
+    @staticmethod
+    def _zygote_reap(ctl):
+        """
+        Reaps exited children and reports them back to lsmd as
+        'EXIT <pid> <wait status>'.
+        """
+        while True:
+            try:
+                (pid, status) = os.waitpid(-1, os.WNOHANG)
+            except OSError as oe:
+                if oe.errno == errno.ECHILD:
+                    break
+                raise
+            if pid == 0:
+                break
+            ctl.send(('EXIT %d %d' % (pid, status)).encode('utf-8'))
+
+    @staticmethod
+    def _zygote(ctl_fd):
+        """
+        Runs as a zygote for lsmd.  Everything the plug-in needs is already
+        imported, so for every client connection lsmd hands over the control
+        socket (SCM_RIGHTS) we fork a child to serve it.  Only returns in the
+        forked child, with the file descriptor of the client connection.
+        """
+        ctl = socket.fromfd(ctl_fd, socket.AF_UNIX, socket.SOCK_SEQPACKET)
+        os.close(ctl_fd)
+
+        if not hasattr(ctl, 'recvmsg'):
+            # Python 2 has no recvmsg(), lsmd will fork and exec instead.
+            error('Plug-in zygote needs socket.recvmsg(), exiting')
+            sys.exit(2)
+
+        int_size = array.array('i').itemsize
+        (wake_r, wake_w) = os.pipe()
+        for fd in (wake_r, wake_w):
+            flags = fcntl.fcntl(fd, fcntl.F_GETFL)
+            fcntl.fcntl(fd, fcntl.F_SETFL, flags | os.O_NONBLOCK)
+        signal.signal(signal.SIGCHLD, lambda signum, frame: None)
+        signal.set_wakeup_fd(wake_w)
+
+        try:
+            ctl.send(b'READY')
+            while True:
+                readable = select.select([ctl, wake_r], [], [])[0]
+
+                if wake_r in readable:
+                    try:
+                        os.read(wake_r, 512)
+                    except OSError:
+                        pass
+                    PluginRunner._zygote_reap(ctl)
+
+                if ctl not in readable:
+                    continue
+
+                msg, ancdata, _, _ = ctl.recvmsg(
+                    16, socket.CMSG_LEN(int_size))
+                if not msg:
+                    # lsmd closed the control socket (exit or reload).
+                    break
+
+                fds = array.array('i')
+                for level, cmsg_type, data in ancdata:
+                    if level == socket.SOL_SOCKET and \
+                            cmsg_type == socket.SCM_RIGHTS:
+                        fds.frombytes(data[:len(data) - (len(data) % int_size)])
+                if not fds:
+                    continue
+
+                pid = os.fork()
+                if pid == 0:
+                    signal.set_wakeup_fd(-1)
+                    signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+                    os.close(wake_r)
+                    os.close(wake_w)
+                    ctl.close()
+                    return fds[0]
+
+                os.close(fds[0])
+                ctl.send(('PID %d' % pid).encode('utf-8'))
+        except socket.error as se:
+            if se.errno != errno.EPIPE:
+                error("Unhandled exception in plug-in zygote!\n" +
+                      traceback.format_exc())
+        sys.exit(0)
+
+    @staticmethod
+    def _reg_key(params):
+        """
+        Returns the key of a plugin_register request, sessions registered
+        with equal keys can share one plug-in instance.
+        """
+        return (params.get('uri'), params.get('password'),
+                params.get('timeout'), params.get('flags'))
+
+    @staticmethod
+    def _unregister(plugin):
+        """
+        Lets a plug-in instance clean up, ignoring its errors.
+        """
+        try:
+            plugin.plugin_unregister()
+        except Exception:
+            error("Error on plugin_unregister\n" + traceback.format_exc())
+
+    def _mux_idle_take(self, key):
+        """
+        Returns the worker of an idle plug-in instance registered with key,
+        or None.
+        """
+        with self._mux_lock:
+            for i, (_, idle_key, worker) in enumerate(self._mux_idle):
+                if idle_key == key:
+                    del self._mux_idle[i]
+                    worker.reused = True
+                    return worker
+        return None
+
+    def _mux_idle_put(self, worker):
+        """
+        Keeps the registered plug-in instance of a worker for the idle
+        timeout.
+        """
+        with self._mux_lock:
+            self._mux_idle.append(
+                (time.time() + self._mux_idle_tmo, worker.key, worker))
+        os.write(self._mux_wake_w, b'.')
+
+    def _mux_idle_expire(self, everything=False):
+        """
+        Unregisters idle plug-in instances which timed out.
+        """
+        expired = []
+        now = time.time()
+        with self._mux_lock:
+            while self._mux_idle and \
+                    (everything or self._mux_idle[0][0] <= now):
+                expired.append(self._mux_idle.pop(0)[2])
+        for worker in expired:
+            worker.post(None)
+
+    def _mux_worker(self, conn, sid, method=None, params=None):
+        """
+        Returns the worker of a session of a connection, taking an idle
+        one for plugin_register or else starting one.
+        """
+        worker = conn.sessions.get(sid)
+        if worker is None:
+            if method == 'plugin_register':
+                worker = self._mux_idle_take(
+                    PluginRunner._reg_key(params or {}))
+            if worker is None:
+                worker = _MuxWorker(self)
+                with self._mux_lock:
+                    self._mux_workers.add(worker)
+            conn.sessions[sid] = worker
+        return worker
+
+    def _mux_worker_done(self, worker):
+        with self._mux_lock:
+            self._mux_workers.discard(worker)
+
+    def _mux_batch(self, conn, msgs):
+        """
+        Hands a batch of requests, which can belong to different sessions,
+        to the workers of their sessions.
+        """
+        if not msgs:
+            conn.send(conn.tp.send_batch, [])
+            return
+
+        parts = {}
+        for (i, msg) in enumerate(msgs):
+            sid = msg.get('session') if isinstance(msg, dict) else None
+            parts.setdefault(sid, []).append(i)
+
+        batch = _MuxBatch(conn, msgs, len(parts))
+        for (sid, indices) in parts.items():
+            self._mux_worker(conn, sid).post(('batch', batch, indices))
+
+    def _mux_read(self, conn):
+        """
+        Reads the requests of a connection on a thread of its own and hands
+        them to the workers of their sessions.  A client stalling in the
+        middle of a message holds up only this thread, until it times out.
+        """
+        status = 0
+        try:
+            while True:
+                # No timeout in between requests
+                select.select([conn.tp.s], [], [])
+                msg = conn.tp.read_req()
+                if isinstance(msg, list):
+                    self._mux_batch(conn, msg)
+                    continue
+
+                sid = msg.get('session')
+                worker = self._mux_worker(conn, sid, msg['method'],
+                                          msg['params'])
+                if msg['method'] == 'plugin_unregister':
+                    del conn.sessions[sid]
+                worker.post(('request', conn, msg))
+        except (_SocketEOF, LsmError, socket.error):
+            pass
+        except Exception:
+            error("Unhandled exception in plug-in!\n" + traceback.format_exc())
+            conn.send(conn.tp.send_error, 0, ErrorNumber.PLUGIN_BUG,
+                      "Unhandled exception in plug-in",
+                      str(traceback.format_exc()))
+            status = 1 << 8
+        self._mux_close(conn, status)
+
+    def _mux_close(self, conn, status):
+        """
+        Ends a multiplexed connection, reporting it to lsmd like a zygote
+        child exit.
+        """
+        for worker in conn.sessions.values():
+            worker.post(None)
+        if conn.sessions:
+            # Client wasn't nice
+            status = 2 << 8
+        if conn.failed:
+            status = 1 << 8
+        conn.sessions = {}
+        conn.close()
+
+        with self._mux_lock:
+            del self._mux_conns[conn.number]
+            if self._mux_ctl is not None:
+                try:
+                    self._mux_ctl.send(
+                        ('EXIT %d %d' % (conn.number, status)).encode('utf-8'))
+                except socket.error:
+                    pass
+        os.write(self._mux_wake_w, b'.')
+
+    def _mux_run(self):
+        """
+        Serves every client connection lsmd hands over the control socket in
+        this process, so that expensive connections to the storage array
+        are set up once.  Each connection is read by a thread of its own
+        and can carry several logical sessions, told apart by the optional
+        'session' member of requests.  Each session gets a worker thread
+        with its own plug-in instance and plugin_register state, so a slow
+        call holds up only its own session.  On plugin_unregister an
+        instance is kept for the idle timeout and handed to the next
+        session registering with the same URI, password, timeout and flags.
+        """
+        ctl = socket.fromfd(self._mux_ctl_fd, socket.AF_UNIX,
+                            socket.SOCK_SEQPACKET)
+        os.close(self._mux_ctl_fd)
+
+        if not hasattr(ctl, 'recvmsg'):
+            # Python 2 has no recvmsg(), lsmd will fork and exec instead.
+            error('Plug-in session multiplexing needs socket.recvmsg(), '
+                  'exiting')
+            sys.exit(2)
+
+        int_size = array.array('i').itemsize
+        next_conn = 1
+        self._mux_ctl = ctl
+        (self._mux_wake_r, self._mux_wake_w) = os.pipe()
+
+        try:
+            ctl.send(b'READY')
+            while True:
+                with self._mux_lock:
+                    if ctl is None and not self._mux_conns:
+                        break
+                    tmo = None
+                    if self._mux_idle:
+                        tmo = max(0, self._mux_idle[0][0] - time.time())
+
+                rlist = [self._mux_wake_r]
+                if ctl is not None:
+                    rlist.append(ctl)
+                readable = select.select(rlist, [], [], tmo)[0]
+                self._mux_idle_expire()
+                if self._mux_wake_r in readable:
+                    os.read(self._mux_wake_r, 512)
+                if ctl is None or ctl not in readable:
+                    continue
+
+                msg, ancdata, _, _ = ctl.recvmsg(16, socket.CMSG_LEN(int_size))
+                if not msg:
+                    # lsmd closed the control socket (exit or reload),
+                    # finish the connections we have.
+                    with self._mux_lock:
+                        self._mux_ctl = None
+                    ctl.close()
+                    ctl = None
+                    continue
+
+                fds = array.array('i')
+                for level, cmsg_type, data in ancdata:
+                    if level == socket.SOL_SOCKET and \
+                            cmsg_type == socket.SCM_RIGHTS:
+                        fds.frombytes(
+                            data[:len(data) - (len(data) % int_size)])
+                if not fds:
+                    continue
+
+                s = socket.fromfd(fds[0], socket.AF_UNIX, socket.SOCK_STREAM)
+                os.close(fds[0])
+                conn = _MuxConn(s, next_conn)
+                with self._mux_lock:
+                    self._mux_conns[next_conn] = conn
+                    ctl.send(('PID %d' % next_conn).encode('utf-8'))
+                next_conn += 1
+                conn.thread = threading.Thread(target=self._mux_read,
+                                               args=(conn,))
+                conn.thread.daemon = True
+                conn.thread.start()
+        except socket.error as se:
+            if se.errno != errno.EPIPE:
+                error("Unhandled exception in plug-in!\n" +
+                      traceback.format_exc())
+        finally:
+            with self._mux_lock:
+                self._mux_ctl = None
+                conns = list(self._mux_conns.values())
+            for conn in conns:
+                conn.shutdown()
+            for conn in conns:
+                conn.thread.join()
+            self._mux_idle_expire(True)
+            with self._mux_lock:
+                workers = list(self._mux_workers)
+            for worker in workers:
+                worker.join()
+        sys.exit(0)
+
     def __init__(self, plugin, args):
         self.cmdline = False
+        self.plugin = None
+        self._mux_ctl_fd = -1
+        self._mux_idle_tmo = 0
+        # Guards the control socket and the connections, idle instances and
+        # workers below, which threads of connections and workers change.
+        self._mux_lock = threading.Lock()
+        self._mux_ctl = None
+        (self._mux_wake_r, self._mux_wake_w) = (-1, -1)
+        # (expiry time, plugin_register key, _MuxWorker)
+        self._mux_idle = []
+        # Connection number -> _MuxConn
+        self._mux_conns = {}
+        self._mux_workers = set()
+        self._sub = None
+
+        if len(args) == 4 and args[1] == PluginRunner.MUX_ARG and \
+                PluginRunner._is_number(args[2]) and \
+                PluginRunner._is_number(args[3]):
+            # Plug-in instances are created per session
+            self.plugin = plugin
+            self._mux_ctl_fd = int(args[2])
+            self._mux_idle_tmo = int(args[3])
+            return
+
+        if len(args) == 3 and args[1] == PluginRunner.ZYGOTE_ARG and \
+                PluginRunner._is_number(args[2]):
+            args = [args[0], str(PluginRunner._zygote(int(args[2])))]
+
         if len(args) == 2 and PluginRunner._is_number(args[1]):
             try:
                 fd = int(args[1])
@@ -81,11 +1006,29 @@ def __init__(self, plugin, args):
             self.cmdline = True
             cmd_line_wrapper(plugin)
 
+    def _sub_wait(self):
+        """
+        Waits for the next request while sending the events of the
+        subscription.  Returns True when a request is there to read.
+        """
+        rlist = [self.tp.s]
+        if self._sub.fd() is not None:
+            rlist.append(self._sub.fd())
+        readable = select.select(rlist, [], [], self._sub.timeout())[0]
+        if self.tp.s in readable:
+            return True
+        for event in self._sub.check(bool(readable)):
+            self.tp.send_event(event)
+        return False
+
     def run(self):
         # Don't need to invoke this when running stand alone as a cmdline
         if self.cmdline:
             return
 
+        if self._mux_ctl_fd >= 0:
+            self._mux_run()
+
         need_shutdown = False
         msg_id = 0
 
@@ -94,20 +1037,32 @@ def run(self):
                 try:
                     # result = None
 
+                    if self._sub is not None and not self._sub_wait():
+                        continue
+
                     msg = self.tp.read_req()
 
+                    if isinstance(msg, list):
+                        self.tp.send_batch(
+                            _batch_run([self.plugin] * len(msg), msg))
+                        continue
+
                     method = msg['method']
                     msg_id = msg['id']
                     params = msg['params']
 
                     # Check to see if this plug-in implements this operation
                     # if not return the expected error.
-                    if hasattr(self.plugin, method):
-                        if params is None:
-                            result = getattr(self.plugin, method)()
-                        else:
-                            result = getattr(self.plugin, method)(
-                                **msg['params'])
+                    if method == 'subscribe':
+                        self._sub = _Subscription(self.plugin, params)
+                        result = None
+                    elif method == 'unsubscribe':
+                        self._sub = None
+                        result = None
+                    elif hasattr(self.plugin, method):
+                        result = _call(self.plugin, method, params)
+                        if method == 'plugin_register':
+                            result = _FEATURES
                     else:
                         raise LsmError(ErrorNumber.NO_SUPPORT,
                                        "Unsupported operation")
@@ -0,0 +1,165 @@
+# Copyright (C) 2026 Red Hat, Inc.
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; If not, see <http://www.gnu.org/licenses/>.
+
+import threading
+
+from lsm._data import AccessGroup
+
+
+class _RecordSet(object):
+    """
+    Records of a list reply, looked up by id and by the ids they refer to.
+    Each key gets its index on first use, later lookups take constant time.
+    """
+
+    def __init__(self, records):
+        self._records = list(records)
+        self._indexes = {}
+        self._lock = threading.Lock()
+
+    def __len__(self):
+        return len(self._records)
+
+    def __iter__(self):
+        return iter(self._records)
+
+    def __getitem__(self, i):
+        return self._records[i]
+
+    def _index(self, key):
+        with self._lock:
+            index = self._indexes.get(key)
+            if index is None:
+                index = {}
+                for r in self._records:
+                    # Private member, properties raise for unsupported ones
+                    values = getattr(r, '_' + key)
+                    if not isinstance(values, list):
+                        values = [values]
+                    for v in values:
+                        if v:
+                            group = index.setdefault(v, [])
+                            if not group or group[-1] is not r:
+                                group.append(r)
+                self._indexes[key] = index
+        return index
+
+    def _find(self, key, value):
+        return list(self._index(key).get(value, ()))
+
+    def find_id(self, id_):
+        """
+        Returns the record of the given id, None if there is none.
+        """
+        group = self._index('id').get(id_)
+        return group[0] if group else None
+
+
+class VolumeSet(_RecordSet):
+    """
+    lsm.VolumeSet(volumes)
+
+    Version:
+        1.10
+    Usage:
+        Indexes the lsm.Volume list of lsm.Client.volumes().  Besides
+        find_id(), looks volumes up by pool, system or VPD83, in the order
+        of the list.
+    Parameters:
+        volumes (list of lsm.Volume)
+    Returns:
+        VolumeSet, iterating over the volumes.
+    """
+
+    def find_pool_id(self, pool_id):
+        return self._find('pool_id', pool_id)
+
+    def find_system_id(self, system_id):
+        return self._find('system_id', system_id)
+
+    def find_vpd83(self, vpd83):
+        return self._find('vpd83', vpd83)
+
+
+class DiskSet(_RecordSet):
+    """
+    lsm.DiskSet(disks)
+
+    Version:
+        1.10
+    Usage:
+        Like lsm.VolumeSet for the lsm.Disk list of lsm.Client.disks(),
+        looking disks up by system or VPD83.
+    """
+
+    def find_system_id(self, system_id):
+        return self._find('system_id', system_id)
+
+    def find_vpd83(self, vpd83):
+        return self._find('vpd83', vpd83)
+
+
+class PoolSet(_RecordSet):
+    """
+    lsm.PoolSet(pools)
+
+    Version:
+        1.10
+    Usage:
+        Like lsm.VolumeSet for the lsm.Pool list of lsm.Client.pools(),
+        looking pools up by system.
+    """
+
+    def find_system_id(self, system_id):
+        return self._find('system_id', system_id)
+
+
+class AccessGroupSet(_RecordSet):
+    """
+    lsm.AccessGroupSet(access_groups)
+
+    Version:
+        1.10
+    Usage:
+        Like lsm.VolumeSet for the lsm.AccessGroup list of
+        lsm.Client.access_groups(), looking access groups up by system or
+        initiator.  A WWPN matches in any form accepted by
+        lsm.AccessGroup.initiator_id_verify().
+    """
+
+    def find_system_id(self, system_id):
+        return self._find('system_id', system_id)
+
+    def find_init_id(self, init_id):
+        (valid, init_type, std_init_id) = \
+            AccessGroup.initiator_id_verify(init_id)
+        return self._find('init_ids', std_init_id if valid else init_id)
+
+
+class FileSystemSet(_RecordSet):
+    """
+    lsm.FileSystemSet(fs)
+
+    Version:
+        1.10
+    Usage:
+        Like lsm.VolumeSet for the lsm.FileSystem list of lsm.Client.fs(),
+        looking file systems up by pool or system.
+    """
+
+    def find_pool_id(self, pool_id):
+        return self._find('pool_id', pool_id)
+
+    def find_system_id(self, system_id):
+        return self._find('system_id', system_id)
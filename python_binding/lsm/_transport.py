@@ -15,17 +15,55 @@
 # Author: tasleson
 
 import json
+import select
 import socket
 import string
 import os
+import time
 import unittest
 import threading
+from collections import deque
 
 from lsm._common import LsmError, ErrorNumber
 from lsm._common import SocketEOF as _SocketEOF
+from lsm._clib import _cbor_encode, _cbor_decode
 from lsm._data import DataDecoder as _DataDecoder
 from lsm._data import DataEncoder as _DataEncoder
 
+_DATA_ENCODER = _DataEncoder()
+
+
+if hasattr(time, 'monotonic'):
+    _now = time.monotonic
+else:
+    _now = time.time
+
+
+class _Prefetched(Exception):
+    """
+    Stops a call once its request is sent ahead by TransPort.prefetch(), or
+    taken into a batch by TransPort.batch().
+    """
+    pass
+
+
+class _SharedSocket(object):
+    """
+    Connection carrying several sessions, see TransPort.session_open().
+    """
+
+    def __init__(self):
+        # Guards reading and everything below
+        self.lock = threading.Lock()
+        # Keeps the messages of the sessions from interleaving
+        self.send_lock = threading.Lock()
+        # Session -> messages read for it by the transport of another one
+        self.stash = {}
+        self.next_session = 1
+        # Transports not closed yet
+        self.users = 1
+
+
 class TransPort(object):
     """
     Provides wire serialization by using json.  Loosely conforms to json-rpc,
@@ -33,7 +71,9 @@ class TransPort(object):
     non sax like json parsers, which are more abundant.
 
     <Zero padded 10 digit number [1..2**32] for the length followed by
-    valid json.
+    valid json.  Plug-ins listing 'cbor' in the 'encodings' of their reply to
+    plugin_register take CBOR (RFC 8949) instead, messages starting with the
+    head of a CBOR map or array rather than with ASCII.
 
     Notes:
     id field (json-rpc) is present but currently not being used.
@@ -53,26 +93,64 @@ def _read_all(self, l):
 
         data = bytearray()
         while len(data) < l:
+            self._deadline_check()
             r = self.s.recv(l - len(data))
             if not r:
                 raise _SocketEOF()
             data += r
 
-        return data.decode("utf-8")
+        return data
 
     def _send_msg(self, msg):
         """
-        Sends the json formatted message by pre-appending the length
+        Sends the json or CBOR formatted message by pre-appending the length
         first.
         """
 
         if msg is None or len(msg) < 1:
             raise ValueError("Msg argument empty")
 
+        if not isinstance(msg, bytes):
+            msg = msg.encode('utf-8')
+
         # Note: Don't catch io exceptions at this level!
-        s = str.zfill(str(len(msg)), self.HDR_LEN) + msg
+        s = str.zfill(str(len(msg)), self.HDR_LEN).encode('utf-8') + msg
         # common.Info("SEND: ", msg)
-        self.s.sendall(bytes(s.encode('utf-8')))
+        self._deadline_check()
+        if self._shared is None:
+            self.s.sendall(s)
+        else:
+            with self._shared.send_lock:
+                self.s.sendall(s)
+
+    def _dumps(self, obj):
+        """
+        Serializes a message in the encoding messages are sent in.
+        """
+        if self.cbor:
+            return _cbor_encode(obj, _DATA_ENCODER.default)
+        return json.dumps(obj, cls=_DataEncoder)
+
+    def _loads(self, data):
+        """
+        Parses a message of either encoding, a peer sending CBOR reads it
+        too.
+        """
+        if data[0] & 0x80:
+            self.cbor = True
+            return _cbor_decode(data, _DataDecoder.object_hook)
+        return json.loads(data.decode('utf-8'), cls=_DataDecoder)
+
+    def _deadline_check(self):
+        """
+        Limits blocking on the socket to the time left before the deadline.
+        """
+        if self.deadline is not None:
+            left = self.deadline - _now()
+            if left <= 0:
+                raise LsmError(ErrorNumber.TIMEOUT,
+                               "Timed out waiting for the plug-in")
+            self.s.settimeout(left)
 
     def _recv_msg(self):
         """
@@ -83,6 +161,9 @@ def _recv_msg(self):
             l = self._read_all(self.HDR_LEN)
             msg = self._read_all(int(l))
             # common.Info("RECV: ", msg)
+        except socket.timeout:
+            raise LsmError(ErrorNumber.TIMEOUT,
+                           "Timed out waiting for the plug-in")
         except socket.error as e:
             raise LsmError(ErrorNumber.TRANSPORT_COMMUNICATION,
                            "Error while reading a message from the plug-in",
@@ -91,6 +172,29 @@ def _recv_msg(self):
 
     def __init__(self, socket_descriptor):
         self.s = socket_descriptor
+        # Events which came in while waiting for a response
+        self._events = deque()
+        # [request, response] of requests sent ahead of their call, the
+        # response is None until read.  Responses come in request order.
+        self._ahead = deque()
+        self._prefetching = False
+        # (method, args, request) of the batch being collected, or None
+        self._batching = None
+        # Plug-in takes batches, told by its reply to plugin_register
+        self.batch_supported = False
+        # Messages go out in CBOR rather than json, once the plug-in listed
+        # it at registration or the other side sent it.
+        self.cbor = False
+        # Time (of _now()) to give up waiting for the plug-in, a message
+        # cut off by it leaves the transport unusable.
+        self.deadline = None
+        # Plug-in takes several sessions over one connection, told by its
+        # reply to plugin_register
+        self.sessions_supported = False
+        # Session of the requests sent, None for the one of the connection
+        self.session = None
+        # _SharedSocket once other sessions use the connection too
+        self._shared = None
 
     @staticmethod
     def get_socket(path):
@@ -118,25 +222,64 @@ def get_socket(path):
 
     def close(self):
         """
-        Closes the transport and the underlying socket
+        Closes the transport and the underlying socket, once no other
+        session uses it
         """
+        if self._shared is not None:
+            with self._shared.lock:
+                self._shared.stash.pop(self.session, None)
+                self._shared.users -= 1
+                if self._shared.users:
+                    return
         self.s.close()
 
-    def send_req(self, method, args):
+    def session_open(self):
         """
-        Sends a request given a method and arguments.
-        Note: arguments must be in the form that can be automatically
-        serialized to json
+        Returns a transport for another session over the connection of this
+        one, for plug-ins which take several sessions per connection.  Each
+        session needs a plugin_register of its own, responses of other
+        sessions are kept for them while waiting for its own.
+        """
+        if self._shared is None:
+            self._shared = _SharedSocket()
+        tp = TransPort(self.s)
+        tp.deadline = self.deadline
+        tp.cbor = self.cbor
+        tp._shared = self._shared
+        with self._shared.lock:
+            tp.session = self._shared.next_session
+            self._shared.next_session += 1
+            self._shared.users += 1
+        return tp
+
+    def _request(self, method, args, msg_id=100):
+        """
+        Returns a request of the session of this transport.
         """
+        msg = {'method': method, 'id': msg_id, 'params': args}
+        if self.session is not None:
+            msg['session'] = self.session
+        return msg
+
+    def _send_req_msg(self, data):
         try:
-            msg = {'method': method, 'id': 100, 'params': args}
-            data = json.dumps(msg, cls=_DataEncoder)
             self._send_msg(data)
+        except socket.timeout:
+            raise LsmError(ErrorNumber.TIMEOUT,
+                           "Timed out waiting for the plug-in")
         except socket.error as se:
             raise LsmError(ErrorNumber.TRANSPORT_COMMUNICATION,
                            "Error while sending a message to the plug-in",
                            str(se))
 
+    def send_req(self, method, args):
+        """
+        Sends a request given a method and arguments.
+        Note: arguments must be in the form that can be automatically
+        serialized to json
+        """
+        self._send_req_msg(self._dumps(self._request(method, args)))
+
     def read_req(self):
         """
         Reads a message and returns the parsed version of it.
@@ -144,42 +287,228 @@ def read_req(self):
         data = self._recv_msg()
         if len(data):
             # common.Info(str(data))
-            return json.loads(data, cls=_DataDecoder)
+            return self._loads(data)
 
     def rpc(self, method, args):
         """
-        Sends a request and waits for a response.
+        Sends a request and waits for a response.  If the same request was
+        sent ahead by prefetch(), its response is returned instead.
         """
-        self.send_req(method, args)
-        (reply, msg_id) = self.read_resp()
+        data = self._dumps(self._request(method, args))
+
+        if self._batching is not None:
+            self._batching.append((method, args, data))
+            raise _Prefetched()
+
+        if self._prefetching:
+            self._send_req_msg(data)
+            self._ahead.append([data, None])
+            raise _Prefetched()
+
+        ahead = next((a for a in self._ahead if a[0] == data), None)
+        if ahead is not None:
+            self._read_ahead(ahead)
+            self._ahead.remove(ahead)
+            resp = ahead[1]
+        else:
+            self._send_req_msg(data)
+            self._read_ahead()
+            resp = self._read_reply()
+
+        (reply, msg_id) = TransPort._reply_result(resp)
         assert msg_id == 100
         return reply
 
-    def send_error(self, msg_id, error_code, msg, data=None):
+    def prefetch(self, call, *args, **kwargs):
+        """
+        Runs call up to its first request on this transport and sends that
+        request without waiting for the response, so that independent reads
+        can be pipelined.  Whatever call does before the request is done
+        again when it is called for real, exceptions raised by it are passed
+        on.
+        """
+        self._prefetching = True
+        try:
+            call(*args, **kwargs)
+        except _Prefetched:
+            pass
+        finally:
+            self._prefetching = False
+
+    def batch(self, calls):
+        """
+        Runs each (call, args) of calls up to its first request like
+        prefetch(), but sends all the requests in one message the plug-in
+        answers with one message, working on them concurrently if it can.
+        Plug-ins not taking batches get the requests pipelined instead.
+        """
+        if not self.batch_supported:
+            for (call, args) in calls:
+                self.prefetch(call, *args)
+            return
+
+        self._batching = []
+        try:
+            for (call, args) in calls:
+                try:
+                    call(*args)
+                except _Prefetched:
+                    pass
+            requests = self._batching
+        finally:
+            self._batching = None
+
+        if not requests:
+            return
+        self._send_req_msg(self._dumps(
+            [self._request(m, a, i)
+             for (i, (m, a, _)) in enumerate(requests)]))
+
+        self._read_ahead()
+        replies = self._read_reply()
+        if not isinstance(replies, list):
+            TransPort._reply_result(replies)
+        if len(replies) != len(requests):
+            raise LsmError(ErrorNumber.PLUGIN_BUG,
+                           "Plug-in replied to %d of %d batched requests" %
+                           (len(replies), len(requests)))
+        for ((_, _, data), reply) in zip(requests, replies):
+            reply['id'] = 100
+            self._ahead.append([data, reply])
+
+    def prefetch_drain(self):
+        """
+        Reads and drops the responses of prefetched requests which were not
+        asked for.
+        """
+        self._read_ahead()
+        self._ahead.clear()
+
+    def _read_ahead(self, until=None):
+        """
+        Reads the responses of requests sent ahead, up to the given one or
+        all of them.
+        """
+        for a in self._ahead:
+            if a[1] is None:
+                a[1] = self._read_reply()
+            if a is until:
+                break
+
+    def send_error(self, msg_id, error_code, msg, data=None, session=None):
         """
         Used to transmit an error.
         """
         e = {'id': msg_id, 'error': {'code': error_code, 'message': msg,
                                      'data': data}}
-        self._send_msg(json.dumps(e, cls=_DataEncoder))
+        if session is not None:
+            e['session'] = session
+        self._send_msg(self._dumps(e))
 
-    def send_resp(self, result, msg_id=100):
+    def send_resp(self, result, msg_id=100, session=None):
         """
-        Used to transmit a response
+        Used to transmit a response, session is echoed back to clients
+        multiplexing several sessions over one connection.
         """
         r = {'id': msg_id, 'result': result}
-        self._send_msg(json.dumps(r, cls=_DataEncoder))
+        if session is not None:
+            r['session'] = session
+        self._send_msg(self._dumps(r))
 
-    def read_resp(self):
-        data = self._recv_msg()
-        resp = json.loads(data, cls=_DataDecoder)
+    def send_batch(self, replies):
+        """
+        Used to transmit the replies to a batch of requests, in order.
+        """
+        self._send_msg(self._dumps(replies))
+
+    def send_event(self, event, session=None):
+        """
+        Used to transmit an event of a subscription, it can come in between
+        a request and its response.
+        """
+        e = {'event': event}
+        if session is not None:
+            e['session'] = session
+        self._send_msg(self._dumps(e))
 
+    def read_event(self, timeout=None):
+        """
+        Returns the next event, or None if there was none for timeout
+        seconds.  Waits forever when timeout is None.
+        """
+        while not self._events:
+            if not self._stashed() and \
+                    not select.select([self.s], [], [], timeout)[0]:
+                return None
+            resp = self._next_msg(False)
+            if resp is None:
+                # Message of another session
+                continue
+            if 'event' in resp:
+                self._events.append(resp['event'])
+            else:
+                # Response of a request sent ahead
+                unread = next((a for a in self._ahead if a[1] is None), None)
+                if unread is not None:
+                    unread[1] = resp
+        return self._events.popleft()
+
+    def _stashed(self):
+        """
+        Returns True if messages of this session were read by another one.
+        """
+        return self._shared is not None and \
+            bool(self._shared.stash.get(self.session))
+
+    @staticmethod
+    def _msg_session(msg):
+        if isinstance(msg, list):
+            msg = msg[0] if msg else None
+        return msg.get('session') if isinstance(msg, dict) else None
+
+    def _next_msg(self, wait=True):
+        """
+        Reads the next message of the session of this transport, keeping
+        the ones of other sessions for them.  Unless wait, returns None
+        after reading one of those.
+        """
+        if self._shared is None:
+            return self._loads(self._recv_msg())
+
+        with self._shared.lock:
+            stash = self._shared.stash
+            while True:
+                if stash.get(self.session):
+                    return stash[self.session].popleft()
+                msg = self._loads(self._recv_msg())
+                session = TransPort._msg_session(msg)
+                if session == self.session:
+                    return msg
+                stash.setdefault(session, deque()).append(msg)
+                if not wait:
+                    return None
+
+    def _read_reply(self):
+        """
+        Reads the next response, queueing the events in front of it.
+        """
+        resp = self._next_msg()
+        while isinstance(resp, dict) and 'event' in resp:
+            self._events.append(resp['event'])
+            resp = self._next_msg()
+        return resp
+
+    @staticmethod
+    def _reply_result(resp):
         if 'result' in resp:
             return resp['result'], resp['id']
         else:
             e = resp['error']
             raise LsmError(**e)
 
+    def read_resp(self):
+        return TransPort._reply_result(self._read_reply())
+
 
 def _server(s):
     """
@@ -190,7 +519,12 @@ def _server(s):
     msg = srv.read_req()
 
     try:
-        while msg['method'] != 'done':
+        while isinstance(msg, list) or msg['method'] != 'done':
+            if isinstance(msg, list):
+                srv.send_batch([{'id': m['id'], 'result': m['params']}
+                                for m in msg])
+                msg = srv.read_req()
+                continue
 
             if msg['method'] == 'error':
                 srv.send_error(
@@ -260,6 +594,81 @@ def test_slow(self):
             reply, msg_id = self.client.read_resp()
             self.assertTrue(payload == reply)
 
+    def test_prefetch(self):
+        def reads(*params):
+            return [self.client.rpc('echo', p) for p in params]
+
+        self.client.prefetch(reads, 'one', 'two')
+        self.client.prefetch(self.client.rpc, 'error',
+                             {'errorcode': 100, 'errormsg': 'Prefetched'})
+        self.client.prefetch(reads, 'three')
+
+        # Requests not sent ahead wait for the ones which were
+        self.assertTrue(self.client.rpc('echo', 'four') == 'four')
+        self.assertTrue(reads('one', 'two', 'three') ==
+                        ['one', 'two', 'three'])
+        self.assertRaises(LsmError, self.client.rpc, 'error',
+                          {'errorcode': 100, 'errormsg': 'Prefetched'})
+
+        self.client.prefetch(reads, 'five')
+        self.client.prefetch_drain()
+        self.assertTrue(self.client.rpc('echo', 'five') == 'five')
+
+    def test_batch(self):
+        def reads(*params):
+            return [self.client.rpc('echo', p) for p in params]
+
+        calls = [(reads, ('one', 'two')), (self.client.rpc, ('echo', 3))]
+
+        # Pipelined one request at a time
+        self.client.batch(calls)
+        self.assertTrue(reads('one', 'two') == ['one', 'two'])
+        self.assertTrue(self.client.rpc('echo', 3) == 3)
+
+        # One message each way, in front of which prefetched ones come
+        self.client.batch_supported = True
+        self.client.prefetch(reads, 'zero')
+        self.client.batch(calls)
+        self.assertTrue(self.client.rpc('echo', 3) == 3)
+        self.assertTrue(reads('zero', 'one', 'two') == ['zero', 'one', 'two'])
+        self.assertFalse(self.client._ahead)
+
+    def test_cbor(self):
+        params = {'class': 'Disk', 'id': 'DISK_1', 'name': 'Disk \u00e9 "1"',
+                  'disk_type': 11, 'block_size': 512,
+                  'num_of_blocks': 2 ** 64 - 1, 'status': 2,
+                  'plugin_data': None, 'system_id': 'sim-01',
+                  'location': 'bay 1', 'rpm': 7200, 'link_type': -1,
+                  'vpd83': ''}
+
+        # The server answers in the encoding it was asked in
+        self.client.cbor = True
+        disk = self.client.rpc('echo', params)
+        self.assertTrue(disk.name == params['name'])
+        self.assertTrue(disk.num_of_blocks == 2 ** 64 - 1)
+        self.assertTrue(disk.link_type == -1)
+        self.assertTrue(self.client.rpc('echo', [b'\x00\xff', -1.5, None]) ==
+                        [b'\x00\xff', -1.5, None])
+
+        self.client.cbor = False
+        self.assertTrue(self.client.rpc('echo', params).name == params['name'])
+
+    def test_deadline(self):
+        self.client.deadline = _now() - 1
+        self.assertRaises(LsmError, self.client.rpc, 'echo', 'late')
+
+        # Nothing is coming
+        self.client.deadline = _now() + 0.2
+        try:
+            self.client.read_resp()
+            self.assertTrue(False)
+        except LsmError as le:
+            self.assertTrue(le.code == ErrorNumber.TIMEOUT)
+
+        self.client.deadline = _now() + 10
+        self.assertTrue(self.client.rpc('echo', 'in time') == 'in time')
+        self.client.deadline = None
+
     def tearDown(self):
         self.client.send_req("done", None)
         resp, msg_id = self.client.read_resp()
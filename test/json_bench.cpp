@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures in GB/s how fast list replies are tokenized: by jsmn_parse()
+ * alone, growing its token array until it fits as the library used to, and
+ * by the structural index with each kernel the CPU runs, first pass alone
+ * and whole.  Tokens of the index are checked against the ones of jsmn.
+ * Besides volumes and disks it tokenizes an array of small numbers, more
+ * tokens than jsmn expects, which it parses thrice.
+ *
+ * Usage: json_bench [records] [rounds]
+ */
+
+#define JSMN_HEADER
+#define JSMN_PARENT_LINKS
+#include "jsmn.h"
+#include "lsm_json_index.hpp"
+#include "lsm_schema.hpp"
+#include <inttypes.h>
+#include <libstoragemgmt/libstoragemgmt_plug_interface.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *what, size_t bytes, int rounds,
+                   double elapsed) {
+    printf("    %s: %.2f GB/s\n", what, bytes * (double)rounds / elapsed / 1e9);
+}
+
+/* Tokenizes like the library did before the index. */
+static int jsmn_tokenize(const std::string &json, jsmntok_t **tok) {
+    size_t num_tokens = std::max(size_t(json.length() / 10), size_t(500));
+    jsmn_parser p;
+    int rc;
+
+    while (1) {
+        jsmn_init(&p);
+        *tok = (jsmntok_t *)calloc(num_tokens, sizeof(**tok));
+        rc = jsmn_parse(&p, json.c_str(), json.length(), *tok, num_tokens);
+        if (JSMN_ERROR_NOMEM != rc) {
+            return rc;
+        }
+        free(*tok);
+        num_tokens *= 2;
+    }
+}
+
+static void check(const char *what, const jsmntok_t *expected, int count,
+                  const jsmntok_t *tok, int rc) {
+    if (rc != count || memcmp(expected, tok, sizeof(*tok) * count)) {
+        fprintf(stderr, "%s: tokens differ\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void bench(const char *name, const std::string &json, int rounds) {
+    const char *kernels[] = {"avx2", "sse2", "scalar"};
+    jsmntok_t *expected = NULL;
+    jsmntok_t *tok = NULL;
+    int count = 0;
+    double start;
+
+    printf("  %s (%.1f MB):\n", name, json.size() / 1e6);
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        free(expected);
+        count = jsmn_tokenize(json, &expected);
+    }
+    report("jsmn", json.size(), rounds, now() - start);
+    if (count < 1) {
+        fprintf(stderr, "%s: jsmn failed with %d\n", name, count);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        std::string what;
+        int rc = 0;
+
+        if (!json_index_kernel_set(kernels[k])) {
+            continue;
+        }
+
+        start = now();
+        for (int i = 0; i < rounds; ++i) {
+            if (json_index_count(json.c_str(), json.size()) != count) {
+                fprintf(stderr, "%s: token count differs\n", kernels[k]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        report((what = std::string("index_") + kernels[k]).c_str(),
+               json.size(), rounds, now() - start);
+
+        start = now();
+        for (int i = 0; i < rounds; ++i) {
+            free(tok);
+            rc = json_index_tokenize(json.c_str(), json.size(), &tok);
+        }
+        report((what = std::string("tokenize_") + kernels[k]).c_str(),
+               json.size(), rounds, now() - start);
+        check(kernels[k], expected, count, tok, rc);
+    }
+    json_index_kernel_set(NULL);
+
+    free(tok);
+    free(expected);
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    std::string volumes;
+    std::string disks;
+    std::string numbers;
+    char id[32];
+    char name[64];
+    char vpd83[33];
+
+    if (!count || rounds < 1) {
+        fprintf(stderr, "Usage: %s [records] [rounds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        snprintf(id, sizeof(id), "VOL_ID_%08" PRIu32, i);
+        snprintf(name, sizeof(name), "volume \\\"%" PRIu32 "\\\"", i);
+        snprintf(vpd83, sizeof(vpd83), "600508b1001c79ade5178f06%08" PRIx32,
+                 i);
+        lsm_volume *v = lsm_volume_record_alloc(
+            id, name, vpd83, 512, 2097152 + i, LSM_VOLUME_ADMIN_STATE_ENABLED,
+            "sim-01", "POOL_ID_00001", NULL);
+
+        snprintf(id, sizeof(id), "DISK_ID_%08" PRIu32, i);
+        snprintf(name, sizeof(name), "disk %" PRIu32, i);
+        lsm_disk *d = lsm_disk_record_alloc(id, name, LSM_DISK_TYPE_SAS, 512,
+                                            1953525168, LSM_DISK_STATUS_OK,
+                                            "sim-01");
+        if (!v || !d) {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+        lsm_disk_location_set(d, "Port: 3 Box: 1 Bay: 4");
+
+        volumes += i ? ", " : "[";
+        schema_encode(volumes, VOLUME_SCHEMA, v, NULL);
+        disks += i ? ", " : "[";
+        schema_encode(disks, DISK_SCHEMA, d, NULL);
+        lsm_volume_record_free(v);
+        lsm_disk_record_free(d);
+
+        for (uint32_t n = 0; n < 64; ++n) {
+            numbers += (i || n) ? ", " : "[";
+            numbers += '0' + (i + n) % 10;
+        }
+    }
+    volumes += "]";
+    disks += "]";
+    numbers += "]";
+
+    printf("records: %" PRIu32 "\nrounds: %d\nkernel: %s\nresults:\n", count,
+           rounds, json_index_kernel());
+    bench("Volume", volumes, rounds);
+    bench("Disk", disks, rounds);
+    bench("Numbers", numbers, rounds);
+    return EXIT_SUCCESS;
+}
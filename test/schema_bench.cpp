@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures how many records per second go through the record converters,
+ * comparing the Value tree path (record -> Value -> JSON and back, as the
+ * converters did before the schemas) with the schema encoder and the token
+ * decoder, and the JSON of the latter with CBOR in size and speed.  It also
+ * tells what parsing a reply into a Value tree costs per record, in time and
+ * in heap.
+ *
+ * Usage: schema_bench [records] [rounds]
+ */
+
+#include "lsm_ipc.hpp"
+#include "lsm_schema.hpp"
+#include <inttypes.h>
+#include <libstoragemgmt/libstoragemgmt_plug_interface.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Bytes allocated from the heap, 0 where the C library does not tell. */
+static size_t heap_used(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static void records_free(const lsm_schema &s, void **records,
+                         uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        s.record_free(records[i]);
+    }
+    free(records);
+}
+
+static std::string value_encode(const lsm_schema &s, void **records,
+                                uint32_t count) {
+    std::vector<Value> array;
+    for (uint32_t i = 0; i < count; ++i) {
+        array.push_back(schema_to_value(s, records[i], NULL));
+    }
+    Value v(array);
+    return Payload::serialize(v);
+}
+
+static uint32_t value_decode(const lsm_schema &s, const std::string &json) {
+    Value v = Payload::deserialize(json);
+    std::vector<Value> array = v.asArray();
+    for (size_t i = 0; i < array.size(); ++i) {
+        s.record_free(schema_from_value(s, array[i]));
+    }
+    return array.size();
+}
+
+static std::string direct_encode(const lsm_schema &s, void **records,
+                                 uint32_t count, Payload::encoding e) {
+    std::string out;
+    schema_array_encode(out, s, records, count, NULL, e);
+    return out;
+}
+
+static uint32_t direct_decode(const lsm_schema &s, const std::string &msg) {
+    Message m;
+    void **records = NULL;
+    uint32_t count = 0;
+
+    m.parse(msg);
+    if (schema_array_decode(s, m, 0, &records, &count) != LSM_ERR_OK) {
+        fprintf(stderr, "%s: decode failed\n", s.class_name);
+        exit(EXIT_FAILURE);
+    }
+    records_free(s, records, count);
+    return count;
+}
+
+static void report(const char *what, uint32_t records, int rounds,
+                   double elapsed) {
+    printf("    %s: %.0f records/s\n", what, records * rounds / elapsed);
+}
+
+static void bench(const lsm_schema &s, void **records, uint32_t count,
+                  int rounds) {
+    std::string json;
+    std::string direct;
+    std::string cbor;
+    double start;
+
+    printf("  %s:\n", s.class_name);
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        json = value_encode(s, records, count);
+    }
+    report("value_encode", count, rounds, now() - start);
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        direct = direct_encode(s, records, count, Payload::JSON);
+    }
+    report("direct_encode", count, rounds, now() - start);
+
+    /* Value objects keep their keys sorted, compare through one. */
+    Value canonical = Payload::deserialize(direct);
+    if (Payload::serialize(canonical) != json) {
+        fprintf(stderr, "%s: encoders differ\n", s.class_name);
+        exit(EXIT_FAILURE);
+    }
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        value_decode(s, json);
+    }
+    report("value_decode", count, rounds, now() - start);
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        Value tree = Payload::deserialize(json);
+    }
+    printf("    value_parse: %.0f ns/record\n",
+           (now() - start) * 1e9 / ((double)count * rounds));
+
+    size_t heap = heap_used();
+    Value tree = Payload::deserialize(json);
+    printf("    value_heap: %.1f bytes/record\n",
+           (double)(heap_used() - heap) / count);
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        if (direct_decode(s, json) != count) {
+            fprintf(stderr, "%s: record count differs\n", s.class_name);
+            exit(EXIT_FAILURE);
+        }
+    }
+    report("direct_decode", count, rounds, now() - start);
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        cbor = direct_encode(s, records, count, Payload::CBOR);
+    }
+    report("cbor_encode", count, rounds, now() - start);
+
+    Value decoded = Payload::deserialize(cbor);
+    if (Payload::serialize(decoded) != json) {
+        fprintf(stderr, "%s: CBOR differs\n", s.class_name);
+        exit(EXIT_FAILURE);
+    }
+
+    start = now();
+    for (int i = 0; i < rounds; ++i) {
+        if (direct_decode(s, cbor) != count) {
+            fprintf(stderr, "%s: record count differs\n", s.class_name);
+            exit(EXIT_FAILURE);
+        }
+    }
+    report("cbor_decode", count, rounds, now() - start);
+
+    printf("    json_size: %.1f bytes/record\n", (double)direct.size() / count);
+    printf("    cbor_size: %.1f bytes/record\n", (double)cbor.size() / count);
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    void **volumes = (void **)calloc(count, sizeof(void *));
+    void **disks = (void **)calloc(count, sizeof(void *));
+    char id[32];
+    char name[64];
+    char vpd83[33];
+
+    if (!count || rounds < 1 || !volumes || !disks) {
+        fprintf(stderr, "Usage: %s [records] [rounds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        snprintf(id, sizeof(id), "VOL_ID_%08" PRIu32, i);
+        snprintf(name, sizeof(name), "volume %" PRIu32, i);
+        snprintf(vpd83, sizeof(vpd83), "600508b1001c79ade5178f06%08" PRIx32,
+                 i);
+        volumes[i] = lsm_volume_record_alloc(
+            id, name, vpd83, 512, 2097152 + i, LSM_VOLUME_ADMIN_STATE_ENABLED,
+            "sim-01", "POOL_ID_00001", NULL);
+
+        snprintf(id, sizeof(id), "DISK_ID_%08" PRIu32, i);
+        snprintf(name, sizeof(name), "disk %" PRIu32, i);
+        disks[i] = lsm_disk_record_alloc(id, name, LSM_DISK_TYPE_SAS, 512,
+                                         1953525168, LSM_DISK_STATUS_OK,
+                                         "sim-01");
+        if (!volumes[i] || !disks[i]) {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+        lsm_disk_location_set((lsm_disk *)disks[i], "Port: 3 Box: 1 Bay: 4");
+        lsm_disk_vpd83_set((lsm_disk *)disks[i], vpd83);
+    }
+
+    printf("records: %" PRIu32 "\nrounds: %d\nresults:\n", count, rounds);
+    bench(VOLUME_SCHEMA, volumes, count, rounds);
+    bench(DISK_SCHEMA, disks, count, rounds);
+
+    records_free(VOLUME_SCHEMA, volumes, count);
+    records_free(DISK_SCHEMA, disks, count);
+    return EXIT_SUCCESS;
+}
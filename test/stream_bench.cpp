@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures how long after a list call its first and last record are
+ * decoded, receiving the whole reply before decoding it as the library used
+ * to, and decoding records while the reply arrives.  A thread plays the
+ * plug-in, sending a reply of volumes over a socket pair at a given rate, in
+ * JSON and in CBOR.
+ *
+ * Usage: stream_bench [records] [rounds] [MB/s]
+ */
+
+#include "lsm_ipc.hpp"
+#include "lsm_schema.hpp"
+#include <inttypes.h>
+#include <libstoragemgmt/libstoragemgmt_plug_interface.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Bytes the plug-in sends at once */
+#define CHUNK (64 * 1024)
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Plug-in side, answering each request with the same reply.
+ */
+struct plugin {
+    int fd;            /**< Socket */
+    std::string reply; /**< Header and payload */
+    double rate;       /**< Bytes per second */
+    int rounds;        /**< Requests to answer */
+};
+
+static void *plugin_run(void *arg) {
+    plugin *p = (plugin *)arg;
+    Transport t(p->fd);
+
+    for (int i = 0; i < p->rounds; ++i) {
+        int ec = 0;
+
+        t.msg_recv(ec);
+
+        double start = now();
+        for (size_t sent = 0; sent < p->reply.size();) {
+            size_t n = std::min((size_t)CHUNK, p->reply.size() - sent);
+            ssize_t rc = send(p->fd, p->reply.data() + sent, n, MSG_NOSIGNAL);
+
+            if (rc <= 0) {
+                return NULL;
+            }
+            sent += rc;
+
+            double wait = start + sent / p->rate - now();
+            if (wait > 0) {
+                usleep((useconds_t)(wait * 1e6));
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Decodes records as they arrive, noting when the first and last one were.
+ */
+class LSM_DLL_LOCAL TimedSink : public ElementSink {
+  public:
+    TimedSink(const lsm_schema &s) : count(0), first(0), last(0), schema(s) {}
+
+    virtual bool elements(const Message &m, int index, uint32_t n) {
+        for (uint32_t i = 0; i < n; ++i, index = m.next(index)) {
+            void *r = schema_decode(schema, m, index);
+
+            if (!r) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            schema.record_free(r);
+            if (!count++) {
+                first = now();
+            }
+        }
+        last = now();
+        return true;
+    }
+
+    uint32_t count; /**< Records decoded */
+    double first;   /**< When the first one was */
+    double last;    /**< When the last one was */
+
+  private:
+    const lsm_schema &schema;
+};
+
+static void check(const char *what, uint32_t got, uint32_t count) {
+    if (got != count) {
+        fprintf(stderr, "%s: %" PRIu32 " records instead of %" PRIu32 "\n",
+                what, got, count);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void bench(const char *name, const std::string &payload,
+                  uint32_t count, int rounds, double rate) {
+    Value params = Value(std::map<std::string, Value>());
+    double whole_first = 0;
+    double whole_last = 0;
+    double stream_first = 0;
+    double stream_last = 0;
+    pthread_t thread;
+    plugin p;
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+
+    char len[Transport::HDR_LEN + 1];
+    snprintf(len, sizeof(len), "%0*zu", Transport::HDR_LEN, payload.size());
+    p.fd = sv[1];
+    p.reply = std::string(len) + payload;
+    p.rate = rate;
+    p.rounds = 2 * rounds;
+    pthread_create(&thread, NULL, plugin_run, &p);
+
+    Ipc ipc(sv[0]);
+
+    for (int i = 0; i < rounds; ++i) {
+        Message response;
+        void **records = NULL;
+        uint32_t got = 0;
+
+        double start = now();
+        int result = ipc.rpc("volumes", params, response);
+        schema_array_decode(VOLUME_SCHEMA, response, result, &records, &got);
+        double end = now();
+
+        check("whole", got, count);
+        for (uint32_t j = 0; j < got; ++j) {
+            VOLUME_SCHEMA.record_free(records[j]);
+        }
+        free(records);
+        whole_first += end - start;
+        whole_last += end - start;
+
+        TimedSink sink(VOLUME_SCHEMA);
+        start = now();
+        ipc.rpc("volumes", params, sink);
+
+        check("stream", sink.count, count);
+        stream_first += sink.first - start;
+        stream_last += sink.last - start;
+    }
+    pthread_join(thread, NULL);
+    close(sv[1]);
+
+    printf("  %s (%.1f MB):\n", name, payload.size() / 1e6);
+    printf("    whole: first %.1f ms, last %.1f ms\n",
+           whole_first * 1e3 / rounds, whole_last * 1e3 / rounds);
+    printf("    stream: first %.1f ms, last %.1f ms\n",
+           stream_first * 1e3 / rounds, stream_last * 1e3 / rounds);
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    double rate = argc > 3 ? atof(argv[3]) : 200;
+    void **volumes = NULL;
+    char id[32];
+    char name[64];
+    char vpd83[33];
+
+    if (!count || rounds < 1 || rate <= 0) {
+        fprintf(stderr, "Usage: %s [records] [rounds] [MB/s]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    volumes = (void **)calloc(count, sizeof(void *));
+    for (uint32_t i = 0; volumes && i < count; ++i) {
+        snprintf(id, sizeof(id), "VOL_ID_%08" PRIu32, i);
+        snprintf(name, sizeof(name), "volume %" PRIu32, i);
+        snprintf(vpd83, sizeof(vpd83), "600508b1001c79ade5178f06%08" PRIx32,
+                 i);
+        volumes[i] = lsm_volume_record_alloc(
+            id, name, vpd83, 512, 2097152 + i, LSM_VOLUME_ADMIN_STATE_ENABLED,
+            "sim-01", "POOL_ID_00001", NULL);
+        if (!volumes[i]) {
+            volumes = NULL;
+        }
+    }
+    if (!volumes) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    std::string json = "{\"id\": 100, \"result\": ";
+    schema_array_encode(json, VOLUME_SCHEMA, volumes, count, NULL);
+    json += "}";
+
+    std::string cbor;
+    Payload::cborHead(cbor, 5, 2);
+    Payload::cborString(cbor, "id");
+    Payload::cborHead(cbor, 0, 100);
+    Payload::cborString(cbor, "result");
+    schema_array_encode(cbor, VOLUME_SCHEMA, volumes, count, NULL,
+                        Payload::CBOR);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        VOLUME_SCHEMA.record_free(volumes[i]);
+    }
+    free(volumes);
+
+    printf("records: %" PRIu32 "\nrounds: %d\nrate: %.0f MB/s\nresults:\n",
+           count, rounds, rate);
+    bench("Volume json", json, count, rounds, rate * 1e6);
+    bench("Volume cbor", cbor, count, rounds, rate * 1e6);
+    return EXIT_SUCCESS;
+}
@@ -268,6 +268,16 @@ function lsm_test_base_install
         "${LSM_TEST_BIN_DIR}/plugin_test.py"
     _good install "${build_dir}/test/cmdtest.py" \
         "${LSM_TEST_BIN_DIR}/cmdtest.py"
+    _good install "${build_dir}/test/plugin_hotplug_test.py" \
+        "${LSM_TEST_BIN_DIR}/plugin_hotplug_test.py"
+    _good install "${build_dir}/test/targetd_test.py" \
+        "${LSM_TEST_BIN_DIR}/targetd_test.py"
+    _good install "${build_dir}/test/smispy_test.py" \
+        "${LSM_TEST_BIN_DIR}/smispy_test.py"
+    _good install "${build_dir}/test/scan_scsi_target_test.py" \
+        "${LSM_TEST_BIN_DIR}/scan_scsi_target_test.py"
+    _good install "${build_dir}/tools/udev/scan-scsi-target" \
+        "${LSM_TEST_BIN_DIR}/scan-scsi-target"
 
     _good install "${src_dir}/config/lsmd.conf" \
         "${LSM_TEST_CFG_DIR}/lsmd.conf"
@@ -419,3 +429,33 @@ function lsm_test_plugin_test_run
 
     _good $LSM_TEST_BIN_DIR/plugin_test.py -v
 }
+
+function lsm_test_plugin_hotplug_run
+{
+    export LSM_TEST_URI="$1";
+
+    _good $LSM_TEST_BIN_DIR/plugin_hotplug_test.py -v
+}
+
+# Test the targetd plugin against a mock targetd, needs python plugins
+# installed.
+function lsm_test_targetd_run
+{
+    _good $LSM_TEST_BIN_DIR/targetd_test.py -v
+}
+
+# Test the smispy plugin against a mock WBEM connection, needs python plugins
+# installed.
+function lsm_test_smispy_run
+{
+    if [ "$INCLUDE_SMISPY" == "no" ] ; then
+        return 0
+    fi
+    _good $LSM_TEST_BIN_DIR/smispy_test.py -v
+}
+
+# Test scan-scsi-target and its rescan coalescer against a fake sysfs tree.
+function lsm_test_scan_scsi_target_run
+{
+    _good $LSM_TEST_BIN_DIR/scan_scsi_target_test.py -v
+}
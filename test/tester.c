@@ -47,6 +47,7 @@ static int is_simc_plugin = 0;
 #define _URI_BUFF_SIZE            128
 
 lsm_connect *c = NULL;
+static char setup_uri[_URI_BUFF_SIZE]; /* URI of connection c */
 
 char *error(lsm_error_ptr e) {
     static char eb[1024];
@@ -199,12 +200,10 @@ void setup(void) {
     /*
      * Note: Do not use any error reporting functions in this function
      */
-    char uri[_URI_BUFF_SIZE];
-
     lsm_error_ptr e = NULL;
 
-    int rc = lsm_connect_password(plugin_to_use(uri), NULL, &c, 30000, &e,
-                                  LSM_CLIENT_FLAG_RSVD);
+    int rc = lsm_connect_password(plugin_to_use(setup_uri), NULL, &c, 30000,
+                                  &e, LSM_CLIENT_FLAG_RSVD);
 
     if (LSM_ERR_OK == rc) {
         if (getenv("LSM_DEBUG_PLUGIN")) {
@@ -2791,6 +2790,755 @@ START_TEST(test_search_disks) {
 }
 END_TEST
 
+START_TEST(test_list_fields) {
+    int rc;
+    uint32_t i = 0;
+    lsm_volume **volumes = NULL;
+    lsm_volume **partial_volumes = NULL;
+    uint32_t volume_count = 0;
+    uint32_t partial_count = 0;
+    lsm_disk **disks = NULL;
+    lsm_disk **partial_disks = NULL;
+    uint32_t disk_count = 0;
+    lsm_system **systems = NULL;
+    uint32_t system_count = 0;
+    lsm_string_list *fields = lsm_string_list_alloc(0);
+
+    lsm_pool *pool = get_test_pool(c);
+    create_volumes(c, pool, 2);
+
+    G(rc, lsm_volume_list, c, NULL, NULL, &volumes, &volume_count,
+      LSM_CLIENT_FLAG_RSVD);
+    G(rc, lsm_string_list_append, fields, "name");
+    G(rc, lsm_string_list_append, fields, "pool_id");
+    G(rc, lsm_volume_list_fields, c, NULL, NULL, fields, &partial_volumes,
+      &partial_count, LSM_CLIENT_FLAG_RSVD);
+
+    ck_assert_msg(partial_count == volume_count, "Expecting %d volumes, got %d",
+                  volume_count, partial_count);
+    for (i = 0; i < partial_count && i < volume_count; ++i) {
+        ASSERT_STR_MATCH(lsm_volume_id_get(partial_volumes[i]),
+                         lsm_volume_id_get(volumes[i]));
+        ASSERT_STR_MATCH(lsm_volume_name_get(partial_volumes[i]),
+                         lsm_volume_name_get(volumes[i]));
+        ASSERT_STR_MATCH(lsm_volume_pool_id_get(partial_volumes[i]),
+                         lsm_volume_pool_id_get(volumes[i]));
+        ASSERT_STR_MATCH(lsm_volume_system_id_get(partial_volumes[i]), "");
+        ck_assert(lsm_volume_vpd83_get(partial_volumes[i]) == NULL);
+        ck_assert(lsm_volume_block_size_get(partial_volumes[i]) == 0);
+    }
+    G(rc, lsm_volume_record_array_free, partial_volumes, partial_count);
+    G(rc, lsm_volume_record_array_free, volumes, volume_count);
+    partial_volumes = NULL;
+
+    /* Search keys apply to all the attributes, not only those asked for */
+    G(rc, lsm_volume_list_fields, c, "system_id", SYSTEM_ID, fields,
+      &partial_volumes, &partial_count, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(partial_count == volume_count, "Expecting %d volumes, got %d",
+                  volume_count, partial_count);
+    G(rc, lsm_volume_record_array_free, partial_volumes, partial_count);
+    partial_volumes = NULL;
+
+    G(rc, lsm_string_list_append, fields, "no_such_field");
+    F(rc, lsm_volume_list_fields, c, NULL, NULL, fields, &partial_volumes,
+      &partial_count, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    G(rc, lsm_string_list_free, fields);
+
+    fields = lsm_string_list_alloc(0);
+    G(rc, lsm_string_list_append, fields, "status");
+    G(rc, lsm_disk_list, c, NULL, NULL, &disks, &disk_count,
+      LSM_CLIENT_FLAG_RSVD);
+    G(rc, lsm_disk_list_fields, c, NULL, NULL, fields, &partial_disks,
+      &partial_count, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(partial_count == disk_count, "Expecting %d disks, got %d",
+                  disk_count, partial_count);
+    for (i = 0; i < partial_count && i < disk_count; ++i) {
+        ASSERT_STR_MATCH(lsm_disk_id_get(partial_disks[i]),
+                         lsm_disk_id_get(disks[i]));
+        ck_assert(lsm_disk_status_get(partial_disks[i]) ==
+                  lsm_disk_status_get(disks[i]));
+        ASSERT_STR_MATCH(lsm_disk_name_get(partial_disks[i]), "");
+        ck_assert(lsm_disk_type_get(partial_disks[i]) ==
+                  LSM_DISK_TYPE_UNKNOWN);
+        ck_assert(lsm_disk_rpm_get(partial_disks[i]) ==
+                  LSM_DISK_RPM_NO_SUPPORT);
+    }
+    G(rc, lsm_disk_record_array_free, partial_disks, partial_count);
+    G(rc, lsm_disk_record_array_free, disks, disk_count);
+    G(rc, lsm_string_list_free, fields);
+
+    /* No fields at all, only the IDs */
+    fields = lsm_string_list_alloc(0);
+    G(rc, lsm_system_list_fields, c, fields, &systems, &system_count,
+      LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(system_count == 1, "Expecting 1 system, got %d",
+                  system_count);
+    if (system_count == 1) {
+        ASSERT_STR_MATCH(lsm_system_id_get(systems[0]), SYSTEM_ID);
+        ASSERT_STR_MATCH(lsm_system_name_get(systems[0]), "");
+        ck_assert(lsm_system_status_get(systems[0]) ==
+                  LSM_SYSTEM_STATUS_UNKNOWN);
+    }
+    G(rc, lsm_system_record_array_free, systems, system_count);
+    G(rc, lsm_string_list_free, fields);
+
+    lsm_pool_record_free(pool);
+}
+END_TEST
+
+/*
+ * Waits for the event of given type about given volume, skipping others.
+ */
+static void wait_for_volume_event(lsm_connect *c, lsm_event_type type,
+                                  const char *vol_id) {
+    int rc;
+    int i = 0;
+    int found = 0;
+
+    for (i = 0; i < 20 && !found; ++i) {
+        lsm_event *event = NULL;
+
+        G(rc, lsm_event_next, c, &event, 10000, LSM_CLIENT_FLAG_RSVD);
+        ck_assert_msg(event != NULL, "No event for volume %s", vol_id);
+        if (event == NULL) {
+            break;
+        }
+        if (lsm_event_class_get(event) == LSM_EVENT_CLASS_VOLUME &&
+            strcmp(lsm_event_id_get(event), vol_id) == 0) {
+            ck_assert_msg(lsm_event_type_get(event) == type,
+                          "Expecting event %d, got %d", type,
+                          lsm_event_type_get(event));
+            ck_assert(lsm_event_volume_get(event) != NULL);
+            ck_assert(lsm_event_pool_get(event) == NULL);
+            found = 1;
+        }
+        G(rc, lsm_event_record_free, event);
+    }
+    ck_assert_msg(found, "No event for volume %s", vol_id);
+}
+
+START_TEST(test_subscribe) {
+    int rc;
+    lsm_connect *c2 = NULL;
+    lsm_error_ptr e = NULL;
+    lsm_event *event = NULL;
+    lsm_volume *vol = NULL;
+    lsm_pool **pools = NULL;
+    uint32_t count = 0;
+    char *job = NULL;
+    char *vol_id = NULL;
+    lsm_pool *pool = get_test_pool(c);
+
+    F(rc, lsm_subscribe, c, 0, 1, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_event_next, c, NULL, 0, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    ck_assert(lsm_event_fd_get(NULL) == -1);
+    ck_assert(lsm_event_fd_get(c) >= 0);
+
+    G(rc, lsm_subscribe, c, LSM_EVENT_CLASS_VOLUME | LSM_EVENT_CLASS_POOL, 1,
+      LSM_CLIENT_FLAG_RSVD);
+
+    /* Nothing changed yet */
+    G(rc, lsm_event_next, c, &event, 0, LSM_CLIENT_FLAG_RSVD);
+    ck_assert(event == NULL);
+
+    /* Changes made through another connection to the same array */
+    rc = lsm_connect_password(setup_uri, NULL, &c2, 30000, &e,
+                              LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_OK, "rc = %d (%s)", rc, error(e));
+
+    rc = lsm_volume_create(c2, pool, "subscribe", 20000000,
+                           LSM_VOLUME_PROVISION_DEFAULT, &vol, &job,
+                           LSM_CLIENT_FLAG_RSVD);
+    if (LSM_ERR_JOB_STARTED == rc) {
+        vol = wait_for_job_vol(c2, &job);
+    } else {
+        ck_assert_msg(LSM_ERR_OK == rc, "rc = %d", rc);
+    }
+    vol_id = strdup(lsm_volume_id_get(vol));
+
+    /* Requests still work while subscribed, events are kept for later */
+    G(rc, lsm_pool_list, c, NULL, NULL, &pools, &count, LSM_CLIENT_FLAG_RSVD);
+    G(rc, lsm_pool_record_array_free, pools, count);
+
+    wait_for_volume_event(c, LSM_EVENT_TYPE_CREATED, vol_id);
+
+    rc = lsm_volume_delete(c2, vol, &job, LSM_CLIENT_FLAG_RSVD);
+    if (LSM_ERR_JOB_STARTED == rc) {
+        wait_for_job(c2, &job);
+    } else {
+        ck_assert_msg(LSM_ERR_OK == rc, "rc = %d", rc);
+    }
+
+    wait_for_volume_event(c, LSM_EVENT_TYPE_DELETED, vol_id);
+
+    G(rc, lsm_unsubscribe, c, LSM_CLIENT_FLAG_RSVD);
+
+    free(vol_id);
+    G(rc, lsm_volume_record_free, vol);
+    G(rc, lsm_connect_close, c2, LSM_CLIENT_FLAG_RSVD);
+    G(rc, lsm_pool_record_free, pool);
+}
+END_TEST
+
+START_TEST(test_record_set) {
+    int rc;
+    lsm_pool **pools = NULL;
+    lsm_pool **found_pools = NULL;
+    lsm_pool *pool = NULL;
+    lsm_pool_set *pool_set = NULL;
+    lsm_volume *volumes[3] = {NULL};
+    lsm_volume **vols = NULL;
+    lsm_volume **found_vols = NULL;
+    lsm_volume *vol = NULL;
+    lsm_volume_set *vol_set = NULL;
+    lsm_access_group *group = NULL;
+    lsm_access_group **groups = NULL;
+    lsm_access_group **found_groups = NULL;
+    lsm_access_group_set *ag_set = NULL;
+    lsm_string_list *inits = NULL;
+    uint32_t count = 0;
+    uint32_t found = 0;
+    uint32_t same_system = 0;
+    uint32_t i = 0;
+
+    /* Pools from the plug-in */
+    G(rc, lsm_pool_list, c, NULL, NULL, &pools, &count, LSM_CLIENT_FLAG_RSVD);
+    ck_assert(count > 0);
+    pool_set = lsm_pool_set_alloc(pools, count);
+    ck_assert(pool_set != NULL);
+
+    for (i = 0; i < count; ++i) {
+        G(rc, lsm_pool_set_find_id, pool_set, lsm_pool_id_get(pools[i]),
+          &pool);
+        ck_assert(pool == pools[i]);
+        if (!strcmp(lsm_pool_system_id_get(pools[i]),
+                    lsm_pool_system_id_get(pools[0]))) {
+            same_system++;
+        }
+    }
+    G(rc, lsm_pool_set_find_id, pool_set, "NO_SUCH_POOL", &pool);
+    ck_assert(pool == NULL);
+    G(rc, lsm_pool_set_find_system_id, pool_set,
+      lsm_pool_system_id_get(pools[0]), &found_pools, &found);
+    ck_assert_msg(found == same_system, "found = %" PRIu32, found);
+    ck_assert(found_pools[0] == pools[0]);
+
+    F(rc, lsm_pool_set_find_id, pool_set, NULL, &pool);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    /* A set of another type is not valid */
+    F(rc, lsm_volume_set_free, (lsm_volume_set *)pool_set);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    G(rc, lsm_pool_set_free, pool_set);
+
+    /* Volumes sharing pools, one without VPD83 */
+    volumes[0] = lsm_volume_record_alloc(
+        "VOL_1", "vol 1", "600508b1001c79ade5178f0626caaa9c", 512, 100,
+        LSM_VOLUME_ADMIN_STATE_ENABLED, "sim-01", "POOL_1", NULL);
+    volumes[1] = lsm_volume_record_alloc(
+        "VOL_2", "vol 2", NULL, 512, 100, LSM_VOLUME_ADMIN_STATE_ENABLED,
+        "sim-01", "POOL_2", NULL);
+    volumes[2] = lsm_volume_record_alloc(
+        "VOL_3", "vol 3", "600508b1001c79ade5178f0626caaa9d", 512, 100,
+        LSM_VOLUME_ADMIN_STATE_ENABLED, "sim-01", "POOL_1", NULL);
+    vols = lsm_volume_record_array_alloc(3);
+    ck_assert(vols != NULL && volumes[0] && volumes[1] && volumes[2]);
+    for (i = 0; i < 3; ++i) {
+        vols[i] = volumes[i];
+    }
+
+    ck_assert(lsm_volume_set_alloc(NULL, 3) == NULL);
+    vol_set = lsm_volume_set_alloc(vols, 3);
+    ck_assert(vol_set != NULL);
+
+    G(rc, lsm_volume_set_records_get, vol_set, &found_vols, &found);
+    ck_assert(found_vols == vols && found == 3);
+    G(rc, lsm_volume_set_find_id, vol_set, "VOL_2", &vol);
+    ck_assert(vol == volumes[1]);
+    G(rc, lsm_volume_set_find_pool_id, vol_set, "POOL_1", &found_vols,
+      &found);
+    ck_assert(found == 2);
+    ck_assert(found_vols[0] == volumes[0] && found_vols[1] == volumes[2]);
+    G(rc, lsm_volume_set_find_system_id, vol_set, "sim-01", &found_vols,
+      &found);
+    ck_assert(found == 3);
+    G(rc, lsm_volume_set_find_vpd83, vol_set,
+      "600508b1001c79ade5178f0626caaa9d", &found_vols, &found);
+    ck_assert(found == 1 && found_vols[0] == volumes[2]);
+    G(rc, lsm_volume_set_find_vpd83, vol_set, "", &found_vols, &found);
+    ck_assert(found == 0 && found_vols == NULL);
+    G(rc, lsm_volume_set_free, vol_set);
+
+    /* Access groups by initiator, WWPN in another form */
+    inits = lsm_string_list_alloc(0);
+    ck_assert(inits != NULL);
+    G(rc, lsm_string_list_append, inits, "0x500A0986994B8DC5");
+    group = lsm_access_group_record_alloc("AG_1", "ag 1", inits,
+                                          LSM_ACCESS_GROUP_INIT_TYPE_WWPN,
+                                          "sim-01", NULL);
+    groups = lsm_access_group_record_array_alloc(1);
+    ck_assert(group != NULL && groups != NULL);
+    groups[0] = group;
+    ag_set = lsm_access_group_set_alloc(groups, 1);
+    ck_assert(ag_set != NULL);
+
+    G(rc, lsm_access_group_set_find_init_id, ag_set, "500a0986994b8dc5",
+      &found_groups, &found);
+    ck_assert(found == 1 && found_groups[0] == group);
+    G(rc, lsm_access_group_set_find_init_id, ag_set,
+      "iqn.1994-05.com.domain:01", &found_groups, &found);
+    ck_assert(found == 0);
+    G(rc, lsm_access_group_set_free, ag_set);
+    G(rc, lsm_string_list_free, inits);
+}
+END_TEST
+
+START_TEST(test_batch) {
+    int rc;
+    lsm_batch *b = NULL;
+    lsm_pool **pools = NULL;
+    lsm_volume **vols = NULL;
+    lsm_system **systems = NULL;
+    void **records = NULL;
+    const char *message = NULL;
+    uint32_t pool_count = 0;
+    uint32_t vol_count = 0;
+    uint32_t sys_count = 0;
+    uint32_t count = 0;
+    int round = 0;
+
+    G(rc, lsm_system_list, c, &systems, &sys_count, LSM_CLIENT_FLAG_RSVD);
+    G(rc, lsm_pool_list, c, NULL, NULL, &pools, &pool_count,
+      LSM_CLIENT_FLAG_RSVD);
+    ck_assert(pool_count > 0);
+    G(rc, lsm_volume_list, c, "pool_id", lsm_pool_id_get(pools[0]), &vols,
+      &vol_count, LSM_CLIENT_FLAG_RSVD);
+
+    b = lsm_batch_alloc();
+    ck_assert(b != NULL);
+    ck_assert(lsm_batch_count_get(b) == 0);
+
+    F(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_ALL, NULL, NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_SYSTEMS, "id", "sim-01");
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_POOLS, "id", NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+
+    G(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_SYSTEMS, NULL, NULL);
+    G(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_POOLS, NULL, NULL);
+    G(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_VOLUMES, "pool_id",
+      lsm_pool_id_get(pools[0]));
+    F(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_DISKS, "pool_id",
+      lsm_pool_id_get(pools[0]));
+    ck_assert_msg(rc == LSM_ERR_UNSUPPORTED_SEARCH_KEY, "rc = %d", rc);
+    G(rc, lsm_batch_list_add, b, LSM_MULTI_LIST_VOLUMES, "id",
+      "NO_SUCH_VOLUME");
+    ck_assert(lsm_batch_count_get(b) == 4);
+
+    /* No results before submitting */
+    F(rc, lsm_batch_result_records_get, b, 0, &records, &count);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+
+    /* Submitting again replaces the results */
+    for (round = 0; round < 2; ++round) {
+        G(rc, lsm_batch_submit, c, b, LSM_CLIENT_FLAG_RSVD);
+
+        G(rc, lsm_batch_result_error_get, b, 0, &message);
+        ck_assert(message == NULL);
+        G(rc, lsm_batch_result_records_get, b, 0, &records, &count);
+        ck_assert_msg(count == sys_count, "count = %" PRIu32, count);
+        ck_assert_str_eq(lsm_system_id_get((lsm_system *)records[0]),
+                         lsm_system_id_get(systems[0]));
+
+        G(rc, lsm_batch_result_records_get, b, 1, &records, &count);
+        ck_assert_msg(count == pool_count, "count = %" PRIu32, count);
+        G(rc, lsm_batch_result_records_get, b, 2, &records, &count);
+        ck_assert_msg(count == vol_count, "count = %" PRIu32, count);
+
+        G(rc, lsm_batch_result_records_get, b, 3, &records, &count);
+        ck_assert(records == NULL && count == 0);
+    }
+
+    F(rc, lsm_batch_result_error_get, b, 4, &message);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_batch_submit, c, b, 1);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+
+    G(rc, lsm_batch_free, b);
+    F(rc, lsm_batch_free, (lsm_batch *)pools[0]);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+
+    G(rc, lsm_system_record_array_free, systems, sys_count);
+    G(rc, lsm_pool_record_array_free, pools, pool_count);
+    if (vols) {
+        G(rc, lsm_volume_record_array_free, vols, vol_count);
+    }
+}
+END_TEST
+
+/* Records taken by list_stream_cb(), which fails once it took stop. */
+struct stream_take {
+    lsm_volume **vols;
+    uint32_t count;
+    uint32_t stop;
+};
+
+static int list_stream_cb(void *record, void *user_data) {
+    struct stream_take *t = (struct stream_take *)user_data;
+    lsm_volume *v = (lsm_volume *)record;
+
+    ck_assert_str_eq(lsm_volume_id_get(v),
+                     lsm_volume_id_get(t->vols[t->count]));
+    lsm_volume_record_free(v);
+    return (++t->count == t->stop) ? LSM_ERR_NO_MEMORY : LSM_ERR_OK;
+}
+
+START_TEST(test_list_stream) {
+    int rc;
+    lsm_pool **pools = NULL;
+    lsm_volume **vols = NULL;
+    uint32_t pool_count = 0;
+    uint32_t vol_count = 0;
+    struct stream_take t;
+
+    G(rc, lsm_pool_list, c, NULL, NULL, &pools, &pool_count,
+      LSM_CLIENT_FLAG_RSVD);
+    ck_assert(pool_count > 0);
+    create_volumes(c, pools[0], 3);
+    G(rc, lsm_volume_list, c, NULL, NULL, &vols, &vol_count,
+      LSM_CLIENT_FLAG_RSVD);
+    ck_assert(vol_count >= 3);
+
+    t.vols = vols;
+    t.count = 0;
+    t.stop = 0;
+    G(rc, lsm_list_stream, c, LSM_MULTI_LIST_VOLUMES, NULL, NULL,
+      list_stream_cb, &t, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(t.count == vol_count, "count = %" PRIu32, t.count);
+
+    /* The callback stops the list */
+    t.count = 0;
+    t.stop = 2;
+    F(rc, lsm_list_stream, c, LSM_MULTI_LIST_VOLUMES, NULL, NULL,
+      list_stream_cb, &t, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_NO_MEMORY, "rc = %d", rc);
+    ck_assert_msg(t.count == 2, "count = %" PRIu32, t.count);
+
+    /* The connection still works after it */
+    t.count = 0;
+    t.stop = 0;
+    G(rc, lsm_list_stream, c, LSM_MULTI_LIST_VOLUMES, "id",
+      lsm_volume_id_get(vols[0]), list_stream_cb, &t, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(t.count == 1, "count = %" PRIu32, t.count);
+
+    F(rc, lsm_list_stream, c, LSM_MULTI_LIST_ALL, NULL, NULL, list_stream_cb,
+      &t, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_list_stream, c, LSM_MULTI_LIST_SYSTEMS, "id", "sim-01",
+      list_stream_cb, &t, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_list_stream, c, LSM_MULTI_LIST_DISKS, "pool_id",
+      lsm_pool_id_get(pools[0]), list_stream_cb, &t, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_UNSUPPORTED_SEARCH_KEY, "rc = %d", rc);
+    F(rc, lsm_list_stream, c, LSM_MULTI_LIST_VOLUMES, NULL, NULL, NULL, &t,
+      LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_list_stream, c, LSM_MULTI_LIST_VOLUMES, NULL, NULL,
+      list_stream_cb, &t, 1);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+
+    G(rc, lsm_pool_record_array_free, pools, pool_count);
+    G(rc, lsm_volume_record_array_free, vols, vol_count);
+}
+END_TEST
+
+START_TEST(test_multi) {
+    int rc;
+    lsm_multi *m = NULL;
+    lsm_multi_result *r = NULL;
+    uint32_t seen[2][3] = {{0}};
+    uint32_t results = 0;
+    const uint64_t lists[3] = {LSM_MULTI_LIST_SYSTEMS, LSM_MULTI_LIST_POOLS,
+                               LSM_MULTI_LIST_VOLUMES};
+
+    ck_assert(lsm_multi_alloc(0, 1000) == NULL);
+    ck_assert(lsm_multi_alloc(2, 0) == NULL);
+
+    m = lsm_multi_alloc(2, 30000);
+    ck_assert(m != NULL);
+
+    F(rc, lsm_multi_array_add, NULL, setup_uri, NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_multi_array_add, m, "", NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_multi_run, m, 0, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    ck_assert(lsm_multi_pending_get(m) == 0);
+
+    G(rc, lsm_multi_array_add, m, setup_uri, NULL);
+    G(rc, lsm_multi_array_add, m, "nosuchplugin://", NULL);
+    G(rc, lsm_multi_run, m,
+      LSM_MULTI_LIST_SYSTEMS | LSM_MULTI_LIST_POOLS | LSM_MULTI_LIST_VOLUMES,
+      LSM_CLIENT_FLAG_RSVD);
+    ck_assert(lsm_multi_pending_get(m) == 6);
+
+    F(rc, lsm_multi_array_add, m, setup_uri, NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+    F(rc, lsm_multi_run, m, LSM_MULTI_LIST_ALL, LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+
+    while (lsm_multi_pending_get(m)) {
+        void **records = NULL;
+        uint32_t count = 0;
+        const char *message = NULL;
+        int array = 0;
+        int list = 0;
+
+        G(rc, lsm_multi_next, m, &r, -1);
+        ck_assert(r != NULL);
+        if (r == NULL) {
+            break;
+        }
+
+        array = strcmp(lsm_multi_result_uri_get(r), setup_uri) ? 1 : 0;
+        while (list < 3 && lists[list] != lsm_multi_result_list_get(r)) {
+            ++list;
+        }
+        ck_assert_msg(list < 3, "list = %" PRIu64,
+                      lsm_multi_result_list_get(r));
+        if (list == 3) {
+            break;
+        }
+        seen[array][list]++;
+
+        G(rc, lsm_multi_result_records_get, r, &records, &count);
+        rc = lsm_multi_result_error_get(r, &message);
+        if (array == 0) {
+            ck_assert_msg(rc == LSM_ERR_OK, "rc = %d (%s)", rc, message);
+            ck_assert(message == NULL);
+            if (lists[list] != LSM_MULTI_LIST_VOLUMES) {
+                ck_assert(count > 0);
+            }
+            if (lists[list] == LSM_MULTI_LIST_SYSTEMS && count) {
+                ck_assert(lsm_system_id_get((lsm_system *)records[0]) != NULL);
+            }
+        } else {
+            ck_assert_msg(rc != LSM_ERR_OK, "rc = %d", rc);
+            ck_assert(records == NULL && count == 0);
+        }
+
+        G(rc, lsm_multi_result_free, r);
+        r = NULL;
+        results++;
+    }
+
+    ck_assert_msg(results == 6, "results = %" PRIu32, results);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            ck_assert(seen[i][j] == 1);
+        }
+    }
+
+    /* Done, nothing more to wait for */
+    G(rc, lsm_multi_next, m, &r, -1);
+    ck_assert(r == NULL);
+
+    G(rc, lsm_multi_free, m);
+    F(rc, lsm_multi_free, NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT, "rc = %d", rc);
+}
+END_TEST
+
+/*
+ * Waits for a volume job without freeing it.
+ * @return Error code of the last job status query.
+ */
+static int wait_for_job_vol_rc(lsm_connect *c, const char *job_id,
+                               lsm_volume **vol) {
+    lsm_job_status status = LSM_JOB_INPROGRESS;
+    uint8_t pc = 0;
+    int rc = LSM_ERR_OK;
+
+    while (rc == LSM_ERR_OK && status == LSM_JOB_INPROGRESS) {
+        usleep(POLL_SLEEP);
+        rc = lsm_job_status_volume_get(c, job_id, &status, &pc, vol,
+                                       LSM_CLIENT_FLAG_RSVD);
+    }
+    return rc;
+}
+
+/*
+ * Size of the volume of the given ID, 0 when not found.
+ */
+static uint64_t volume_size_get(lsm_connect *c, const char *vol_id) {
+    int rc;
+    lsm_volume **vols = NULL;
+    uint32_t count = 0;
+    uint64_t size = 0;
+
+    G(rc, lsm_volume_list, c, "id", vol_id, &vols, &count,
+      LSM_CLIENT_FLAG_RSVD);
+    if (count == 1) {
+        size = lsm_volume_number_of_blocks_get(vols[0]) *
+               lsm_volume_block_size_get(vols[0]);
+    }
+    G(rc, lsm_volume_record_array_free, vols, count);
+    return size;
+}
+
+START_TEST(test_plugin_jobs) {
+    int rc;
+    int i;
+    int resized = 0;
+    lsm_connect *c2 = NULL;
+    lsm_error_ptr e = NULL;
+    lsm_pool *pool = NULL;
+    /* One to complete, one to fail, one to free and the ones queued when
+     * unregistering, three times as many as the runtime has workers. */
+    lsm_volume *vols[15] = {NULL};
+    lsm_volume *vol = NULL;
+    char name[64];
+    char *job = NULL;
+    char *job_del = NULL;
+    char *jobs[12] = {NULL};
+    char job_done[128];
+    lsm_job_status status;
+    uint8_t pc = 0;
+    uint8_t pc_last = 0;
+    int progressed = 0;
+    uint64_t size = 0;
+    const char *sim_time = NULL;
+
+    if (is_simc_plugin == 0) {
+        /* simc resizes volumes through jobs of the C plug-in runtime */
+        return;
+    }
+
+    pool = get_test_pool(c);
+
+    for (i = 0; i < 15; ++i) {
+        snprintf(name, sizeof(name), "job_executor_%d", i);
+        rc = lsm_volume_create(c, pool, name, 20000000,
+                               LSM_VOLUME_PROVISION_DEFAULT, &vols[i], &job,
+                               LSM_CLIENT_FLAG_RSVD);
+        if (LSM_ERR_JOB_STARTED == rc) {
+            vols[i] = wait_for_job_vol(c, &job);
+        } else {
+            ck_assert_msg(LSM_ERR_OK == rc, "rc = %d", rc);
+        }
+    }
+    size = lsm_volume_number_of_blocks_get(vols[0]) *
+           lsm_volume_block_size_get(vols[0]);
+
+    /* Progress goes up while the job runs, the volume comes on completion */
+    rc = lsm_volume_resize(c, vols[0], size * 2, &vol, &job,
+                           LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_JOB_STARTED, "rc = %d", rc);
+    ck_assert_msg(strncmp(job, "PLUG_JOB_", 9) == 0, "job = %s", job);
+    do {
+        usleep(POLL_SLEEP / 10);
+        G(rc, lsm_job_status_volume_get, c, job, &status, &pc, &vol,
+          LSM_CLIENT_FLAG_RSVD);
+        if (status == LSM_JOB_INPROGRESS) {
+            ck_assert_msg(pc >= pc_last && pc < 100, "pc = %d", pc);
+            ck_assert(vol == NULL);
+            if (pc > 0)
+                progressed = 1;
+            pc_last = pc;
+        }
+    } while (status == LSM_JOB_INPROGRESS);
+    ck_assert_msg(status == LSM_JOB_COMPLETE, "status = %d", status);
+    ck_assert_msg(pc == 100, "pc = %d", pc);
+    ck_assert(progressed);
+    ck_assert(vol != NULL);
+    ck_assert_str_eq(lsm_volume_id_get(vol), lsm_volume_id_get(vols[0]));
+    ck_assert(lsm_volume_number_of_blocks_get(vol) *
+                  lsm_volume_block_size_get(vol) ==
+              size * 2);
+    G(rc, lsm_volume_record_free, vol);
+    vol = NULL;
+
+    snprintf(job_done, sizeof(job_done), "%s", job);
+    G(rc, lsm_job_free, c, &job, LSM_CLIENT_FLAG_RSVD);
+    rc = lsm_job_status_volume_get(c, job_done, &status, &pc, &vol,
+                                   LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_NOT_FOUND_JOB, "rc = %d", rc);
+
+    /* The volume goes away before the job ends, which reports why */
+    rc = lsm_volume_resize(c, vols[1], size * 2, &vol, &job,
+                           LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_JOB_STARTED, "rc = %d", rc);
+    rc = lsm_volume_delete(c, vols[1], &job_del, LSM_CLIENT_FLAG_RSVD);
+    if (LSM_ERR_JOB_STARTED == rc) {
+        wait_for_job(c, &job_del);
+    } else {
+        ck_assert_msg(LSM_ERR_OK == rc, "rc = %d", rc);
+    }
+    rc = wait_for_job_vol_rc(c, job, &vol);
+    ck_assert_msg(rc == LSM_ERR_NOT_FOUND_VOLUME, "rc = %d", rc);
+    ck_assert(vol == NULL);
+    e = lsm_error_last_get(c);
+    ck_assert(e != NULL);
+    ck_assert(lsm_error_message_get(e) != NULL);
+    ck_assert_msg(strcmp(lsm_error_message_get(e),
+                         "Plugin didn't provide error message") != 0,
+                  "%s", lsm_error_message_get(e));
+    lsm_error_free(e);
+    e = NULL;
+    G(rc, lsm_job_free, c, &job, LSM_CLIENT_FLAG_RSVD);
+
+    /* Freeing a running job forgets it right away */
+    rc = lsm_volume_resize(c, vols[2], size * 2, &vol, &job,
+                           LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_JOB_STARTED, "rc = %d", rc);
+    snprintf(job_done, sizeof(job_done), "%s", job);
+    G(rc, lsm_job_free, c, &job, LSM_CLIENT_FLAG_RSVD);
+    ck_assert(job == NULL);
+    rc = lsm_job_status_volume_get(c, job_done, &status, &pc, &vol,
+                                   LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_NOT_FOUND_JOB, "rc = %d", rc);
+
+    /*
+     * Unregistering drops the queued jobs, the plug-in process still waits
+     * for the running ones after replying, so only some volumes are resized
+     * even after all jobs could have run three times over.
+     */
+    rc = lsm_connect_password(setup_uri, NULL, &c2, 30000, &e,
+                              LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_OK, "rc = %d (%s)", rc, error(e));
+    for (i = 0; i < 12; ++i) {
+        rc = lsm_volume_resize(c2, vols[i + 3], size * 2, &vol, &jobs[i],
+                               LSM_CLIENT_FLAG_RSVD);
+        ck_assert_msg(rc == LSM_ERR_JOB_STARTED, "rc = %d", rc);
+    }
+    G(rc, lsm_connect_close, c2, LSM_CLIENT_FLAG_RSVD);
+    sim_time = getenv("LSM_SIM_TIME");
+    usleep((sim_time ? strtod(sim_time, NULL) : 1) * 4 * 1000000);
+    for (i = 0; i < 12; ++i) {
+        if (volume_size_get(c, lsm_volume_id_get(vols[i + 3])) == size * 2)
+            resized++;
+        free(jobs[i]);
+    }
+    ck_assert_msg(resized > 0 && resized < 12, "resized = %d", resized);
+
+    for (i = 0; i < 15; ++i) {
+        if (i != 1) {
+            rc = lsm_volume_delete(c, vols[i], &job, LSM_CLIENT_FLAG_RSVD);
+            if (LSM_ERR_JOB_STARTED == rc) {
+                wait_for_job(c, &job);
+            } else {
+                ck_assert_msg(LSM_ERR_OK == rc, "rc = %d", rc);
+            }
+        }
+        G(rc, lsm_volume_record_free, vols[i]);
+    }
+    G(rc, lsm_pool_record_free, pool);
+}
+END_TEST
+
 START_TEST(test_search_access_groups) {
     int rc;
     lsm_access_group **ag = NULL;
@@ -3475,6 +4223,101 @@ START_TEST(test_local_disk_vpd83_search) {
 }
 END_TEST
 
+START_TEST(test_local_disk_index) {
+    int rc = LSM_ERR_OK;
+    lsm_local_disk_index *index = NULL;
+    lsm_string_list *disk_path_list = NULL;
+    lsm_string_list **disk_path_lists = NULL;
+    lsm_volume **volumes = NULL;
+    uint32_t volume_count = 0;
+    uint32_t i = 0;
+    lsm_error *lsm_err = NULL;
+
+    if (is_simc_plugin == 1) {
+        /* silently skip on simc, no need for duplicate test. */
+        return;
+    }
+
+    rc = lsm_local_disk_index_new(NULL, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT,
+                  "lsm_local_disk_index_new(): Expecting "
+                  "LSM_ERR_INVALID_ARGUMENT when index argument pointer "
+                  "is NULL");
+    lsm_error_free(lsm_err);
+
+    rc = lsm_local_disk_index_new(&index, NULL);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT,
+                  "lsm_local_disk_index_new(): Expecting "
+                  "LSM_ERR_INVALID_ARGUMENT when lsm_err argument pointer "
+                  "is NULL");
+    ck_assert_msg(index == NULL, "lsm_local_disk_index_new(): Expecting "
+                                 "index been set as NULL.");
+
+    ck_assert_msg(lsm_local_disk_index_free(NULL) == LSM_ERR_INVALID_ARGUMENT,
+                  "lsm_local_disk_index_free(): Expecting "
+                  "LSM_ERR_INVALID_ARGUMENT when index is NULL");
+    ck_assert_msg(lsm_local_disk_index_fd_get(NULL) == -1,
+                  "lsm_local_disk_index_fd_get(): Expecting -1 when index "
+                  "is NULL");
+
+    rc = lsm_local_disk_index_new(&index, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_OK, "lsm_local_disk_index_new(): %d", rc);
+    ck_assert_msg(lsm_err == NULL,
+                  "lsm_local_disk_index_new(): Expecting lsm_err as NULL "
+                  "when valid argument provided");
+
+    rc = lsm_local_disk_index_vpd83_search(index, INVALID_VPD83,
+                                           &disk_path_list, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_INVALID_ARGUMENT,
+                  "lsm_local_disk_index_vpd83_search(): Expecting "
+                  "LSM_ERR_INVALID_ARGUMENT when incorrect VPD83 provided");
+    ck_assert_msg(disk_path_list == NULL,
+                  "lsm_local_disk_index_vpd83_search(): Expecting "
+                  "disk_path_list been set as NULL.");
+    lsm_error_free(lsm_err);
+    lsm_err = NULL;
+
+    rc = lsm_local_disk_index_update(index, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_OK, "lsm_local_disk_index_update(): %d", rc);
+
+    rc = lsm_local_disk_index_vpd83_search(index, VALID_BUT_NOT_EXIST_VPD83,
+                                           &disk_path_list, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_OK,
+                  "lsm_local_disk_index_vpd83_search(): Expecting LSM_ERR_OK "
+                  "when valid argument provided");
+    ck_assert_msg(disk_path_list == NULL,
+                  "lsm_local_disk_index_vpd83_search(): Expecting "
+                  "disk_path_list as NULL when searching for "
+                  "VALID_BUT_NOT_EXIST_VPD83");
+
+    rc = lsm_volume_list(c, NULL, NULL, &volumes, &volume_count,
+                         LSM_CLIENT_FLAG_RSVD);
+    ck_assert_msg(rc == LSM_ERR_OK, "lsm_volume_list(): %d", rc);
+
+    /* Volumes of the simulator are not visible on this host */
+    rc = lsm_local_disk_volume_join(index, volumes, volume_count,
+                                    &disk_path_lists, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_OK, "lsm_local_disk_volume_join(): %d", rc);
+    for (i = 0; i < volume_count; ++i)
+        ck_assert_msg(disk_path_lists[i] == NULL,
+                      "lsm_local_disk_volume_join(): Expecting no disk for "
+                      "simulator volume %s",
+                      lsm_volume_id_get(volumes[i]));
+    lsm_local_disk_volume_join_free(disk_path_lists, volume_count);
+    disk_path_lists = NULL;
+
+    /* Without index, a temporary one is built */
+    rc = lsm_local_disk_volume_join(NULL, volumes, volume_count,
+                                    &disk_path_lists, &lsm_err);
+    ck_assert_msg(rc == LSM_ERR_OK, "lsm_local_disk_volume_join(): %d", rc);
+    lsm_local_disk_volume_join_free(disk_path_lists, volume_count);
+
+    lsm_volume_record_array_free(volumes, volume_count);
+    ck_assert_msg(lsm_local_disk_index_free(index) == LSM_ERR_OK,
+                  "lsm_local_disk_index_free(): Expecting LSM_ERR_OK");
+}
+END_TEST
+
 START_TEST(test_local_disk_serial_num_get) {
     int rc = LSM_ERR_OK;
     char *serial_num;
@@ -4149,6 +4992,13 @@ Suite *lsm_suite(void) {
     tcase_add_test(basic, test_search_access_groups);
     tcase_add_test(basic, test_search_disks);
     tcase_add_test(basic, test_search_volumes);
+    tcase_add_test(basic, test_list_fields);
+    tcase_add_test(basic, test_subscribe);
+    tcase_add_test(basic, test_multi);
+    tcase_add_test(basic, test_record_set);
+    tcase_add_test(basic, test_batch);
+    tcase_add_test(basic, test_list_stream);
+    tcase_add_test(basic, test_plugin_jobs);
     tcase_add_test(basic, test_search_pools);
 
     tcase_add_test(basic, test_uri_parse);
@@ -4182,6 +5032,7 @@ Suite *lsm_suite(void) {
     tcase_add_test(basic, test_volume_ident_led_on);
     tcase_add_test(basic, test_volume_ident_led_off);
     tcase_add_test(basic, test_local_disk_vpd83_search);
+    tcase_add_test(basic, test_local_disk_index);
     tcase_add_test(basic, test_local_disk_serial_num_get);
     tcase_add_test(basic, test_local_disk_vpd83_get);
     tcase_add_test(basic, test_read_cache_pct_update);
@@ -16,10 +16,15 @@
 # Author: tasleson
 #         Gris Ge <fge@redhat.com>
 
+import copy
 import os
 import sys
 import getpass
+import json
 import re
+import select
+import shlex
+import threading
 import time
 import tty
 import termios
@@ -30,7 +35,7 @@
                  Volume, JobStatus, ErrorNumber, BlockRange,
                  uri_parse, Proxy, size_human_2_size_bytes,
                  AccessGroup, FileSystem, NfsExport, TargetPort, LocalDisk,
-                 Battery)
+                 Battery, MultiClient)
 
 from lsm.lsmcli.data_display import (
     DisplayData, PlugData, out,
@@ -43,6 +48,20 @@
                              'local-disk-fault-led-on',
                              'local-disk-fault-led-off']
 
+# Commands which only query the array, batch mode sends their first request
+# ahead of the commands before them.
+_READ_COMMANDS = ['list', 'capabilities', 'plugin-info', 'volume-raid-info',
+                  'pool-member-info', 'volume-raid-create-cap',
+                  'volume-cache-info', 'access-group-volumes',
+                  'volume-access-group', 'volume-dependants',
+                  'fs-dependants', 'volume-replicate-range-block-size']
+
+# Exit code of the commands of a batch which ran fine or started a job
+_BATCH_OK = (0, ErrorNumber.JOB_STARTED)
+
+# Most arrays of --uri-file talked to at the same time
+_MULTI_WORKERS = 8
+
 if six.PY3:
     long = int
 
@@ -294,6 +313,12 @@ def _add_common_options(arg_parser, is_child=False):
         dest="%suri" % prefix,
         help='Uniform resource identifier (env LSMCLI_URI)')
 
+    arg_parser.add_argument(
+        '--uri-file', action="store", type=str, metavar='<FILE>',
+        dest="%suri_file" % prefix,
+        help='Run a query command on each array listed in FILE,\n'
+             'one "URI [PASSWORD]" per line')
+
     arg_parser.add_argument(
         '-P', '--prompt', action="store_true", dest="%sprompt" % prefix,
         help='Prompt for password (env LSMCLI_PASSWORD)')
@@ -375,6 +400,26 @@ def _add_sd_paths(lsm_obj):
     return lsm_obj
 
 
+# Stands in for stdout while the arrays of --uri-file are queried, keeping
+# what the threads querying them write apart.
+class _ThreadOutput(object):
+    def __init__(self, stdout):
+        self.stdout = stdout
+        self.local = threading.local()
+
+    def _target(self):
+        buf = getattr(self.local, 'buf', None)
+        if buf is None:
+            return self.stdout
+        return buf
+
+    def write(self, s):
+        self._target().write(s)
+
+    def flush(self):
+        self._target().flush()
+
+
 # This class represents a command line argument error
 class ArgError(Exception):
     def __init__(self, message, *args, **kwargs):
@@ -388,6 +433,21 @@ def __str__(self):
         return "%s: error: %s\n" % (os.path.basename(sys.argv[0]), self.msg)
 
 
+def _batch_json(obj):
+    """
+    Encodes the objects commands of a batch display.
+    """
+    rc = dict()
+    if hasattr(obj, '_to_dict'):
+        rc = obj._to_dict()
+    for (k, v) in vars(obj).items():
+        # Attributes added by lsmcli, like sd_paths, lack the leading '_'
+        if not k.startswith('_'):
+            rc.pop(k[1:], None)
+            rc[k] = v
+    return rc
+
+
 # Finds an item based on the id.  Each list item requires a member "id"
 # @param    l       list to search
 # @param    the_id  the id to match
@@ -1073,6 +1133,20 @@ def _check_network_host(addr):
             dict(local_disk_path_opt),
         ],
     ),
+    dict(
+        name='batch',
+        help='Run commands read one per line from standard input or a file\n'
+             'over a single connection, printing a JSON line for each',
+        optional=[
+            dict(name="--file", metavar='<FILE>',
+                 help='Read the commands from FILE'),
+            dict(name="--keep-going", action='store_true', default=False,
+                 help='Run the remaining commands after one failed'),
+            dict(name="--depth", metavar='<DEPTH>', default=8,
+                 type=_check_positive_integer,
+                 help='Number of query commands sent ahead (default 8)'),
+        ],
+    ),
 )
 
 aliases = dict(
@@ -1133,6 +1207,10 @@ def confirm_prompt(self, deleting):
         Give the user a chance to bail.
         """
         if not self.args.force:
+            if self.batch_running:
+                # Standard input may be the batch itself
+                raise ArgError("data loss operations need --force in "
+                               "batch mode")
             msg = "will" if deleting else "may"
             out("Warning: You are about to do an operation that %s cause data "
                 "to be lost!\nPress [Y|y] to continue, any other key to abort"
@@ -1151,9 +1229,15 @@ def confirm_prompt(self, deleting):
     # Tries to make the output better when it varies considerably from
     # plug-in to plug-in.
     # @param    objects    Data, first row is header all other data.
-    def display_data(self, objects):
+    # @param    prefixes   Columns to show ahead of each object, see
+    #                      DisplayData.display_data()
+    def display_data(self, objects, prefixes=None):
         display_all = False
 
+        if self.batch_data is not None:
+            self.batch_data.append(objects)
+            return
+
         if len(objects) == 0:
             return
 
@@ -1172,7 +1256,7 @@ def display_data(self, objects):
             objects, display_way=display_way, flag_human=self.args.human,
             flag_enum=self.args.enum,
             splitter=self.args.sep, flag_with_header=flag_with_header,
-            flag_dsp_all_data=display_all)
+            flag_dsp_all_data=display_all, prefixes=prefixes)
 
     def display_available_plugins(self):
         d = []
@@ -1186,16 +1270,17 @@ def display_available_plugins(self):
         self.display_data(d)
 
     @staticmethod
-    def handle_alias():
+    def handle_alias(argv):
         """
         Walk the command line argument list and build up a new command line
         with the appropriate substitutions which is then passed to argparse, so
         that we can avoid adding more sub parsers and do all argument parsing
         before the need to talk to the library
+        :param argv: command line args, without the program name
         :return copy of command line args with alias expansion:
         """
         rc = []
-        for i in sys.argv[1:]:
+        for i in argv:
             if i in aliases:
                 rc.extend(aliases[i].split(" "))
             else:
@@ -1258,7 +1343,13 @@ def cli(self):
 
         self.parser = parser
 
-        known_args = parser.parse_args(args=CmdLine.handle_alias())
+        return self._parse_args(sys.argv[1:])
+
+    # Parses a command line
+    # @param    argv    Command line arguments, without the program name
+    # @return Parsed arguments
+    def _parse_args(self, argv):
+        known_args = self.parser.parse_args(args=CmdLine.handle_alias(argv))
         # Copy child value to root.
 
         for k, v in vars(known_args).items():
@@ -2000,6 +2091,12 @@ def __init__(self):
         self.c = None
         self.parser = None
         self.unknown_args = None
+        # Set while a batch runs its commands, lists of objects they display
+        # are collected in batch_data instead of printed.
+        self.batch_running = False
+        self.batch_data = None
+        # (URI, password) of the arrays of --uri-file
+        self.arrays = None
         self.args = self.cli()
 
         self.cleanup = None
@@ -2018,6 +2115,15 @@ def __init__(self):
         if self.args.uri is not None:
             self.uri = self.args.uri
 
+        if self.args.uri_file is not None:
+            if self.args.uri is not None:
+                raise ArgError("--uri and --uri-file cannot be used together")
+            if self.args.prompt:
+                self.password = getpass.getpass()
+            self.arrays = CmdLine._uri_file_read(self.args.uri_file,
+                                                 self.password)
+            return
+
         if self.uri is None:
             # We need a valid plug-in to instantiate even if all we are trying
             # to do is list the plug-ins at the moment to keep that code
@@ -2043,6 +2149,10 @@ def __init__(self):
     # Does appropriate clean-up
     # @param    ec      The exit code
     def shutdown(self, ec=None):
+        if self.batch_running:
+            # Only ends the command, the batch goes on with the connection
+            sys.exit(ec)
+
         if self.cleanup:
             self.cleanup()
 
@@ -2057,6 +2167,10 @@ def process(self, cli=None):
         """
         if self.is_connection_free_cmd():
             self.args.func(self.args)
+        elif self.arrays is not None:
+            if cli:
+                raise ArgError("--uri-file is not supported here")
+            self.multi_process()
         else:
             if cli:
                 # Directly invoking code though a wrapper to catch unsupported
@@ -2077,6 +2191,297 @@ def process(self, cli=None):
             self.args.func(self.args)
             self.shutdown()
 
+    # Reads the arrays of --uri-file, skipping blank lines and comments.
+    # @param    path        File with a "URI [PASSWORD]" line for each array
+    # @param    password    Password of the URIs with a user name but no
+    #                       password in the file
+    # @return List of (URI, password)
+    @staticmethod
+    def _uri_file_read(path, password):
+        arrays = []
+        try:
+            with open(path) as f:
+                for (line_no, line) in enumerate(f, 1):
+                    fields = line.split()
+                    if not fields or fields[0].startswith('#'):
+                        continue
+                    if len(fields) > 2:
+                        raise ArgError("%s:%d: expecting URI [PASSWORD]" %
+                                       (path, line_no))
+                    uri = fields[0]
+                    if uri in (a[0] for a in arrays):
+                        raise ArgError("%s:%d: duplicate URI %s" %
+                                       (path, line_no, uri))
+                    has_user = uri_parse(uri)['username'] is not None
+                    if len(fields) == 2:
+                        if not has_user:
+                            raise ArgError("%s:%d: password specified with "
+                                           "no user name in uri" %
+                                           (path, line_no))
+                        arrays.append((uri, fields[1]))
+                    else:
+                        arrays.append((uri, password if has_user else None))
+        except IOError as ioe:
+            raise ArgError("unable to open %s: %s" % (path, ioe))
+
+        if not arrays:
+            raise ArgError("no URI in %s" % path)
+        return arrays
+
+    # Runs a query command on all arrays of --uri-file at the same time.
+    # Errors and plain text output are shown as each array finishes, the
+    # objects of all arrays are shown together at the end, each with the
+    # URI it came from.
+    def multi_process(self):
+        cmd = self.args.func.__name__.replace("_", "-")
+        if cmd not in _READ_COMMANDS:
+            raise ArgError("%s cannot be used with --uri-file" % cmd)
+
+        results = {}
+        rc = 0
+        stdout = sys.stdout
+        sys.stdout = _ThreadOutput(stdout)
+        try:
+            multi = MultiClient(self.arrays, _MULTI_WORKERS, self.tmo)
+            for (uri, result, error) in multi.run(self._multi_run):
+                if error is not None:
+                    ec = 4
+                    if error.code == ErrorNumber.PERMISSION_DENIED:
+                        ec = 13
+                    result = (ec, str(error), [], '')
+                (ec, msg, objects, output) = result
+                if msg:
+                    sys.stderr.write("%s: %s\n" % (uri, msg))
+                    sys.stderr.flush()
+                for line in output.splitlines():
+                    out("%s: %s" % (uri, line))
+                results[uri] = objects
+                rc = rc or ec
+        finally:
+            sys.stdout = stdout
+
+        # Lists shown by a command one after the other are merged by
+        # position, arrays keep the order of the file.
+        merged = []
+        for (uri, _) in self.arrays:
+            for (i, objects) in enumerate(results.get(uri, [])):
+                if i == len(merged):
+                    merged.append(([], []))
+                merged[i][0].extend(objects)
+                merged[i][1].extend(OrderedDict([('URI', uri)])
+                                    for o in objects)
+        for (objects, prefixes) in merged:
+            self.display_data(objects, prefixes)
+
+        if rc:
+            self.shutdown(rc)
+
+    # Runs the command of this invocation on one array of --uri-file, in a
+    # thread of its own.
+    # @param    client  Client connected to the array
+    # @return (exit code, error message, lists of objects, text output)
+    def _multi_run(self, client):
+        cli = copy.copy(self)
+        cli.c = Proxy(client)
+        cli.batch_running = True
+        cli.batch_data = []
+        sys.stdout.local.buf = six.StringIO()
+        ec = 0
+        msg = None
+        try:
+            getattr(cli, self.args.func.__name__)(self.args)
+        except ArgError as ae:
+            ec = 2
+            msg = ae.msg
+        except SystemExit as se:
+            ec = se.code or 0
+        finally:
+            output = sys.stdout.local.buf.getvalue()
+            sys.stdout.local.buf = None
+        return ec, msg, cli.batch_data, output
+
+    # Runs the commands of a batch over the connection of this invocation.
+    # Query commands are sent ahead while the commands before them run,
+    # anything else waits for all the commands before it to finish.
+    def batch(self, args):
+        if args.file:
+            try:
+                f = open(args.file)
+            except IOError as ioe:
+                raise ArgError("unable to open %s: %s" % (args.file, ioe))
+        else:
+            f = sys.stdin
+
+        # Plug-ins running lsmcli in their process have nothing to pipeline
+        pipelined = isinstance(self.c.proxied_obj, Client)
+        rc = 0
+        pending = []
+        try:
+            for (line_no, line, more) in CmdLine._batch_lines(f):
+                entry = self._batch_parse(args, line_no, line)
+                if entry is not None and entry[2] is not None:
+                    cmd = entry[2].func.__name__.replace("_", "-")
+                    if cmd not in _READ_COMMANDS:
+                        more = False
+                    elif pipelined:
+                        self._batch_prefetch(entry[2])
+                if entry is not None:
+                    pending.append(entry)
+
+                if not more or len(pending) >= args.depth:
+                    ec = self._batch_run(pending, args.keep_going, pipelined)
+                    rc = rc or ec
+                    pending = []
+                    if rc and not args.keep_going:
+                        break
+            else:
+                ec = self._batch_run(pending, args.keep_going, pipelined)
+                rc = rc or ec
+        finally:
+            self.args = args
+            if f is not sys.stdin:
+                f.close()
+
+        if rc:
+            self.shutdown(rc)
+
+    # Reads the lines of a batch as they come in.
+    # @param    f   File to read
+    # @return Generator of (line number, line, more) where more tells if the
+    #         next line is at hand already
+    @staticmethod
+    def _batch_lines(f):
+        fd = f.fileno()
+        buf = b''
+        eof = False
+        line_no = 0
+
+        while True:
+            while b'\n' not in buf and not eof:
+                data = os.read(fd, 65536)
+                eof = not data
+                buf += data
+            if not buf:
+                return
+
+            (line, _, buf) = buf.partition(b'\n')
+            line_no += 1
+            more = b'\n' in buf or (eof and len(buf) > 0) or \
+                (not eof and len(select.select([fd], [], [], 0)[0]) > 0)
+            yield line_no, line.decode('utf-8'), more
+
+    # Parses a line of a batch.
+    # @param    args        Arguments of the batch command
+    # @param    line_no     Line number
+    # @param    line        Command line
+    # @return None for an empty line, else (line number, line, arguments or
+    #         None, error)
+    def _batch_parse(self, args, line_no, line):
+        try:
+            argv = shlex.split(line, comments=True)
+        except ValueError as ve:
+            return line_no, line, None, ArgError(str(ve))
+
+        if len(argv) == 0:
+            return None
+
+        # Keeps help and usage of argparse out of the JSON lines
+        stdout = sys.stdout
+        sys.stdout = sys.stderr
+        try:
+            cmd_args = self._parse_args(argv)
+        except SystemExit as se:
+            # argparse printed why
+            return line_no, line, None, se
+        finally:
+            sys.stdout = stdout
+
+        if cmd_args.func == self.batch:
+            return line_no, line, None, ArgError("batch cannot be nested")
+        if cmd_args.uri is not None and cmd_args.uri != self.uri:
+            return line_no, line, None, ArgError(
+                "batch commands all go to %s" % self.uri)
+
+        # Options given to the batch apply to all of its commands
+        for k in ('human', 'enum', 'force', 'script', 'header', 'sep',
+                  '_async'):
+            if getattr(cmd_args, k) is None or getattr(cmd_args, k) is False:
+                setattr(cmd_args, k, getattr(args, k))
+        return line_no, line, cmd_args, None
+
+    # Sends the first request of a query command of a batch ahead.
+    # @param    cmd_args    Arguments of the command
+    def _batch_prefetch(self, cmd_args):
+        stdout = sys.stdout
+        sys.stdout = six.StringIO()
+        self.batch_running = True
+        self.batch_data = []
+        self.args = cmd_args
+        try:
+            self.c.prefetch(cmd_args.func, cmd_args)
+        except Exception:
+            # Fails again when the command runs
+            pass
+        finally:
+            sys.stdout = stdout
+            self.batch_running = False
+            self.batch_data = None
+
+    # Runs commands of a batch in order, printing a JSON line for each.
+    # @param    entries     Parsed lines from _batch_parse()
+    # @param    keep_going  Run the commands after a failed one
+    # @param    pipelined   Query commands were sent ahead
+    # @return Exit code of the first failed command, else 0
+    def _batch_run(self, entries, keep_going, pipelined):
+        rc = 0
+        for (line_no, line, cmd_args, error) in entries:
+            result = OrderedDict([('line', line_no), ('command', line)])
+            stdout = sys.stdout
+            sys.stdout = six.StringIO()
+            self.batch_running = True
+            self.batch_data = []
+            try:
+                if error is not None:
+                    raise error
+                self.args = cmd_args
+                cmd_args.func(cmd_args)
+                ec = 0
+            except ArgError as ae:
+                ec = 2
+                result['error'] = OrderedDict([('message', ae.msg)])
+            except LsmError as le:
+                ec = 4
+                if le.code == ErrorNumber.PERMISSION_DENIED:
+                    ec = 13
+                result['error'] = OrderedDict([('code', le.code),
+                                               ('message', le.msg)])
+            except SystemExit as se:
+                ec = se.code or 0
+            finally:
+                output = sys.stdout.getvalue()
+                sys.stdout = stdout
+                self.batch_running = False
+
+            result['exit_code'] = ec
+            if self.batch_data:
+                result['data'] = [o for objs in self.batch_data for o in objs]
+            if output:
+                result['output'] = output.splitlines()
+            self.batch_data = None
+            out(json.dumps(result, default=_batch_json))
+
+            if ec not in _BATCH_OK and not rc:
+                rc = ec
+                if not keep_going:
+                    break
+
+        # Requests sent ahead for commands which did not run, or which
+        # failed before sending them, would answer later commands with data
+        # from before them.
+        if pipelined:
+            self.c.prefetch_drain()
+        return rc
+
     def local_disk_list(self, args):
         local_disks = []
         func_dict = {
@@ -981,7 +981,12 @@ def display_data(objs, display_way=None,
                      extra_properties=None,
                      splitter=None,
                      flag_with_header=True,
-                     flag_dsp_all_data=False):
+                     flag_dsp_all_data=False,
+                     prefixes=None):
+        """
+        prefixes, when given, holds an OrderedDict for each object with
+        columns to show ahead of its properties.
+        """
         if len(objs) == 0:
             return None
 
@@ -993,10 +998,14 @@ def display_data(objs, display_way=None,
 
         data_dict_list = []
         if type(objs[0]) in list(DisplayData.VALUE_CONVERT.keys()):
-            for obj in objs:
+            for i, obj in enumerate(objs):
                 data_dict = DisplayData._data_dict_gen(
                     obj, flag_human, flag_enum, display_way,
                     extra_properties, flag_dsp_all_data)
+                if prefixes:
+                    prefixed = OrderedDict(prefixes[i])
+                    prefixed.update(data_dict)
+                    data_dict = prefixed
                 data_dict_list.extend([data_dict])
         else:
             return None
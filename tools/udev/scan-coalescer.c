@@ -0,0 +1,457 @@
+/*
+ * Coalescing SCSI target rescan service for scan-scsi-target
+ *
+ * Copyright (C) 2026, Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+#include "scan-coalescer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * An array changing its LUN mapping raises a REPORTED LUNS DATA HAS CHANGED
+ * unit attention on every LUN of every target it exports, and udev runs
+ * scan-scsi-target once for each of them.  Each of those scans walks the
+ * whole target and the kernel serializes the scans of one Scsi_Host, so
+ * hundreds of them queue up behind each other for what is one scan per
+ * target.
+ *
+ * Requests are "<host> <channel> <id>" datagrams.  The first request for a
+ * host opens its coalescing window, once it is over the distinct targets
+ * received for that host are written to its "scan" entry, one after the
+ * other, on a thread of their own.  Requests arriving during the scan of a
+ * host open the next window of that host, which is handled once that scan
+ * is done, so no change reported after a scan started is lost.
+ */
+
+/* First file descriptor passed by systemd, see sd_listen_fds(3) */
+#define _LISTEN_FDS_START 3
+
+#define _REQUEST_MAX_LEN 64
+
+struct _target {
+    unsigned int channel;
+    unsigned int id;
+};
+
+struct _host {
+    unsigned int no;
+    int busy;
+    uint64_t deadline;
+    struct _target *targets;
+    size_t count;
+    size_t size;
+};
+
+struct _scan_job {
+    const char *sysfs_root;
+    unsigned int host_no;
+    struct _target *targets;
+    size_t count;
+    int done_fd;
+};
+
+static uint64_t _now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int scan_coalescer_request(const char *sock_path, unsigned int host,
+                           unsigned int channel, unsigned int id) {
+    struct sockaddr_un addr;
+    char msg[_REQUEST_MAX_LEN];
+    int len;
+    int fd;
+    ssize_t sent;
+
+    if (strlen(sock_path) >= sizeof(addr.sun_path))
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sock_path);
+
+    len = snprintf(msg, sizeof(msg), "%u %u %u", host, channel, id);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    sent = sendto(fd, msg, len, MSG_DONTWAIT, (struct sockaddr *)&addr,
+                  sizeof(addr));
+    close(fd);
+    return (sent == len) ? 0 : -1;
+}
+
+static void _target_scan(const char *sysfs_root, unsigned int host_no,
+                         const struct _target *target) {
+    char path[PATH_MAX];
+    char data[_REQUEST_MAX_LEN];
+    int fd;
+    int len;
+
+    snprintf(path, sizeof(path), "%s/class/scsi_host/host%u/scan", sysfs_root,
+             host_no);
+    len = snprintf(data, sizeof(data), "%u %u -", target->channel, target->id);
+
+    /*
+     * The write returns once the kernel is done scanning the target.
+     */
+    if ((fd = open(path, O_WRONLY | O_CLOEXEC)) < 0) {
+        fprintf(stderr, "Cannot open '%s': %s\n", path, strerror(errno));
+        return;
+    }
+    if (write(fd, data, len) < 0)
+        fprintf(stderr, "Cannot write '%s' to '%s': %s\n", data, path,
+                strerror(errno));
+    close(fd);
+}
+
+static void *_scan_job_run(void *arg) {
+    struct _scan_job *job = (struct _scan_job *)arg;
+    size_t i;
+    ssize_t rc;
+
+    for (i = 0; i < job->count; ++i)
+        _target_scan(job->sysfs_root, job->host_no, &job->targets[i]);
+
+    /* Smaller than PIPE_BUF, so never interleaved with other jobs */
+    do {
+        rc = write(job->done_fd, &job->host_no, sizeof(job->host_no));
+    } while (rc < 0 && errno == EINTR);
+
+    free(job->targets);
+    free(job);
+    return NULL;
+}
+
+static int _host_scan_start(struct _host *host, const char *sysfs_root,
+                            int done_fd) {
+    struct _scan_job *job;
+    pthread_attr_t attr;
+    pthread_t tid;
+    int rc;
+
+    job = (struct _scan_job *)malloc(sizeof(struct _scan_job));
+    if (!job) {
+        fprintf(stderr, "Memory allocation failure!\n");
+        return -1;
+    }
+
+    job->sysfs_root = sysfs_root;
+    job->host_no = host->no;
+    job->targets = host->targets;
+    job->count = host->count;
+    job->done_fd = done_fd;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(&tid, &attr, _scan_job_run, job);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        fprintf(stderr, "Cannot start scan of host%u: %s\n", host->no,
+                strerror(rc));
+        free(job);
+        return -1;
+    }
+
+    host->busy = 1;
+    host->targets = NULL;
+    host->count = 0;
+    host->size = 0;
+    return 0;
+}
+
+static struct _host *_host_get(struct _host **hosts, size_t *host_count,
+                               unsigned int host_no) {
+    struct _host *tmp;
+    size_t i;
+
+    for (i = 0; i < *host_count; ++i) {
+        if ((*hosts)[i].no == host_no)
+            return &(*hosts)[i];
+    }
+
+    tmp = (struct _host *)realloc(*hosts,
+                                  sizeof(struct _host) * (*host_count + 1));
+    if (!tmp)
+        return NULL;
+
+    *hosts = tmp;
+    memset(&tmp[*host_count], 0, sizeof(struct _host));
+    tmp[*host_count].no = host_no;
+    return &tmp[(*host_count)++];
+}
+
+/*
+ * Returns 0 if the target was queued or is queued already, -1 on memory
+ * allocation failure.
+ */
+static int _target_queue(struct _host *host, unsigned int channel,
+                         unsigned int id, unsigned int window_ms) {
+    struct _target *tmp;
+    size_t i;
+
+    for (i = 0; i < host->count; ++i) {
+        if (host->targets[i].channel == channel && host->targets[i].id == id)
+            return 0;
+    }
+
+    if (host->count == host->size) {
+        size_t size = host->size ? host->size * 2 : 16;
+
+        tmp = (struct _target *)realloc(host->targets,
+                                        sizeof(struct _target) * size);
+        if (!tmp)
+            return -1;
+        host->targets = tmp;
+        host->size = size;
+    }
+
+    if (host->count == 0)
+        host->deadline = _now_ms() + window_ms;
+
+    host->targets[host->count].channel = channel;
+    host->targets[host->count].id = id;
+    host->count++;
+    return 0;
+}
+
+/*
+ * Returns the socket passed by systemd, or binds sock_path.  *bound is set
+ * when the socket file was created by us.
+ */
+static int _listen_fd_get(const char *sock_path, int *bound) {
+    const char *listen_pid = getenv("LISTEN_PID");
+    const char *listen_fds = getenv("LISTEN_FDS");
+    struct sockaddr_un addr;
+    int fd;
+
+    *bound = 0;
+
+    if (listen_pid && listen_fds &&
+        strtol(listen_pid, NULL, 10) == (long)getpid() &&
+        strtol(listen_fds, NULL, 10) >= 1) {
+        unsetenv("LISTEN_PID");
+        unsetenv("LISTEN_FDS");
+        unsetenv("LISTEN_FDNAMES");
+        fcntl(_LISTEN_FDS_START, F_SETFD, FD_CLOEXEC);
+        return _LISTEN_FDS_START;
+    }
+
+    if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path '%s' is too long\n", sock_path);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sock_path);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot create socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    unlink(sock_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Cannot bind '%s': %s\n", sock_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    /* Only root may ask for scans */
+    if (chmod(sock_path, S_IRUSR | S_IWUSR) < 0) {
+        fprintf(stderr, "Cannot chmod '%s': %s\n", sock_path, strerror(errno));
+        unlink(sock_path);
+        close(fd);
+        return -1;
+    }
+
+    *bound = 1;
+    return fd;
+}
+
+/*
+ * Queues all requests waiting on the socket.  Returns the number of
+ * requests read, -1 on error.
+ */
+static int _requests_read(int fd, struct _host **hosts, size_t *host_count,
+                          unsigned int window_ms) {
+    char msg[_REQUEST_MAX_LEN];
+    unsigned int host_no, channel, id;
+    struct _host *host;
+    ssize_t len;
+    int count = 0;
+
+    for (;;) {
+        len = recv(fd, msg, sizeof(msg) - 1, MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return count;
+            fprintf(stderr, "Cannot receive request: %s\n", strerror(errno));
+            return -1;
+        }
+
+        count++;
+        msg[len] = '\0';
+        if (sscanf(msg, "%u %u %u", &host_no, &channel, &id) != 3) {
+            fprintf(stderr, "Invalid request '%s'\n", msg);
+            continue;
+        }
+
+        host = _host_get(hosts, host_count, host_no);
+        if (!host || _target_queue(host, channel, id, window_ms) < 0) {
+            fprintf(stderr, "Memory allocation failure!\n");
+            return -1;
+        }
+    }
+}
+
+int scan_coalescer_run(const char *sock_path, const char *sysfs_root,
+                       unsigned int window_ms, unsigned int idle_timeout) {
+    struct _host *hosts = NULL;
+    size_t host_count = 0;
+    struct pollfd fds[2];
+    int done_pipe[2];
+    int bound;
+    int sock_fd;
+    int rc = 1;
+    size_t i;
+
+    sock_fd = _listen_fd_get(sock_path, &bound);
+    if (sock_fd < 0)
+        return 1;
+
+    if (pipe2(done_pipe, O_CLOEXEC) < 0) {
+        fprintf(stderr, "Cannot create pipe: %s\n", strerror(errno));
+        goto out;
+    }
+
+    fds[0].fd = sock_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = done_pipe[0];
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        uint64_t now = _now_ms();
+        int timeout = -1;
+        int idle = 1;
+        int ready;
+
+        for (i = 0; i < host_count; ++i) {
+            struct _host *host = &hosts[i];
+
+            if (host->busy) {
+                idle = 0;
+                continue;
+            }
+            if (host->count == 0)
+                continue;
+
+            idle = 0;
+            if (host->deadline <= now) {
+                if (_host_scan_start(host, sysfs_root, done_pipe[1]) < 0)
+                    goto out;
+            } else if (timeout < 0 || host->deadline - now < (uint64_t)timeout) {
+                timeout = (int)(host->deadline - now);
+            }
+        }
+
+        if (idle && idle_timeout)
+            timeout = (idle_timeout > INT_MAX / 1000) ? INT_MAX
+                                                      : (int)idle_timeout * 1000;
+
+        ready = poll(fds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "poll() failed: %s\n", strerror(errno));
+            goto out;
+        }
+
+        if (ready == 0 && idle && idle_timeout) {
+            /*
+             * Requests sent before the socket is gone would be lost, pick
+             * them up.  Once activated by systemd they stay queued on its
+             * socket until we are started again.
+             */
+            if (bound)
+                unlink(sock_path);
+            ready = _requests_read(sock_fd, &hosts, &host_count, window_ms);
+            if (ready < 0)
+                goto out;
+            if (ready == 0) {
+                bound = 0;
+                rc = 0;
+                goto out;
+            }
+            if (bound) {
+                close(sock_fd);
+                sock_fd = _listen_fd_get(sock_path, &bound);
+                if (sock_fd < 0)
+                    goto out;
+                fds[0].fd = sock_fd;
+            }
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            unsigned int host_no;
+
+            if (read(done_pipe[0], &host_no, sizeof(host_no)) ==
+                sizeof(host_no)) {
+                for (i = 0; i < host_count; ++i) {
+                    if (hosts[i].no == host_no)
+                        hosts[i].busy = 0;
+                }
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            if (_requests_read(sock_fd, &hosts, &host_count, window_ms) < 0)
+                goto out;
+        }
+    }
+
+out:
+    /* Scans still running are abandoned along with the process */
+    for (i = 0; i < host_count; ++i)
+        free(hosts[i].targets);
+    free(hosts);
+    if (bound)
+        unlink(sock_path);
+    if (sock_fd >= 0)
+        close(sock_fd);
+    return rc;
+}
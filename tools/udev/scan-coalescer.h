@@ -0,0 +1,46 @@
+/*
+ * Coalescing SCSI target rescan service for scan-scsi-target
+ *
+ * Copyright (C) 2026, Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef SCAN_COALESCER_H
+#define SCAN_COALESCER_H
+
+#define SCAN_COALESCER_SOCKET       "/run/scan-scsi-target.sock"
+#define SCAN_COALESCER_WINDOW_MS    500
+#define SCAN_COALESCER_IDLE_TIMEOUT 60
+
+/*
+ * Hands a rescan of target <host>:<channel>:<id> to the coalescer listening
+ * on the datagram socket sock_path.  Never blocks.
+ *
+ * Returns 0 if the coalescer took the request, -1 if it is not running or
+ * its queue is full and the caller has to scan the target itself.
+ */
+int scan_coalescer_request(const char *sock_path, unsigned int host,
+                           unsigned int channel, unsigned int id);
+
+/*
+ * Serves rescan requests from sock_path, or from the socket passed by
+ * systemd socket activation.  Requests for the same target received within
+ * window_ms of the first one are merged into one scan, targets of different
+ * SCSI hosts are scanned in parallel.  Returns once no request arrived for
+ * idle_timeout seconds (0 for never).
+ *
+ * Returns 0 on idle exit, 1 on error.
+ */
+int scan_coalescer_run(const char *sock_path, const char *sysfs_root,
+                       unsigned int window_ms, unsigned int idle_timeout);
+
+#endif /* SCAN_COALESCER_H */
@@ -15,6 +15,8 @@
  * General Public License for more details.
  */
 
+#include "scan-coalescer.h"
+
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
@@ -36,17 +38,54 @@
  * "/sys/devices/pseudo_0/adapter0/host3/scsi_host/host3/scan"
  *
  * Note:  Per kernel Documentation/sysfs-rules.txt, sysfs is always mounted at
- * /sys
+ * /sys, --sysfs-root is for testing against a fake sysfs tree only.
+ *
+ * When the coalescing rescan service (--daemon, socket activated by
+ * scan-scsi-target.socket) is running, the target is handed to it instead,
+ * so that a storm of unit attentions ends up in one scan per target.
  */
 
+static const char *sysfs_root = "/sys";
+
 static void __attribute__((__noreturn__)) usage(char **argv, int err) {
     fprintf(stderr, "\nUsage:\n");
-    fprintf(stderr, "%s <uevent DEVPATH of SCSI device>\n", argv[0]);
+    fprintf(stderr, "%s [options] <uevent DEVPATH of SCSI device>\n", argv[0]);
+    fprintf(stderr, "%s --daemon [options]\n", argv[0]);
     fprintf(stderr, "\nOptions:\n");
-    fprintf(stderr, "  -h, --help     display this help and exit\n");
+    fprintf(stderr, "  -d, --daemon               coalesce and run the rescans "
+                    "requested by\n"
+                    "                             other instances\n");
+    fprintf(stderr, "  -w, --window <ms>          coalescing window of "
+                    "--daemon, default %d\n",
+            SCAN_COALESCER_WINDOW_MS);
+    fprintf(stderr, "  -i, --idle-timeout <sec>   exit --daemon when idle, 0 "
+                    "for never,\n"
+                    "                             default %d\n",
+            SCAN_COALESCER_IDLE_TIMEOUT);
+    fprintf(stderr, "  -s, --socket <path>        socket of --daemon, default\n"
+                    "                             %s\n",
+            SCAN_COALESCER_SOCKET);
+    fprintf(stderr, "  -D, --direct               scan the target without "
+                    "--daemon\n");
+    fprintf(stderr, "  -S, --sysfs-root <path>    default /sys\n");
+    fprintf(stderr, "  -h, --help                 display this help and "
+                    "exit\n");
     exit(err);
 }
 
+static unsigned int number_arg(char **argv, const char *arg) {
+    char *end;
+    unsigned long val;
+
+    errno = 0;
+    val = strtoul(arg, &end, 10);
+    if (errno || end == arg || *end != '\0' || val > 24 * 3600 * 1000UL) {
+        fprintf(stderr, "Invalid number '%s'.\n", arg);
+        usage(argv, 1);
+    }
+    return (unsigned int)val;
+}
+
 static void __attribute__((__noreturn__)) invalid(char **argv, char *devpath) {
     fprintf(stderr, "Invalid DEVPATH '%s'.\n", devpath);
     usage(argv, 1);
@@ -80,13 +119,45 @@ int main(int argc, char **argv) {
 
     char *dir_str;
 
+    int run_daemon = 0;
+    int direct = 0;
+    unsigned int window_ms = SCAN_COALESCER_WINDOW_MS;
+    unsigned int idle_timeout = SCAN_COALESCER_IDLE_TIMEOUT;
+    const char *sock_path = SCAN_COALESCER_SOCKET;
+    unsigned int host_no, channel, id;
+
     static const struct option longopts[] = {
+        {"daemon", no_argument, 0, 'd'},
+        {"window", required_argument, 0, 'w'},
+        {"idle-timeout", required_argument, 0, 'i'},
+        {"socket", required_argument, 0, 's'},
+        {"direct", no_argument, 0, 'D'},
+        {"sysfs-root", required_argument, 0, 'S'},
         {"help", no_argument, 0, 'h'},
         {NULL, no_argument, 0, '0'},
     };
 
-    while ((c = getopt_long(argc, argv, "rh", longopts, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "dw:i:s:DS:h", longopts, NULL)) !=
+           -1) {
         switch (c) {
+        case 'd':
+            run_daemon = 1;
+            break;
+        case 'w':
+            window_ms = number_arg(argv, optarg);
+            break;
+        case 'i':
+            idle_timeout = number_arg(argv, optarg);
+            break;
+        case 's':
+            sock_path = optarg;
+            break;
+        case 'D':
+            direct = 1;
+            break;
+        case 'S':
+            sysfs_root = optarg;
+            break;
         case 'h':
             usage(argv, 0);
         default:
@@ -94,6 +165,13 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (run_daemon) {
+        if (optind < argc)
+            usage(argv, 1);
+        return scan_coalescer_run(sock_path, sysfs_root, window_ms,
+                                  idle_timeout);
+    }
+
     if (optind >= argc) {
         usage(argv, 1);
     }
@@ -108,13 +186,13 @@ int main(int argc, char **argv) {
         usage(argv, 1);
     }
 
-    sysfs_path = malloc(strlen("/sys") + strlen(devpath) + 1);
+    sysfs_path = malloc(strlen(sysfs_root) + strlen(devpath) + 1);
     if (!sysfs_path) {
         fprintf(stderr, "Memory allocation failure!");
         return 1;
     }
 
-    strcpy(sysfs_path, "/sys");
+    strcpy(sysfs_path, sysfs_root);
     strcat(sysfs_path, devpath);
 
     if (stat(sysfs_path, &sysfs_stat) < 0) {
@@ -153,14 +231,14 @@ int main(int argc, char **argv) {
     if (target_len <= strlen("/target"))
         invalid(argv, devpath);
 
-    sysfs_path = malloc(strlen("/sys") + strlen(devpath) - host_next_len +
+    sysfs_path = malloc(strlen(sysfs_root) + strlen(devpath) - host_next_len +
                         strlen("/scsi_host") + host_len + strlen("/scan") + 1);
     if (!sysfs_path) {
         fprintf(stderr, "Memory allocation failure!");
         return 1;
     }
 
-    strcpy(sysfs_path, "/sys");
+    strcpy(sysfs_path, sysfs_root);
     strncat(sysfs_path, devpath, host_next_pos);
     strcat(sysfs_path, "/scsi_host");
     snprintf(sysfs_path + strlen(sysfs_path), host_len + 1, "%s", host_str);
@@ -204,6 +282,18 @@ int main(int argc, char **argv) {
     strncat(sysfs_data, &devpath[target_pos + channel_pos + id_pos], id_len);
     strcat(sysfs_data, " -");
 
+    /*
+     * Let the coalescing rescan service scan the target if it is running.
+     */
+    if (!direct &&
+        sscanf(&host_str[strlen("/host")], "%u", &host_no) == 1 &&
+        sscanf(sysfs_data, "%u %u", &channel, &id) == 2 &&
+        scan_coalescer_request(sock_path, host_no, channel, id) == 0) {
+        free(sysfs_path);
+        free(sysfs_data);
+        return 0;
+    }
+
     /*
      * Tell the kernel to rescan the SCSI target for new LUNs.
      */